@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Decode a bridge binary trace dump into a timeline.
+
+The input is a console log containing the output of "bridge trace dump"
+(the hex lines between TRACE BEGIN and TRACE END) or a raw binary image
+retrieved through the DiagnosticLogs cluster, which starts with a block of
+bridge counters followed by the trace.
+"""
+
+import argparse
+import struct
+import sys
+
+COUNTERS_HEADER = struct.Struct('<4sBBH')
+HEADER = struct.Struct('<4sBBBBI')
+RING_HEADER = struct.Struct('<16sII')
+RECORD = struct.Struct('<IHHII')
+
+# Keep in sync with SnapshotCounters() in src/diagnostic_logs.cpp
+COUNTERS = [
+    'uptime_ms', 'uart_rx_bytes', 'uart_tx_bytes', 'uart_rx_dropped_bytes',
+    'zb_commands', 'zb_command_errors', 'zb_command_timeouts', 'zb_parser_errors',
+] + ['events_{}_{}'.format(lane, field)
+     for lane in ('control', 'discovery', 'housekeeping')
+     for field in ('depth', 'high_water', 'posted', 'dropped', 'coalesced')] + [
+    'optimistic_confirmed', 'optimistic_rolled_back',
+] + ['{}_{}'.format(stage, field)
+     for stage in ('write_to_report', 'write_to_tx', 'tx_to_done', 'done_to_complete', 'end_to_end')
+     for field in ('count', 'p50_us', 'p99_us', 'max_us')] + [
+    'cpu_main_permille', 'cpu_sysworkq_permille', 'cpu_chip_permille', 'cpu_zb_rx_permille',
+    'rx_wake_to_parse_count', 'rx_wake_to_parse_p50_us', 'rx_wake_to_parse_p99_us', 'rx_wake_to_parse_max_us',
+    'zb_event_pool_exhausted', 'zb_warm_start', 'zb_ready_uptime_ms', 'zb_start_duration_ms',
+    'matter_ready_ms', 'commissionable_ms', 'first_endpoint_ms', 'uart_rx_overflows',
+    'uart_rx_stalls', 'uart_rx_resyncs', 'uart_tx_busy_permille', 'uart_tx_buffer_waits',
+    'uart_tx_aborted', 'device_cmd_queued', 'device_cmd_rejected', 'device_cmd_active_high_water',
+    'breaker_opened', 'breaker_closed', 'breaker_probes', 'breaker_refused',
+    'liveness_probes', 'liveness_missed', 'liveness_suppressed', 'liveness_deferred',
+    'poll_polls', 'poll_changes', 'poll_deferred',
+    'report_emitted', 'report_unwatched', 'report_coalesced',
+    'zb_cmd_late_responses', 'poll_configure_retries', 'poll_silent', 'uart_rx_overrun_bytes',
+]
+
+# Keep in sync with Trace::EventId in src/trace.h
+EVENTS = {
+    1: ('ReadOnOff', 'ep={0} attr=0x{1:04x} max_len={2}'),
+    2: ('ReadBridgedBasic', 'ep={0} attr=0x{1:04x} max_len={2}'),
+    3: ('WriteOnOff', 'ep={0} attr=0x{1:04x} value={2}'),
+    4: ('DeviceOnOff', 'ep={0} on={1}'),
+    5: ('DeviceOnOffPending', 'ep={0} on={1} seq={2}'),
+    6: ('DeviceRollback', 'ep={0} on={1} seq={2}'),
+    7: ('UartRx', 'len={0} buffered={1}'),
+    8: ('UartTx', 'len={0}'),
+    9: ('ShellParsed', 'parsed={0} available={1}'),
+    10: ('ZclCmd', 'addr=0x{0:04x} ep={ep} cluster=0x{cluster:04x} cmd=0x{2:02x}'),
+    11: ('ZclAttrRead', 'addr=0x{0:04x} ep={ep} cluster=0x{cluster:04x} attr=0x{2:04x}'),
+    12: ('ZclAttrValue', 'attr=0x{0:04x} type=0x{1:02x} len={2}'),
+    13: ('ZigbeeEvent', 'event={0}'),
+    14: ('UartRxStall', 'buffers={0} flow_control={1}'),
+    15: ('ShellResync', 'dropped={0} cause={1}'),
+}
+
+
+def read_image(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data.startswith(b'BTRC') or data.startswith(b'BSTA'):
+        return data
+
+    image = bytearray()
+    inside = False
+    for line in data.decode(errors='replace').splitlines():
+        line = line.strip()
+        if 'TRACE BEGIN' in line:
+            image.clear()
+            inside = True
+        elif 'TRACE END' in line:
+            inside = False
+        elif inside and line:
+            image += bytes.fromhex(line.split()[-1])
+    return bytes(image)
+
+
+def split_counters(image):
+    """Return the counters block of a DiagnosticLogs image and the trace behind it."""
+    if not image.startswith(b'BSTA'):
+        return {}, image
+    _, version, count, _ = COUNTERS_HEADER.unpack_from(image, 0)
+    if version != 2:
+        raise ValueError('unsupported counters version {}'.format(version))
+    values = struct.unpack_from('<{}I'.format(count), image, COUNTERS_HEADER.size)
+    names = COUNTERS + ['counter{}'.format(i) for i in range(len(COUNTERS), count)]
+    return dict(zip(names, values)), image[COUNTERS_HEADER.size + 4 * count:]
+
+
+def decode(image):
+    if not image:
+        return 1, []
+    magic, version, ring_count, record_size, _, hz = HEADER.unpack_from(image, 0)
+    if magic != b'BTRC' or version != 1 or record_size != RECORD.size:
+        raise ValueError('not a bridge trace image')
+
+    events = []
+    offset = HEADER.size
+    for ring in range(ring_count):
+        owner, head, capacity = RING_HEADER.unpack_from(image, offset)
+        owner = owner.split(b'\0')[0].decode() or 'ring{}'.format(ring)
+        offset += RING_HEADER.size
+        first = max(0, head - capacity)
+        for seq in range(first, head):
+            record = RECORD.unpack_from(image, offset + (seq % capacity) * RECORD.size)
+            # Id 0 is a record still being written or cut by a writer that reused its slot
+            if record[1] != 0:
+                events.append((owner, seq) + record)
+        offset += capacity * RECORD.size
+
+    return hz, events
+
+
+def unwrap(events):
+    """Sort by time, unwrapping the 32-bit cycle counter around the newest record."""
+    if not events:
+        return []
+    newest = max(e[2] for e in events)
+    return sorted(events, key=lambda e: e[2] - (1 << 32 if e[2] > newest else 0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='console log or binary trace image')
+    args = parser.parse_args()
+
+    counters, image = split_counters(read_image(args.input))
+    for name, value in counters.items():
+        print('{:<28} {}'.format(name, value))
+
+    hz, events = decode(image)
+    events = unwrap(events)
+    if not events:
+        print('no events')
+        return 0
+
+    start = events[0][2]
+    for owner, _, ts, event_id, arg0, arg1, arg2 in events:
+        name, fmt = EVENTS.get(event_id, ('Event{}'.format(event_id), '{0} {1} {2}'))
+        us = ((ts - start) & 0xffffffff) * 1000000 // hz
+        text = fmt.format(arg0, arg1, arg2, ep=arg1 >> 16, cluster=arg1 & 0xffff)
+        print('{:>12} us  {:<16} {:<20} {}'.format(us, owner, name, text))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "app_event_queue.h"
+#include "bench.h"
+
+#include <logging/log.h>
+
+/*
+ * Host run of the bridge microbenchmarks, the counterpart of the "bridge
+ * bench" shell command. The cases of the Matter side of AppTask need the
+ * CHIP stack and run on the device only; the app event queue is timed
+ * here on its own, with this thread as producer and consumer.
+ */
+
+namespace {
+struct Options {
+	const char *filter = nullptr;
+	uint32_t iterations = 1000;
+	const char *output = nullptr;
+};
+
+void Usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options] [FILTER]\n"
+		"  FILTER            run the cases whose name contains FILTER\n"
+		"  --iterations N    iterations per batch (default 1000)\n"
+		"  -o FILE           append the JSON Lines results to FILE instead of stdout\n",
+		name);
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+
+		if (!strcmp(argv[i], "--iterations") && hasValue) {
+			options.iterations = atoi(argv[++i]);
+			options.iterations = MAX(options.iterations, 1);
+		} else if (!strcmp(argv[i], "-o") && hasValue) {
+			options.output = argv[++i];
+		} else if (argv[i][0] != '-' && options.filter == nullptr) {
+			options.filter = argv[i];
+		} else {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void PrintLine(void *context, const char *line)
+{
+	fprintf(static_cast<FILE *>(context), "%s\n", line);
+}
+
+void RunEventQueueBenchmarks(Bench::Runner &runner)
+{
+	static AppEventQueue queue;
+	AppEvent event(AppEvent::FunctionTimer);
+	AppEvent received;
+
+	queue.Init();
+	runner.Run("queue.post_get", [&] {
+		queue.Post(event, AppEventQueue::kLane_Control);
+		queue.Get(received);
+		Bench::DoNotOptimize(received.Type);
+	});
+}
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	Options options;
+	FILE *out = stdout;
+
+	if (!ParseOptions(argc, argv, options)) {
+		Usage(argv[0]);
+		return 1;
+	}
+	if (options.output != nullptr) {
+		out = fopen(options.output, "a");
+		if (out == nullptr) {
+			perror(options.output);
+			return 1;
+		}
+	}
+	sim_log_set_level(LOG_LEVEL_NONE);
+
+	Bench::Runner runner(PrintLine, out, options.filter, options.iterations);
+
+	runner.Begin("host");
+	Bench::RunZigbeeShellBenchmarks(runner);
+	RunEventQueueBenchmarks(runner);
+	runner.End();
+
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	return 0;
+}
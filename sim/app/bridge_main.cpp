@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "capture_file.h"
+#include "sim_bridge.h"
+#include "sim_ncp.h"
+#include "zigbee_shell.h"
+
+#include <logging/log.h>
+#include <sim_uart.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+/*
+ * Runs the Zigbee transport and the discovery flow of the bridge on the
+ * host, against the simulated NCP on the other end of a socket pair or
+ * against an NCP on the terminal given with --uart.
+ */
+
+namespace {
+struct Options {
+	SimNcp::Config ncp;
+	const char *uart = nullptr;
+	size_t endpoints = 16;
+	uint32_t timeoutMs = 10000;
+	const char *capture = nullptr;
+	int logLevel = LOG_LEVEL_WRN;
+};
+
+void Usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --lights N        lights on the network (default 8)\n"
+		"  --endpoints N     bridged endpoint slots (default 16)\n"
+		"  --fresh           start the NCP without a formed network\n"
+		"  --match-desc MS   time match_desc collects responses (default 50)\n"
+		"  --seed N          seed of the simulated network\n"
+		"  --uart PATH       use the NCP on this terminal instead\n"
+		"  --timeout MS      time allowed for discovery (default 10000)\n"
+		"  --capture FILE    save the Zigbee UART traffic for uart_replay\n"
+		"  -v                log info messages, twice for debug\n",
+		name);
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+
+		if (!strcmp(argv[i], "--lights") && hasValue) {
+			options.ncp.lightCount = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--endpoints") && hasValue) {
+			options.endpoints = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--fresh")) {
+			options.ncp.commissioned = false;
+		} else if (!strcmp(argv[i], "--match-desc") && hasValue) {
+			options.ncp.matchDescTimeoutMs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--seed") && hasValue) {
+			options.ncp.seed = strtoul(argv[++i], nullptr, 0);
+		} else if (!strcmp(argv[i], "--uart") && hasValue) {
+			options.uart = argv[++i];
+		} else if (!strcmp(argv[i], "--timeout") && hasValue) {
+			options.timeoutMs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--capture") && hasValue) {
+			options.capture = argv[++i];
+		} else if (!strcmp(argv[i], "-v")) {
+			options.logLevel++;
+		} else if (!strcmp(argv[i], "-vv")) {
+			options.logLevel += 2;
+		} else {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int OpenTerminal(const char *path)
+{
+	struct termios tio;
+	int fd = open(path, O_RDWR | O_NOCTTY);
+
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	if (tcgetattr(fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+
+	return fd;
+}
+
+void PrintReport(SimBridge &bridge, const ZigbeeShell &shell, size_t expected, uint32_t doneMs)
+{
+	const ZigbeeShell::StartInfo &start = shell.GetStartInfo();
+
+	printf("NCP ready:       %u ms (%s start in %u ms)\n", start.readyUptimeMs, start.warmStart ? "warm" : "cold",
+	       start.durationMs);
+	printf("First endpoint:  %u ms\n", bridge.GetFirstEndpointMs());
+	printf("Lights bridged:  %zu/%zu, state known for %zu, at %u ms\n", bridge.BridgedCount(), expected,
+	       bridge.KnownCount(), doneMs);
+	bridge.PrintStats();
+}
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	Options options;
+	int fd;
+
+	if (!ParseOptions(argc, argv, options)) {
+		Usage(argv[0]);
+		return 1;
+	}
+	sim_log_set_level(options.logLevel);
+
+	if (options.uart != nullptr) {
+		fd = OpenTerminal(options.uart);
+		if (fd < 0) {
+			return 1;
+		}
+	} else {
+		int fds[2];
+
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+			perror("socketpair");
+			return 1;
+		}
+		fd = fds[0];
+		std::thread([&options, ncpFd = fds[1]]() {
+			static SimNcp sNcp(options.ncp);
+
+			sNcp.Run(ncpFd);
+		}).detach();
+	}
+	sim_uart_attach(CONFIG_ZIGBEE_SHELL_DEVICE_NAME, fd);
+
+	/* Constructed once its UART exists, the target has it ready before main() */
+	static ZigbeeShell sZbShell;
+	static SimBridge sBridge(sZbShell, options.endpoints);
+	size_t expected = MIN(options.ncp.lightCount, options.endpoints);
+	bool ok;
+
+	sBridge.Start();
+	ok = sBridge.WaitForLights(expected, options.timeoutMs);
+	PrintReport(sBridge, sZbShell, expected, k_uptime_get_32());
+	fflush(stdout);
+	if (options.capture != nullptr && !CaptureFile::Save(options.capture)) {
+		ok = false;
+	}
+
+	/* The shell and NCP threads never return, leave without running destructors */
+	_exit(ok ? 0 : 1);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "capture_file.h"
+
+#include <zephyr.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+constexpr size_t kHeaderSize = 20;
+
+bool ParseImage(const std::string &image, CaptureFile &capture)
+{
+	uint32_t length;
+	size_t offset = kHeaderSize;
+
+	if (image.size() < kHeaderSize || image.compare(0, 4, "BCAP") || image[4] != 1) {
+		return false;
+	}
+	memcpy(&capture.CyclesPerSecond, &image[8], sizeof(uint32_t));
+	memcpy(&length, &image[12], sizeof(uint32_t));
+	memcpy(&capture.Dropped, &image[16], sizeof(uint32_t));
+
+	/* Records appended while a dump was taken are left out with the length of the header */
+	while (offset + sizeof(UartCapture::Record) <= MIN(image.size(), kHeaderSize + length)) {
+		UartCapture::Record record;
+
+		memcpy(&record, &image[offset], sizeof(record));
+		offset += sizeof(record);
+		if (offset + record.Length > image.size()) {
+			return false;
+		}
+		capture.Chunks.push_back({ record.Timestamp, static_cast<UartCapture::Direction>(record.Direction),
+					   image.substr(offset, record.Length) });
+		offset += ROUND_UP(record.Length, 4);
+	}
+
+	return true;
+}
+
+std::string HexToBytes(const std::string &hex)
+{
+	std::string bytes;
+
+	for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+		bytes += static_cast<char>(strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+	}
+
+	return bytes;
+}
+} /* namespace */
+
+bool CaptureFile::Save(const char *path)
+{
+	FILE *file = fopen(path, "wb");
+	uint8_t chunk[4096];
+	size_t offset = 0;
+	size_t len;
+
+	if (file == nullptr) {
+		perror(path);
+		return false;
+	}
+	while ((len = UartCapture::Read(offset, chunk, sizeof(chunk))) > 0) {
+		fwrite(chunk, 1, len, file);
+		offset += len;
+	}
+
+	return fclose(file) == 0;
+}
+
+bool CaptureFile::Load(const char *path)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	std::istringstream lines(data);
+	std::string line, image;
+	bool inside = false;
+
+	if (!file) {
+		perror(path);
+		return false;
+	}
+	if (data.compare(0, 4, "BCAP") == 0) {
+		return ParseImage(data, *this);
+	}
+
+	while (std::getline(lines, line)) {
+		size_t last = line.find_last_not_of(" \t\r");
+
+		if (line.find("CAPTURE BEGIN") != std::string::npos) {
+			image.clear();
+			inside = true;
+		} else if (line.find("CAPTURE END") != std::string::npos) {
+			inside = false;
+		} else if (inside && last != std::string::npos) {
+			size_t first = line.find_last_of(" \t", last);
+			size_t start = (first == std::string::npos) ? 0 : first + 1;
+
+			image += HexToBytes(line.substr(start, last + 1 - start));
+		}
+	}
+
+	return ParseImage(image, *this);
+}
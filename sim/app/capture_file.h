@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "uart_capture.h"
+
+#include <string>
+#include <vector>
+
+/* Zigbee UART capture as stored in a file, see src/uart_capture.h */
+struct CaptureFile {
+	struct Chunk {
+		uint32_t Timestamp;
+		UartCapture::Direction Direction;
+		std::string Data;
+	};
+
+	uint32_t CyclesPerSecond = 0;
+	uint32_t Dropped = 0;
+	std::vector<Chunk> Chunks;
+
+	/* Saves the capture of this process as a binary image */
+	static bool Save(const char *path);
+	/* Loads a binary image or a console log with the output of "bridge capture dump" */
+	bool Load(const char *path);
+};
@@ -0,0 +1,1215 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "capture_file.h"
+#include "sim_bridge.h"
+#include "sim_ncp.h"
+#include "zigbee_shell.h"
+
+#include <logging/log.h>
+#include <sim_uart.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Synthetic load on the bridge from a large simulated Zigbee network.
+ *
+ * The bridge is started against the simulated NCP and runs the phases of
+ * the scenario in order:
+ *
+ *   discover  wait for the network rejoin discovery of all lights
+ *   burst     all lights announce themselves at once
+ *   toggle    every bridged light is toggled, as by a controller
+ *   noisy     the other lights are toggled one by one while one light
+ *             is flooded with commands, and their latency is compared
+ *             with the same toggles without the flood
+ *   outage    one light loses power and is sent commands until its
+ *             breaker opens, then comes back and is probed reachable
+ *   liveness  the lights are probed while idle and while sent commands,
+ *             then a tenth of them lose power without being sent any
+ *             command and come back, and the probe rate is checked
+ *             against the budget
+ *   poll      the lights that cannot report, see --legacy, are switched
+ *             locally, half of them watched by a subscriber, and the
+ *             time until the bridge sees the changes and the poll rates
+ *             are compared, then the others start being watched. With
+ *             --unanswered-configs, the lights that report have to be
+ *             configured by the retries instead of being polled
+ *   reports   the lights that report flap faster than the shortest
+ *             Matter report interval, half of them watched by a
+ *             subscriber, and the Matter reports of each are counted,
+ *             then a watched light is switched by a command and has to
+ *             be reported at once
+ *   late      a light answers only after the bridge timed its command
+ *             out, and the command to another light sent next has to
+ *             wait for its own response
+ *
+ * and reports how long each took, the command throughput and latency
+ * percentiles, the event queue drops and the RX ring buffer overflows.
+ * The NCP output can be paced at a baud rate, and without flow control
+ * the bytes sent while the bridge receiver is stopped are lost. With a
+ * list of rates, the scenario runs once per rate and the command
+ * throughput and latency at each rate are compared.
+ */
+
+namespace {
+struct Options {
+	SimNcp::Config ncp;
+	size_t endpoints = 0;
+	std::string scenario = "discover,burst,toggle";
+	uint16_t burst = 0;
+	uint32_t toggleRounds = 1;
+	uint32_t toggleRate = 0;
+	uint32_t timeoutMs = 30000;
+	const char *capture = nullptr;
+	bool flowControl = false;
+	std::vector<uint32_t> baudRates;
+	LivenessMonitor::Config liveness;
+	PollScheduler::Config poll;
+	ReportLimiter::Config report;
+	uint16_t readsPerSecond = CONFIG_BRIDGE_ZIGBEE_READS_PER_S;
+	int logLevel = LOG_LEVEL_NONE;
+};
+
+void Usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --lights N        lights on the network (default 100)\n"
+		"  --endpoints N     bridged endpoint slots (default: one per light)\n"
+		"  --scenario LIST   comma-separated phases (default discover,burst,toggle)\n"
+		"  --burst N         lights announcing in the burst phase (default all)\n"
+		"  --rounds N        toggles of every light in the toggle phase (default 1)\n"
+		"  --rate N          On/Off commands posted per second, 0 for all at once (default 0,\n"
+		"                    20 for the other lights of the noisy phase)\n"
+		"  --latency US      response latency of the lights (default 0)\n"
+		"  --jitter US       uniform random jitter added to the latency (default 0)\n"
+		"  --loss PCT        frames from the lights lost, in percent (default 0)\n"
+		"  --report-ms MS    attribute report period of every light, 0 for none (default 0)\n"
+		"  --match-desc MS   time match_desc collects responses (default 50)\n"
+		"  --seed N          seed of the simulated network\n"
+		"  --baud N          NCP output paced at this baud rate, 0 for unpaced (default 0)\n"
+		"  --flow-control    RTS/CTS are wired, bytes wait instead of being lost\n"
+		"  --bauds LIST      run the scenario once per comma-separated NCP baud rate and compare\n"
+		"  --liveness-ms MS  liveness probe interval, the other liveness delays scaled along\n"
+		"                    (default %u)\n"
+		"  --legacy PCT      lights that cannot report their state, in percent (default 0)\n"
+		"  --unanswered-configs N report configurations each other light leaves unanswered (default 0)\n"
+		"  --silent PCT      lights that can report but never do, in percent of them (default 0)\n"
+		"  --report-timeout-ms MS time a configured light has to report in before it is polled\n"
+		"                    (default %u)\n"
+		"  --poll-ms MS      shortest poll interval, the other poll intervals scaled along\n"
+		"                    (default %u)\n"
+		"  --read-rate N     most liveness probes and state polls per second, together (default %u)\n"
+		"  --report-min-ms MS shortest time between two Matter reports of an attribute (default %u)\n"
+		"  --timeout MS      time allowed for each phase (default 30000)\n"
+		"  --capture FILE    save the Zigbee UART traffic for uart_replay\n"
+		"  -v                log warnings, more for info and debug\n",
+		name, CONFIG_BRIDGE_LIVENESS_INTERVAL_MS, CONFIG_BRIDGE_REPORT_MAX_INTERVAL_S * 1500,
+		CONFIG_BRIDGE_POLL_MIN_INTERVAL_MS,
+		CONFIG_BRIDGE_ZIGBEE_READS_PER_S, CONFIG_BRIDGE_MATTER_REPORT_MIN_INTERVAL_MS);
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+	options.ncp.lightCount = 100;
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+
+		if (!strcmp(argv[i], "--lights") && hasValue) {
+			options.ncp.lightCount = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--endpoints") && hasValue) {
+			options.endpoints = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--scenario") && hasValue) {
+			options.scenario = argv[++i];
+		} else if (!strcmp(argv[i], "--burst") && hasValue) {
+			options.burst = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--rounds") && hasValue) {
+			options.toggleRounds = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--rate") && hasValue) {
+			options.toggleRate = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--latency") && hasValue) {
+			options.ncp.latencyUs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--jitter") && hasValue) {
+			options.ncp.jitterUs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--loss") && hasValue) {
+			options.ncp.lossPercent = MIN(atoi(argv[++i]), 100);
+		} else if (!strcmp(argv[i], "--report-ms") && hasValue) {
+			options.ncp.reportIntervalMs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--match-desc") && hasValue) {
+			options.ncp.matchDescTimeoutMs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--seed") && hasValue) {
+			options.ncp.seed = strtoul(argv[++i], nullptr, 0);
+		} else if (!strcmp(argv[i], "--baud") && hasValue) {
+			options.ncp.baudRate = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--flow-control")) {
+			options.flowControl = true;
+		} else if (!strcmp(argv[i], "--bauds") && hasValue) {
+			std::istringstream list(argv[++i]);
+			std::string rate;
+
+			while (std::getline(list, rate, ',')) {
+				options.baudRates.push_back(strtoul(rate.c_str(), nullptr, 0));
+			}
+		} else if (!strcmp(argv[i], "--liveness-ms") && hasValue) {
+			LivenessMonitor::Config &liveness = options.liveness;
+			uint32_t intervalMs = strtoul(argv[++i], nullptr, 0);
+
+			/* Keeps the ratios of the Kconfig delays, each at least a tick */
+			liveness.retryMs = MAX(uint64_t{ liveness.retryMs } * intervalMs / liveness.intervalMs,
+					       liveness.tickMs);
+			liveness.unreachableMs = MAX(uint64_t{ liveness.unreachableMs } * intervalMs /
+							     liveness.intervalMs,
+						     liveness.tickMs);
+			liveness.backoffMaxMs = MAX(uint64_t{ liveness.backoffMaxMs } * intervalMs / liveness.intervalMs,
+						    liveness.tickMs);
+			liveness.intervalMs = MAX(intervalMs, liveness.tickMs);
+		} else if (!strcmp(argv[i], "--legacy") && hasValue) {
+			int legacy = atoi(argv[++i]);
+
+			options.ncp.legacyPercent = MIN(legacy, 100);
+		} else if (!strcmp(argv[i], "--unanswered-configs") && hasValue) {
+			int unanswered = atoi(argv[++i]);
+
+			options.ncp.unansweredConfigs = MIN(unanswered, UINT8_MAX);
+		} else if (!strcmp(argv[i], "--silent") && hasValue) {
+			int silent = atoi(argv[++i]);
+
+			options.ncp.silentPercent = MIN(silent, 100);
+		} else if (!strcmp(argv[i], "--report-timeout-ms") && hasValue) {
+			options.poll.reportTimeoutMs = strtoul(argv[++i], nullptr, 0);
+		} else if (!strcmp(argv[i], "--poll-ms") && hasValue) {
+			PollScheduler::Config &poll = options.poll;
+			uint32_t intervalMs = strtoul(argv[++i], nullptr, 0);
+
+			intervalMs = MAX(intervalMs, poll.tickMs);
+			poll.maxIntervalMs = uint64_t{ poll.maxIntervalMs } * intervalMs / poll.minIntervalMs;
+			poll.idleIntervalMs = uint64_t{ poll.idleIntervalMs } * intervalMs / poll.minIntervalMs;
+			poll.configureRetryMs = uint64_t{ poll.configureRetryMs } * intervalMs / poll.minIntervalMs;
+			poll.minIntervalMs = intervalMs;
+		} else if (!strcmp(argv[i], "--read-rate") && hasValue) {
+			options.readsPerSecond = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--report-min-ms") && hasValue) {
+			options.report.minIntervalMs = strtoul(argv[++i], nullptr, 0);
+		} else if (!strcmp(argv[i], "--timeout") && hasValue) {
+			options.timeoutMs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--capture") && hasValue) {
+			options.capture = argv[++i];
+		} else if (!strncmp(argv[i], "-v", 2) && strspn(argv[i] + 1, "v") == strlen(argv[i] + 1)) {
+			options.logLevel += strlen(argv[i]) - 1;
+		} else {
+			return false;
+		}
+	}
+	if (options.readsPerSecond == 0) {
+		return false;
+	}
+	if (options.endpoints == 0) {
+		options.endpoints = options.ncp.lightCount;
+	}
+	if (options.burst == 0) {
+		options.burst = options.ncp.lightCount;
+	}
+
+	return true;
+}
+
+/*
+ * Polls done() until it holds, or until progress() has not changed for
+ * idleMs. Returns the time from start until done or the last progress.
+ */
+template <typename Done, typename Progress>
+int64_t WaitFor(int64_t start, Done done, Progress progress, uint32_t idleMs, uint32_t timeoutMs, bool &completed)
+{
+	int64_t lastProgress = start;
+	auto last = progress();
+
+	completed = true;
+	while (!done()) {
+		int64_t now = k_uptime_get();
+		auto current = progress();
+
+		if (current != last) {
+			last = current;
+			lastProgress = now;
+		}
+		if (now - lastProgress > idleMs || now - start > timeoutMs) {
+			completed = false;
+			return lastProgress - start;
+		}
+		k_sleep(K_MSEC(1));
+	}
+
+	return k_uptime_get() - start;
+}
+
+/* Outcome of a run, compared across baud rates */
+struct Summary {
+	uint32_t baudRate;
+	bool flowControl;
+	size_t bridged;
+	size_t completed;
+	double commandsPerSecond;
+	uint32_t p50Us;
+	uint32_t p99Us;
+	size_t lost;
+	uint32_t resyncs;
+	/* Discovery or a phase did not finish, or had nothing to do */
+	bool stalled;
+	/* Commands of the other lights stayed within the bound of the noisy phase */
+	bool fair;
+	/* The light of the outage phase was found unreachable and reachable again */
+	bool recovered;
+	/* The liveness phase found the dark lights and kept to the probe budget */
+	bool live;
+	/* The poll phase saw the changes and polled as often as the subscribers need, within the budget */
+	bool polled;
+	/* The reports phase kept to the report interval and reported the watched lights only */
+	bool reported;
+	/* The late response of the late phase did not complete the next command */
+	bool late;
+};
+
+uint32_t Percentile(const std::vector<uint32_t> &sorted, uint8_t percent)
+{
+	if (sorted.empty()) {
+		return 0;
+	}
+
+	return sorted[MIN(sorted.size() - 1, (sorted.size() * percent + 99) / 100 - 1)];
+}
+
+void Discover(SimBridge &bridge, const Options &options, Summary &summary)
+{
+	size_t expected = MIN(options.ncp.lightCount, options.endpoints);
+	bool done = bridge.WaitForLights(expected, options.timeoutMs);
+
+	summary.stalled |= !done;
+
+	printf("discover   %zu/%zu lights bridged, state known for %zu, %s at %u ms (first endpoint at %u ms)\n",
+	       bridge.BridgedCount(), expected, bridge.KnownCount(), done ? "done" : "stalled", k_uptime_get_32(),
+	       bridge.GetFirstEndpointMs());
+}
+
+void Burst(SimBridge &bridge, SimNcp &ncp, const Options &options, Summary &summary)
+{
+	uint32_t announces = bridge.AnnounceCount();
+	uint32_t descriptors = bridge.SimpleDescCount();
+	uint32_t idleMs = 2 * (options.ncp.lossTimeoutMs + options.ncp.matchDescTimeoutMs) + 500;
+	int64_t elapsed;
+	bool done;
+
+	ncp.AnnounceBurst(options.burst);
+	elapsed = WaitFor(
+		k_uptime_get(), [&]() { return bridge.SimpleDescCount() - descriptors >= options.burst; },
+		[&]() { return bridge.SimpleDescCount() + bridge.AnnounceCount(); }, idleMs, options.timeoutMs, done);
+	summary.stalled |= !done;
+	printf("burst      %u announces sent, %u handled, %u re-described, %s in %lld ms\n", options.burst,
+	       bridge.AnnounceCount() - announces, bridge.SimpleDescCount() - descriptors,
+	       done ? "done" : "stalled", static_cast<long long>(elapsed));
+}
+
+void Toggle(SimBridge &bridge, const Options &options, Summary &summary)
+{
+	uint32_t before = bridge.GetCommandStats().Completed;
+	uint32_t posted = 0, dropped = 0;
+	uint32_t idleMs = 2 * options.ncp.lossTimeoutMs + 500;
+	uint32_t start = k_cycle_get_32();
+
+	for (uint32_t round = 0; round < options.toggleRounds; round++) {
+		for (auto &light : bridge.GetLights()) {
+			if (!ZigbeeBridge::IsBridged(light)) {
+				continue;
+			}
+			if (bridge.PostOnOff(light, !light.IsOn())) {
+				dropped++;
+			} else {
+				posted++;
+			}
+			if (options.toggleRate) {
+				k_sleep(K_USEC(1000000 / options.toggleRate));
+			}
+		}
+	}
+
+	bool done;
+
+	WaitFor(
+		k_uptime_get(), [&]() { return bridge.GetCommandStats().Completed - before >= posted; },
+		[&]() { return bridge.GetCommandStats().Completed; }, idleMs, options.timeoutMs, done);
+	SimBridge::CommandStats stats = bridge.GetCommandStats();
+	std::vector<uint32_t> latency(stats.LatencyUs.end() - (stats.Completed - before), stats.LatencyUs.end());
+
+	std::sort(latency.begin(), latency.end());
+	/* Nothing to toggle is a stall as well, discovery bridged no light */
+	done = done && posted > 0;
+	summary.stalled |= !done;
+	summary.completed = latency.size();
+	if (latency.empty()) {
+		/* The last completion is of an earlier phase, if any */
+		printf("toggle     %u posted, %u dropped, 0 completed, stalled\n", posted, dropped);
+		return;
+	}
+
+	uint32_t elapsedUs = k_cyc_to_us_floor32(stats.LastCompleted - start);
+
+	summary.commandsPerSecond = elapsedUs ? latency.size() * 1e6 / elapsedUs : 0.0;
+	summary.p50Us = Percentile(latency, 50);
+	summary.p99Us = Percentile(latency, 99);
+	printf("toggle     %u posted, %u dropped, %zu completed (%u errors), %s in %.1f ms, %.1f cmd/s\n", posted,
+	       dropped, latency.size(), stats.Errors, done ? "done" : "stalled", elapsedUs / 1e3,
+	       summary.commandsPerSecond);
+	printf("           latency p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", Percentile(latency, 50) / 1e3,
+	       Percentile(latency, 90) / 1e3, Percentile(latency, 99) / 1e3, Percentile(latency, 100) / 1e3);
+}
+
+/* Latencies of the commands completed from first on, of the flooded light or of the others */
+std::vector<uint32_t> SortedLatency(const SimBridge::CommandStats &stats, size_t first, const Device *noisy,
+				    bool ofNoisy)
+{
+	std::vector<uint32_t> latency;
+
+	for (size_t i = first; i < stats.LatencyUs.size(); i++) {
+		if ((stats.Lights[i] == noisy) == ofNoisy) {
+			latency.push_back(stats.LatencyUs[i]);
+		}
+	}
+	std::sort(latency.begin(), latency.end());
+
+	return latency;
+}
+
+/* Toggles every light but the noisy one, one after the other, and waits for the commands */
+size_t ToggleOthers(SimBridge &bridge, const Options &options, const Device *noisy, Summary &summary)
+{
+	uint32_t rate = options.toggleRate ? options.toggleRate : 20;
+	uint32_t before = bridge.GetCommandStats().Completed;
+	size_t first = bridge.GetCommandStats().LatencyUs.size();
+	uint32_t posted = 0;
+	bool done;
+
+	for (auto &light : bridge.GetLights()) {
+		if (!ZigbeeBridge::IsBridged(light) || &light == noisy) {
+			continue;
+		}
+		posted += !bridge.PostOnOff(light, !light.IsOn());
+		k_sleep(K_USEC(1000000 / rate));
+	}
+	WaitFor(
+		k_uptime_get(),
+		[&]() {
+			SimBridge::CommandStats stats = bridge.GetCommandStats();
+
+			return SortedLatency(stats, first, noisy, false).size() >= posted;
+		},
+		[&]() { return bridge.GetCommandStats().Completed - before; }, 2 * options.ncp.lossTimeoutMs + 500,
+		options.timeoutMs, done);
+	summary.stalled |= !done || posted == 0;
+
+	return first;
+}
+
+/*
+ * A light is sent commands as fast as it accepts them, as by a runaway
+ * automation, while the others are toggled one by one. Served in turn,
+ * a command of another light waits at most for the command in progress
+ * and one more of the flooded light, so its latency has to stay within
+ * three times the worst latency of the same toggles without the flood.
+ */
+void Noisy(SimBridge &bridge, const Options &options, Summary &summary)
+{
+	Device *noisy = nullptr;
+	std::atomic<bool> stop(false);
+	uint32_t accepted = 0, refused = 0;
+
+	for (auto &light : bridge.GetLights()) {
+		if (ZigbeeBridge::IsBridged(light)) {
+			noisy = &light;
+			break;
+		}
+	}
+	if (noisy == nullptr) {
+		printf("noisy      no light bridged\n");
+		summary.stalled = true;
+		return;
+	}
+
+	std::vector<uint32_t> quiet =
+		SortedLatency(bridge.GetCommandStats(), ToggleOthers(bridge, options, noisy, summary), noisy, false);
+	std::thread flood([&]() {
+		bool on = noisy->IsOn();
+
+		while (!stop) {
+			if (bridge.PostOnOff(*noisy, on = !on)) {
+				refused++;
+			} else {
+				accepted++;
+			}
+			k_sleep(K_USEC(100));
+		}
+	});
+	size_t first = ToggleOthers(bridge, options, noisy, summary);
+
+	stop = true;
+	flood.join();
+
+	SimBridge::CommandStats stats = bridge.GetCommandStats();
+	std::vector<uint32_t> others = SortedLatency(stats, first, noisy, false);
+	std::vector<uint32_t> flooded = SortedLatency(stats, first, noisy, true);
+	uint32_t bound = 3 * Percentile(quiet, 100);
+
+	summary.fair = Percentile(others, 100) <= bound;
+	printf("noisy      0x%04hx flooded: %u accepted, %u refused, %zu completed, p50 %.2f ms\n", noisy->GetZbAddr(),
+	       accepted, refused, flooded.size(), Percentile(flooded, 50) / 1e3);
+	printf("           other lights alone: %zu commands, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", quiet.size(),
+	       Percentile(quiet, 50) / 1e3, Percentile(quiet, 99) / 1e3, Percentile(quiet, 100) / 1e3);
+	printf("           other lights flooded: %zu commands, p50 %.2f ms, p99 %.2f ms, max %.2f ms, bound %.2f ms %s\n",
+	       others.size(), Percentile(others, 50) / 1e3, Percentile(others, 99) / 1e3,
+	       Percentile(others, 100) / 1e3, bound / 1e3, summary.fair ? "ok" : "EXCEEDED");
+}
+
+/*
+ * The first bridged light loses power. Commands to it time out until its
+ * breaker opens, then writes are refused without waiting for the light.
+ * Once powered again, a probe of the bridge has to find it reachable
+ * within the probe interval, and a command to it succeeds again.
+ */
+void Outage(SimBridge &bridge, SimNcp &ncp, const Options &options, Summary &summary)
+{
+	Device *dark = nullptr;
+	uint32_t failed = 0, refused = 0, refusedMaxUs = 0;
+	int64_t start, opened, restored;
+	bool done;
+
+	for (auto &light : bridge.GetLights()) {
+		if (ZigbeeBridge::IsBridged(light)) {
+			dark = &light;
+			break;
+		}
+	}
+	if (dark == nullptr) {
+		printf("outage     no light bridged\n");
+		summary.recovered = false;
+		return;
+	}
+
+	ncp.SetLightPowered(dark->GetZbAddr(), false);
+	start = k_uptime_get();
+	while (dark->IsReachable() && k_uptime_get() - start < options.timeoutMs) {
+		uint32_t before = bridge.GetCommandStats().Completed;
+
+		if (bridge.PostOnOff(*dark, !dark->IsOn())) {
+			break;
+		}
+		WaitFor(
+			k_uptime_get(), [&]() { return bridge.GetCommandStats().Completed != before; },
+			[&]() { return bridge.GetCommandStats().Completed; }, 2 * options.ncp.lossTimeoutMs + 500,
+			options.timeoutMs, done);
+		failed++;
+	}
+	opened = k_uptime_get() - start;
+
+	/* Writes to the unreachable light fail at once */
+	for (int i = 0; i < 10; i++) {
+		uint32_t posted = k_cycle_get_32();
+
+		refused += (bridge.PostOnOff(*dark, !dark->IsOn()) == -EHOSTUNREACH);
+		refusedMaxUs = MAX(refusedMaxUs, k_cyc_to_us_floor32(k_cycle_get_32() - posted));
+	}
+
+	ncp.SetLightPowered(dark->GetZbAddr(), true);
+	restored = WaitFor(
+		k_uptime_get(), [&]() { return dark->IsReachable(); }, [&]() { return bridge.GetBreakerStats().Probes; },
+		options.liveness.unreachableMs + options.ncp.lossTimeoutMs + 500, options.timeoutMs, done);
+
+	uint32_t before = bridge.GetCommandStats().Completed;
+	uint32_t errors = bridge.GetCommandStats().Errors;
+
+	if (done && !bridge.PostOnOff(*dark, !dark->IsOn())) {
+		WaitFor(
+			k_uptime_get(), [&]() { return bridge.GetCommandStats().Completed != before; },
+			[&]() { return bridge.GetCommandStats().Completed; }, 2 * options.ncp.lossTimeoutMs + 500,
+			options.timeoutMs, done);
+	}
+
+	SimBridge::CommandStats stats = bridge.GetCommandStats();
+	DeviceBreaker::Stats breakers = bridge.GetBreakerStats();
+
+	summary.recovered = refused == 10 && stats.Completed == before + 1 && stats.Errors == errors;
+	printf("outage     0x%04hx off: unreachable after %u failed commands in %lld ms, %u/10 writes refused "
+	       "within %u us\n",
+	       dark->GetZbAddr(), failed, static_cast<long long>(opened), refused, refusedMaxUs);
+	printf("           0x%04hx on: reachable after %lld ms and %u probes, next command %s\n", dark->GetZbAddr(),
+	       static_cast<long long>(restored), breakers.Probes, summary.recovered ? "ok" : "FAILED");
+}
+
+/* Probes started per second over a time, waiting it out */
+double ProbeRate(SimBridge &bridge, uint32_t ms, std::function<void()> traffic = nullptr)
+{
+	uint32_t probes = bridge.GetLivenessStats().Probes;
+	int64_t start = k_uptime_get();
+
+	while (k_uptime_get() - start < ms) {
+		if (traffic) {
+			traffic();
+		} else {
+			k_sleep(K_MSEC(10));
+		}
+	}
+
+	return (bridge.GetLivenessStats().Probes - probes) * 1000.0 / (k_uptime_get() - start);
+}
+
+/*
+ * Without traffic, every light is probed once per interval, as far as the
+ * budget allows. Commands answered in the meantime suppress the probes.
+ * Lights that lose power are found unreachable by the probes alone, and
+ * reachable again when they are back, within the backoff delay.
+ */
+void Liveness(SimBridge &bridge, SimNcp &ncp, const Options &options, Summary &summary)
+{
+	const LivenessMonitor::Config &config = options.liveness;
+	std::vector<Device *> lights, dark;
+	uint32_t window = 2 * config.intervalMs;
+	uint32_t budget = MIN(options.readsPerSecond, 1000 / config.tickMs);
+	int64_t start, lost, found;
+	bool done;
+
+	for (auto &light : bridge.GetLights()) {
+		if (ZigbeeBridge::IsBridged(light)) {
+			lights.push_back(&light);
+		}
+	}
+	if (lights.empty()) {
+		printf("liveness   no light bridged\n");
+		summary.live = false;
+		return;
+	}
+
+	/* The first probes are due an interval after the lights were added */
+	k_sleep(K_MSEC(config.intervalMs));
+
+	double idleRate = ProbeRate(bridge, window);
+	uint32_t suppressed = bridge.GetLivenessStats().Suppressed;
+	size_t next = 0;
+	double busyRate = ProbeRate(bridge, window, [&]() {
+		Device *light = lights[next++ % lights.size()];
+
+		/* Every light answers a command twice per interval */
+		bridge.PostOnOff(*light, !light->IsOn());
+		k_sleep(K_MSEC(MAX(config.intervalMs / 2 / lights.size(), 1u)));
+	});
+
+	suppressed = bridge.GetLivenessStats().Suppressed - suppressed;
+	for (size_t i = 0; i < lights.size(); i += 10) {
+		dark.push_back(lights[i]);
+	}
+
+	auto reachable = [&](bool expected) {
+		return std::all_of(dark.begin(), dark.end(), [&](const Device *light) {
+			return light->IsReachable() == expected;
+		});
+	};
+	auto progress = [&]() { return bridge.GetLivenessStats().Probes; };
+	uint32_t idleMs = config.backoffMaxMs + config.intervalMs + 1000;
+
+	/* Commands in flight are answered before the power goes */
+	k_sleep(K_MSEC(2 * options.ncp.lossTimeoutMs));
+	for (Device *light : dark) {
+		ncp.SetLightPowered(light->GetZbAddr(), false);
+	}
+	start = k_uptime_get();
+	lost = WaitFor(start, [&]() { return reachable(false); }, progress, idleMs, options.timeoutMs, done);
+	summary.live = done;
+	for (Device *light : dark) {
+		ncp.SetLightPowered(light->GetZbAddr(), true);
+	}
+	start = k_uptime_get();
+	found = WaitFor(start, [&]() { return reachable(true); }, progress, idleMs, options.timeoutMs, done);
+	summary.live = summary.live && done && idleRate <= budget + 0.5 && busyRate <= budget + 0.5;
+
+	LivenessMonitor::Stats stats = bridge.GetLivenessStats();
+
+	printf("liveness   %zu lights, interval %u ms, budget %u probes/s: %.2f probes/s idle, %.2f while commanded "
+	       "(%u suppressed)\n",
+	       lights.size(), config.intervalMs, budget, idleRate, busyRate, suppressed);
+	printf("           %zu lights off: unreachable after %lld ms, on: reachable after %lld ms, %u probes missed, "
+	       "%u ticks deferred %s\n",
+	       dark.size(), static_cast<long long>(lost), static_cast<long long>(found), stats.Missed, stats.Deferred,
+	       summary.live ? "ok" : "FAILED");
+}
+
+/* A light switched locally, and how long the bridge took to see it */
+struct Switched {
+	Device *light;
+	int64_t nextToggle;
+	int64_t toggled;
+	bool seen;
+	uint32_t toggles;
+	uint32_t unseen;
+	int64_t latencyMs;
+	int64_t maxLatencyMs;
+};
+
+/* Polls per light of a class over the phase */
+double PollsPerLight(SimBridge &bridge, const std::vector<Device *> &lights, const std::vector<uint32_t> &start)
+{
+	uint32_t polls = 0;
+
+	for (size_t i = 0; i < lights.size(); i++) {
+		polls += bridge.PollCount(*lights[i]) - start[i];
+	}
+
+	return lights.empty() ? 0 : static_cast<double>(polls) / lights.size();
+}
+
+/*
+ * The lights that cannot report are polled at an interval adapted to how
+ * often they change while a subscriber watches them, and at the idle
+ * interval otherwise. A light starting to be watched is polled right away.
+ * The lights that report are seen through their reports instead.
+ */
+void Poll(SimBridge &bridge, SimNcp &ncp, const Options &options, Summary &summary)
+{
+	const PollScheduler::Config &config = options.poll;
+	/* Watched or not, switched or not */
+	std::vector<Device *> classes[2][2];
+	std::vector<uint32_t> counts[2][2];
+	std::vector<Switched> switched;
+	/* Shared with the liveness probes */
+	uint32_t budget = MIN(options.readsPerSecond, 1000 / config.tickMs);
+	uint32_t window = 3 * config.maxIntervalMs;
+	uint32_t togglePeriod = 10 * config.minIntervalMs;
+	size_t polled = 0, reporting = 0;
+	int64_t start, now, watchedMs;
+	bool done, configured = true;
+
+	/* The report configuration follows the first read of the state at discovery */
+	WaitFor(
+		k_uptime_get(), [&]() { return bridge.ConfiguredCount() >= bridge.BridgedCount(); },
+		[&]() { return bridge.ConfiguredCount(); }, options.timeoutMs, options.timeoutMs, done);
+	/* The lights that took the configuration but do not report are polled after the report timeout */
+	if (options.ncp.silentPercent > 0) {
+		size_t expected = ncp.SilentCount();
+		int64_t silentMs;
+
+		silentMs = WaitFor(
+			k_uptime_get(), [&]() { return bridge.GetPollStats().Silent >= expected; },
+			[&]() { return bridge.GetPollStats().Silent; }, 2 * config.reportTimeoutMs, options.timeoutMs,
+			done);
+		/* The others kept reporting, none of them is polled */
+		configured = done && bridge.GetPollStats().Silent == expected;
+		printf("poll       %u/%zu lights that do not report polled within %lld ms, report timeout %u ms %s\n",
+		       bridge.GetPollStats().Silent, expected, static_cast<long long>(silentMs), config.reportTimeoutMs,
+		       configured ? "ok" : "FAILED");
+	}
+	for (auto &light : bridge.GetLights()) {
+		if (!ZigbeeBridge::IsBridged(light)) {
+			continue;
+		}
+		if (!bridge.IsPolled(light)) {
+			/* A few of the lights that report are switched too */
+			if (reporting++ % 4 == 0) {
+				switched.push_back({ &light, 0, 0, false, 0, 0, 0, 0 });
+			}
+			continue;
+		}
+
+		bool watched = polled % 2 == 0;
+		bool busy = polled / 2 % 2 == 0;
+
+		classes[watched][busy].push_back(&light);
+		if (watched) {
+			bridge.SetSubscribed(light, true);
+		}
+		if (busy) {
+			switched.push_back({ &light, 0, 0, false, 0, 0, 0, 0 });
+		}
+		polled++;
+	}
+	/* The lights that left their report configuration unanswered are configured by the retries */
+	if (options.ncp.unansweredConfigs > 0 && options.ncp.unansweredConfigs <= config.configureRetries) {
+		size_t expected = ncp.ReportingCount();
+		int64_t configuredMs;
+
+		configuredMs = WaitFor(
+			k_uptime_get(), [&]() { return ncp.SubscribedCount() >= expected; },
+			[&]() { return bridge.GetPollStats().ConfigureRetries; }, 2 * config.configureRetryMs,
+			options.timeoutMs, done);
+		configured &= done && reporting == expected &&
+			      bridge.GetPollStats().ConfigureRetries == expected * options.ncp.unansweredConfigs;
+		printf("poll       %zu/%zu lights that report configured after %u retries in %lld ms, %zu polled %s\n",
+		       static_cast<size_t>(ncp.SubscribedCount()), expected, bridge.GetPollStats().ConfigureRetries,
+		       static_cast<long long>(configuredMs), polled, configured ? "ok" : "FAILED");
+	}
+	if (polled == 0) {
+		printf("poll       no light without reports, see --legacy\n");
+		summary.polled = false;
+		return;
+	}
+
+	uint32_t polls = bridge.GetPollStats().Polls;
+	uint32_t probes = bridge.GetLivenessStats().Probes;
+
+	for (int watched = 0; watched < 2; watched++) {
+		for (int busy = 0; busy < 2; busy++) {
+			for (Device *light : classes[watched][busy]) {
+				counts[watched][busy].push_back(bridge.PollCount(*light));
+			}
+		}
+	}
+	start = k_uptime_get();
+	for (size_t i = 0; i < switched.size(); i++) {
+		/* Spread over the period */
+		switched[i].nextToggle = start + togglePeriod * (i + 1) / switched.size();
+		switched[i].seen = true;
+	}
+	while ((now = k_uptime_get()) - start < window) {
+		for (Switched &light : switched) {
+			if (!light.seen && light.light->IsOn() == ncp.IsLightOn(light.light->GetZbAddr())) {
+				light.seen = true;
+				light.latencyMs += now - light.toggled;
+				light.maxLatencyMs = MAX(light.maxLatencyMs, now - light.toggled);
+			}
+			if (now < light.nextToggle) {
+				continue;
+			}
+			light.unseen += !light.seen;
+			light.toggles++;
+			light.toggled = now;
+			light.seen = false;
+			light.nextToggle = now + togglePeriod;
+			ncp.ToggleLight(light.light->GetZbAddr());
+		}
+		k_sleep(K_MSEC(10));
+	}
+
+	int64_t elapsed = k_uptime_get() - start;
+	double rate = (bridge.GetPollStats().Polls - polls) * 1000.0 / elapsed;
+	double readRate = rate + (bridge.GetLivenessStats().Probes - probes) * 1000.0 / elapsed;
+	double perLight[2][2];
+
+	for (int watched = 0; watched < 2; watched++) {
+		for (int busy = 0; busy < 2; busy++) {
+			perLight[watched][busy] = PollsPerLight(bridge, classes[watched][busy], counts[watched][busy]);
+		}
+	}
+
+	/* Every light no one watched is polled soon after a subscriber comes */
+	std::vector<Device *> unwatched = classes[0][0];
+	std::vector<uint32_t> before;
+
+	unwatched.insert(unwatched.end(), classes[0][1].begin(), classes[0][1].end());
+	for (Device *light : unwatched) {
+		before.push_back(bridge.PollCount(*light));
+		bridge.SetSubscribed(*light, true);
+	}
+	watchedMs = WaitFor(
+		k_uptime_get(),
+		[&]() {
+			for (size_t i = 0; i < unwatched.size(); i++) {
+				if (bridge.PollCount(*unwatched[i]) == before[i]) {
+					return false;
+				}
+			}
+			return true;
+		},
+		[&]() { return bridge.GetPollStats().Polls; }, config.maxIntervalMs, options.timeoutMs, done);
+
+	/* Seen when switched, by polls or reports: the polled lights watched, and the ones reporting */
+	auto seen = [&](bool polledLights, uint32_t &toggles, uint32_t &unseen, int64_t &maxMs) {
+		int64_t totalMs = 0;
+		uint32_t seenCount = 0;
+
+		toggles = unseen = 0;
+		maxMs = 0;
+		for (const Switched &light : switched) {
+			if (bridge.IsPolled(*light.light) != polledLights ||
+			    (polledLights && std::find(classes[1][1].begin(), classes[1][1].end(), light.light) ==
+						     classes[1][1].end())) {
+				continue;
+			}
+			toggles += light.toggles;
+			unseen += light.unseen + !light.seen;
+			totalMs += light.latencyMs;
+			seenCount += light.toggles - light.unseen - !light.seen;
+			maxMs = MAX(maxMs, light.maxLatencyMs);
+		}
+		return seenCount ? totalMs / seenCount : 0;
+	};
+	uint32_t polledToggles, polledUnseen, reportToggles, reportUnseen;
+	int64_t polledMaxMs, reportMaxMs;
+	int64_t polledMs = seen(true, polledToggles, polledUnseen, polledMaxMs);
+	int64_t reportMs = seen(false, reportToggles, reportUnseen, reportMaxMs);
+
+	summary.polled = configured && done && readRate <= budget + 0.5 && perLight[1][1] > perLight[1][0] &&
+			 perLight[1][0] > MAX(perLight[0][0], perLight[0][1]) && reportUnseen <= 1 &&
+			 polledMs < togglePeriod / 2;
+	printf("poll       %zu of %zu lights without reports, intervals %u..%u ms, idle %u ms, budget %u reads/s: "
+	       "%.2f polls/s, %.2f with the probes\n",
+	       polled, polled + reporting, config.minIntervalMs, config.maxIntervalMs, config.idleIntervalMs, budget,
+	       rate, readRate);
+	printf("           polls per light in %u ms: watched %.1f switched, %.1f static, unwatched %.1f switched, "
+	       "%.1f static\n",
+	       window, perLight[1][1], perLight[1][0], perLight[0][1], perLight[0][0]);
+	printf("           switched every %u ms, seen after %lld ms (max %lld) polled, %u/%u missed; %lld ms (max %lld) "
+	       "reported, %u/%u missed\n",
+	       togglePeriod, static_cast<long long>(polledMs), static_cast<long long>(polledMaxMs), polledUnseen,
+	       polledToggles, static_cast<long long>(reportMs), static_cast<long long>(reportMaxMs), reportUnseen,
+	       reportToggles);
+	printf("           %zu lights newly watched: all polled within %lld ms %s\n", unwatched.size(),
+	       static_cast<long long>(watchedMs), summary.polled ? "ok" : "FAILED");
+}
+
+/*
+ * The lights that report are switched locally faster than the shortest
+ * Matter report interval. The watched ones are reported at most once per
+ * interval, the last report carrying the state they ended in, and the
+ * others are not reported to anyone, but bump their data version on every
+ * change. A change written by a command is reported at once, even within
+ * the interval of the previous report.
+ */
+void Reports(SimBridge &bridge, SimNcp &ncp, const Options &options, Summary &summary)
+{
+	const ReportLimiter::Config &config = options.report;
+	/* Unwatched and watched */
+	std::vector<Device *> lights[2];
+	std::vector<uint32_t> counts[2];
+	std::vector<uint32_t> versions;
+	std::vector<Device *> switched;
+	uint32_t window = MAX(5 * config.minIntervalMs, 1000u);
+	uint32_t flapMs = MAX(config.minIntervalMs / 10, 20u);
+	uint32_t toggles = 0;
+	int64_t start;
+	bool done;
+
+	WaitFor(
+		k_uptime_get(), [&]() { return bridge.ConfiguredCount() >= bridge.BridgedCount(); },
+		[&]() { return bridge.ConfiguredCount(); }, options.timeoutMs, options.timeoutMs, done);
+	for (auto &light : bridge.GetLights()) {
+		if (!ZigbeeBridge::IsBridged(light) || bridge.IsPolled(light)) {
+			continue;
+		}
+
+		bool watched = (lights[0].size() + lights[1].size()) % 2 == 0;
+
+		lights[watched].push_back(&light);
+		switched.push_back(&light);
+		if (watched) {
+			bridge.SetSubscribed(light, true);
+		}
+		/* After the report a new subscription is sent */
+		counts[watched].push_back(bridge.ReportCount(light));
+		if (!watched) {
+			versions.push_back(bridge.DataVersion(light));
+		}
+	}
+	if (lights[1].empty()) {
+		printf("reports    no light reporting its state\n");
+		summary.reported = false;
+		return;
+	}
+
+	ReportLimiter::Stats before = bridge.GetReportStats();
+
+	start = k_uptime_get();
+	while (k_uptime_get() - start < window) {
+		/* Spread over the period, as a burst of reports of them all overflows the receiver */
+		for (Device *light : switched) {
+			ncp.ToggleLight(light->GetZbAddr());
+			k_sleep(K_MSEC(flapMs / switched.size()));
+		}
+		toggles++;
+		if (flapMs < switched.size()) {
+			k_sleep(K_MSEC(flapMs));
+		}
+	}
+	/* The held reports go out once their interval is over */
+	k_sleep(K_MSEC(config.minIntervalMs + 2 * config.tickMs + 100));
+
+	ReportLimiter::Stats after = bridge.GetReportStats();
+	uint32_t bound = config.minIntervalMs ? window / config.minIntervalMs + 2 : toggles + 1;
+	uint32_t watchedReports = 0, maxReports = 0, unwatchedReports = 0;
+	size_t stale = 0, silent = 0, unversioned = 0;
+
+	for (size_t i = 0; i < lights[1].size(); i++) {
+		const Device &light = *lights[1][i];
+		uint32_t reports = bridge.ReportCount(light) - counts[1][i];
+
+		watchedReports += reports;
+		maxReports = MAX(maxReports, reports);
+		silent += reports == 0;
+		stale += bridge.ReportedOnOff(light) != light.IsOn();
+	}
+	for (size_t i = 0; i < lights[0].size(); i++) {
+		unwatchedReports += bridge.ReportCount(*lights[0][i]) - counts[0][i];
+		unversioned += bridge.DataVersion(*lights[0][i]) - versions[i] != toggles;
+	}
+
+	/* Seen by the bridge before the command, so that its report is recent or held */
+	Device &written = *lights[1][0];
+	bool on = !ncp.IsLightOn(written.GetZbAddr());
+	uint32_t writtenReports;
+	int64_t writtenMs = -1;
+
+	ncp.ToggleLight(written.GetZbAddr());
+	WaitFor(
+		k_uptime_get(), [&]() { return written.IsOn() == on; }, [&]() { return written.IsOn(); }, options.timeoutMs,
+		options.timeoutMs, done);
+	writtenReports = bridge.ReportCount(written);
+	start = k_uptime_get();
+	if (done && !bridge.PostOnOff(written, !on)) {
+		WaitFor(
+			start,
+			[&]() {
+				return bridge.ReportCount(written) != writtenReports &&
+				       bridge.ReportedOnOff(written) == !on;
+			},
+			[&]() { return bridge.ReportCount(written); }, options.timeoutMs, options.timeoutMs, done);
+		writtenMs = done ? k_uptime_get() - start : -1;
+	}
+
+	summary.reported = unwatchedReports == 0 && unversioned == 0 && silent == 0 && stale == 0 &&
+			   maxReports <= bound && writtenMs >= 0 && writtenMs <= config.minIntervalMs / 2;
+	printf("reports    %zu lights switched every %u ms for %u ms, %u times each, min interval %u ms\n",
+	       switched.size(), flapMs, window, toggles, config.minIntervalMs);
+	printf("           watched %zu: %.1f reports per light (max %u, bound %u), %zu without one, %zu not on the "
+	       "last state; unwatched %zu: %u reports, %zu without a data version per change\n",
+	       lights[1].size(), static_cast<double>(watchedReports) / lights[1].size(), maxReports, bound, silent,
+	       stale, lights[0].size(), unwatchedReports, unversioned);
+	printf("           switched by a command: reported in %lld ms\n", static_cast<long long>(writtenMs));
+	printf("           limiter: %u emitted, %u unwatched, %u coalesced %s\n", after.Emitted - before.Emitted,
+	       after.Unwatched - before.Unwatched, after.Coalesced - before.Coalesced,
+	       summary.reported ? "ok" : "FAILED");
+}
+
+/*
+ * The first bridged light loses power and the shell of the NCP waits
+ * longer for it than the bridge waits for the shell, so its "Error" comes
+ * after the command timed out, while the command to the second light is
+ * already sent. That command must complete on its own "Done" and switch
+ * the second light, not fail on the late "Error".
+ */
+void Late(SimBridge &bridge, SimNcp &ncp, const Options &options, Summary &summary)
+{
+	std::vector<Device *> lights;
+	uint32_t before, errors, timeouts, late;
+	bool done, on;
+
+	for (auto &light : bridge.GetLights()) {
+		if (ZigbeeBridge::IsBridged(light) && light.IsReachable() && lights.size() < 2) {
+			lights.push_back(&light);
+		}
+	}
+	if (lights.size() < 2) {
+		printf("late       two reachable lights needed\n");
+		summary.late = false;
+		return;
+	}
+
+	Device &dark = *lights[0];
+	Device &next = *lights[1];
+
+	before = bridge.GetCommandStats().Completed;
+	errors = bridge.GetCommandStats().Errors;
+	timeouts = bridge.GetShellStats().commandTimeouts;
+	late = bridge.GetShellStats().commandLateResponses;
+	on = !next.IsOn();
+	ncp.SetLossTimeout(CONFIG_ZIGBEE_SHELL_CMD_TIMEOUT_MS + 1000);
+	ncp.SetLightPowered(dark.GetZbAddr(), false);
+	if (bridge.PostOnOff(dark, !dark.IsOn()) || bridge.PostOnOff(next, on)) {
+		printf("late       commands not posted\n");
+		summary.late = false;
+		return;
+	}
+	WaitFor(
+		k_uptime_get(), [&]() { return bridge.GetCommandStats().Completed >= before + 2; },
+		[&]() { return bridge.GetCommandStats().Completed; }, CONFIG_ZIGBEE_SHELL_CMD_TIMEOUT_MS + 2000,
+		CONFIG_ZIGBEE_SHELL_CMD_TIMEOUT_MS + options.timeoutMs, done);
+	/* The late "Error" is parsed once the second command completed */
+	WaitFor(
+		k_uptime_get(), [&]() { return bridge.GetShellStats().commandLateResponses != late; },
+		[&]() { return 0; }, 2000, 2000, done);
+	ncp.SetLightPowered(dark.GetZbAddr(), true);
+	ncp.SetLossTimeout(options.ncp.lossTimeoutMs);
+
+	SimBridge::CommandStats stats = bridge.GetCommandStats();
+	const ZigbeeShell::Stats &shell = bridge.GetShellStats();
+
+	summary.late = stats.Completed == before + 2 && stats.Errors == errors + 1 &&
+		       shell.commandTimeouts == timeouts + 1 && shell.commandLateResponses == late + 1 &&
+		       next.IsOn() == on && ncp.IsLightOn(next.GetZbAddr()) == on;
+	printf("late       0x%04hx timed out, %u late response dropped, next command to 0x%04hx %s\n", dark.GetZbAddr(),
+	       shell.commandLateResponses - late, next.GetZbAddr(), summary.late ? "ok" : "FAILED");
+}
+
+/* Runs the scenario in this process, which cannot start another bridge afterwards */
+void Run(const Options &options, Summary &summary)
+{
+	int fds[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+		perror("socketpair");
+		_exit(1);
+	}
+
+	static SimNcp sNcp(options.ncp);
+
+	std::thread([ncpFd = fds[1]]() { sNcp.Run(ncpFd); }).detach();
+	sim_uart_attach(CONFIG_ZIGBEE_SHELL_DEVICE_NAME, fds[0]);
+	sim_uart_set_flow_control(CONFIG_ZIGBEE_SHELL_DEVICE_NAME, false);
+	sim_uart_set_line(CONFIG_ZIGBEE_SHELL_DEVICE_NAME, options.ncp.baudRate, options.flowControl);
+
+	static ZigbeeShell sZbShell;
+	static SimBridge sBridge(sZbShell, options.endpoints, options.liveness, options.poll, options.report,
+				 options.readsPerSecond);
+	std::istringstream scenario(options.scenario);
+	std::string phase;
+
+	printf("scenario   %u lights, latency %u+%u us, loss %u%%, reports every %u ms\n", options.ncp.lightCount,
+	       options.ncp.latencyUs, options.ncp.jitterUs, options.ncp.lossPercent, options.ncp.reportIntervalMs);
+	sBridge.Start();
+	while (std::getline(scenario, phase, ',')) {
+		if (phase == "discover") {
+			Discover(sBridge, options, summary);
+		} else if (phase == "burst") {
+			Burst(sBridge, sNcp, options, summary);
+		} else if (phase == "toggle") {
+			Toggle(sBridge, options, summary);
+		} else if (phase == "noisy") {
+			Noisy(sBridge, options, summary);
+		} else if (phase == "outage") {
+			Outage(sBridge, sNcp, options, summary);
+		} else if (phase == "liveness") {
+			Liveness(sBridge, sNcp, options, summary);
+		} else if (phase == "poll") {
+			Poll(sBridge, sNcp, options, summary);
+		} else if (phase == "reports") {
+			Reports(sBridge, sNcp, options, summary);
+		} else if (phase == "late") {
+			Late(sBridge, sNcp, options, summary);
+		} else {
+			fprintf(stderr, "Unknown phase %s\n", phase.c_str());
+			_exit(1);
+		}
+		fflush(stdout);
+	}
+
+	SimNcp::Stats ncp = sNcp.GetStats();
+	const ZigbeeShell::StartInfo &start = sZbShell.GetStartInfo();
+
+	summary.baudRate = start.baudRate;
+	summary.flowControl = start.flowControl;
+	summary.bridged = sBridge.BridgedCount();
+	summary.lost = sim_uart_rx_lost(CONFIG_ZIGBEE_SHELL_DEVICE_NAME);
+	summary.resyncs = sZbShell.GetStats().rxResyncs;
+	printf("NCP        %u responses, %u frames lost, %u announces, %u reports\n", ncp.responses, ncp.lost,
+	       ncp.announces, ncp.reports);
+	printf("UART       NCP at %u baud, link at %u baud after %u probes, flow control %s, %zu bytes lost on the "
+	       "line\n",
+	       options.ncp.baudRate, start.baudRate, start.linkProbes, start.flowControl ? "on" : "off",
+	       summary.lost);
+	sBridge.PrintStats();
+	fflush(stdout);
+	if (options.capture != nullptr && !CaptureFile::Save(options.capture)) {
+		_exit(1);
+	}
+}
+
+/* Each rate gets a process of its own, as the bridge cannot be torn down */
+bool ForkRun(const Options &options, Summary &summary)
+{
+	int fds[2];
+	pid_t pid;
+
+	if (pipe(fds)) {
+		perror("pipe");
+		return false;
+	}
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return false;
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		Run(options, summary);
+		if (write(fds[1], &summary, sizeof(summary)) != sizeof(summary)) {
+			_exit(1);
+		}
+		_exit(0);
+	}
+
+	ssize_t len = read(fds[0], &summary, sizeof(summary));
+
+	close(fds[0]);
+	close(fds[1]);
+	waitpid(pid, nullptr, 0);
+
+	return len == sizeof(summary);
+}
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	Options options;
+	Summary summary;
+
+	if (!ParseOptions(argc, argv, options)) {
+		Usage(argv[0]);
+		return 1;
+	}
+	sim_log_set_level(options.logLevel);
+
+	if (options.baudRates.empty()) {
+		summary.fair = true;
+		summary.recovered = true;
+		summary.live = true;
+		summary.polled = true;
+		summary.reported = true;
+		summary.late = true;
+		summary.stalled = false;
+		Run(options, summary);
+		_exit(!summary.stalled && summary.fair && summary.recovered && summary.live && summary.polled &&
+				      summary.reported && summary.late ? 0 : 1);
+	}
+
+	std::vector<Summary> results;
+	bool stalled = false;
+
+	for (uint32_t baudRate : options.baudRates) {
+		printf("== NCP at %u baud\n", baudRate);
+		options.ncp.baudRate = baudRate;
+		summary = {};
+		if (!ForkRun(options, summary)) {
+			fprintf(stderr, "Run at %u baud failed\n", baudRate);
+			return 1;
+		}
+		results.push_back(summary);
+		stalled |= summary.stalled;
+	}
+
+	printf("\n%10s %10s %6s %8s %10s %10s %10s %10s %8s\n", "ncp baud", "link baud", "flow", "bridged",
+	       "commands", "cmd/s", "p50 ms", "p99 ms", "resyncs");
+	for (size_t i = 0; i < results.size(); i++) {
+		const Summary &result = results[i];
+
+		printf("%10u %10u %6s %8zu %10zu %10.1f %10.2f %10.2f %8u\n", options.baudRates[i], result.baudRate,
+		       result.flowControl ? "on" : "off", result.bridged, result.completed, result.commandsPerSecond,
+		       result.p50Us / 1e3, result.p99Us / 1e3, result.resyncs);
+	}
+
+	return stalled ? 1 : 0;
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "app_event_queue.h"
+
+#include <logging/log.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ * Stress test of the app event queue with several producer threads.
+ *
+ * Every producer posts a numbered run of events into each lane, posting
+ * again whenever the lane is full, and between them the coalesced events
+ * of the lane. One consumer thread takes the events as the app task does
+ * and checks that no event is lost or taken twice, that the events of a
+ * producer come out of a lane in the order they were posted, and that
+ * every coalesced post is followed by the event of its key being taken,
+ * so that no key is left set without an event queued.
+ */
+
+namespace {
+struct Options {
+	uint32_t producers = 4;
+	uint32_t events = 20000;
+	/* Events posted between two coalesced ones */
+	uint32_t coalesceEvery = 7;
+};
+
+struct LaneKey {
+	AppEvent event;
+	uint32_t key;
+};
+
+/* The coalesced event posted into each lane */
+const LaneKey kLaneKeys[AppEventQueue::kLaneCount] = {
+	{ AppEvent(AppEvent::DeviceCmdReady), AppEvent::kCoalesce_DeviceCmdReady },
+	{ AppEvent(AppEvent::SubscriptionsChanged), AppEvent::kCoalesce_SubscriptionsChanged },
+	{ AppEvent(AppEvent::PollTimer), AppEvent::kCoalesce_PollTimer },
+};
+
+/* Posts of the coalesced event of a lane not yet followed by one taken */
+std::atomic<uint32_t> sDirty[AppEventQueue::kLaneCount];
+
+void Usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --producers N     producer threads (default 4)\n"
+		"  --events N        events each producer posts into each lane (default 20000)\n",
+		name);
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+
+		if (!strcmp(argv[i], "--producers") && hasValue) {
+			options.producers = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--events") && hasValue) {
+			options.events = strtoul(argv[++i], nullptr, 0);
+		} else {
+			return false;
+		}
+	}
+
+	return options.producers > 0 && options.producers <= UINT16_MAX / AppEventQueue::kLaneCount;
+}
+
+/* The producer and lane of a numbered event, and its number */
+AppEvent Numbered(uint32_t producer, uint8_t lane, uint32_t number)
+{
+	AppEvent event(AppEvent::BenchPing);
+
+	event.DeviceCmdEvent = { nullptr, static_cast<uint16_t>(producer * AppEventQueue::kLaneCount + lane), false,
+				 number };
+
+	return event;
+}
+
+struct ProducerStats {
+	/* Posts refused with the lane full, posted again */
+	uint32_t retries[AppEventQueue::kLaneCount] = {};
+	/* Posts of the coalesced event, queued or coalesced */
+	uint32_t keyPosts[AppEventQueue::kLaneCount] = {};
+};
+
+void Produce(AppEventQueue &queue, const Options &options, uint32_t producer, ProducerStats &stats)
+{
+	for (uint32_t number = 0; number < options.events; number++) {
+		for (uint8_t lane = 0; lane < AppEventQueue::kLaneCount; lane++) {
+			AppEventQueue::Lane id = static_cast<AppEventQueue::Lane>(lane);
+
+			while (queue.Post(Numbered(producer, lane, number), id)) {
+				stats.retries[lane]++;
+				k_yield();
+			}
+			if ((number + producer) % options.coalesceEvery) {
+				continue;
+			}
+			/* Set before the post, the consumer clears it once it took an event of the key */
+			sDirty[lane].store(1);
+			while (queue.Post(kLaneKeys[lane].event, id, kLaneKeys[lane].key)) {
+				stats.retries[lane]++;
+				k_yield();
+			}
+			stats.keyPosts[lane]++;
+		}
+	}
+}
+
+struct ConsumerStats {
+	uint32_t taken[AppEventQueue::kLaneCount] = {};
+	uint32_t keyTaken[AppEventQueue::kLaneCount] = {};
+	uint32_t outOfOrder = 0;
+	uint32_t unknown = 0;
+};
+
+/* Takes the events until the stop event and the events queued before it */
+void Consume(AppEventQueue &queue, std::vector<uint32_t> &next, ConsumerStats &stats)
+{
+	bool stopped = false;
+	AppEvent event;
+
+	for (;;) {
+		if (stopped) {
+			uint32_t depth = 0;
+
+			for (uint8_t lane = 0; lane < AppEventQueue::kLaneCount; lane++) {
+				depth += queue.Depth(static_cast<AppEventQueue::Lane>(lane));
+			}
+			if (depth == 0) {
+				return;
+			}
+		}
+		queue.Get(event);
+
+		if (event.Type == AppEvent::FunctionRelease) {
+			stopped = true;
+			continue;
+		}
+		if (event.Type == AppEvent::BenchPing) {
+			uint16_t stream = event.DeviceCmdEvent.Seq;
+
+			if (stream >= next.size()) {
+				stats.unknown++;
+				continue;
+			}
+			stats.taken[stream % AppEventQueue::kLaneCount]++;
+			if (event.DeviceCmdEvent.Timestamp != next[stream]) {
+				stats.outOfOrder++;
+			}
+			next[stream] = event.DeviceCmdEvent.Timestamp + 1;
+			continue;
+		}
+
+		uint8_t lane = 0;
+
+		while (lane < AppEventQueue::kLaneCount && kLaneKeys[lane].event.Type != event.Type) {
+			lane++;
+		}
+		if (lane == AppEventQueue::kLaneCount) {
+			stats.unknown++;
+			continue;
+		}
+		stats.taken[lane]++;
+		stats.keyTaken[lane]++;
+		sDirty[lane].store(0);
+	}
+}
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	static AppEventQueue sQueue;
+	Options options;
+	ConsumerStats consumed;
+	bool ok = true;
+
+	if (!ParseOptions(argc, argv, options)) {
+		Usage(argv[0]);
+		return 1;
+	}
+	sim_log_set_level(LOG_LEVEL_NONE);
+	sQueue.Init();
+
+	std::vector<uint32_t> next(options.producers * AppEventQueue::kLaneCount, 0);
+	std::vector<ProducerStats> produced(options.producers);
+	std::vector<std::thread> producers;
+	int64_t start = k_uptime_get();
+
+	std::thread consumer([&]() { Consume(sQueue, next, consumed); });
+	for (uint32_t i = 0; i < options.producers; i++) {
+		producers.emplace_back([&, i]() { Produce(sQueue, options, i, produced[i]); });
+	}
+	for (auto &producer : producers) {
+		producer.join();
+	}
+	while (sQueue.Post(AppEvent(AppEvent::FunctionRelease), AppEventQueue::kLane_Control)) {
+		k_yield();
+	}
+	consumer.join();
+
+	printf("%u producers, %u events each per lane, %lld ms\n", options.producers, options.events,
+	       static_cast<long long>(k_uptime_get() - start));
+	for (uint8_t lane = 0; lane < AppEventQueue::kLaneCount; lane++) {
+		AppEventQueue::Lane id = static_cast<AppEventQueue::Lane>(lane);
+		AppEventQueue::LaneStats stats = sQueue.Stats(id);
+		uint32_t retries = 0, keyPosts = 0, missing = 0;
+		bool laneOk;
+
+		for (const ProducerStats &producer : produced) {
+			retries += producer.retries[lane];
+			keyPosts += producer.keyPosts[lane];
+		}
+		for (uint32_t i = 0; i < options.producers; i++) {
+			missing += options.events - next[i * AppEventQueue::kLaneCount + lane];
+		}
+		/* The stop event was posted into the control lane and taken */
+		stats.Posted -= (id == AppEventQueue::kLane_Control);
+
+		laneOk = missing == 0 && stats.Posted == consumed.taken[lane] && stats.Dropped == retries &&
+			 keyPosts == consumed.keyTaken[lane] + stats.Coalesced && sDirty[lane].load() == 0;
+		printf("%-12s %u taken, %u missing, %u posted again when full, %u keyed posts: %u taken, %u coalesced "
+		       "%s\n",
+		       AppEventQueue::LaneName(id), consumed.taken[lane], missing, retries, keyPosts,
+		       consumed.keyTaken[lane], stats.Coalesced, laneOk ? "ok" : "FAILED");
+		ok &= laneOk;
+	}
+	printf("%u out of order, %u unknown\n", consumed.outOfOrder, consumed.unknown);
+	ok &= consumed.outOfOrder == 0 && consumed.unknown == 0;
+
+	return ok ? 0 : 1;
+}
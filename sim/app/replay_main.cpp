@@ -0,0 +1,626 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "capture_file.h"
+#include "zigbee_shell.h"
+
+#include <logging/log.h>
+#include <sim_thread.h>
+#include <sim_uart.h>
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+/*
+ * Replays a Zigbee UART capture into the transport and checks the parser.
+ *
+ * Each pass runs a fresh ZigbeeShell in a child process. The commands of
+ * the capture are issued again through the ZigbeeShell API, and the RX
+ * chunks captured after each command are fed back once the shell has
+ * written it, so requests and responses keep their original order. Each
+ * chunk is fed only after the parser and the command issuer settled on
+ * the previous one, which makes a pass deterministic. The first pass
+ * keeps the captured chunking, the others cut the RX stream between two
+ * commands at random. Every pass must decode the same events and command
+ * results; the CPU time of the shell RX thread gives the parse time.
+ */
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+	const char *input = nullptr;
+	uint32_t passes = 3;
+	size_t maxChunk = 64;
+	uint32_t seed = 1;
+	const char *events = nullptr;
+	const char *expect = nullptr;
+	int logLevel = LOG_LEVEL_NONE;
+};
+
+struct PassResult {
+	size_t chunks = 0;
+	size_t bytes = 0;
+	uint64_t parseUs = 0;
+	uint64_t wallUs = 0;
+	uint32_t overflows = 0;
+	uint32_t resyncs = 0;
+	uint32_t parserErrors = 0;
+	uint32_t timeouts = 0;
+	std::string error;
+	std::vector<std::string> events;
+	std::vector<std::string> commands;
+};
+
+struct RecordedEvent {
+	ZigbeeShell::Event_t Type;
+	ZigbeeShell::BdbEvent Bdb;
+	ZigbeeShell::ZdoEvent Zdo;
+	ZigbeeShell::ZclEvent Zcl;
+};
+
+void Usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options] CAPTURE\n"
+		"  CAPTURE           binary capture or console log with \"bridge capture dump\"\n"
+		"  --passes N        passes with random chunking after the original one (default 3)\n"
+		"  --chunk N         largest random chunk in bytes (default 64)\n"
+		"  --seed N          seed of the random chunking (default 1)\n"
+		"  --events FILE     write the decoded sequence of the first pass\n"
+		"  --expect FILE     compare the decoded sequence with one written before\n"
+		"  -v                log transport messages, repeat for more\n",
+		name);
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+
+		if (!strcmp(argv[i], "--passes") && hasValue) {
+			options.passes = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--chunk") && hasValue) {
+			options.maxChunk = atoi(argv[++i]);
+			options.maxChunk = MAX(options.maxChunk, 1);
+		} else if (!strcmp(argv[i], "--seed") && hasValue) {
+			options.seed = strtoul(argv[++i], nullptr, 0);
+		} else if (!strcmp(argv[i], "--events") && hasValue) {
+			options.events = argv[++i];
+		} else if (!strcmp(argv[i], "--expect") && hasValue) {
+			options.expect = argv[++i];
+		} else if (argv[i][0] == '-' && argv[i][1] == 'v' && strspn(argv[i] + 1, "v") == strlen(argv[i] + 1)) {
+			options.logLevel += strlen(argv[i]) - 1;
+		} else if (argv[i][0] != '-' && options.input == nullptr) {
+			options.input = argv[i];
+		} else {
+			return false;
+		}
+	}
+
+	return options.input != nullptr;
+}
+
+std::string Printable(const std::string &data)
+{
+	std::string text;
+
+	for (char c : data) {
+		if (c == '\r' || c == '\n') {
+			continue;
+		}
+		text += isprint(static_cast<unsigned char>(c)) ? c : '.';
+	}
+
+	return text;
+}
+
+std::string FormatEvent(const RecordedEvent &event)
+{
+	char text[160];
+
+	switch (event.Type) {
+	case ZigbeeShell::kEvent_NetworkRejoin:
+	case ZigbeeShell::kEvent_NetworkSteering:
+		snprintf(text, sizeof(text), "%s ext_pan_id=%s pan_id=0x%04x",
+			 event.Type == ZigbeeShell::kEvent_NetworkRejoin ? "rejoin" : "steering", event.Bdb.ext_pan_id,
+			 event.Bdb.pan_id);
+		break;
+	case ZigbeeShell::kEvent_DeviceAnnounceRsp:
+		snprintf(text, sizeof(text), "announce 0x%04x", event.Zdo.addr);
+		break;
+	case ZigbeeShell::kEvent_ActiveEpRsp:
+		snprintf(text, sizeof(text), "active_ep 0x%04x ep=%u", event.Zdo.addr, event.Zdo.ep);
+		break;
+	case ZigbeeShell::kEvent_SimpleDescRsp:
+		snprintf(text, sizeof(text), "simple_desc 0x%04x ep=%u dev_id=0x%04x", event.Zdo.addr, event.Zdo.ep,
+			 event.Zdo.dev_id);
+		break;
+	case ZigbeeShell::kEvent_ZclAttrRead:
+	case ZigbeeShell::kEvent_ZclAttrReport:
+		snprintf(text, sizeof(text), "%s 0x%04x ep=%u cluster=0x%04x attr=0x%04x type=0x%02x value=%s",
+			 event.Type == ZigbeeShell::kEvent_ZclAttrRead ? "attr" : "report", event.Zcl.addr, event.Zcl.ep, event.Zcl.cluster_id, event.Zcl.attr_id, event.Zcl.type,
+			 event.Zcl.value);
+		break;
+	case ZigbeeShell::kEvent_Ready:
+		snprintf(text, sizeof(text), "ready");
+		break;
+	default:
+		snprintf(text, sizeof(text), "event %d", event.Type);
+		break;
+	}
+
+	return text;
+}
+
+/* State of the pass running in this process */
+const CaptureFile *sCapture;
+/* End of the chunks replayed, without the commands the capture was saved before the response of */
+size_t sReplayEnd;
+std::vector<RecordedEvent> sEvents;
+std::mutex sEventsLock;
+std::atomic<size_t> sCommandsMatched;
+std::atomic<bool> sNcpDone;
+std::string sNcpError;
+k_tid_t sRxThread;
+k_tid_t sDriverThread;
+
+void OnEvent(ZigbeeShell *shell, ZigbeeShell::EventPayload *payload)
+{
+	RecordedEvent event = {};
+
+	ARG_UNUSED(shell);
+
+	/* Runs on the RX thread being timed, so formatting is left for later */
+	event.Type = payload->type;
+	switch (payload->type) {
+	case ZigbeeShell::kEvent_NetworkRejoin:
+	case ZigbeeShell::kEvent_NetworkSteering:
+		event.Bdb = payload->Bdb;
+		break;
+	case ZigbeeShell::kEvent_ZclAttrRead:
+	case ZigbeeShell::kEvent_ZclAttrReport:
+		event.Zcl = payload->Zcl;
+		break;
+	default:
+		event.Zdo = payload->Zdo;
+		break;
+	}
+
+	std::lock_guard<std::mutex> guard(sEventsLock);
+
+	sEvents.push_back(event);
+}
+
+void FindRxThread(const struct k_thread *thread, void *userData)
+{
+	ARG_UNUSED(userData);
+
+	if (!strcmp(thread->name, "zb_rx")) {
+		sRxThread = const_cast<k_tid_t>(thread);
+	}
+}
+
+void Feed(const std::string &data, PassResult &result)
+{
+	uint32_t waits = sim_thread_wait_count(sRxThread);
+
+	sim_uart_rx_inject(CONFIG_ZIGBEE_SHELL_DEVICE_NAME, reinterpret_cast<const uint8_t *>(data.data()),
+			   data.size());
+	/* Let the RX thread parse the chunk, and a command it completed move on, before the next one */
+	while (sim_thread_wait_count(sRxThread) == waits || !sim_thread_is_blocked(sDriverThread)) {
+		std::this_thread::yield();
+	}
+	result.chunks++;
+	result.bytes += data.size();
+}
+
+/* Feeds the RX chunks from index on until the next command, returns the index of that command */
+size_t FeedRx(size_t index, bool random, std::mt19937 &rng, size_t maxChunk, PassResult &result)
+{
+	const std::vector<CaptureFile::Chunk> &chunks = sCapture->Chunks;
+	std::string stream;
+
+	for (; index < chunks.size() && chunks[index].Direction == UartCapture::kDirection_Rx; index++) {
+		if (random) {
+			stream += chunks[index].Data;
+		} else {
+			Feed(chunks[index].Data, result);
+		}
+	}
+	for (size_t pos = 0; pos < stream.size();) {
+		size_t len = MIN(stream.size() - pos, std::uniform_int_distribution<size_t>(1, maxChunk)(rng));
+
+		Feed(stream.substr(pos, len), result);
+		pos += len;
+	}
+
+	return index;
+}
+
+/* Sent by ZigbeeShell::SetupLink() at start */
+const char kLinkProbe[] = "shell echo off\r\n";
+const char kPromptRsp[] = "\r\nuart:~$ ";
+
+bool ReadCommand(int fd, std::string &command)
+{
+	char c;
+
+	command.clear();
+	while (read(fd, &c, 1) == 1) {
+		command += c;
+		if (c == '\n') {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Plays the NCP: checks each command against the capture and answers with the captured RX */
+void NcpThreadMain(int fd, bool random, uint32_t seed, size_t maxChunk, PassResult *result)
+{
+	const std::vector<CaptureFile::Chunk> &chunks = sCapture->Chunks;
+	std::mt19937 rng(seed);
+	size_t index = FeedRx(0, random, rng, maxChunk, *result);
+	std::string command;
+
+	while (index < sReplayEnd) {
+		if (!ReadCommand(fd, command)) {
+			break;
+		}
+		if (command != chunks[index].Data && command == kLinkProbe) {
+			/* Captures from before the link setup have no probes, answered as by the NCP */
+			Feed(kPromptRsp, *result);
+			continue;
+		}
+		if (command != chunks[index].Data) {
+			sNcpError = "sent \"" + Printable(command) + "\", captured \"" + Printable(chunks[index].Data) + "\"";
+			break;
+		}
+		sCommandsMatched++;
+		index = FeedRx(index + 1, random, rng, maxChunk, *result);
+	}
+	sNcpDone = true;
+}
+
+/* Issues a captured command again through the API that produced it */
+bool IssueCommand(ZigbeeShell &shell, const std::string &command, int &err)
+{
+	uint16_t addr, profile, cluster, attr, cmd, minInterval, maxInterval;
+	uint8_t ep, type;
+
+	if (command == "bdb start") {
+		err = shell.NetworkSteering();
+	} else if (sscanf(command.c_str(), "zdo active_ep 0x%hx", &addr) == 1) {
+		err = shell.ZdoActiveEpReq(addr);
+	} else if (sscanf(command.c_str(), "zdo simple_desc_req 0x%hx %hhu", &addr, &ep) == 2) {
+		err = shell.ZdoSimpleDescReq(addr, ep);
+	} else if (sscanf(command.c_str(), "zcl cmd -d 0x%hx %hhu 0x%hx 0x%hx", &addr, &ep, &cluster, &cmd) == 4) {
+		err = shell.ZclCmd(addr, ep, cluster, cmd);
+	} else if (sscanf(command.c_str(), "zcl attr read 0x%hx %hhu 0x%hx 0x%hx 0x%hx", &addr, &ep, &cluster,
+			  &profile, &attr) == 5) {
+		err = shell.ZclAttrRead(addr, ep, profile, static_cast<ZigbeeShell::Cluster_t>(cluster), attr);
+	} else if (sscanf(command.c_str(), "zcl subscribe on 0x%hx %hhu 0x%hx 0x%hx 0x%hx %hhu %hu %hu", &addr, &ep,
+			  &cluster, &profile, &attr, &type, &minInterval, &maxInterval) == 8) {
+		err = shell.ZclSubscribe(addr, ep, profile, static_cast<ZigbeeShell::Cluster_t>(cluster), attr,
+					 static_cast<ZigbeeShell::ZclAttrType_t>(type), minInterval, maxInterval);
+	} else if (command.compare(0, strlen("zdo match_desc "), "zdo match_desc ") == 0) {
+		std::istringstream args(command.substr(strlen("zdo match_desc ")));
+		uint16_t dst, req, inClusters[8], outClusters[8];
+		unsigned int inCount = 0, outCount = 0;
+
+		args >> std::hex >> dst >> req >> profile >> std::dec >> inCount;
+		for (unsigned int i = 0; i < inCount && i < ARRAY_SIZE(inClusters); i++) {
+			args >> std::hex >> inClusters[i];
+		}
+		args >> std::dec >> outCount;
+		for (unsigned int i = 0; i < outCount && i < ARRAY_SIZE(outClusters); i++) {
+			args >> std::hex >> outClusters[i];
+		}
+		if (!args || inCount > ARRAY_SIZE(inClusters) || outCount > ARRAY_SIZE(outClusters)) {
+			return false;
+		}
+		err = shell.ZdoMatchDesc(dst, req, profile, inCount, inClusters, outCount, outClusters);
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+bool IsStartCommand(const std::string &command)
+{
+	/* The link setup probes come first since it was added */
+	return command == "shell echo off" || command == "shell colors off" || command == "kernel reboot cold";
+}
+
+/* Runs one pass in this process and fills the result */
+void RunPass(bool random, uint32_t seed, size_t maxChunk, PassResult &result)
+{
+	std::vector<size_t> commands;
+	int fds[2];
+
+	for (size_t i = 0; i < sReplayEnd; i++) {
+		if (sCapture->Chunks[i].Direction == UartCapture::kDirection_Tx) {
+			commands.push_back(i);
+		}
+	}
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+		result.error = "socketpair failed";
+		return;
+	}
+	sim_uart_attach(CONFIG_ZIGBEE_SHELL_DEVICE_NAME, fds[0]);
+	/* The injected bytes wait for the parser instead of being lost */
+	sim_uart_set_flow_control(CONFIG_ZIGBEE_SHELL_DEVICE_NAME, true);
+
+	static ZigbeeShell sZbShell;
+	k_thread_runtime_stats_t before, after;
+	Clock::time_point start = Clock::now();
+
+	sZbShell.SetEventCallback(OnEvent);
+	sDriverThread = k_current_get();
+	k_thread_foreach(FindRxThread, nullptr);
+	k_thread_runtime_stats_get(sRxThread, &before);
+	std::thread(NcpThreadMain, fds[1], random, seed, maxChunk, &result).detach();
+
+	while (sNcpError.empty() && sCommandsMatched < commands.size()) {
+		size_t matched = sCommandsMatched;
+		std::string command = Printable(sCapture->Chunks[commands[matched]].Data);
+		int err = 0;
+
+		if (matched == 0 && IsStartCommand(command)) {
+			err = sZbShell.Start();
+			command = "start";
+		} else if (!IssueCommand(sZbShell, command, err)) {
+			result.error = "cannot replay \"" + command + "\"";
+			break;
+		}
+		result.commands.push_back(command + " -> " + std::to_string(err));
+		if (sCommandsMatched == matched && sNcpError.empty()) {
+			result.error = "\"" + command + "\" was not sent";
+			break;
+		}
+	}
+	while (result.error.empty() && sNcpError.empty() && !sNcpDone) {
+		k_sleep(K_MSEC(1));
+	}
+	if (!sNcpError.empty()) {
+		result.error = sNcpError;
+	}
+
+	k_thread_runtime_stats_get(sRxThread, &after);
+	result.parseUs = after.execution_cycles - before.execution_cycles;
+	result.wallUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+	result.overflows = sZbShell.GetStats().rxOverflows;
+	result.resyncs = sZbShell.GetStats().rxResyncs;
+	result.parserErrors = sZbShell.GetStats().parserErrors;
+	result.timeouts = sZbShell.GetStats().commandTimeouts;
+
+	std::lock_guard<std::mutex> guard(sEventsLock);
+
+	for (const RecordedEvent &event : sEvents) {
+		result.events.push_back(FormatEvent(event));
+	}
+}
+
+/* Each pass gets a process of its own, as the transport cannot be torn down */
+bool ForkPass(bool random, uint32_t seed, size_t maxChunk, PassResult &result)
+{
+	int fds[2];
+	pid_t pid;
+
+	if (pipe(fds)) {
+		perror("pipe");
+		return false;
+	}
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return false;
+	}
+	if (pid == 0) {
+		std::ostringstream out;
+
+		close(fds[0]);
+		RunPass(random, seed, maxChunk, result);
+		out << result.chunks << ' ' << result.bytes << ' ' << result.parseUs << ' ' << result.wallUs << ' '
+		    << result.overflows << ' ' << result.resyncs << ' ' << result.parserErrors << ' '
+		    << result.timeouts << '\n'
+		    << result.error << '\n';
+		for (const std::string &event : result.events) {
+			out << "event " << event << '\n';
+		}
+		for (const std::string &command : result.commands) {
+			out << "command " << command << '\n';
+		}
+
+		std::string text = out.str();
+
+		for (size_t written = 0; written < text.size();) {
+			ssize_t ret = write(fds[1], text.data() + written, text.size() - written);
+
+			if (ret <= 0) {
+				break;
+			}
+			written += ret;
+		}
+		/* The shell threads never return, leave without running destructors */
+		_exit(0);
+	}
+
+	std::string text;
+	char buf[4096];
+	ssize_t len;
+	int status;
+
+	close(fds[1]);
+	while ((len = read(fds[0], buf, sizeof(buf))) > 0) {
+		text.append(buf, len);
+	}
+	close(fds[0]);
+	waitpid(pid, &status, 0);
+
+	std::istringstream in(text);
+	std::string line;
+
+	if (!(in >> result.chunks >> result.bytes >> result.parseUs >> result.wallUs >> result.overflows >>
+	      result.resyncs >> result.parserErrors >> result.timeouts)) {
+		result.error = WIFSIGNALED(status) ? std::string("pass crashed: ") + strsignal(WTERMSIG(status)) :
+						     "pass failed";
+		return true;
+	}
+	std::getline(in, line);
+	std::getline(in, result.error);
+	while (std::getline(in, line)) {
+		if (line.compare(0, 6, "event ") == 0) {
+			result.events.push_back(line.substr(6));
+		} else if (line.compare(0, 8, "command ") == 0) {
+			result.commands.push_back(line.substr(8));
+		}
+	}
+
+	return true;
+}
+
+std::vector<std::string> Sequence(const PassResult &result)
+{
+	std::vector<std::string> lines;
+
+	for (const std::string &event : result.events) {
+		lines.push_back("event " + event);
+	}
+	for (const std::string &command : result.commands) {
+		lines.push_back("command " + command);
+	}
+
+	return lines;
+}
+
+/* Empty when equal, otherwise the first difference */
+std::string Compare(const std::vector<std::string> &actual, const std::vector<std::string> &expected)
+{
+	for (size_t i = 0; i < MAX(actual.size(), expected.size()); i++) {
+		const char *got = i < actual.size() ? actual[i].c_str() : "(end)";
+		const char *want = i < expected.size() ? expected[i].c_str() : "(end)";
+
+		if (strcmp(got, want)) {
+			return "line " + std::to_string(i + 1) + ": \"" + got + "\", expected \"" + want + "\"";
+		}
+	}
+
+	return "";
+}
+
+void PrintCapture(const CaptureFile &capture)
+{
+	size_t rxChunks = 0, rxBytes = 0, commands = 0;
+	uint32_t durationMs = 0;
+
+	for (const CaptureFile::Chunk &chunk : capture.Chunks) {
+		if (chunk.Direction == UartCapture::kDirection_Rx) {
+			rxChunks++;
+			rxBytes += chunk.Data.size();
+		} else {
+			commands++;
+		}
+	}
+	if (!capture.Chunks.empty() && capture.CyclesPerSecond) {
+		uint32_t cycles = capture.Chunks.back().Timestamp - capture.Chunks.front().Timestamp;
+
+		durationMs = static_cast<uint64_t>(cycles) * 1000 / capture.CyclesPerSecond;
+	}
+	printf("capture    %zu RX chunks, %zu bytes, %zu commands over %u ms, %u records dropped\n", rxChunks,
+	       rxBytes, commands, durationMs, capture.Dropped);
+}
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	Options options;
+	CaptureFile capture;
+	std::vector<std::string> reference;
+	bool ok = true;
+
+	if (!ParseOptions(argc, argv, options)) {
+		Usage(argv[0]);
+		return 1;
+	}
+	if (!capture.Load(options.input)) {
+		fprintf(stderr, "%s: no capture found\n", options.input);
+		return 1;
+	}
+	sim_log_set_level(options.logLevel);
+	sCapture = &capture;
+	sReplayEnd = capture.Chunks.size();
+	while (sReplayEnd > 0 && capture.Chunks[sReplayEnd - 1].Direction == UartCapture::kDirection_Tx) {
+		sReplayEnd--;
+	}
+	PrintCapture(capture);
+
+	printf("%-4s %-12s %8s %10s %10s %10s %8s %9s %7s %7s  %s\n", "pass", "chunking", "chunks", "parse ms",
+	       "ms/MB", "MB/s", "wall ms", "overflows", "resyncs", "events", "result");
+	for (uint32_t pass = 0; pass <= options.passes; pass++) {
+		PassResult result;
+		bool random = pass > 0;
+		char chunking[16];
+		double megabytes;
+		std::string outcome;
+
+		if (!ForkPass(random, options.seed + pass, options.maxChunk, result)) {
+			return 1;
+		}
+		megabytes = result.bytes / 1048576.0;
+		snprintf(chunking, sizeof(chunking), random ? "random<=%zu" : "original", options.maxChunk);
+
+		std::vector<std::string> sequence = Sequence(result);
+
+		if (!result.error.empty()) {
+			outcome = result.error;
+		} else if (pass == 0) {
+			reference = sequence;
+		} else {
+			outcome = Compare(sequence, reference);
+		}
+		ok = ok && outcome.empty();
+		printf("%-4u %-12s %8zu %10.3f %10.1f %10.1f %8llu %9u %7u %7zu  %s\n", pass, chunking, result.chunks,
+		       result.parseUs / 1000.0, megabytes > 0 ? result.parseUs / 1000.0 / megabytes : 0.0,
+		       result.parseUs ? megabytes * 1000000.0 / result.parseUs : 0.0,
+		       static_cast<unsigned long long>(result.wallUs / 1000), result.overflows, result.resyncs,
+		       result.events.size(),
+		       outcome.empty() ? "ok" : outcome.c_str());
+	}
+
+	if (options.events != nullptr) {
+		std::ofstream out(options.events);
+
+		for (const std::string &line : reference) {
+			out << line << '\n';
+		}
+	}
+	if (options.expect != nullptr) {
+		std::ifstream in(options.expect);
+		std::vector<std::string> expected;
+		std::string line;
+		std::string outcome;
+
+		while (std::getline(in, line)) {
+			expected.push_back(line);
+		}
+		outcome = Compare(reference, expected);
+		printf("expected   %s\n", outcome.empty() ? "ok" : outcome.c_str());
+		ok = ok && outcome.empty();
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sim_bridge.h"
+
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(app);
+
+namespace {
+K_THREAD_STACK_DEFINE(sAppThreadStack, 4096);
+} /* namespace */
+
+SimBridge::SimBridge(ZigbeeShell &shell, size_t endpointCount, const LivenessMonitor::Config &liveness,
+		     const PollScheduler::Config &poll, const ReportLimiter::Config &report, uint16_t readsPerSecond)
+	: mShell(shell), mBridge(shell), mLights(endpointCount), mDeviceCmdSlots(endpointCount),
+	  mBreakers(endpointCount), mLivenessSlots(endpointCount), mPollSlots(endpointCount),
+	  mReported(ATOMIC_BITMAP_SIZE(endpointCount)), mStateRead(ATOMIC_BITMAP_SIZE(endpointCount)),
+	  mStateOn(ATOMIC_BITMAP_SIZE(endpointCount)), mSubscriptionSlots(endpointCount),
+	  mReportSlots(endpointCount), mDiscoverySlots(endpointCount * DiscoveryQueue::kSlotsPerDevice),
+	  mPollCounts(endpointCount), mReportCounts(endpointCount), mReportedOnOff(endpointCount),
+	  mDataVersions(endpointCount), mKnown(endpointCount)
+{
+	ZigbeeBridge::Config config;
+
+	config.liveness = liveness;
+	config.poll = poll;
+	config.report = report;
+	config.readsPerSecond = readsPerSecond;
+	k_sem_init(&mLightSem, 0, 1);
+	mBridge.Init(ZigbeeBridge::Storage{ mLights.data(), mDeviceCmdSlots.data(), mBreakers.data(),
+					    mLivenessSlots.data(), mPollSlots.data(), mSubscriptionSlots.data(),
+					    mReportSlots.data(), mDiscoverySlots.data(), mReported.data(),
+					    mStateRead.data(), mStateOn.data(), endpointCount },
+		     *this, config);
+}
+
+void SimBridge::Start()
+{
+	k_thread_create(&mAppThread, sAppThreadStack, K_THREAD_STACK_SIZEOF(sAppThreadStack), AppThreadMain, this,
+			nullptr, nullptr, 0, 0, K_NO_WAIT);
+	k_thread_name_set(&mAppThread, "app");
+}
+
+bool SimBridge::WaitForLights(size_t count, uint32_t timeoutMs)
+{
+	int64_t deadline = k_uptime_get() + timeoutMs;
+
+	while (KnownCount() < count) {
+		int64_t left = deadline - k_uptime_get();
+
+		if (left <= 0 || k_sem_take(&mLightSem, K_MSEC(left))) {
+			return KnownCount() >= count;
+		}
+	}
+
+	return true;
+}
+
+int SimBridge::PostOnOff(Device &dev, bool on)
+{
+	/* As the CHIP thread writes the attribute, with the stack locked */
+	std::lock_guard<std::mutex> guard(mLock);
+
+	return mBridge.WriteOnOff(dev, on, k_cycle_get_32());
+}
+
+void SimBridge::SetSubscribed(Device &dev, bool subscribed)
+{
+	/* As the CHIP thread does when a subscription is established or terminated */
+	std::lock_guard<std::mutex> guard(mLock);
+
+	mBridge.UpdateSubscription(mBridge.IndexOf(dev), SubscriptionTracker::kAttribute_OnOff, subscribed);
+}
+
+SimBridge::CommandStats SimBridge::GetCommandStats()
+{
+	std::lock_guard<std::mutex> guard(mCommandLock);
+
+	return mCommandStats;
+}
+
+ZigbeeBridge::OptimisticStats SimBridge::GetOptimisticStats()
+{
+	std::lock_guard<std::mutex> guard(mLock);
+
+	return mBridge.GetOptimisticStats();
+}
+
+ReportLimiter::Stats SimBridge::GetReportStats()
+{
+	std::lock_guard<std::mutex> guard(mLock);
+
+	return mBridge.GetReportStats();
+}
+
+size_t SimBridge::BridgedCount() const
+{
+	size_t count = 0;
+
+	for (const auto &light : mLights) {
+		count += ZigbeeBridge::IsBridged(light);
+	}
+
+	return count;
+}
+
+void SimBridge::AppThreadMain(void *arg1, void *arg2, void *arg3)
+{
+	SimBridge *sim = static_cast<SimBridge *>(arg1);
+	AppEvent event = {};
+
+	ARG_UNUSED(arg2);
+	ARG_UNUSED(arg3);
+
+	/* The NCP comes up next to the app task, as with AppTask::Init() */
+	sim->mBridge.Start();
+	for (;;) {
+		sim->mBridge.GetEventQueue().Get(event);
+		sim->mBridge.Dispatch(event);
+		if (event.Type == AppEvent::SimpleDescRsp) {
+			atomic_inc(&sim->mSimpleDescCount);
+			/* A light bridged by the response has been configured by now */
+			atomic_set(&sim->mConfiguredCount, sim->BridgedCount());
+		}
+		ZigbeeBridge::ReleaseEvent(event);
+	}
+}
+
+void SimBridge::Report(Device &dev, uint8_t attributes)
+{
+	size_t index = mBridge.IndexOf(dev);
+
+	if (!(attributes & SubscriptionTracker::kAttribute_OnOff)) {
+		return;
+	}
+	atomic_inc(&mDataVersions[index]);
+	/* Sent only to the subscribers */
+	if (mBridge.GetSubscriptions().Subscribed(index, SubscriptionTracker::kAttribute_OnOff)) {
+		atomic_inc(&mReportCounts[index]);
+		atomic_set(&mReportedOnOff[index], dev.IsOn());
+	}
+}
+
+void SimBridge::CommandCompleted(const AppEvent &cmd, int err)
+{
+	uint32_t now = k_cycle_get_32();
+	std::lock_guard<std::mutex> guard(mCommandLock);
+
+	mCommandStats.Completed++;
+	mCommandStats.Errors += (err != 0);
+	mCommandStats.LastCompleted = now;
+	mCommandStats.LatencyUs.push_back(k_cyc_to_us_floor32(now - cmd.DeviceCmdEvent.Timestamp));
+	mCommandStats.Lights.push_back(cmd.DeviceCmdEvent.Dev);
+}
+
+void SimBridge::StateRead(Device &dev)
+{
+	if (!atomic_set(&mKnown[mBridge.IndexOf(dev)], 1)) {
+		atomic_inc(&mKnownCount);
+		k_sem_give(&mLightSem);
+	}
+}
+
+void SimBridge::Polled(Device &dev)
+{
+	atomic_inc(&mPollCounts[mBridge.IndexOf(dev)]);
+}
+
+void SimBridge::PrintStats() const
+{
+	const ZigbeeShell::Stats &stats = mShell.GetStats();
+	uint32_t uptimeMs = MAX(k_uptime_get_32(), 1u);
+
+	printf("Commands:        %u, errors %u, timeouts %u, %u late responses\n", stats.commands,
+	       stats.commandErrors, stats.commandTimeouts, stats.commandLateResponses);
+	printf("UART:            rx %u bytes, tx %u bytes\n", stats.rxBytes, stats.txBytes);
+	printf("TX:              busy %u.%03u s, %u.%u%% of uptime, %u buffer waits, %u aborted\n",
+	       stats.txBusyUs / 1000000, stats.txBusyUs / 1000 % 1000, stats.txBusyUs / uptimeMs / 10,
+	       stats.txBusyUs / uptimeMs % 10, stats.txBufferWaits, stats.txAborted);
+	printf("RX ring:         %u overflows, %u stalls, %u resyncs, %u bytes dropped, %u overrun\n",
+	       stats.rxOverflows, stats.rxStalls, stats.rxResyncs, stats.rxDroppedBytes, stats.rxOverrunBytes);
+	printf("Parser errors:   %u, event pool exhausted %u\n", stats.parserErrors, stats.eventPoolExhausted);
+	for (uint8_t lane = 0; lane < AppEventQueue::kLaneCount; lane++) {
+		AppEventQueue::Lane id = static_cast<AppEventQueue::Lane>(lane);
+		AppEventQueue::LaneStats laneStats = mBridge.GetEventQueue().Stats(id);
+
+		printf("Lane %-12s posted %u, dropped %u, coalesced %u, high water %u/%u\n",
+		       AppEventQueue::LaneName(id), laneStats.Posted, laneStats.Dropped, laneStats.Coalesced,
+		       laneStats.HighWater, mBridge.GetEventQueue().Capacity(id));
+	}
+
+	DeviceCmdQueue::Stats cmdStats = mBridge.GetDeviceCmdQueue().GetStats();
+
+	printf("Device commands: %u queued, %u refused at %u in flight, up to %u lights waiting\n", cmdStats.Queued,
+	       cmdStats.Rejected, CONFIG_BRIDGE_DEVICE_CMD_LIMIT, cmdStats.ActiveHighWater);
+
+	DiscoveryQueue::Stats discovery = mBridge.GetDiscoveryStats();
+
+	printf("Discovery:       %u queued, %u coalesced, %u dropped, up to %u addresses waiting\n", discovery.Queued,
+	       discovery.Coalesced, discovery.Dropped, discovery.HighWater);
+
+	const DeviceBreaker::Stats &breakers = mBridge.GetBreakerStats();
+
+	printf("Breakers:        %u open, opened %u, closed %u, %u probes, %u commands refused\n",
+	       mBridge.GetOpenBreakers(), breakers.Opened, breakers.Closed, breakers.Probes, breakers.Refused);
+
+	const LivenessMonitor::Stats &liveness = mBridge.GetLivenessStats();
+
+	printf("Liveness:        %u lights, %u probes, %u missed, %u suppressed by traffic, %u ticks deferred\n",
+	       liveness.Monitored, liveness.Probes, liveness.Missed, liveness.Suppressed, liveness.Deferred);
+
+	const PollScheduler::Stats &poll = mBridge.GetPollStats();
+
+	printf("Polls:           %u lights without reports, %u polls, %u changes found, %u ticks deferred, "
+	       "%u report configurations retried, %u polled after no report\n",
+	       poll.Devices, poll.Polls, poll.Changes, poll.Deferred, poll.ConfigureRetries, poll.Silent);
+
+	const ReportLimiter::Stats &reports = mBridge.GetReportStats();
+
+	printf("Reports:         %u emitted, %u unwatched reported at once, %u coalesced\n", reports.Emitted,
+	       reports.Unwatched, reports.Coalesced);
+}
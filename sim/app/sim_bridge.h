@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "Device.h"
+#include "zigbee_bridge.h"
+#include "zigbee_shell.h"
+
+#include <mutex>
+#include <vector>
+#include <zephyr.h>
+
+/*
+ * ZigbeeBridge of the host build, with the Matter side simulated.
+ *
+ * The bridge runs on an app thread as on AppTask, from the same sources. A
+ * discovered light takes a Device of a fixed table, and stands for its
+ * Matter endpoint. The Matter writes of a controller are posted with
+ * PostOnOff() and subscriptions set with SetSubscribed(), from any thread.
+ * The Matter reports the bridge sends are counted in place of being sent.
+ * The intervals of the schedulers can be shortened from the Kconfig ones
+ * for a run of the simulation.
+ */
+class SimBridge : private ZigbeeBridge::Delegate {
+public:
+	/* Outcome of the On/Off commands, with their post to completion times and lights */
+	struct CommandStats {
+		uint32_t Completed;
+		uint32_t Errors;
+		uint32_t LastCompleted;
+		std::vector<uint32_t> LatencyUs;
+		std::vector<const Device *> Lights;
+	};
+
+	SimBridge(ZigbeeShell &shell, size_t endpointCount,
+		  const LivenessMonitor::Config &liveness = LivenessMonitor::Config{},
+		  const PollScheduler::Config &poll = PollScheduler::Config{},
+		  const ReportLimiter::Config &report = ReportLimiter::Config{},
+		  uint16_t readsPerSecond = CONFIG_BRIDGE_ZIGBEE_READS_PER_S);
+
+	void Start();
+	/* Waits until count lights are bridged and their state is known */
+	bool WaitForLights(size_t count, uint32_t timeoutMs);
+	/* A Matter write of the On/Off state, -EHOSTUNREACH while the light is unreachable */
+	int PostOnOff(Device &dev, bool on);
+	/* A Matter subscriber starts or stops watching the On/Off state of the light, and has it reported */
+	void SetSubscribed(Device &dev, bool subscribed);
+
+	size_t BridgedCount() const;
+	size_t KnownCount() const { return static_cast<size_t>(atomic_get(&mKnownCount)); }
+	uint32_t AnnounceCount() const { return mBridge.GetDiscoveryStats().Announces; }
+	uint32_t SimpleDescCount() const { return static_cast<uint32_t>(atomic_get(&mSimpleDescCount)); }
+	/* Lights configured to report their state, or polled when that failed */
+	size_t ConfiguredCount() const { return static_cast<size_t>(atomic_get(&mConfiguredCount)); }
+	CommandStats GetCommandStats();
+	std::vector<Device> &GetLights() { return mLights; }
+	const AppEventQueue &GetEventQueue() const { return mBridge.GetEventQueue(); }
+	const DeviceCmdQueue &GetDeviceCmdQueue() const { return mBridge.GetDeviceCmdQueue(); }
+	DeviceBreaker::Stats GetBreakerStats() const { return mBridge.GetBreakerStats(); }
+	LivenessMonitor::Stats GetLivenessStats() const { return mBridge.GetLivenessStats(); }
+	PollScheduler::Stats GetPollStats() const { return mBridge.GetPollStats(); }
+	ZigbeeBridge::OptimisticStats GetOptimisticStats();
+	/* The light failed its report configuration, and the polls of its state so far */
+	bool IsPolled(const Device &dev) const { return mBridge.IsPolled(mBridge.IndexOf(dev)); }
+	uint32_t PollCount(const Device &dev) const { return atomic_get(&mPollCounts[mBridge.IndexOf(dev)]); }
+	/* Matter reports of the On/Off state of the light to its subscribers, and the state the last one carried */
+	uint32_t ReportCount(const Device &dev) const { return atomic_get(&mReportCounts[mBridge.IndexOf(dev)]); }
+	/* Data version of its On/Off cluster, bumped by every report whether someone subscribed or not */
+	uint32_t DataVersion(const Device &dev) const { return atomic_get(&mDataVersions[mBridge.IndexOf(dev)]); }
+	bool ReportedOnOff(const Device &dev) const { return atomic_get(&mReportedOnOff[mBridge.IndexOf(dev)]); }
+	ReportLimiter::Stats GetReportStats();
+	const ZigbeeShell::Stats &GetShellStats() const { return mShell.GetStats(); }
+	uint32_t GetZigbeeReadyMs() const { return mBridge.GetZigbeeReadyMs(); }
+	uint32_t GetFirstEndpointMs() const { return mBridge.GetFirstEndpointMs(); }
+	/* Prints the transport counters and the event queue lanes */
+	void PrintStats() const;
+
+private:
+	static void AppThreadMain(void *arg1, void *arg2, void *arg3);
+
+	/* Stand in for the CHIP stack lock, the Matter endpoints and their reports */
+	void Lock() override { mLock.lock(); }
+	void Unlock() override { mLock.unlock(); }
+	void AddEndpoint(Device &dev) override { ARG_UNUSED(dev); }
+	void Report(Device &dev, uint8_t attributes) override;
+	void CommandCompleted(const AppEvent &cmd, int err) override;
+	void StateRead(Device &dev) override;
+	void Polled(Device &dev) override;
+
+	ZigbeeShell &mShell;
+	ZigbeeBridge mBridge;
+	std::vector<Device> mLights;
+	std::vector<DeviceCmdQueue::Slot> mDeviceCmdSlots;
+	std::vector<DeviceBreaker> mBreakers;
+	std::vector<LivenessMonitor::Slot> mLivenessSlots;
+	std::vector<PollScheduler::Slot> mPollSlots;
+	std::vector<atomic_t> mReported;
+	std::vector<atomic_t> mStateRead;
+	std::vector<atomic_t> mStateOn;
+	std::vector<SubscriptionTracker::Slot> mSubscriptionSlots;
+	std::vector<ReportLimiter::Slot> mReportSlots;
+	std::vector<DiscoveryQueue::Slot> mDiscoverySlots;
+	std::mutex mLock;
+	std::vector<atomic_t> mPollCounts;
+	std::vector<atomic_t> mReportCounts;
+	std::vector<atomic_t> mReportedOnOff;
+	std::vector<atomic_t> mDataVersions;
+	std::vector<atomic_t> mKnown;
+	struct k_thread mAppThread;
+	struct k_sem mLightSem;
+	atomic_t mKnownCount = ATOMIC_INIT(0);
+	atomic_t mSimpleDescCount = ATOMIC_INIT(0);
+	atomic_t mConfiguredCount = ATOMIC_INIT(0);
+	std::mutex mCommandLock;
+	CommandStats mCommandStats = {};
+};
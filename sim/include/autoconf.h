@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+/* Kconfig defaults of the bridge (see Kconfig) for the host build */
+
+#define CONFIG_ZIGBEE_SHELL_DEVICE_NAME "UART_1"
+#define CONFIG_ZIGBEE_SHELL_CMD_TIMEOUT_MS 5000
+#define CONFIG_ZIGBEE_SHELL_WARM_START 1
+#define CONFIG_ZIGBEE_SHELL_PROBE_TIMEOUT_MS 500
+#define CONFIG_ZIGBEE_SHELL_EXT_PAN_ID ""
+#define CONFIG_ZIGBEE_SHELL_START_STACK_SIZE 2048
+#define CONFIG_ZIGBEE_SHELL_THREAD_PRIORITY -2
+#define CONFIG_ZIGBEE_SHELL_THREAD_STACK_SIZE 2048
+#define CONFIG_ZIGBEE_SHELL_EVENT_POOL_SIZE 32
+#define CONFIG_ZIGBEE_SHELL_LINK_SETUP 1
+#define CONFIG_ZIGBEE_SHELL_BAUD_RATES "1000000 460800 230400 115200"
+#define CONFIG_ZIGBEE_SHELL_FLOW_CONTROL 1
+#define CONFIG_ZIGBEE_SHELL_LINK_PROBE_TIMEOUT_MS 100
+#define CONFIG_ZIGBEE_SHELL_RX_BUF_SIZE 256
+#define CONFIG_ZIGBEE_SHELL_RX_BUF_COUNT 3
+#define CONFIG_ZIGBEE_SHELL_RX_TIMEOUT_US 1000
+#define CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT 2
+#define CONFIG_ZIGBEE_SHELL_TX_TIMEOUT_MS 100
+#define CONFIG_APP_EVENT_LANE_CONTROL_SIZE 16
+#define CONFIG_APP_EVENT_LANE_DISCOVERY_SIZE 32
+#define CONFIG_APP_EVENT_LANE_HOUSEKEEPING_SIZE 8
+#define CONFIG_BRIDGE_DEVICE_CMD_LIMIT 4
+#define CONFIG_BRIDGE_BREAKER_FAILURES 3
+#define CONFIG_BRIDGE_BREAKER_PROBE_INTERVAL_MS 10000
+#define CONFIG_BRIDGE_LIVENESS_TICK_MS 100
+#define CONFIG_BRIDGE_LIVENESS_INTERVAL_MS 60000
+#define CONFIG_BRIDGE_LIVENESS_RETRY_MS 2000
+#define CONFIG_BRIDGE_LIVENESS_BACKOFF_MAX_MS 300000
+#define CONFIG_BRIDGE_LIVENESS_JITTER_PERCENT 10
+#define CONFIG_BRIDGE_REPORT_MIN_INTERVAL_S 0
+#define CONFIG_BRIDGE_REPORT_MAX_INTERVAL_S 300
+#define CONFIG_BRIDGE_REPORT_CONFIG_RETRY_MS 30000
+#define CONFIG_BRIDGE_REPORT_CONFIG_RETRIES 3
+#define CONFIG_BRIDGE_POLL_TICK_MS 100
+#define CONFIG_BRIDGE_POLL_MIN_INTERVAL_MS 2000
+#define CONFIG_BRIDGE_POLL_MAX_INTERVAL_MS 60000
+#define CONFIG_BRIDGE_POLL_IDLE_INTERVAL_MS 300000
+#define CONFIG_BRIDGE_ZIGBEE_READS_PER_S 4
+#define CONFIG_BRIDGE_MATTER_REPORT_TICK_MS 50
+#define CONFIG_BRIDGE_MATTER_REPORT_MIN_INTERVAL_MS 1000
+#define CONFIG_BRIDGE_LATENCY_STATS 1
+#define CONFIG_BRIDGE_TRACE 1
+#define CONFIG_BRIDGE_TRACE_RING_COUNT 6
+#define CONFIG_BRIDGE_TRACE_RING_SIZE 128
+/* Enabled with room for whole load runs, for --capture of the host tools */
+#define CONFIG_BRIDGE_UART_CAPTURE 1
+#define CONFIG_BRIDGE_UART_CAPTURE_SIZE (4 * 1024 * 1024)
+
+#define CONFIG_THREAD_NAME 1
+#define CONFIG_THREAD_MAX_NAME_LEN 32
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+struct device {
+	const char *name;
+	void *data;
+};
+
+const struct device *device_get_binding(const char *name);
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <device.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/* Asynchronous UART API, see sim_uart.h for how a device is backed on the host */
+
+enum uart_event_type {
+	UART_TX_DONE,
+	UART_TX_ABORTED,
+	UART_RX_RDY,
+	UART_RX_BUF_REQUEST,
+	UART_RX_BUF_RELEASED,
+	UART_RX_DISABLED,
+	UART_RX_STOPPED,
+};
+
+enum uart_rx_stop_reason {
+	UART_ERROR_OVERRUN = (1 << 0),
+	UART_ERROR_PARITY = (1 << 1),
+	UART_ERROR_FRAMING = (1 << 2),
+	UART_BREAK = (1 << 3),
+};
+
+struct uart_event_tx {
+	const uint8_t *buf;
+	size_t len;
+};
+
+struct uart_event_rx {
+	uint8_t *buf;
+	size_t offset;
+	size_t len;
+};
+
+struct uart_event_rx_buf {
+	uint8_t *buf;
+};
+
+struct uart_event_rx_stop {
+	enum uart_rx_stop_reason reason;
+	struct uart_event_rx data;
+};
+
+struct uart_event {
+	enum uart_event_type type;
+	union uart_event_data {
+		struct uart_event_tx tx;
+		struct uart_event_rx rx;
+		struct uart_event_rx_buf rx_buf;
+		struct uart_event_rx_stop rx_stop;
+	} data;
+};
+
+enum uart_config_parity {
+	UART_CFG_PARITY_NONE,
+	UART_CFG_PARITY_ODD,
+	UART_CFG_PARITY_EVEN,
+	UART_CFG_PARITY_MARK,
+	UART_CFG_PARITY_SPACE,
+};
+
+enum uart_config_stop_bits {
+	UART_CFG_STOP_BITS_0_5,
+	UART_CFG_STOP_BITS_1,
+	UART_CFG_STOP_BITS_1_5,
+	UART_CFG_STOP_BITS_2,
+};
+
+enum uart_config_data_bits {
+	UART_CFG_DATA_BITS_5,
+	UART_CFG_DATA_BITS_6,
+	UART_CFG_DATA_BITS_7,
+	UART_CFG_DATA_BITS_8,
+	UART_CFG_DATA_BITS_9,
+};
+
+enum uart_config_flow_control {
+	UART_CFG_FLOW_CTRL_NONE,
+	UART_CFG_FLOW_CTRL_RTS_CTS,
+	UART_CFG_FLOW_CTRL_DTR_DSR,
+};
+
+struct uart_config {
+	uint32_t baudrate;
+	uint8_t parity;
+	uint8_t stop_bits;
+	uint8_t data_bits;
+	uint8_t flow_ctrl;
+};
+
+typedef void (*uart_callback_t)(const struct device *dev, struct uart_event *evt, void *user_data);
+
+int uart_callback_set(const struct device *dev, uart_callback_t callback, void *user_data);
+int uart_tx(const struct device *dev, const uint8_t *buf, size_t len, int32_t timeout);
+int uart_rx_enable(const struct device *dev, uint8_t *buf, size_t len, int32_t timeout);
+int uart_rx_buf_rsp(const struct device *dev, uint8_t *buf, size_t len);
+int uart_rx_disable(const struct device *dev);
+int uart_configure(const struct device *dev, const struct uart_config *cfg);
+int uart_config_get(const struct device *dev, struct uart_config *cfg);
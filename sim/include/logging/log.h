@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+/* Log messages go to stderr, filtered by the level set with sim_log_set_level() */
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERR 1
+#define LOG_LEVEL_WRN 2
+#define LOG_LEVEL_INF 3
+#define LOG_LEVEL_DBG 4
+
+#define LOG_MODULE_REGISTER(name, ...) __attribute__((unused)) static const char *const sim_log_module = #name
+#define LOG_MODULE_DECLARE(name, ...) __attribute__((unused)) static const char *const sim_log_module = #name
+
+#define LOG_ERR(...) sim_log(sim_log_module, LOG_LEVEL_ERR, __VA_ARGS__)
+#define LOG_WRN(...) sim_log(sim_log_module, LOG_LEVEL_WRN, __VA_ARGS__)
+#define LOG_INF(...) sim_log(sim_log_module, LOG_LEVEL_INF, __VA_ARGS__)
+#define LOG_DBG(...) sim_log(sim_log_module, LOG_LEVEL_DBG, __VA_ARGS__)
+
+#define log_strdup(str) (str)
+
+void sim_log(const char *module, int level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+void sim_log_set_level(int level);
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+/* Not cryptographically secure, as with the Zephyr test random generator */
+static inline uint32_t sys_rand32_get(void)
+{
+	return static_cast<uint32_t>(random()) ^ (static_cast<uint32_t>(random()) << 16);
+}
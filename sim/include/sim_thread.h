@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+/*
+ * Number of times the thread blocked on a semaphore. A thread woken by a
+ * give has handled it once this count moves on, which lets a test driver
+ * wait for a thread to go idle without sleeping.
+ */
+uint32_t sim_thread_wait_count(k_tid_t thread);
+
+/*
+ * True while the thread waits on a semaphore that has not been given or
+ * sleeps with time left, false once it can run again.
+ */
+bool sim_thread_is_blocked(k_tid_t thread);
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Backs the UART device with the given name by a file descriptor, such as
+ * one end of a socket pair or a pseudo terminal. Bytes read from it are
+ * delivered with the UART_RX_RDY events of the asynchronous API as they
+ * arrive, and uart_tx() writes to it from a thread of its own, reporting
+ * UART_TX_DONE from there as the UARTE does from its interrupt.
+ */
+int sim_uart_attach(const char *name, int fd);
+
+/*
+ * Whether the device has RTS/CTS flow control, as reported by
+ * uart_config_get(). With it the other end is not read while receiving is
+ * stopped, so it blocks once the file descriptor is full. Without it the
+ * bytes received meanwhile are dropped and counted by sim_uart_rx_lost().
+ */
+int sim_uart_set_flow_control(const char *name, bool enable);
+size_t sim_uart_rx_lost(const char *name);
+
+/*
+ * The line to the other end: its baud rate, or 0 when it works at any
+ * rate, and whether RTS/CTS are wired. A buffer given to uart_tx() takes
+ * the time of its bytes at that rate to be sent. Bytes sent or received while
+ * uart_configure() set another rate are garbled. With flow control
+ * configured but not wired, nothing is sent and the bytes received are
+ * lost as without flow control.
+ */
+int sim_uart_set_line(const char *name, uint32_t baudRate, bool flowControlWired);
+
+/*
+ * Delivers the bytes as if they had been received by the UART, in one
+ * UART_RX_RDY event unless they cross the end of the current RX buffer.
+ * Returns once the callback has handled them, waiting for receiving to be
+ * enabled again when it stopped and flow control is set. Meant for a
+ * device whose file descriptor is never written from the other end, so
+ * the chunking seen by the driver is exactly the one given here.
+ */
+int sim_uart_rx_inject(const char *name, const uint8_t *data, size_t len);
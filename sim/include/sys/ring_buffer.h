@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Byte mode of the Zephyr ring buffer. As on the target, one producer and
+ * one consumer may use it concurrently without locking.
+ */
+struct ring_buf {
+	uint8_t *buffer;
+	uint32_t size;
+	uint32_t head;
+	uint32_t tail;
+};
+
+void ring_buf_init(struct ring_buf *buf, uint32_t size, void *data);
+void ring_buf_reset(struct ring_buf *buf);
+uint32_t ring_buf_put(struct ring_buf *buf, const uint8_t *data, uint32_t size);
+uint32_t ring_buf_get(struct ring_buf *buf, uint8_t *data, uint32_t size);
+uint32_t ring_buf_peek(struct ring_buf *buf, uint8_t *data, uint32_t size);
+uint32_t ring_buf_space_get(struct ring_buf *buf);
+uint32_t ring_buf_size_get(struct ring_buf *buf);
+
+static inline uint32_t ring_buf_capacity_get(struct ring_buf *buf)
+{
+	return buf->size;
+}
+
+static inline bool ring_buf_is_empty(struct ring_buf *buf)
+{
+	return ring_buf_size_get(buf) == 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+/*
+ * Host stand-in for the Zephyr timing API. A timing cycle is a nanosecond
+ * of the monotonic clock, much finer than the microsecond cycle counter
+ * of k_cycle_get_32(), as the benchmarks need.
+ */
+
+#include <chrono>
+#include <cstdint>
+
+typedef uint64_t timing_t;
+
+static inline void timing_init(void)
+{
+}
+
+static inline void timing_start(void)
+{
+}
+
+static inline void timing_stop(void)
+{
+}
+
+static inline timing_t timing_counter_get(void)
+{
+	return static_cast<timing_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+			.count());
+}
+
+static inline uint64_t timing_cycles_get(volatile timing_t *const start, volatile timing_t *const end)
+{
+	return *end - *start;
+}
+
+static inline uint64_t timing_freq_get(void)
+{
+	return 1000000000;
+}
+
+static inline uint64_t timing_cycles_to_ns(uint64_t cycles)
+{
+	return cycles;
+}
+
+static inline uint32_t timing_freq_get_mhz(void)
+{
+	return 1000;
+}
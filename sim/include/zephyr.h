@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+/*
+ * Host stand-in for the part of the Zephyr kernel API the bridge core uses.
+ *
+ * Threads are POSIX threads, so priorities and stacks are ignored, and a
+ * timeout tick is 100 us. The cycle counter counts microseconds of the
+ * monotonic clock, which keeps the latency histograms in range.
+ */
+
+#include <autoconf.h>
+#include <device.h>
+
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+#include <strings.h>
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define ARG_UNUSED(x) (void)(x)
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define BIT(n) (1UL << (n))
+#define ROUND_UP(x, align) ((((x) + (align)-1) / (align)) * (align))
+#define DIV_ROUND_UP(n, d) (((n) + (d)-1) / (d))
+#define __ASSERT_NO_MSG(test) assert(test)
+#define compiler_barrier() __asm__ __volatile__("" ::: "memory")
+
+typedef struct {
+	int64_t us;
+} k_timeout_t;
+
+#define K_NO_WAIT (k_timeout_t{ 0 })
+#define K_FOREVER (k_timeout_t{ -1 })
+#define K_USEC(t) (k_timeout_t{ static_cast<int64_t>(t) })
+#define K_MSEC(t) K_USEC(static_cast<int64_t>(t) * 1000)
+#define K_SECONDS(t) K_MSEC(static_cast<int64_t>(t) * 1000)
+#define K_TICKS(t) K_USEC(static_cast<int64_t>(t) * 100)
+
+/* Time */
+
+int64_t k_uptime_get(void);
+uint32_t k_cycle_get_32(void);
+
+static inline uint32_t k_uptime_get_32(void)
+{
+	return static_cast<uint32_t>(k_uptime_get());
+}
+
+static inline uint32_t sys_clock_hw_cycles_per_sec(void)
+{
+	return 1000000;
+}
+
+static inline uint32_t k_cyc_to_us_floor32(uint32_t cycles)
+{
+	return cycles;
+}
+
+static inline uint32_t k_cyc_to_us_ceil32(uint32_t cycles)
+{
+	return cycles;
+}
+
+static inline uint64_t k_cyc_to_ns_floor64(uint64_t cycles)
+{
+	return cycles * 1000;
+}
+
+/* Threads */
+
+typedef void (*k_thread_entry_t)(void *p1, void *p2, void *p3);
+
+struct k_thread {
+	char name[CONFIG_THREAD_MAX_NAME_LEN];
+	int prio;
+	pthread_t native;
+	/* Blocking state for sim_thread.h */
+	std::atomic<uint32_t> waits;
+	std::atomic<struct k_sem *> pendingSem;
+	std::atomic<int64_t> sleepUntilUs;
+};
+
+typedef struct k_thread *k_tid_t;
+
+typedef struct {
+	char data;
+} k_thread_stack_t;
+
+#define K_THREAD_STACK_DEFINE(sym, size) k_thread_stack_t sym[size]
+#define K_THREAD_STACK_SIZEOF(sym) sizeof(sym)
+
+k_tid_t k_thread_create(struct k_thread *new_thread, k_thread_stack_t *stack, size_t stack_size,
+			k_thread_entry_t entry, void *p1, void *p2, void *p3, int prio, uint32_t options,
+			k_timeout_t delay);
+int k_thread_name_set(k_tid_t thread, const char *name);
+const char *k_thread_name_get(k_tid_t thread);
+k_tid_t k_current_get(void);
+int k_thread_priority_get(k_tid_t thread);
+int32_t k_sleep(k_timeout_t timeout);
+void k_yield(void);
+bool k_is_in_isr(void);
+
+typedef void (*k_thread_user_cb_t)(const struct k_thread *thread, void *user_data);
+
+void k_thread_foreach(k_thread_user_cb_t user_cb, void *user_data);
+
+/* Execution cycles are microseconds of CPU time of the POSIX thread */
+typedef struct {
+	uint64_t execution_cycles;
+} k_thread_runtime_stats_t;
+
+int k_thread_runtime_stats_get(k_tid_t thread, k_thread_runtime_stats_t *stats);
+
+/* Interrupt locking takes the lock that serializes simulated interrupts */
+unsigned int irq_lock(void);
+void irq_unlock(unsigned int key);
+
+/* Semaphores */
+
+struct k_sem {
+	std::mutex lock;
+	std::condition_variable cond;
+	unsigned int count;
+	unsigned int limit;
+};
+
+int k_sem_init(struct k_sem *sem, unsigned int initial_count, unsigned int limit);
+int k_sem_take(struct k_sem *sem, k_timeout_t timeout);
+void k_sem_give(struct k_sem *sem);
+void k_sem_reset(struct k_sem *sem);
+unsigned int k_sem_count_get(struct k_sem *sem);
+
+/* Timers, expiring on a thread of their own inside an IsrScope */
+
+struct k_timer;
+
+typedef void (*k_timer_expiry_t)(struct k_timer *timer);
+typedef void (*k_timer_stop_t)(struct k_timer *timer);
+
+struct k_timer {
+	k_timer_expiry_t expiry_fn;
+	k_timer_stop_t stop_fn;
+	void *user_data;
+	std::mutex lock;
+	std::condition_variable cond;
+	bool threadStarted;
+	/* Next expiry in microseconds of uptime, negative when stopped */
+	int64_t nextUs;
+	int64_t periodUs;
+};
+
+void k_timer_init(struct k_timer *timer, k_timer_expiry_t expiry_fn, k_timer_stop_t stop_fn);
+void k_timer_start(struct k_timer *timer, k_timeout_t duration, k_timeout_t period);
+void k_timer_stop(struct k_timer *timer);
+
+static inline void k_timer_user_data_set(struct k_timer *timer, void *user_data)
+{
+	timer->user_data = user_data;
+}
+
+static inline void *k_timer_user_data_get(struct k_timer *timer)
+{
+	return timer->user_data;
+}
+
+/* Memory slabs, allocation does not wait for a free block */
+
+struct k_mem_slab {
+	k_mem_slab(char *buffer, size_t blockSize, uint32_t numBlocks);
+
+	std::mutex lock;
+	char *buffer;
+	size_t block_size;
+	uint32_t num_blocks;
+	uint32_t num_used;
+	char *free_list;
+};
+
+#define K_MEM_SLAB_DEFINE(name, slab_block_size, slab_num_blocks, slab_align)                                          \
+	alignas(16) static char _k_mem_slab_buf_##name[(slab_num_blocks)*ROUND_UP(slab_block_size, 16)];              \
+	struct k_mem_slab name(_k_mem_slab_buf_##name, ROUND_UP(slab_block_size, 16), slab_num_blocks)
+
+int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem, k_timeout_t timeout);
+void k_mem_slab_free(struct k_mem_slab *slab, void **mem);
+
+static inline uint32_t k_mem_slab_num_used_get(struct k_mem_slab *slab)
+{
+	return slab->num_used;
+}
+
+static inline uint32_t k_mem_slab_num_free_get(struct k_mem_slab *slab)
+{
+	return slab->num_blocks - slab->num_used;
+}
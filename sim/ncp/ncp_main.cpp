@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sim_ncp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*
+ * Serves the simulated NCP on a pseudo terminal, so the bridge, or a
+ * terminal program, can be attached to it as to the UART of a real one.
+ * The NCP state survives the bridge closing and reopening the terminal.
+ */
+
+namespace {
+void Usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --lights N        lights on the network (default 8)\n"
+		"  --fresh           start without a formed network\n"
+		"  --match-desc MS   time match_desc collects responses (default 50)\n"
+		"  --seed N          seed of addresses and network identifiers\n",
+		name);
+}
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	SimNcp::Config config;
+	struct termios tio;
+	int master, slave;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--lights") && i + 1 < argc) {
+			config.lightCount = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--fresh")) {
+			config.commissioned = false;
+		} else if (!strcmp(argv[i], "--match-desc") && i + 1 < argc) {
+			config.matchDescTimeoutMs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+			config.seed = strtoul(argv[++i], nullptr, 0);
+		} else {
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) || unlockpt(master)) {
+		perror("posix_openpt");
+		return 1;
+	}
+	/* Keep the slave open so reads do not fail while no bridge is attached */
+	slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	if (slave < 0 || tcgetattr(slave, &tio)) {
+		perror("open pty");
+		return 1;
+	}
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+
+	SimNcp ncp(config);
+
+	printf("Zigbee NCP with %u lights on %s\n", ncp.LightCount(), ptsname(master));
+	fflush(stdout);
+	ncp.Run(master);
+
+	return 0;
+}
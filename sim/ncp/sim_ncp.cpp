@@ -0,0 +1,647 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sim_ncp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+constexpr uint16_t kProfileHa = 0x0104;
+constexpr uint16_t kDimmableLightDeviceId = 0x0101;
+constexpr uint8_t kLightEndpoint = 10;
+constexpr uint16_t kClusterOnOff = 0x0006;
+constexpr uint16_t kLightInClusters[] = { 0x0000, 0x0003, 0x0004, 0x0005, 0x0006, 0x0008 };
+constexpr char kPrompt[] = "uart:~$ ";
+/* Bytes written at once by a paced output, about the UARTE RX FIFO */
+constexpr size_t kPacedChunk = 16;
+
+const auto sBootTime = std::chrono::steady_clock::now();
+
+bool HasInCluster(uint16_t cluster)
+{
+	return std::find(std::begin(kLightInClusters), std::end(kLightInClusters), cluster) !=
+	       std::end(kLightInClusters);
+}
+
+long ParseNumber(const std::string &arg, int base)
+{
+	return strtol(arg.c_str(), nullptr, base);
+}
+
+void Sleep(uint32_t ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void SleepUs(uint32_t us)
+{
+	std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+} /* namespace */
+
+SimNcp::SimNcp(const Config &config)
+	: mConfig(config), mRandom(config.seed), mCommissioned(config.commissioned), mCoordinator(config.commissioned)
+{
+	std::uniform_int_distribution<uint16_t> addrDist(0x0001, 0xfff7);
+	std::set<uint16_t> used;
+	size_t reporting = 0;
+	char extPanId[17];
+
+	while (mLights.size() < config.lightCount) {
+		uint16_t addr = addrDist(mRandom);
+		size_t i = mLights.size();
+		bool legacy = (i + 1) * config.legacyPercent / 100 != i * config.legacyPercent / 100;
+		/* Spread over the lights that can report */
+		bool silent = !legacy && (reporting + 1) * config.silentPercent / 100 != reporting * config.silentPercent / 100;
+
+		if (used.insert(addr).second) {
+			mLights.push_back({ addr, kLightEndpoint, kDimmableLightDeviceId, false, true, !legacy, false,
+					    config.unansweredConfigs, silent });
+			reporting += !legacy;
+		}
+	}
+	snprintf(extPanId, sizeof(extPanId), "f4ce36%010llx",
+		 static_cast<unsigned long long>(mRandom()) << 8 | (mRandom() & 0xff));
+	mExtPanId = extPanId;
+	mPanId = static_cast<uint16_t>(mRandom() % 0x3fff + 1);
+}
+
+void SimNcp::Run(int fd)
+{
+	char buf[64];
+	ssize_t len;
+
+	mFd = fd;
+	if (mConfig.reportIntervalMs > 0) {
+		std::thread(&SimNcp::ReportThreadMain, this).detach();
+	}
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		for (ssize_t i = 0; i < len; i++) {
+			char c = buf[i];
+
+			if (c != '\r' && c != '\n') {
+				mLine.push_back(c);
+				if (mEcho) {
+					Write(std::string(1, c));
+				}
+				continue;
+			}
+			if (mLine.empty()) {
+				continue;
+			}
+			if (mEcho) {
+				Write("\r\n");
+			}
+			HandleLine(mLine);
+			mLine.clear();
+			Write(kPrompt);
+		}
+	}
+}
+
+void SimNcp::Reboot()
+{
+	Sleep(20);
+	mEcho = true;
+	mStarted = false;
+	mLine.clear();
+	Write("\r\n*** Booting Zephyr OS build v2.7.0-ncs1  ***\r\n");
+}
+
+void SimNcp::HandleLine(const std::string &line)
+{
+	std::istringstream stream(line);
+	std::vector<std::string> argv;
+	std::string arg;
+
+	while (stream >> arg) {
+		argv.push_back(arg);
+	}
+
+	const std::string &cmd = argv[0];
+
+	if (cmd == "kernel" && argv.size() >= 2 && argv[1] == "reboot") {
+		Reboot();
+	} else if (cmd == "shell" && argv.size() == 3 && argv[1] == "echo") {
+		mEcho = (argv[2] == "on");
+	} else if (cmd == "shell" && argv.size() == 3 && argv[1] == "colors") {
+		/* Output is never colored */
+	} else if (cmd == "bdb") {
+		CmdBdb(argv);
+	} else if (cmd == "zdo") {
+		CmdZdo(argv);
+	} else if (cmd == "zcl") {
+		CmdZcl(argv);
+	} else {
+		Print("%s: command not found", cmd.c_str());
+	}
+}
+
+void SimNcp::Write(const std::string &text)
+{
+	std::lock_guard<std::mutex> guard(mWriteLock);
+	size_t written = 0;
+
+	while (written < text.size()) {
+		size_t len = text.size() - written;
+
+		if (mConfig.baudRate != 0) {
+			/* Bytes reach the other end in small chunks as they are shifted out */
+			len = std::min(len, kPacedChunk);
+			mLineFree = std::max(mLineFree, std::chrono::steady_clock::now()) +
+				    std::chrono::microseconds(len * 10 * 1000000ull / mConfig.baudRate);
+			std::this_thread::sleep_until(mLineFree);
+		}
+
+		ssize_t ret = write(mFd, text.data() + written, len);
+
+		if (ret <= 0) {
+			return;
+		}
+		written += ret;
+	}
+}
+
+void SimNcp::Print(const char *fmt, ...)
+{
+	char line[256];
+	va_list args;
+
+	va_start(args, fmt);
+	vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+	Write(std::string(line) + "\r\n");
+}
+
+/* Logger prefix of a line of the module, with the default timestamp */
+static std::string LogPrefix(const char *module)
+{
+	auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sBootTime);
+	long long us = now.count();
+	char prefix[64];
+
+	snprintf(prefix, sizeof(prefix), "[%02lld:%02lld:%02lld.%03lld,%03lld] <inf> %s: ", us / 3600000000LL,
+		 us / 60000000LL % 60, us / 1000000 % 60, us / 1000 % 1000, us % 1000, module);
+
+	return prefix;
+}
+
+void SimNcp::PrintLog(const char *fmt, ...)
+{
+	char line[256];
+	va_list args;
+
+	/* Zigbee stack signals come through the logger */
+	va_start(args, fmt);
+	vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+	Write(LogPrefix("zigbee_app_utils") + line + "\r\n");
+}
+
+void SimNcp::PrintReport(uint16_t addr, bool on)
+{
+	std::string prefix = LogPrefix("zigbee_shell");
+	char lines[192];
+
+	/* Logged by the subscribe command of the shell, in two lines written at once */
+	snprintf(lines, sizeof(lines),
+		 "Received value updates from the remote node 0x%04hx\r\n%sProfile: 0x%04hx Cluster: 0x%04hx "
+		 "Attribute: 0x0000 Type: 16 Value: %s\r\n",
+		 addr, prefix.c_str(), kProfileHa, kClusterOnOff, on ? "True" : "False");
+	Write(prefix + lines);
+}
+
+void SimNcp::Done()
+{
+	Print("Done");
+}
+
+void SimNcp::Error(const char *reason)
+{
+	Print("Error: %s", reason);
+}
+
+SimNcp::Light *SimNcp::FindLight(uint16_t addr, int ep)
+{
+	for (auto &light : mLights) {
+		if (light.addr == addr && (ep < 0 || light.ep == ep)) {
+			return &light;
+		}
+	}
+
+	return nullptr;
+}
+
+SimNcp::Stats SimNcp::GetStats()
+{
+	std::lock_guard<std::mutex> guard(mStateLock);
+
+	return mStats;
+}
+
+SimNcp::Frame SimNcp::NextFrame()
+{
+	std::lock_guard<std::mutex> guard(mStateLock);
+	Frame frame;
+
+	frame.delayUs = mConfig.latencyUs + (mConfig.jitterUs ? mRandom() % (mConfig.jitterUs + 1) : 0);
+	frame.lost = mConfig.lossPercent && mRandom() % 100 < mConfig.lossPercent;
+	if (frame.lost) {
+		mStats.lost++;
+	}
+
+	return frame;
+}
+
+void SimNcp::SetLightPowered(uint16_t addr, bool powered)
+{
+	std::lock_guard<std::mutex> guard(mStateLock);
+	Light *light = FindLight(addr);
+
+	if (light != nullptr) {
+		light->powered = powered;
+	}
+}
+
+void SimNcp::SetLossTimeout(uint32_t ms)
+{
+	std::lock_guard<std::mutex> guard(mStateLock);
+
+	mConfig.lossTimeoutMs = ms;
+}
+
+void SimNcp::ToggleLight(uint16_t addr)
+{
+	std::unique_lock<std::mutex> guard(mStateLock);
+	Light *light = FindLight(addr);
+	bool on;
+
+	if (light == nullptr || !light->powered) {
+		return;
+	}
+	light->on = !light->on;
+	if (!light->subscribed || light->silent) {
+		return;
+	}
+	on = light->on;
+	guard.unlock();
+
+	if (!mStarted || NextFrame().lost) {
+		return;
+	}
+	guard.lock();
+	mStats.reports++;
+	guard.unlock();
+	PrintReport(addr, on);
+}
+
+bool SimNcp::IsLightOn(uint16_t addr)
+{
+	std::lock_guard<std::mutex> guard(mStateLock);
+	Light *light = FindLight(addr);
+
+	return light != nullptr && light->on;
+}
+
+uint16_t SimNcp::SubscribedCount()
+{
+	std::lock_guard<std::mutex> guard(mStateLock);
+
+	return std::count_if(mLights.begin(), mLights.end(), [](const Light &light) { return light.subscribed; });
+}
+
+uint16_t SimNcp::ReportingCount() const
+{
+	/* Set when the network is created */
+	return std::count_if(mLights.begin(), mLights.end(), [](const Light &light) { return light.reporting; });
+}
+
+uint16_t SimNcp::SilentCount() const
+{
+	return std::count_if(mLights.begin(), mLights.end(), [](const Light &light) { return light.silent; });
+}
+
+bool SimNcp::Receive(const Light &light)
+{
+	Frame frame = NextFrame();
+	uint32_t lossTimeoutMs;
+	bool powered;
+
+	{
+		std::lock_guard<std::mutex> guard(mStateLock);
+
+		powered = light.powered;
+		lossTimeoutMs = mConfig.lossTimeoutMs;
+	}
+	if (frame.lost || !powered) {
+		Sleep(lossTimeoutMs);
+		return false;
+	}
+	SleepUs(frame.delayUs);
+
+	std::lock_guard<std::mutex> guard(mStateLock);
+
+	mStats.responses++;
+
+	return true;
+}
+
+void SimNcp::ReceiveAll(std::vector<std::string> lines, bool log, uint32_t *stat)
+{
+	std::vector<std::pair<uint32_t, size_t>> arrivals;
+	uint32_t elapsedUs = 0;
+
+	/* Frames sent at once reach the NCP in the order of their delays */
+	for (size_t i = 0; i < lines.size(); i++) {
+		Frame frame = NextFrame();
+
+		if (!frame.lost) {
+			arrivals.emplace_back(frame.delayUs, i);
+		}
+	}
+	std::sort(arrivals.begin(), arrivals.end());
+	for (const auto &arrival : arrivals) {
+		SleepUs(arrival.first - elapsedUs);
+		elapsedUs = arrival.first;
+		if (log) {
+			PrintLog("%s", lines[arrival.second].c_str());
+		} else {
+			Print("%s", lines[arrival.second].c_str());
+		}
+		std::lock_guard<std::mutex> guard(mStateLock);
+		(*stat)++;
+	}
+}
+
+void SimNcp::AnnounceLights(uint16_t count)
+{
+	std::vector<std::string> lines;
+	char line[64];
+
+	for (uint16_t i = 0; i < count && i < mLights.size(); i++) {
+		snprintf(line, sizeof(line), "New device commissioned or rejoined (short: 0x%04hx)", mLights[i].addr);
+		lines.push_back(line);
+	}
+	ReceiveAll(lines, true, &mStats.announces);
+}
+
+void SimNcp::AnnounceBurst(uint16_t count)
+{
+	std::thread([this, count]() { AnnounceLights(count); }).detach();
+}
+
+void SimNcp::ReportThreadMain()
+{
+	uint32_t spacingUs = mConfig.reportIntervalMs * 1000 / std::max<size_t>(mLights.size(), 1);
+
+	/* Reports of the lights are spread evenly over the period */
+	for (;;) {
+		for (size_t i = 0; i < mLights.size(); i++) {
+			uint16_t addr;
+			bool on;
+
+			SleepUs(spacingUs);
+			if (!mStarted || NextFrame().lost) {
+				continue;
+			}
+			{
+				std::lock_guard<std::mutex> guard(mStateLock);
+
+				if (!mLights[i].powered || mLights[i].silent) {
+					continue;
+				}
+				addr = mLights[i].addr;
+				on = mLights[i].on;
+				mStats.reports++;
+			}
+			PrintReport(addr, on);
+		}
+	}
+}
+
+void SimNcp::CmdBdb(const std::vector<std::string> &argv)
+{
+	const std::string sub = argv.size() > 1 ? argv[1] : "";
+
+	if (sub == "role" && argv.size() == 2) {
+		Print("%s", mCoordinator ? "zc" : "zr");
+		Done();
+	} else if (sub == "role") {
+		if (mStarted) {
+			Error("Stack already started");
+			return;
+		}
+		mCoordinator = (argv[2] == "zc");
+		Done();
+	} else if (sub == "extpanid") {
+		Print("%s", (mStarted && mCommissioned) ? mExtPanId.c_str() : "0000000000000000");
+		Done();
+	} else if (sub == "legacy") {
+		Done();
+	} else if (sub == "start") {
+		if (!mCoordinator) {
+			Error("Only the coordinator role is simulated");
+			return;
+		}
+		if (mStarted) {
+			Print("Started network steering");
+			Done();
+			return;
+		}
+		mStarted = true;
+		Print("Started coordinator");
+		Done();
+		/* The stack reports the network from its own thread once it has started */
+		std::thread([this]() {
+			Sleep(10);
+			if (mCommissioned) {
+				PrintLog("Joined network successfully on reboot signal (Extended PAN ID: %s, PAN ID: 0x%04hx)",
+					 mExtPanId.c_str(), mPanId);
+				return;
+			}
+			mCommissioned = true;
+			PrintLog("Network formed successfully (Extended PAN ID: %s, PAN ID: 0x%04hx)", mExtPanId.c_str(),
+				 mPanId);
+			Sleep(10);
+			AnnounceLights(mLights.size());
+		}).detach();
+	} else {
+		Error("Invalid bdb command");
+	}
+}
+
+void SimNcp::CmdZdo(const std::vector<std::string> &argv)
+{
+	const std::string sub = argv.size() > 1 ? argv[1] : "";
+
+	if (!mStarted) {
+		Error("Zigbee stack has not been started");
+		return;
+	}
+
+	if (sub == "short") {
+		Print("%04hx", static_cast<uint16_t>(0x0000));
+		Done();
+	} else if (sub == "active_ep" && argv.size() == 3) {
+		Light *light = FindLight(ParseNumber(argv[2], 16));
+
+		if (light == nullptr || !Receive(*light)) {
+			Error("Timeout");
+			return;
+		}
+		Print("src_addr=%04hX ep=%d", light->addr, light->ep);
+		Done();
+	} else if (sub == "simple_desc_req" && argv.size() == 4) {
+		Light *light = FindLight(ParseNumber(argv[2], 16), ParseNumber(argv[3], 10));
+
+		if (light == nullptr || !Receive(*light)) {
+			Error("Timeout");
+			return;
+		}
+		Print("src_addr=0x%04hx ep=%d profile_id=0x%04hx app_dev_id=0x%04hx app_dev_ver=0x1 "
+		      "in_clusters=0x0000,0x0003,0x0004,0x0005,0x0006,0x0008 out_clusters=",
+		      light->addr, light->ep, kProfileHa, light->devId);
+		Done();
+	} else if (sub == "match_desc" && argv.size() >= 6) {
+		/* zdo match_desc <dst> <req> <profile> <n in> <in>... <n out> <out>... [-t <s>] */
+		size_t arg = 5;
+		long inCount = ParseNumber(argv[5], 10);
+		bool match = ParseNumber(argv[4], 16) == kProfileHa;
+
+		for (long i = 0; i < inCount && arg + 1 < argv.size(); i++) {
+			uint16_t cluster = ParseNumber(argv[++arg], 16);
+
+			match = match && HasInCluster(cluster);
+		}
+		std::vector<std::string> lines;
+		char line[32];
+
+		for (const auto &light : mLights) {
+			if (match && light.powered) {
+				snprintf(line, sizeof(line), "src_addr=%04hX ep=%d", light.addr, light.ep);
+				lines.push_back(line);
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		ReceiveAll(lines, false, &mStats.responses);
+		std::this_thread::sleep_until(start + std::chrono::milliseconds(mConfig.matchDescTimeoutMs));
+		Done();
+	} else {
+		Error("Invalid zdo command");
+	}
+}
+
+void SimNcp::CmdZcl(const std::vector<std::string> &argv)
+{
+	const std::string sub = argv.size() > 1 ? argv[1] : "";
+
+	if (!mStarted) {
+		Error("Zigbee stack has not been started");
+		return;
+	}
+
+	if (sub == "cmd") {
+		/* zcl cmd [-d] <addr> <ep> <cluster> <cmd id> */
+		size_t arg = (argv.size() > 2 && argv[2] == "-d") ? 3 : 2;
+
+		if (argv.size() < arg + 4) {
+			Error("Invalid arguments");
+			return;
+		}
+
+		Light *light = FindLight(ParseNumber(argv[arg], 16), ParseNumber(argv[arg + 1], 10));
+
+		if (light == nullptr) {
+			Error("Unable to send the command");
+			return;
+		}
+		if (ParseNumber(argv[arg + 2], 16) == kClusterOnOff) {
+			std::lock_guard<std::mutex> guard(mStateLock);
+			long cmdId = ParseNumber(argv[arg + 3], 16);
+
+			if (light->powered) {
+				light->on = (cmdId == 2) ? !light->on : (cmdId == 1);
+			}
+		}
+		/* With -d the shell waits for the default response of the light */
+		if (arg == 3 && !Receive(*light)) {
+			Error("Timeout");
+			return;
+		}
+		Done();
+	} else if (sub == "attr" && argv.size() == 8 && argv[2] == "read") {
+		/* zcl attr read <addr> <ep> <cluster> <profile> <attr id> */
+		Light *light = FindLight(ParseNumber(argv[3], 16), ParseNumber(argv[4], 10));
+
+		if (light == nullptr) {
+			Error("Unable to read the attribute");
+			return;
+		}
+		if (ParseNumber(argv[5], 16) != kClusterOnOff || ParseNumber(argv[7], 16) != 0) {
+			Error("Unsupported attribute");
+			return;
+		}
+		if (!Receive(*light)) {
+			Error("Timeout");
+			return;
+		}
+		std::unique_lock<std::mutex> guard(mStateLock);
+		bool on = light->on;
+
+		guard.unlock();
+		Print("ID: 0 Type: 10 Value: %s", on ? "True" : "False");
+		Done();
+	} else if (sub == "subscribe" && argv.size() >= 9 && argv.size() <= 11 && argv[2] == "on") {
+		/* zcl subscribe on <addr> <ep> <cluster> <profile> <attr id> <attr type> [<min s>] [<max s>] */
+		Light *light = FindLight(ParseNumber(argv[3], 16), ParseNumber(argv[4], 10));
+
+		if (light == nullptr) {
+			Error("Unable to configure the reporting");
+			return;
+		}
+		if (ParseNumber(argv[5], 16) != kClusterOnOff || ParseNumber(argv[7], 16) != 0) {
+			Error("Unsupported attribute");
+			return;
+		}
+		if (!Receive(*light)) {
+			Error("Timeout");
+			return;
+		}
+		std::unique_lock<std::mutex> guard(mStateLock);
+
+		/* The configure reporting request is dropped by the light, as when it is busy */
+		if (light->reporting && light->unansweredConfigs > 0) {
+			uint32_t lossTimeoutMs = mConfig.lossTimeoutMs;
+
+			light->unansweredConfigs--;
+			guard.unlock();
+			Sleep(lossTimeoutMs);
+			Error("Timeout");
+			return;
+		}
+		/* The configure reporting response of a light that cannot report */
+		if (!light->reporting) {
+			guard.unlock();
+			Error("Unsupported attribute reporting");
+			return;
+		}
+		light->subscribed = true;
+		guard.unlock();
+		Done();
+	} else {
+		Error("Invalid zcl command");
+	}
+}
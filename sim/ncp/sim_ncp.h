@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Stand-in for the Zigbee shell NCP of the bridge.
+ *
+ * Speaks the command and response grammar of the nRF Connect SDK Zigbee
+ * shell over a file descriptor for the commands the bridge sends, and
+ * keeps a population of dimmable lights on its network that answer the
+ * ZDO discovery requests and the On/Off cluster commands, reads and report
+ * configurations.
+ */
+class SimNcp {
+public:
+	struct Config {
+		/* Number of lights on the network */
+		uint16_t lightCount = 8;
+		/* The network is already formed, as in the NVRAM of a reset NCP */
+		bool commissioned = true;
+		/* Time "zdo match_desc" collects responses for before "Done" */
+		uint32_t matchDescTimeoutMs = 50;
+		/* Seeds the addresses of the lights, the network identifiers and the radio */
+		uint32_t seed = 1;
+		/* Over-the-air delay of a light's response, plus a uniform random jitter */
+		uint32_t latencyUs = 0;
+		uint32_t jitterUs = 0;
+		/* Share of frames from the lights that are lost, in percent */
+		uint8_t lossPercent = 0;
+		/* Time the shell waits for a lost unicast response before "Error" */
+		uint32_t lossTimeoutMs = 200;
+		/* Every light reports its On/Off attribute at this period, 0 for never */
+		uint32_t reportIntervalMs = 0;
+		/* Share of lights that cannot be configured to report, spread evenly, in percent */
+		uint8_t legacyPercent = 0;
+		/* Share of the lights that can report which take the configuration but never report, in percent */
+		uint8_t silentPercent = 0;
+		/* Report configurations each light that can report leaves unanswered before the first it answers */
+		uint8_t unansweredConfigs = 0;
+		/* Output paced at the line rate of this baud rate with 10 bits per byte, 0 for unpaced */
+		uint32_t baudRate = 0;
+	};
+
+	/* Transmitted and lost frames of the simulated lights */
+	struct Stats {
+		uint32_t responses;
+		uint32_t lost;
+		uint32_t announces;
+		uint32_t reports;
+	};
+
+	explicit SimNcp(const Config &config);
+
+	/* Serves the shell on fd until it is closed */
+	void Run(int fd);
+	/* The first count lights rejoin at once, as after a power cut */
+	void AnnounceBurst(uint16_t count);
+	/* A light without power neither answers nor reports, and does not announce itself when powered again */
+	void SetLightPowered(uint16_t addr, bool powered);
+	/* Changes the time the shell waits for a lost response, see Config */
+	void SetLossTimeout(uint32_t ms);
+	/* The light is switched locally, and reports its new state if configured to */
+	void ToggleLight(uint16_t addr);
+	/* State of the light, as a poll or report would give it */
+	bool IsLightOn(uint16_t addr);
+	/* Lights configured to report, out of those that can */
+	uint16_t SubscribedCount();
+	uint16_t ReportingCount() const;
+	uint16_t SilentCount() const;
+
+	uint16_t LightCount() const { return static_cast<uint16_t>(mLights.size()); }
+	Stats GetStats();
+
+private:
+	struct Light {
+		uint16_t addr;
+		uint8_t ep;
+		uint16_t devId;
+		bool on;
+		bool powered;
+		/* Supports attribute reporting, and was configured to report */
+		bool reporting;
+		bool subscribed;
+		/* Report configurations still to leave unanswered */
+		uint8_t unansweredConfigs;
+		/* Configured to report, but sends no report */
+		bool silent;
+	};
+
+	void Reboot();
+	void HandleLine(const std::string &line);
+	void Write(const std::string &text);
+	void Print(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+	void PrintLog(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+	void PrintReport(uint16_t addr, bool on);
+	void Done();
+	void Error(const char *reason);
+	Light *FindLight(uint16_t addr, int ep = -1);
+	void AnnounceLights(uint16_t count);
+	void ReportThreadMain();
+
+	struct Frame {
+		uint32_t delayUs;
+		bool lost;
+	};
+
+	Frame NextFrame();
+	/* Waits for the response of one light, false if it is lost or the light is off */
+	bool Receive(const Light &light);
+	/* Prints the frames sent by several lights at once as they arrive */
+	void ReceiveAll(std::vector<std::string> lines, bool log, uint32_t *stat);
+
+	void CmdBdb(const std::vector<std::string> &argv);
+	void CmdZdo(const std::vector<std::string> &argv);
+	void CmdZcl(const std::vector<std::string> &argv);
+
+	Config mConfig;
+	std::mt19937 mRandom;
+	std::vector<Light> mLights;
+	std::string mExtPanId;
+	uint16_t mPanId;
+	int mFd = -1;
+	std::mutex mWriteLock;
+	/* When the last byte written leaves the line, with a paced output */
+	std::chrono::steady_clock::time_point mLineFree;
+	/* Guards the lights, the random generator and the stats across threads */
+	std::mutex mStateLock;
+	Stats mStats = {};
+
+	/* Kept across reboots like the NVRAM of the NCP */
+	std::atomic<bool> mCommissioned;
+	bool mCoordinator = false;
+
+	/* Reset by a reboot */
+	bool mEcho = true;
+	std::atomic<bool> mStarted{ false };
+	std::string mLine;
+};
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sim_kernel.h"
+
+#include <zephyr.h>
+
+#include <chrono>
+#include <sim_thread.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point sBootTime = Clock::now();
+std::recursive_mutex sIrqLock;
+struct k_thread sMainThread = { "main", 0, pthread_self(), {}, {}, {} };
+thread_local struct k_thread *sCurrentThread = &sMainThread;
+std::mutex sThreadsLock;
+std::vector<struct k_thread *> sThreads = { &sMainThread };
+thread_local bool sInIsr;
+
+int64_t NowUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sBootTime).count();
+}
+
+std::chrono::microseconds ToDuration(k_timeout_t timeout)
+{
+	return std::chrono::microseconds(timeout.us);
+}
+} /* namespace */
+
+IsrScope::IsrScope() : mWasInIsr(sInIsr)
+{
+	sIrqLock.lock();
+	sInIsr = true;
+}
+
+IsrScope::~IsrScope()
+{
+	sInIsr = mWasInIsr;
+	sIrqLock.unlock();
+}
+
+int64_t k_uptime_get(void)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - sBootTime).count();
+}
+
+uint32_t k_cycle_get_32(void)
+{
+	return static_cast<uint32_t>(NowUs());
+}
+
+k_tid_t k_thread_create(struct k_thread *new_thread, k_thread_stack_t *stack, size_t stack_size,
+			k_thread_entry_t entry, void *p1, void *p2, void *p3, int prio, uint32_t options,
+			k_timeout_t delay)
+{
+	ARG_UNUSED(stack);
+	ARG_UNUSED(stack_size);
+	ARG_UNUSED(options);
+
+	new_thread->name[0] = '\0';
+	new_thread->prio = prio;
+	new_thread->waits = 0;
+	new_thread->pendingSem = nullptr;
+	new_thread->sleepUntilUs = 0;
+
+	std::thread thread([=]() {
+		sCurrentThread = new_thread;
+		if (delay.us > 0) {
+			k_sleep(delay);
+		}
+		entry(p1, p2, p3);
+	});
+	std::lock_guard<std::mutex> guard(sThreadsLock);
+
+	new_thread->native = thread.native_handle();
+	sThreads.push_back(new_thread);
+	thread.detach();
+
+	return new_thread;
+}
+
+int k_thread_name_set(k_tid_t thread, const char *name)
+{
+	strncpy(thread->name, name, sizeof(thread->name) - 1);
+	thread->name[sizeof(thread->name) - 1] = '\0';
+
+	return 0;
+}
+
+const char *k_thread_name_get(k_tid_t thread)
+{
+	return thread->name;
+}
+
+k_tid_t k_current_get(void)
+{
+	return sCurrentThread;
+}
+
+int k_thread_priority_get(k_tid_t thread)
+{
+	return thread->prio;
+}
+
+int32_t k_sleep(k_timeout_t timeout)
+{
+	if (timeout.us < 0) {
+		for (;;) {
+			std::this_thread::sleep_for(std::chrono::hours(1));
+		}
+	}
+	sCurrentThread->sleepUntilUs = NowUs() + timeout.us;
+	std::this_thread::sleep_for(ToDuration(timeout));
+	sCurrentThread->sleepUntilUs = 0;
+
+	return 0;
+}
+
+void k_yield(void)
+{
+	std::this_thread::yield();
+}
+
+bool k_is_in_isr(void)
+{
+	return sInIsr;
+}
+
+void k_thread_foreach(k_thread_user_cb_t user_cb, void *user_data)
+{
+	std::lock_guard<std::mutex> guard(sThreadsLock);
+
+	for (struct k_thread *thread : sThreads) {
+		user_cb(thread, user_data);
+	}
+}
+
+int k_thread_runtime_stats_get(k_tid_t thread, k_thread_runtime_stats_t *stats)
+{
+	clockid_t clock;
+	struct timespec now;
+
+	if (pthread_getcpuclockid(thread->native, &clock) || clock_gettime(clock, &now)) {
+		return -EINVAL;
+	}
+	stats->execution_cycles = static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+
+	return 0;
+}
+
+uint32_t sim_thread_wait_count(k_tid_t thread)
+{
+	return thread->waits;
+}
+
+bool sim_thread_is_blocked(k_tid_t thread)
+{
+	struct k_sem *sem = thread->pendingSem;
+	int64_t sleepUntil = thread->sleepUntilUs;
+
+	if (sem != nullptr) {
+		return k_sem_count_get(sem) == 0;
+	}
+
+	return sleepUntil != 0 && NowUs() < sleepUntil;
+}
+
+unsigned int irq_lock(void)
+{
+	sIrqLock.lock();
+
+	return 0;
+}
+
+void irq_unlock(unsigned int key)
+{
+	ARG_UNUSED(key);
+
+	sIrqLock.unlock();
+}
+
+int k_sem_init(struct k_sem *sem, unsigned int initial_count, unsigned int limit)
+{
+	std::lock_guard<std::mutex> guard(sem->lock);
+
+	sem->count = initial_count;
+	sem->limit = limit;
+
+	return 0;
+}
+
+int k_sem_take(struct k_sem *sem, k_timeout_t timeout)
+{
+	std::unique_lock<std::mutex> guard(sem->lock);
+	auto available = [sem]() { return sem->count > 0; };
+	bool waited;
+
+	if (!available() && timeout.us != 0) {
+		sCurrentThread->pendingSem = sem;
+		sCurrentThread->waits++;
+	}
+	if (timeout.us < 0) {
+		sem->cond.wait(guard, available);
+		waited = true;
+	} else {
+		waited = sem->cond.wait_for(guard, ToDuration(timeout), available);
+	}
+	sCurrentThread->pendingSem = nullptr;
+	if (!waited) {
+		return timeout.us == 0 ? -EBUSY : -EAGAIN;
+	}
+	sem->count--;
+
+	return 0;
+}
+
+void k_sem_give(struct k_sem *sem)
+{
+	std::lock_guard<std::mutex> guard(sem->lock);
+
+	if (sem->count < sem->limit) {
+		sem->count++;
+	}
+	sem->cond.notify_one();
+}
+
+void k_sem_reset(struct k_sem *sem)
+{
+	std::lock_guard<std::mutex> guard(sem->lock);
+
+	sem->count = 0;
+}
+
+unsigned int k_sem_count_get(struct k_sem *sem)
+{
+	std::lock_guard<std::mutex> guard(sem->lock);
+
+	return sem->count;
+}
+
+namespace {
+void TimerThreadMain(struct k_timer *timer)
+{
+	std::unique_lock<std::mutex> guard(timer->lock);
+
+	for (;;) {
+		if (timer->nextUs < 0) {
+			timer->cond.wait(guard);
+			continue;
+		}
+
+		int64_t now = NowUs();
+
+		if (now < timer->nextUs) {
+			timer->cond.wait_for(guard, std::chrono::microseconds(timer->nextUs - now));
+			continue;
+		}
+		/* A period of 0 or K_FOREVER makes a one-shot timer */
+		timer->nextUs = timer->periodUs > 0 ? timer->nextUs + timer->periodUs : -1;
+		guard.unlock();
+		{
+			IsrScope isr;
+
+			timer->expiry_fn(timer);
+		}
+		guard.lock();
+	}
+}
+} /* namespace */
+
+void k_timer_init(struct k_timer *timer, k_timer_expiry_t expiry_fn, k_timer_stop_t stop_fn)
+{
+	std::lock_guard<std::mutex> guard(timer->lock);
+
+	timer->expiry_fn = expiry_fn;
+	timer->stop_fn = stop_fn;
+	timer->user_data = nullptr;
+	timer->nextUs = -1;
+	timer->periodUs = 0;
+}
+
+void k_timer_start(struct k_timer *timer, k_timeout_t duration, k_timeout_t period)
+{
+	std::lock_guard<std::mutex> guard(timer->lock);
+
+	timer->nextUs = NowUs() + MAX(duration.us, int64_t(0));
+	timer->periodUs = period.us;
+	if (!timer->threadStarted) {
+		timer->threadStarted = true;
+		std::thread(TimerThreadMain, timer).detach();
+	}
+	timer->cond.notify_one();
+}
+
+void k_timer_stop(struct k_timer *timer)
+{
+	bool running;
+
+	{
+		std::lock_guard<std::mutex> guard(timer->lock);
+
+		running = timer->nextUs >= 0;
+		timer->nextUs = -1;
+		timer->cond.notify_one();
+	}
+	if (running && timer->stop_fn) {
+		timer->stop_fn(timer);
+	}
+}
+
+k_mem_slab::k_mem_slab(char *buffer, size_t blockSize, uint32_t numBlocks)
+	: buffer(buffer), block_size(blockSize), num_blocks(numBlocks), num_used(0), free_list(nullptr)
+{
+	for (uint32_t i = numBlocks; i > 0; i--) {
+		char *block = buffer + (i - 1) * blockSize;
+
+		*reinterpret_cast<char **>(block) = free_list;
+		free_list = block;
+	}
+}
+
+int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem, k_timeout_t timeout)
+{
+	std::lock_guard<std::mutex> guard(slab->lock);
+
+	ARG_UNUSED(timeout);
+
+	if (slab->free_list == nullptr) {
+		*mem = nullptr;
+		return -ENOMEM;
+	}
+	*mem = slab->free_list;
+	slab->free_list = *reinterpret_cast<char **>(slab->free_list);
+	slab->num_used++;
+
+	return 0;
+}
+
+void k_mem_slab_free(struct k_mem_slab *slab, void **mem)
+{
+	std::lock_guard<std::mutex> guard(slab->lock);
+	char *block = static_cast<char *>(*mem);
+
+	*reinterpret_cast<char **>(block) = slab->free_list;
+	slab->free_list = block;
+	slab->num_used--;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <logging/log.h>
+#include <zephyr.h>
+
+#include <cstdarg>
+
+namespace {
+const char *const sLevelNames[] = { "", "err", "wrn", "inf", "dbg" };
+int sLevel = LOG_LEVEL_WRN;
+std::mutex sLogLock;
+} /* namespace */
+
+void sim_log_set_level(int level)
+{
+	sLevel = level;
+}
+
+void sim_log(const char *module, int level, const char *fmt, ...)
+{
+	int64_t now = k_uptime_get();
+	va_list args;
+
+	if (level > sLevel) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(sLogLock);
+
+	fprintf(stderr, "[%03lld.%03lld] <%s> %s: ", static_cast<long long>(now / 1000),
+		static_cast<long long>(now % 1000), sLevelNames[level], module);
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
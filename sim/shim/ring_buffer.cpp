@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <sys/ring_buffer.h>
+
+#include <cstring>
+
+/* head and tail run freely, the producer only writes tail and the consumer only head */
+
+namespace {
+uint32_t Used(struct ring_buf *buf)
+{
+	return __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+}
+
+void CopyOut(struct ring_buf *buf, uint32_t from, uint8_t *data, uint32_t size)
+{
+	uint32_t offset = from % buf->size;
+	uint32_t first = (size < buf->size - offset) ? size : buf->size - offset;
+
+	memcpy(data, buf->buffer + offset, first);
+	memcpy(data + first, buf->buffer, size - first);
+}
+} /* namespace */
+
+void ring_buf_init(struct ring_buf *buf, uint32_t size, void *data)
+{
+	buf->buffer = static_cast<uint8_t *>(data);
+	buf->size = size;
+	ring_buf_reset(buf);
+}
+
+void ring_buf_reset(struct ring_buf *buf)
+{
+	__atomic_store_n(&buf->head, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&buf->tail, 0, __ATOMIC_RELEASE);
+}
+
+uint32_t ring_buf_put(struct ring_buf *buf, const uint8_t *data, uint32_t size)
+{
+	uint32_t tail = buf->tail;
+	uint32_t space = buf->size - Used(buf);
+	uint32_t offset = tail % buf->size;
+	uint32_t first;
+
+	size = (size < space) ? size : space;
+	first = (size < buf->size - offset) ? size : buf->size - offset;
+	memcpy(buf->buffer + offset, data, first);
+	memcpy(buf->buffer, data + first, size - first);
+	__atomic_store_n(&buf->tail, tail + size, __ATOMIC_RELEASE);
+
+	return size;
+}
+
+uint32_t ring_buf_peek(struct ring_buf *buf, uint8_t *data, uint32_t size)
+{
+	uint32_t used = Used(buf);
+
+	size = (size < used) ? size : used;
+	CopyOut(buf, buf->head, data, size);
+
+	return size;
+}
+
+uint32_t ring_buf_get(struct ring_buf *buf, uint8_t *data, uint32_t size)
+{
+	uint32_t used = Used(buf);
+
+	size = (size < used) ? size : used;
+	if (data != nullptr) {
+		CopyOut(buf, buf->head, data, size);
+	}
+	__atomic_store_n(&buf->head, buf->head + size, __ATOMIC_RELEASE);
+
+	return size;
+}
+
+uint32_t ring_buf_space_get(struct ring_buf *buf)
+{
+	return buf->size - Used(buf);
+}
+
+uint32_t ring_buf_size_get(struct ring_buf *buf)
+{
+	return Used(buf);
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+/*
+ * Interrupt context of the host kernel. Simulated peripherals call their
+ * callbacks inside an IsrScope, which serializes them like a single core
+ * and makes k_is_in_isr() true for the callback.
+ */
+class IsrScope {
+public:
+	IsrScope();
+	~IsrScope();
+
+	IsrScope(const IsrScope &) = delete;
+	IsrScope &operator=(const IsrScope &) = delete;
+
+private:
+	bool mWasInIsr;
+};
@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sim_kernel.h"
+
+#include <drivers/uart.h>
+#include <sim_uart.h>
+#include <zephyr.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+constexpr size_t kMaxDevices = 4;
+constexpr size_t kReadChunk = 256;
+
+struct SimUart {
+	struct device dev;
+	int fd;
+	uart_callback_t callback;
+	void *userData;
+	std::mutex lock;
+	/* Signalled when receiving is enabled again */
+	std::condition_variable rxEnabledCond;
+	/* Held while received bytes are delivered, by the RX thread or sim_uart_rx_inject() */
+	std::mutex rxLock;
+	uint8_t *rxBuf;
+	size_t rxLen;
+	size_t rxPos;
+	uint8_t *nextBuf;
+	size_t nextLen;
+	bool rxEnabled;
+	bool rxThreadStarted;
+	/* UART_RX_BUF_REQUEST is sent before the next bytes, out of the caller of uart_rx_enable() */
+	bool bufRequestPending;
+	bool flowControl;
+	uint32_t baudRate;
+	/* Rate of the other end, 0 when any rate works, and whether RTS/CTS are wired */
+	uint32_t lineBaudRate;
+	bool flowControlWired;
+	size_t rxLost;
+	/* Buffer handed to uart_tx() until its UART_TX_DONE or UART_TX_ABORTED */
+	std::condition_variable txCond;
+	const uint8_t *txBuf;
+	size_t txLen;
+	int32_t txTimeout;
+	bool txBusy;
+	bool txThreadStarted;
+};
+
+SimUart sDevices[kMaxDevices];
+size_t sDeviceCount;
+
+SimUart *ToUart(const struct device *dev)
+{
+	return dev ? static_cast<SimUart *>(dev->data) : nullptr;
+}
+
+void Notify(SimUart *uart, struct uart_event &evt)
+{
+	IsrScope isr;
+
+	if (uart->callback) {
+		uart->callback(&uart->dev, &evt, uart->userData);
+	}
+}
+
+/* The other end can be held off with RTS */
+bool HoldsOff(SimUart *uart)
+{
+	return uart->flowControl && uart->flowControlWired;
+}
+
+/* Bytes sent at another rate than the receiver's come out as other, non-ASCII, bytes */
+void Garble(SimUart *uart, uint8_t *data, size_t len)
+{
+	if (uart->lineBaudRate == 0 || uart->lineBaudRate == uart->baudRate) {
+		return;
+	}
+	for (size_t i = 0; i < len; i++) {
+		data[i] = 0x80 | (data[i] ^ 0x55);
+	}
+}
+
+void NotifyBufRequest(SimUart *uart)
+{
+	struct uart_event evt = {};
+
+	evt.type = UART_RX_BUF_REQUEST;
+	Notify(uart, evt);
+}
+
+/* Reports len bytes received at the current buffer position, false when receiving stopped */
+bool Received(SimUart *uart, size_t len)
+{
+	struct uart_event evt = {};
+	bool next;
+
+	evt.type = UART_RX_RDY;
+	evt.data.rx.buf = uart->rxBuf;
+	evt.data.rx.offset = uart->rxPos;
+	evt.data.rx.len = len;
+	uart->rxPos += len;
+	Notify(uart, evt);
+
+	if (uart->rxPos < uart->rxLen) {
+		return true;
+	}
+
+	std::unique_lock<std::mutex> guard(uart->lock);
+
+	evt = {};
+	evt.type = UART_RX_BUF_RELEASED;
+	evt.data.rx_buf.buf = uart->rxBuf;
+	/* The driver stops receiving when it is given no next buffer in time */
+	next = (uart->nextBuf != nullptr);
+	uart->rxEnabled = next;
+	uart->rxBuf = uart->nextBuf;
+	uart->rxLen = uart->nextLen;
+	uart->rxPos = 0;
+	uart->nextBuf = nullptr;
+	guard.unlock();
+	Notify(uart, evt);
+	if (next) {
+		NotifyBufRequest(uart);
+		return true;
+	}
+	evt = {};
+	evt.type = UART_RX_DISABLED;
+	Notify(uart, evt);
+
+	return false;
+}
+
+/*
+ * Delivers bytes received from the line, with rxLock held. With flow
+ * control the sender is held off while receiving is stopped, otherwise
+ * the bytes arriving meanwhile are lost.
+ */
+void Deliver(SimUart *uart, const uint8_t *data, size_t len)
+{
+	while (len > 0) {
+		std::unique_lock<std::mutex> guard(uart->lock);
+		bool bufRequest;
+		size_t chunk;
+
+		if (HoldsOff(uart)) {
+			uart->rxEnabledCond.wait(guard, [uart] { return uart->rxEnabled; });
+		} else if (!uart->rxEnabled) {
+			uart->rxLost += len;
+			return;
+		}
+		bufRequest = uart->bufRequestPending;
+		uart->bufRequestPending = false;
+		guard.unlock();
+		if (bufRequest) {
+			NotifyBufRequest(uart);
+		}
+
+		/* A chunk crossing the end of the buffer is split like the UARTE does */
+		chunk = MIN(len, uart->rxLen - uart->rxPos);
+		memcpy(uart->rxBuf + uart->rxPos, data, chunk);
+		Garble(uart, uart->rxBuf + uart->rxPos, chunk);
+		Received(uart, chunk);
+		data += chunk;
+		len -= chunk;
+	}
+}
+
+/*
+ * Plays the part of the UARTE transmitter: the buffer is sent from where
+ * the caller left it, taking the time of its bytes on the line when the
+ * line has a rate, and its end is reported from this thread.
+ */
+void TxThreadMain(SimUart *uart)
+{
+	std::vector<uint8_t> data;
+
+	for (;;) {
+		std::unique_lock<std::mutex> guard(uart->lock);
+		struct uart_event evt = {};
+		size_t written = 0;
+
+		uart->txCond.wait(guard, [uart] { return uart->txBuf != nullptr; });
+
+		const uint8_t *buf = uart->txBuf;
+		size_t len = uart->txLen;
+		int32_t timeout = uart->txTimeout;
+		uint32_t lineBaudRate = uart->lineBaudRate;
+		/* CTS is never asserted when it is not wired, so nothing is sent before the timeout */
+		bool blocked = uart->flowControl && !uart->flowControlWired;
+
+		guard.unlock();
+		if (blocked) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+		} else {
+			if (lineBaudRate != 0) {
+				/* 10 bits per byte with the start and stop bits */
+				std::this_thread::sleep_for(std::chrono::microseconds(len * 10000000ull / lineBaudRate));
+			}
+			data.assign(buf, buf + len);
+			Garble(uart, data.data(), len);
+			while (written < len) {
+				ssize_t ret = write(uart->fd, data.data() + written, len - written);
+
+				if (ret <= 0) {
+					break;
+				}
+				written += ret;
+			}
+		}
+
+		guard.lock();
+		uart->txBuf = nullptr;
+		uart->txBusy = false;
+		guard.unlock();
+		evt.type = (written == len) ? UART_TX_DONE : UART_TX_ABORTED;
+		evt.data.tx.buf = buf;
+		evt.data.tx.len = written;
+		Notify(uart, evt);
+	}
+}
+
+/* Plays the part of the UARTE receiver and its RX timeout for one device */
+void RxThreadMain(SimUart *uart)
+{
+	uint8_t buf[kReadChunk];
+
+	for (;;) {
+		if (HoldsOff(uart)) {
+			/* The line stays quiet until receiving is enabled again, as with RTS */
+			std::unique_lock<std::mutex> guard(uart->lock);
+
+			uart->rxEnabledCond.wait(guard, [uart] { return uart->rxEnabled; });
+		}
+
+		ssize_t len = read(uart->fd, buf, sizeof(buf));
+		std::lock_guard<std::mutex> guard(uart->rxLock);
+
+		if (len <= 0) {
+			break;
+		}
+		Deliver(uart, buf, len);
+	}
+
+	std::lock_guard<std::mutex> guard(uart->rxLock);
+	struct uart_event evt = {};
+
+	if (uart->rxEnabled) {
+		uart->rxEnabled = false;
+		evt.type = UART_RX_DISABLED;
+		Notify(uart, evt);
+	}
+}
+} /* namespace */
+
+int sim_uart_attach(const char *name, int fd)
+{
+	if (sDeviceCount >= kMaxDevices) {
+		return -ENOMEM;
+	}
+
+	SimUart *uart = &sDevices[sDeviceCount++];
+
+	uart->dev.name = name;
+	uart->dev.data = uart;
+	uart->fd = fd;
+	uart->baudRate = 115200;
+	uart->flowControlWired = true;
+
+	return 0;
+}
+
+int sim_uart_set_flow_control(const char *name, bool enable)
+{
+	SimUart *uart = ToUart(device_get_binding(name));
+
+	if (uart == nullptr) {
+		return -ENODEV;
+	}
+	uart->flowControl = enable;
+
+	return 0;
+}
+
+int sim_uart_set_line(const char *name, uint32_t baudRate, bool flowControlWired)
+{
+	SimUart *uart = ToUart(device_get_binding(name));
+
+	if (uart == nullptr) {
+		return -ENODEV;
+	}
+	uart->lineBaudRate = baudRate;
+	uart->flowControlWired = flowControlWired;
+
+	return 0;
+}
+
+size_t sim_uart_rx_lost(const char *name)
+{
+	SimUart *uart = ToUart(device_get_binding(name));
+
+	if (uart == nullptr) {
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> guard(uart->lock);
+
+	return uart->rxLost;
+}
+
+int sim_uart_rx_inject(const char *name, const uint8_t *data, size_t len)
+{
+	SimUart *uart = ToUart(device_get_binding(name));
+
+	if (uart == nullptr) {
+		return -ENODEV;
+	}
+
+	std::lock_guard<std::mutex> guard(uart->rxLock);
+
+	if (!uart->rxEnabled && !HoldsOff(uart)) {
+		return -EIO;
+	}
+	Deliver(uart, data, len);
+
+	return 0;
+}
+
+const struct device *device_get_binding(const char *name)
+{
+	for (size_t i = 0; i < sDeviceCount; i++) {
+		if (!strcmp(sDevices[i].dev.name, name)) {
+			return &sDevices[i].dev;
+		}
+	}
+
+	return nullptr;
+}
+
+int uart_callback_set(const struct device *dev, uart_callback_t callback, void *user_data)
+{
+	SimUart *uart = ToUart(dev);
+
+	if (uart == nullptr) {
+		return -ENODEV;
+	}
+	uart->callback = callback;
+	uart->userData = user_data;
+
+	return 0;
+}
+
+int uart_tx(const struct device *dev, const uint8_t *buf, size_t len, int32_t timeout)
+{
+	SimUart *uart = ToUart(dev);
+
+	if (uart == nullptr) {
+		return -ENODEV;
+	}
+
+	std::lock_guard<std::mutex> guard(uart->lock);
+
+	if (uart->txBusy) {
+		return -EBUSY;
+	}
+	uart->txBusy = true;
+	uart->txBuf = buf;
+	uart->txLen = len;
+	uart->txTimeout = timeout;
+	uart->txCond.notify_one();
+	if (!uart->txThreadStarted) {
+		uart->txThreadStarted = true;
+		std::thread(TxThreadMain, uart).detach();
+	}
+
+	return 0;
+}
+
+int uart_rx_enable(const struct device *dev, uint8_t *buf, size_t len, int32_t timeout)
+{
+	SimUart *uart = ToUart(dev);
+
+	ARG_UNUSED(timeout);
+
+	if (uart == nullptr) {
+		return -ENODEV;
+	}
+
+	std::lock_guard<std::mutex> guard(uart->lock);
+
+	if (uart->rxEnabled) {
+		return -EBUSY;
+	}
+	uart->rxBuf = buf;
+	uart->rxLen = len;
+	uart->rxPos = 0;
+	uart->nextBuf = nullptr;
+	uart->rxEnabled = true;
+	uart->bufRequestPending = true;
+	uart->rxEnabledCond.notify_all();
+	if (!uart->rxThreadStarted && uart->fd >= 0) {
+		uart->rxThreadStarted = true;
+		std::thread(RxThreadMain, uart).detach();
+	}
+
+	return 0;
+}
+
+int uart_rx_buf_rsp(const struct device *dev, uint8_t *buf, size_t len)
+{
+	SimUart *uart = ToUart(dev);
+	std::lock_guard<std::mutex> guard(uart->lock);
+
+	if (!uart->rxEnabled) {
+		return -EACCES;
+	}
+	if (uart->nextBuf != nullptr) {
+		return -EBUSY;
+	}
+	uart->nextBuf = buf;
+	uart->nextLen = len;
+
+	return 0;
+}
+
+int uart_config_get(const struct device *dev, struct uart_config *cfg)
+{
+	SimUart *uart = ToUart(dev);
+
+	if (uart == nullptr) {
+		return -ENODEV;
+	}
+	*cfg = {};
+	cfg->baudrate = uart->baudRate;
+	cfg->parity = UART_CFG_PARITY_NONE;
+	cfg->stop_bits = UART_CFG_STOP_BITS_1;
+	cfg->data_bits = UART_CFG_DATA_BITS_8;
+	cfg->flow_ctrl = uart->flowControl ? UART_CFG_FLOW_CTRL_RTS_CTS : UART_CFG_FLOW_CTRL_NONE;
+
+	return 0;
+}
+
+int uart_configure(const struct device *dev, const struct uart_config *cfg)
+{
+	SimUart *uart = ToUart(dev);
+
+	if (uart == nullptr) {
+		return -ENODEV;
+	}
+	if (cfg->flow_ctrl == UART_CFG_FLOW_CTRL_DTR_DSR) {
+		return -ENOTSUP;
+	}
+	uart->baudRate = cfg->baudrate;
+	uart->flowControl = (cfg->flow_ctrl == UART_CFG_FLOW_CTRL_RTS_CTS);
+	{
+		std::lock_guard<std::mutex> guard(uart->lock);
+
+		uart->rxEnabledCond.notify_all();
+	}
+
+	return 0;
+}
+
+int uart_rx_disable(const struct device *dev)
+{
+	SimUart *uart = ToUart(dev);
+
+	if (uart == nullptr || !uart->rxEnabled) {
+		return -EFAULT;
+	}
+	/* Receiving stops when the other end closes, see RxThreadMain() */
+	return -ENOTSUP;
+}
@@ -16,21 +16,38 @@
  */
 
 #include "Device.h"
+#include "trace.h"
 
 #include <cstdio>
-#include <lib/support/CHIPMemString.h>
-#include <platform/CHIPDeviceLayer.h>
+#include <cstring>
+#include <logging/log.h>
+#include <zephyr.h>
 
-using namespace ::chip::Platform;
+LOG_MODULE_DECLARE(app);
+
+namespace
+{
+void CopyString(char * dest, size_t destSize, const char * source)
+{
+	snprintf(dest, destSize, "%s", source);
+}
+} // namespace
 
 Device::Device(void)
 {
 	CopyString(mName, sizeof(mName), "none");
 	CopyString(mLocation, sizeof(mLocation), "none");
 	mState	  = kState_Off;
+	mConfirmedState = kState_Off;
+	mPendingCount = 0;
+	mPendingSeq = 0;
+	mPendingSince = 0;
 	mReachable  = false;
 	mEndpointId = 0;
 	mChanged_CB = nullptr;
+	mZbAddr     = 0;
+	mZbEp       = 0;
+	mZbDevId    = 0;
 }
 
 Device::Device(const char * szDeviceName, const char * szLocation)
@@ -38,9 +55,16 @@ Device::Device(const char * szDeviceName, const char * szLocation)
 	CopyString(mName, sizeof(mName), szDeviceName);
 	CopyString(mLocation, sizeof(mLocation), szLocation);
 	mState	  = kState_Off;
+	mConfirmedState = kState_Off;
+	mPendingCount = 0;
+	mPendingSeq = 0;
+	mPendingSince = 0;
 	mReachable  = false;
 	mEndpointId = 0;
 	mChanged_CB = nullptr;
+	mZbAddr     = 0;
+	mZbEp       = 0;
+	mZbDevId    = 0;
 }
 
 bool Device::IsOn() const
@@ -53,27 +77,85 @@ bool Device::IsReachable() const
 	return mReachable;
 }
 
+/* State read back from the Zigbee device. While a write is in flight the
+ * read may predate it, so it only becomes the state to roll back to and
+ * the write decides the reported state when it completes. */
 void Device::SetOnOff(bool aOn)
 {
-	bool changed;
+	mConfirmedState = aOn ? kState_On : kState_Off;
+	TRACE(Trace::kEvent_DeviceOnOff, mEndpointId, aOn);
 
-	if (aOn)
+	if (mPendingCount == 0)
 	{
-		changed = (mState != kState_On);
-		mState  = kState_On;
-		ChipLogProgress(DeviceLayer, "Device[%s]: ON", mName);
+		ApplyState(mConfirmedState);
 	}
-	else
+}
+
+void Device::ApplyState(State_t aState)
+{
+	bool changed = (mState != aState);
+
+	mState = aState;
+
+	if (changed && mChanged_CB)
 	{
-		changed = (mState != kState_Off);
-		mState  = kState_Off;
-		ChipLogProgress(DeviceLayer, "Device[%s]: OFF", mName);
+		mChanged_CB(this, kChanged_State);
 	}
+}
+
+/* Apply the target state before the Zigbee command completes, so that
+ * controllers see the change immediately. Returns the sequence number
+ * to pass to ConfirmOnOff() or RollbackOnOff() once the command finishes. */
+uint16_t Device::SetOnOffPending(bool aOn)
+{
+	State_t target = aOn ? kState_On : kState_Off;
+	bool changed   = (mState != target);
+
+	mState        = target;
+	mPendingCount++;
+	mPendingSince = k_cycle_get_32();
+	mPendingSeq++;
+
+	TRACE(Trace::kEvent_DeviceOnOffPending, mEndpointId, aOn, mPendingSeq);
 
 	if (changed && mChanged_CB)
 	{
 		mChanged_CB(this, kChanged_State);
 	}
+
+	return mPendingSeq;
+}
+
+/* Records the state the command set. Once no other command is queued or
+ * in flight, applies it and reports it when a read in the meantime had it
+ * differ. Returns true when aSeq was the latest command, i.e. the state
+ * reported to controllers is now confirmed by the Zigbee device. */
+bool Device::ConfirmOnOff(uint16_t aSeq, bool aOn)
+{
+	mConfirmedState = aOn ? kState_On : kState_Off;
+
+	if (mPendingCount > 0 && --mPendingCount > 0)
+	{
+		return false;
+	}
+
+	ApplyState(mConfirmedState);
+	return aSeq == mPendingSeq;
+}
+
+/* The command failed or was refused. Once no other command is queued or
+ * in flight, restores the last confirmed state and reports it, so a
+ * failure does not undo the state of commands still to complete. */
+void Device::RollbackOnOff(uint16_t aSeq)
+{
+	if (mPendingCount > 0 && --mPendingCount > 0)
+	{
+		return;
+	}
+
+	TRACE(Trace::kEvent_DeviceRollback, mEndpointId, mConfirmedState == kState_On, aSeq);
+
+	ApplyState(mConfirmedState);
 }
 
 void Device::SetReachable(bool aReachable)
@@ -84,11 +166,11 @@ void Device::SetReachable(bool aReachable)
 
 	if (aReachable)
 	{
-		ChipLogProgress(DeviceLayer, "Device[%s]: ONLINE", mName);
+		LOG_INF("Device[%s]: ONLINE", mName);
 	}
 	else
 	{
-		ChipLogProgress(DeviceLayer, "Device[%s]: OFFLINE", mName);
+		LOG_INF("Device[%s]: OFFLINE", mName);
 	}
 
 	if (changed && mChanged_CB)
@@ -101,7 +183,7 @@ void Device::SetName(const char * szName)
 {
 	bool changed = (strncmp(mName, szName, sizeof(mName)) != 0);
 
-	ChipLogProgress(DeviceLayer, "Device[%s]: New Name=\"%s\"", mName, szName);
+	LOG_INF("Device[%s]: New Name=\"%s\"", mName, szName);
 
 	CopyString(mName, sizeof(mName), szName);
 
@@ -117,7 +199,7 @@ void Device::SetLocation(const char * szLocation)
 
 	CopyString(mLocation, sizeof(mLocation), szLocation);
 
-	ChipLogProgress(DeviceLayer, "Device[%s]: Location=\"%s\"", mName, mLocation);
+	LOG_INF("Device[%s]: Location=\"%s\"", mName, mLocation);
 
 	if (changed && mChanged_CB)
 	{
@@ -135,6 +217,11 @@ void Device::SetZbEp(uint8_t aZbEp)
 	mZbEp = aZbEp;
 }
 
+void Device::SetZbDevId(uint16_t aZbDevId)
+{
+	mZbDevId = aZbDevId;
+}
+
 void Device::SetChangeCallback(DeviceCallback_fn aChanged_CB)
 {
 	mChanged_CB = aChanged_CB;
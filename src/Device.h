@@ -15,7 +15,8 @@
  *    limitations under the License.
  */
 
-#include <app/util/attribute-storage.h>
+#pragma once
+
 #include <functional>
 #include <stdbool.h>
 #include <stdint.h>
@@ -46,28 +47,45 @@ public:
 	bool IsOn() const;
 	bool IsReachable() const;
 	void SetOnOff(bool aOn);
+	uint16_t SetOnOffPending(bool aOn);
+	bool ConfirmOnOff(uint16_t aSeq, bool aOn);
+	void RollbackOnOff(uint16_t aSeq);
+	inline bool IsOnOffPending() const { return mPendingCount > 0; };
+	inline uint32_t GetPendingSince() const { return mPendingSince; };
 	void SetReachable(bool aReachable);
 	void SetName(const char * szDeviceName);
 	void SetLocation(const char * szLocation);
 	void SetZbAddr(uint16_t aZbAddr);
 	void SetZbEp(uint8_t aZbEp);
-	inline void SetEndpointId(chip::EndpointId id) { mEndpointId = id; };
-	inline chip::EndpointId GetEndpointId() { return mEndpointId; };
+	void SetZbDevId(uint16_t aZbDevId);
+	/* Id of its Matter endpoint, a chip::EndpointId */
+	inline void SetEndpointId(uint16_t id) { mEndpointId = id; };
+	inline uint16_t GetEndpointId() const { return mEndpointId; };
 	inline char * GetName() { return mName; };
 	inline char * GetLocation() { return mLocation; };
-	inline uint16_t GetZbAddr() { return mZbAddr; };
-	inline uint8_t GetZbEp() { return mZbEp; };
+	inline uint16_t GetZbAddr() const { return mZbAddr; };
+	inline uint8_t GetZbEp() const { return mZbEp; };
+	inline uint16_t GetZbDevId() const { return mZbDevId; };
 
 	using DeviceCallback_fn = std::function<void(Device *, Changed_t)>;
 	void SetChangeCallback(DeviceCallback_fn aChanged_CB);
 
 private:
+	/* Sets the reported state, and reports it when it changed */
+	void ApplyState(State_t aState);
+
 	State_t mState;
+	State_t mConfirmedState;
+	/* Commands queued or in flight, the state settles when the last one completes */
+	uint16_t mPendingCount;
+	uint16_t mPendingSeq;
+	uint32_t mPendingSince;
 	bool mReachable;
 	char mName[kDeviceNameSize];
 	char mLocation[kDeviceLocationSize];
-	chip::EndpointId mEndpointId;
+	uint16_t mEndpointId;
 	DeviceCallback_fn mChanged_CB;
 	uint16_t mZbAddr;
 	uint8_t mZbEp;
+	uint16_t mZbDevId;
 };
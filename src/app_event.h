@@ -8,37 +8,68 @@
 
 #include <cstdint>
 
-#include "led_widget.h"
 #include "zigbee_shell.h"
 
+class Device;
+
 struct AppEvent {
 	enum LightEventType : uint8_t { On, Off, Toggle, Level };
 
-	enum EventType : uint8_t { FunctionPress = Level + 1, FunctionRelease, FunctionTimer };
-
-	enum UpdateLedStateEventType : uint8_t { UpdateLedState = FunctionTimer + 1 };
+	enum EventType : uint8_t {
+		FunctionPress = Level + 1,
+		FunctionRelease,
+		FunctionTimer,
+		LivenessTimer,
+		PollTimer,
+		SubscriptionsChanged,
+		ReportTimer
+	};
 
 	enum ZigbeeShellEventType : uint8_t {
-		NetworkRejoin = UpdateLedState + 1,
-		DeviceAnnounceRsp,
-		ActiveEpRsp,
+		NetworkRejoin = ReportTimer + 1,
+		/* Has the app task take the next entry of the DiscoveryQueue */
+		DiscoveryReady,
+		/* Has the app task apply the On/Off states the devices read or reported */
+		StateReady,
 		SimpleDescRsp,
-		StartNetworkSteering
+		StartNetworkSteering,
+		ZigbeeReady
+	};
+
+	/* DeviceOnOffCmd waits in the DeviceCmdQueue, DeviceCmdReady has the app task take the next one */
+	enum DeviceCommandEventType : uint8_t { DeviceOnOffCmd = ZigbeeReady + 1, DeviceCmdReady };
+
+	/* Dispatched without effect, for the round trip of the benchmarks */
+	enum BenchEventType : uint8_t { BenchPing = DeviceCmdReady + 1 };
+
+	/* Keys of the events posted with coalescing, see AppEventQueue::Post() */
+	enum CoalesceKey : uint32_t {
+		kCoalesce_DeviceCmdReady = 0x1,
+		kCoalesce_LivenessTimer = 0x2,
+		kCoalesce_PollTimer = 0x4,
+		kCoalesce_SubscriptionsChanged = 0x8,
+		kCoalesce_ReportTimer = 0x10,
+		kCoalesce_DiscoveryReady = 0x20,
+		kCoalesce_StateReady = 0x40
 	};
 
 	AppEvent() = default;
 	explicit AppEvent(EventType type) : Type(type) {}
-	AppEvent(UpdateLedStateEventType type, LEDWidget *ledWidget) : Type(type), UpdateLedStateEvent{ ledWidget } {}
-	AppEvent(ZigbeeShellEventType type) : Type(type) {}
-	AppEvent(ZigbeeShellEventType type, struct ZigbeeShell::BdbEvent bdbEvent) : Type(type), bdb(bdbEvent) {}
-	AppEvent(ZigbeeShellEventType type, struct ZigbeeShell::ZdoEvent zdoEvent) : Type(type), zdo{ zdoEvent } {}
+	explicit AppEvent(BenchEventType type) : Type(type) {}
+	explicit AppEvent(DeviceCommandEventType type) : Type(type) {}
+	AppEvent(ZigbeeShellEventType type, ZigbeeShell::EventPayload *payload = nullptr) : Type(type), Zigbee(payload) {}
+	AppEvent(DeviceCommandEventType type, Device *dev, uint16_t seq, bool on, uint32_t timestamp)
+		: Type(type), DeviceCmdEvent{ dev, seq, on, timestamp } {}
 
 	uint8_t Type;
 	union {
 		struct {
-			LEDWidget *LedWidget;
-		} UpdateLedStateEvent;
-		struct ZigbeeShell::BdbEvent bdb;
-		struct ZigbeeShell::ZdoEvent zdo;
+			Device *Dev;
+			uint16_t Seq;
+			bool On;
+			uint32_t Timestamp;
+		} DeviceCmdEvent;
+		/* Holds a reference released once the event is dispatched */
+		ZigbeeShell::EventPayload *Zigbee;
 	};
 };
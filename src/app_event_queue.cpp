@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "app_event_queue.h"
+
+namespace {
+constexpr uint32_t kLaneSizes[AppEventQueue::kLaneCount] = {
+	CONFIG_APP_EVENT_LANE_CONTROL_SIZE,
+	CONFIG_APP_EVENT_LANE_DISCOVERY_SIZE,
+	CONFIG_APP_EVENT_LANE_HOUSEKEEPING_SIZE,
+};
+
+constexpr bool IsPowerOfTwo(uint32_t value)
+{
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
+static_assert(IsPowerOfTwo(CONFIG_APP_EVENT_LANE_CONTROL_SIZE) &&
+		      IsPowerOfTwo(CONFIG_APP_EVENT_LANE_DISCOVERY_SIZE) &&
+		      IsPowerOfTwo(CONFIG_APP_EVENT_LANE_HOUSEKEEPING_SIZE),
+	      "App event lane sizes must be powers of two");
+
+constexpr uint32_t kTotalSize = CONFIG_APP_EVENT_LANE_CONTROL_SIZE + CONFIG_APP_EVENT_LANE_DISCOVERY_SIZE +
+				CONFIG_APP_EVENT_LANE_HOUSEKEEPING_SIZE;
+
+const char *const sLaneNames[AppEventQueue::kLaneCount] = { "control", "discovery", "housekeeping" };
+
+void UpdateMax(atomic_t *max, uint32_t value)
+{
+	atomic_val_t current;
+
+	do {
+		current = atomic_get(max);
+		if (static_cast<uint32_t>(current) >= value) {
+			return;
+		}
+	} while (!atomic_cas(max, current, value));
+}
+} /* namespace */
+
+void AppEventQueue::Init()
+{
+	/* Cells are laid out lane after lane in one static pool */
+	static Cell sCells[kTotalSize];
+	Cell *cells = sCells;
+
+	for (uint8_t lane = 0; lane < kLaneCount; lane++) {
+		Ring &ring = mLanes[lane];
+
+		ring.cells = cells;
+		ring.mask = kLaneSizes[lane] - 1;
+		atomic_set(&ring.tail, 0);
+		ring.head = 0;
+		atomic_clear(&ring.posted);
+		atomic_clear(&ring.dropped);
+		atomic_clear(&ring.coalesced);
+		atomic_clear(&ring.highWater);
+		for (uint32_t i = 0; i < kLaneSizes[lane]; i++) {
+			atomic_set(&cells[i].seq, i);
+		}
+		cells += kLaneSizes[lane];
+	}
+	atomic_clear(&mCoalescePending);
+	k_sem_init(&mEventSem, 0, kTotalSize);
+}
+
+bool AppEventQueue::Push(Ring &ring, const AppEvent &event, uint32_t coalesceKey)
+{
+	uint32_t pos = atomic_get(&ring.tail);
+	Cell *cell;
+
+	/* Bounded MPMC ring (D. Vyukov): a producer owns a cell once it moves the tail past it */
+	for (;;) {
+		cell = &ring.cells[pos & ring.mask];
+		int32_t diff = static_cast<int32_t>(static_cast<uint32_t>(atomic_get(&cell->seq)) - pos);
+
+		if (diff == 0) {
+			if (atomic_cas(&ring.tail, pos, pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return false;
+		}
+		pos = atomic_get(&ring.tail);
+	}
+
+	cell->event = event;
+	cell->coalesceKey = coalesceKey;
+	atomic_set(&cell->seq, pos + 1);
+	UpdateMax(&ring.highWater, pos + 1 - ring.head);
+
+	return true;
+}
+
+bool AppEventQueue::Pop(Ring &ring, AppEvent &event)
+{
+	Cell *cell = &ring.cells[ring.head & ring.mask];
+
+	if (static_cast<uint32_t>(atomic_get(&cell->seq)) != ring.head + 1) {
+		return false;
+	}
+
+	event = cell->event;
+	if (cell->coalesceKey) {
+		/* Events posted from now on must be queued again */
+		atomic_and(&mCoalescePending, ~cell->coalesceKey);
+	}
+	atomic_set(&cell->seq, ring.head + ring.mask + 1);
+	ring.head++;
+
+	return true;
+}
+
+int AppEventQueue::Post(const AppEvent &event, Lane lane, uint32_t coalesceKey)
+{
+	Ring &ring = mLanes[lane];
+
+	if (coalesceKey && (atomic_or(&mCoalescePending, coalesceKey) & coalesceKey)) {
+		atomic_inc(&ring.coalesced);
+		return 0;
+	}
+
+	if (!Push(ring, event, coalesceKey)) {
+		if (coalesceKey) {
+			atomic_and(&mCoalescePending, ~coalesceKey);
+		}
+		atomic_inc(&ring.dropped);
+		return -ENOMSG;
+	}
+
+	atomic_inc(&ring.posted);
+	k_sem_give(&mEventSem);
+
+	return 0;
+}
+
+void AppEventQueue::Get(AppEvent &event)
+{
+	k_sem_take(&mEventSem, K_FOREVER);
+
+	for (;;) {
+		for (uint8_t lane = 0; lane < kLaneCount; lane++) {
+			if (Pop(mLanes[lane], event)) {
+				return;
+			}
+		}
+		/*
+		 * The semaphore is given only after an event is published, but a
+		 * producer preempted between reserving a cell and publishing it
+		 * hides the events behind it. Let it finish.
+		 */
+		k_sleep(K_TICKS(1));
+	}
+}
+
+uint32_t AppEventQueue::Depth(Lane lane) const
+{
+	const Ring &ring = mLanes[lane];
+
+	return static_cast<uint32_t>(atomic_get(&ring.tail)) - ring.head;
+}
+
+AppEventQueue::LaneStats AppEventQueue::Stats(Lane lane) const
+{
+	const Ring &ring = mLanes[lane];
+
+	return { static_cast<uint32_t>(atomic_get(&ring.posted)), static_cast<uint32_t>(atomic_get(&ring.dropped)),
+		 static_cast<uint32_t>(atomic_get(&ring.coalesced)), static_cast<uint32_t>(atomic_get(&ring.highWater)) };
+}
+
+const char *AppEventQueue::LaneName(Lane lane)
+{
+	return sLaneNames[lane];
+}
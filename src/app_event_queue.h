@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "app_event.h"
+
+#include <zephyr.h>
+#include <sys/atomic.h>
+
+/*
+ * Multi-producer, single-consumer queue of app events.
+ *
+ * Events are posted into one of several lanes, each a bounded lock-free
+ * ring, so posting from threads, timers and interrupts never blocks and a
+ * burst in one lane cannot push events out of another. The app task takes
+ * events from the highest priority lane first.
+ *
+ * Idempotent events can be posted with a coalescing key (one bit of a
+ * 32-bit mask): while an event with that key is queued, posting another
+ * one is counted as coalesced instead of taking a slot.
+ */
+class AppEventQueue {
+public:
+	enum Lane : uint8_t {
+		kLane_Control,
+		kLane_Discovery,
+		kLane_Housekeeping,
+		kLaneCount
+	};
+
+	struct LaneStats {
+		uint32_t Posted;
+		uint32_t Dropped;
+		uint32_t Coalesced;
+		uint32_t HighWater;
+	};
+
+	void Init();
+	int Post(const AppEvent &event, Lane lane, uint32_t coalesceKey = 0);
+	void Get(AppEvent &event);
+
+	uint32_t Depth(Lane lane) const;
+	uint32_t Capacity(Lane lane) const { return mLanes[lane].mask + 1; }
+	LaneStats Stats(Lane lane) const;
+	static const char *LaneName(Lane lane);
+
+private:
+	struct Cell {
+		atomic_t seq;
+		uint32_t coalesceKey;
+		AppEvent event;
+	};
+
+	struct Ring {
+		Cell *cells;
+		uint32_t mask;
+		atomic_t tail;
+		uint32_t head;
+		atomic_t posted;
+		atomic_t dropped;
+		atomic_t coalesced;
+		atomic_t highWater;
+	};
+
+	bool Push(Ring &ring, const AppEvent &event, uint32_t coalesceKey);
+	bool Pop(Ring &ring, AppEvent &event);
+
+	Ring mLanes[kLaneCount];
+	atomic_t mCoalescePending;
+	struct k_sem mEventSem;
+};
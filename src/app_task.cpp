@@ -5,12 +5,22 @@
  */
 
 #include "app_task.h"
-#include "led_widget.h"
+#include "bench.h"
+#include "bridge_diagnostics.h"
+#ifdef CONFIG_BRIDGE_DIAGNOSTIC_LOGS
+#include "diagnostic_logs.h"
+#endif
+#include "latency_stats.h"
+#include "status_indicator.h"
+#include "thread_stats.h"
+#include "trace.h"
+#include "zigbee_bridge.h"
 #include "zigbee_shell.h"
 #include "Device.h"
 
 #include <platform/CHIPDeviceLayer.h>
 
+#include <app/InteractionModelEngine.h>
 #include <app/server/OnboardingCodesUtil.h>
 #include <app/server/Server.h>
 #include <credentials/DeviceAttestationCredsProvider.h>
@@ -19,7 +29,6 @@
 #include <app-common/zap-generated/attribute-id.h>
 #include <app-common/zap-generated/cluster-id.h>
 #include <app/reporting/reporting.h>
-#include <vector>
 
 #include <dk_buttons_and_leds.h>
 #include <logging/log.h>
@@ -33,19 +42,27 @@ LOG_MODULE_DECLARE(app);
 
 namespace
 {
-static constexpr size_t kAppEventQueueSize = 10;
 static constexpr uint32_t kFactoryResetTriggerTimeout = 6000;
 
-K_MSGQ_DEFINE(sAppEventQueue, sizeof(AppEvent), kAppEventQueueSize, alignof(AppEvent));
-LEDWidget sStatusLED;
-LEDWidget sUnusedLED;
-LEDWidget sUnusedLED_1;
-LEDWidget sUnusedLED_2;
+/* State of the bridged devices, see ZigbeeBridge::Storage */
+Device sDevices[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
+DeviceCmdQueue::Slot sDeviceCmdSlots[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
+DeviceBreaker sBreakers[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
+LivenessMonitor::Slot sLivenessSlots[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
+PollScheduler::Slot sPollSlots[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
+ATOMIC_DEFINE(sReported, CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT);
+ATOMIC_DEFINE(sStateRead, CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT);
+ATOMIC_DEFINE(sStateOn, CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT);
+SubscriptionTracker::Slot sSubscriptionSlots[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
+ReportLimiter::Slot sReportSlots[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
+DiscoveryQueue::Slot sDiscoverySlots[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT * DiscoveryQueue::kSlotsPerDevice];
+StatusIndicator sStatusLED;
+StatusIndicator sUnusedLED;
+StatusIndicator sUnusedLED_1;
+StatusIndicator sUnusedLED_2;
 
 ZigbeeShell sZbShell;
-
-#define ZB_HA_DIMMABLE_LIGHT_DEVICE_ID  0x0101
-#define ZB_AF_HA_PROFILE_ID		0x0104
+ZigbeeBridge sBridge(sZbShell);
 
 static const int kNodeLabelSize = 32;
 // Current ZCL implementation of Struct uses a max-size array of 254 bytes
@@ -56,10 +73,6 @@ static EndpointId gCurrentEndpointId;
 static EndpointId gFirstDynamicEndpointId;
 static Device * gDevices[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT]; // number of dynamic endpoints count
 
-// 4 Bridged devices
-//std::vector<Device> Lights(CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT, Device("Default", "None"));
-std::vector<Device> Lights(CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT, Device());
-
 // (taken from chip-devices.xml)
 #define DEVICE_TYPE_CHIP_BRIDGE 0x0a0b
 // (taken from lo-devices.xml)
@@ -120,6 +133,10 @@ bool sIsThreadEnabled;
 bool sHaveBLEConnections;
 
 k_timer sFunctionTimer;
+
+#ifdef CONFIG_BRIDGE_BENCH
+K_SEM_DEFINE(sBenchPingSem, 0, 1);
+#endif
 } /* namespace */
 
 AppTask AppTask::sAppTask;
@@ -198,7 +215,7 @@ void EncodeFixedLabel(const char * label, const char * value, uint8_t * buffer,
 EmberAfStatus HandleReadBridgedDeviceBasicAttribute(Device * dev, chip::AttributeId attributeId, uint8_t * buffer,
 						    uint16_t maxReadLength)
 {
-	ChipLogProgress(DeviceLayer, "HandleReadBridgedDeviceBasicAttribute: attrId=%d, maxReadLength=%d", attributeId, maxReadLength);
+	TRACE(Trace::kEvent_ReadBridgedBasic, dev->GetEndpointId(), attributeId, maxReadLength);
 
 	if ((attributeId == ZCL_REACHABLE_ATTRIBUTE_ID) && (maxReadLength == 1))
 	{
@@ -240,7 +257,7 @@ EmberAfStatus HandleReadFixedLabelAttribute(Device * dev, EmberAfAttributeMetada
 
 EmberAfStatus HandleReadOnOffAttribute(Device * dev, chip::AttributeId attributeId, uint8_t * buffer, uint16_t maxReadLength)
 {
-	ChipLogProgress(DeviceLayer, "HandleReadOnOffAttribute: attrId=%d, maxReadLength=%d", attributeId, maxReadLength);
+	TRACE(Trace::kEvent_ReadOnOff, dev->GetEndpointId(), attributeId, maxReadLength);
 
 	if ((attributeId == ZCL_ON_OFF_ATTRIBUTE_ID) && (maxReadLength == 1))
 	{
@@ -258,13 +275,18 @@ EmberAfStatus HandleReadOnOffAttribute(Device * dev, chip::AttributeId attribute
 	return EMBER_ZCL_STATUS_SUCCESS;
 }
 
-EmberAfStatus HandleWriteOnOffAttribute(Device * dev, chip::AttributeId attributeId, uint8_t * buffer)
+EmberAfStatus HandleWriteOnOffAttribute(Device * dev, chip::AttributeId attributeId, uint8_t * buffer, uint32_t timestamp)
 {
-	ChipLogProgress(DeviceLayer, "HandleWriteOnOffAttribute: attrId=%d", attributeId);
+	TRACE(Trace::kEvent_WriteOnOff, dev->GetEndpointId(), attributeId, *buffer);
+
+	ReturnErrorCodeIf(attributeId != ZCL_ON_OFF_ATTRIBUTE_ID, EMBER_ZCL_STATUS_FAILURE);
 
-	ReturnErrorCodeIf((attributeId != ZCL_ON_OFF_ATTRIBUTE_ID) || (!dev->IsReachable()), EMBER_ZCL_STATUS_FAILURE);
-	dev->SetOnOff(*buffer == 1);
-	sZbShell.ZclCmd(dev->GetZbAddr(), dev->GetZbEp(), ZigbeeShell::kCluster_OnOff, (*buffer == 1)?(true):(false));
+	// The bridge reports the target state right away and confirms or rolls
+	// it back once the Zigbee command is done.
+	if (sBridge.WriteOnOff(*dev, *buffer == 1, timestamp))
+	{
+		return EMBER_ZCL_STATUS_FAILURE;
+	}
 	return EMBER_ZCL_STATUS_SUCCESS;
 }
 
@@ -298,6 +320,7 @@ EmberAfStatus emberAfExternalAttributeReadCallback(EndpointId endpoint, ClusterI
 EmberAfStatus emberAfExternalAttributeWriteCallback(EndpointId endpoint, ClusterId clusterId,
 						    EmberAfAttributeMetadata * attributeMetadata, uint8_t * buffer)
 {
+	uint32_t timestamp     = LATENCY_TIMESTAMP();
 	uint16_t endpointIndex = emberAfGetDynamicIndexFromEndpoint(endpoint);
 
 	if (endpointIndex < CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT)
@@ -306,14 +329,15 @@ EmberAfStatus emberAfExternalAttributeWriteCallback(EndpointId endpoint, Cluster
 
 		if ((dev->IsReachable()) && (clusterId == ZCL_ON_OFF_CLUSTER_ID))
 		{
-			return HandleWriteOnOffAttribute(dev, attributeMetadata->attributeId, buffer);
+			return HandleWriteOnOffAttribute(dev, attributeMetadata->attributeId, buffer, timestamp);
 		}
 	}
 
 	return EMBER_ZCL_STATUS_FAILURE;
 }
 
-void HandleDeviceStatusChanged(Device * dev, Device::Changed_t itemChangedMask)
+/* Reports the attributes of the device, as Device::Changed_t bits, with the CHIP stack locked */
+void ReportDeviceStatus(Device * dev, uint8_t itemChangedMask)
 {
 	if (itemChangedMask & Device::kChanged_Reachable)
 	{
@@ -352,13 +376,73 @@ void HandleDeviceStatusChanged(Device * dev, Device::Changed_t itemChangedMask)
 	}
 }
 
+/* Matter side of the bridge: the dynamic endpoints of the devices and their reports */
+class MatterDelegate : public ZigbeeBridge::Delegate
+{
+public:
+	void Lock() override { PlatformMgr().LockChipStack(); }
+	void Unlock() override { PlatformMgr().UnlockChipStack(); }
+	void AddEndpoint(Device & dev) override { AddDeviceEndpoint(&dev, &bridgedLightEndpoint, DEVICE_TYPE_LO_ON_OFF_LIGHT); }
+	void Report(Device & dev, uint8_t attributes) override { ReportDeviceStatus(&dev, attributes); }
+};
+
+MatterDelegate sMatterDelegate;
+
+/*
+ * Counts the subscriptions to the bridged devices as the interaction model
+ * establishes and terminates them, on the CHIP thread, and has the app task
+ * poll the devices they watch. The ReportLimiter reads the counts to limit
+ * the reports of the attributes they cover. A change while a subscription
+ * was set up was reported before it was counted, and may be missing from
+ * its priming report, so the bridge reports the attributes it covers again
+ * once it is established.
+ */
+class SubscriptionObserver : public app::ReadHandler::ApplicationCallback
+{
+public:
+	void OnSubscriptionEstablished(app::ReadHandler & aReadHandler) override { Update(aReadHandler, true); }
+	void OnSubscriptionTerminated(app::ReadHandler & aReadHandler) override { Update(aReadHandler, false); }
+
+private:
+	static void Update(app::ReadHandler & aReadHandler, bool add)
+	{
+		for (auto * path = aReadHandler.GetAttributePathList(); path != nullptr; path = path->mpNext)
+		{
+			const app::AttributePathParams & params = path->mValue;
+			uint8_t attributes = SubscriptionTracker::AttributesOf(params.mClusterId, params.mAttributeId);
+			size_t index = SubscriptionTracker::kAllDevices;
+
+			if (!params.HasWildcardEndpointId())
+			{
+				uint16_t endpointIndex = emberAfGetDynamicIndexFromEndpoint(params.mEndpointId);
+
+				if (endpointIndex >= CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT || gDevices[endpointIndex] == NULL)
+				{
+					continue;
+				}
+				index = sBridge.IndexOf(*gDevices[endpointIndex]);
+			}
+			if (attributes == 0)
+			{
+				continue;
+			}
+			sBridge.UpdateSubscription(index, attributes, add);
+		}
+	}
+};
+
+SubscriptionObserver sSubscriptionObserver;
+
 int AppTask::Init()
 {
 	int ret;
 
 	/* Initialize LEDs */
-	LEDWidget::InitGpio();
-	LEDWidget::SetStateUpdateCallback(LEDStateUpdateHandler);
+	ret = StatusIndicator::InitGpio();
+	if (ret) {
+		LOG_ERR("StatusIndicator::InitGpio() failed");
+		return ret;
+	}
 
 	sStatusLED.Init(DK_LED1);
 	sUnusedLED.Init(DK_LED2);
@@ -369,19 +453,8 @@ int AppTask::Init()
 
 	memset(gDevices, 0, sizeof(gDevices));
 
-	// Whenever bridged device changes its state
-	for (size_t i = 0; i < Lights.size(); ++i)
-	{
-		Lights[i].SetChangeCallback(&HandleDeviceStatusChanged);
-	}
-
-	/* Init Zigbee stack */
-	sZbShell.SetEventCallback(ZigbeeEventHandler);
-	ret = sZbShell.BdbStart();
-	if (ret) {
-		LOG_ERR("BdbStart() failed");
-		return ret;
-	}
+	/* Bring up the Zigbee NCP while the Matter server starts, ZigbeeReady follows */
+	sBridge.Start();
 
 	/* Initialize buttons */
 	ret = dk_buttons_init(ButtonEventHandler);
@@ -394,8 +467,18 @@ int AppTask::Init()
 	k_timer_init(&sFunctionTimer, &AppTask::TimerEventHandler, nullptr);
 	k_timer_user_data_set(&sFunctionTimer, this);
 
+	/* Report thread and heap usage through the diagnostics clusters */
+	ThreadStats::Init();
+	SetDiagnosticDataProvider(&BridgeDiagnosticDataProvider::GetInstance());
+
+	PlatformMgr().AddEventHandler(ChipEventHandler, 0);
+
 	/* Init ZCL Data Model and start server */
 	chip::Server::GetInstance().Init();
+	app::InteractionModelEngine::GetInstance()->RegisterReadHandlerAppCallback(&sSubscriptionObserver);
+#ifdef CONFIG_BRIDGE_DIAGNOSTIC_LOGS
+	BridgeDiagnosticLogs::Init();
+#endif
 
 	/* Initialize device attestation config */
 	SetDeviceAttestationCredentialsProvider(Examples::GetExampleDACProvider());
@@ -412,12 +495,22 @@ int AppTask::Init()
 	// supported clusters so that ZAP will generated the requisite code.
 	emberAfEndpointEnableDisable(emberAfEndpointFromIndex(static_cast<uint16_t>(emberAfFixedEndpointCount() - 1)), false);
 
+	/* Bridged endpoints are added by the event loop, which starts now */
+	mBootTimes.MatterReady = k_uptime_get_32();
+	LOG_INF("Matter server ready %u ms after reset", mBootTimes.MatterReady);
+
 	return 0;
 }
 
 int AppTask::StartApp()
 {
-	int ret = Init();
+	int ret;
+
+	sBridge.Init(ZigbeeBridge::Storage{ sDevices, sDeviceCmdSlots, sBreakers, sLivenessSlots, sPollSlots,
+					    sSubscriptionSlots, sReportSlots, sDiscoverySlots, sReported,
+					    sStateRead, sStateOn, ARRAY_SIZE(sDevices) },
+		     sMatterDelegate);
+	ret = Init();
 
 	if (ret) {
 		LOG_ERR("AppTask.Init() failed");
@@ -427,24 +520,150 @@ int AppTask::StartApp()
 	AppEvent event = {};
 
 	while (true) {
-		k_msgq_get(&sAppEventQueue, &event, K_FOREVER);
+		sBridge.GetEventQueue().Get(event);
 		DispatchEvent(event);
+		ZigbeeBridge::ReleaseEvent(event);
 	}
 }
 
-void AppTask::PostEvent(const AppEvent &event)
+int AppTask::PostEvent(const AppEvent &event)
+{
+	return sBridge.PostEvent(event);
+}
+
+AppTask::OptimisticStats &AppTask::GetOptimisticStats()
+{
+	return sBridge.GetOptimisticStats();
+}
+
+const DeviceBreaker::Stats &AppTask::GetBreakerStats() const
+{
+	return sBridge.GetBreakerStats();
+}
+
+uint32_t AppTask::GetOpenBreakers() const
+{
+	return sBridge.GetOpenBreakers();
+}
+
+AppTask::BootTimes AppTask::GetBootTimes() const
+{
+	BootTimes times = mBootTimes;
+
+	times.ZigbeeReady = sBridge.GetZigbeeReadyMs();
+	times.FirstEndpoint = sBridge.GetFirstEndpointMs();
+
+	return times;
+}
+
+const AppEventQueue &AppTask::GetEventQueue() const
+{
+	return sBridge.GetEventQueue();
+}
+
+const DeviceCmdQueue &AppTask::GetDeviceCmdQueue() const
+{
+	return sBridge.GetDeviceCmdQueue();
+}
+
+DiscoveryQueue::Stats AppTask::GetDiscoveryStats() const
+{
+	return sBridge.GetDiscoveryStats();
+}
+
+const LivenessMonitor::Stats &AppTask::GetLivenessStats() const
+{
+	return sBridge.GetLivenessStats();
+}
+
+const PollScheduler::Stats &AppTask::GetPollStats() const
+{
+	return sBridge.GetPollStats();
+}
+
+const SubscriptionTracker &AppTask::GetSubscriptions() const
+{
+	return sBridge.GetSubscriptions();
+}
+
+const ReportLimiter::Stats &AppTask::GetReportStats() const
+{
+	return sBridge.GetReportStats();
+}
+
+ZigbeeShell &AppTask::GetZigbeeShell()
+{
+	return sZbShell;
+}
+
+#ifdef CONFIG_BRIDGE_BENCH
+void AppTask::RunBenchmarks(Bench::Runner &runner)
 {
-	if (k_msgq_put(&sAppEventQueue, &event, K_NO_WAIT)) {
-		LOG_INF("Failed to post event to app task event queue");
+	ZigbeeShell::EventPayload report = {};
+	Device *dev = nullptr;
+	uint8_t buffer[kFixedLabelAttributeArraySize];
+
+	/* An attribute report of an address no light has scans all of them without side effects */
+	atomic_set(&report.refCount, 1);
+	report.type = ZigbeeShell::kEvent_ZclAttrRead;
+	report.Zcl.addr = 0xfffe;
+	report.Zcl.cluster_id = ZigbeeShell::kCluster_OnOff;
+	report.Zcl.type = ZigbeeShell::kZclAttrType_BOOL;
+	runner.Run("app.zigbee_event_lookup", [&] { ZigbeeBridge::ZigbeeEventHandler(&sZbShell, &report); });
+
+	for (Device *device : gDevices) {
+		if (device != nullptr) {
+			dev = device;
+			break;
+		}
 	}
+	if (dev == nullptr) {
+		runner.Skip("app.attr_read.bridged_basic", "no bridged device");
+		runner.Skip("app.attr_read.fixed_label", "no bridged device");
+		runner.Skip("app.attr_read.on_off", "no bridged device");
+		runner.Skip("app.status_changed", "no bridged device");
+	} else {
+		EndpointId endpoint = dev->GetEndpointId();
+		EmberAfAttributeMetadata nodeLabel = { .attributeId  = ZCL_NODE_LABEL_ATTRIBUTE_ID,
+						       .size         = kNodeLabelSize,
+						       .defaultValue = static_cast<uint16_t>(0) };
+		EmberAfAttributeMetadata labelList = { .attributeId  = ZCL_LABEL_LIST_ATTRIBUTE_ID,
+						       .size         = kFixedLabelAttributeArraySize,
+						       .defaultValue = static_cast<uint16_t>(0) };
+		EmberAfAttributeMetadata onOff = { .attributeId  = ZCL_ON_OFF_ATTRIBUTE_ID,
+						   .size         = 1,
+						   .defaultValue = static_cast<uint16_t>(0) };
+
+		/* As the interaction model calls them, with the CHIP stack locked */
+		PlatformMgr().LockChipStack();
+		runner.Run("app.attr_read.bridged_basic", [&] {
+			Bench::DoNotOptimize(emberAfExternalAttributeReadCallback(
+				endpoint, ZCL_BRIDGED_DEVICE_BASIC_CLUSTER_ID, &nodeLabel, buffer, kNodeLabelSize));
+		});
+		runner.Run("app.attr_read.fixed_label", [&] {
+			Bench::DoNotOptimize(emberAfExternalAttributeReadCallback(endpoint, ZCL_FIXED_LABEL_CLUSTER_ID,
+										  &labelList, buffer, sizeof(buffer)));
+		});
+		runner.Run("app.attr_read.on_off", [&] {
+			Bench::DoNotOptimize(
+				emberAfExternalAttributeReadCallback(endpoint, ZCL_ON_OFF_CLUSTER_ID, &onOff, buffer, 1));
+		});
+		/* Reported at once without a subscriber, else held by the limiter after the first report of the run */
+		runner.Run("app.status_changed", [&] { sBridge.StatusChanged(dev, Device::kChanged_State); });
+		PlatformMgr().UnlockChipStack();
+	}
+
+	/* From the caller's thread through the event queue to the app task and back */
+	runner.Run("app.post_dispatch", [&] {
+		if (!PostEvent(AppEvent{ AppEvent::BenchPing })) {
+			k_sem_take(&sBenchPingSem, K_FOREVER);
+		}
+	});
 }
+#endif
 
 void AppTask::DispatchEvent(const AppEvent &event)
 {
-	int err;
-	uint16_t InputCluster[] = {ZigbeeShell::Cluster_t::kCluster_OnOff};
-	uint16_t OutputCluster[] = {};
-
 	switch (event.Type) {
 	case AppEvent::FunctionPress:
 		FunctionPressHandler();
@@ -455,45 +674,13 @@ void AppTask::DispatchEvent(const AppEvent &event)
 	case AppEvent::FunctionTimer:
 		FunctionTimerEventHandler();
 		break;
-	case AppEvent::UpdateLedState:
-		event.UpdateLedStateEvent.LedWidget->UpdateState();
-		break;
-	case AppEvent::NetworkRejoin:
-		err = sZbShell.ZdoMatchDesc(0xfffd, 0xfffd, ZB_AF_HA_PROFILE_ID, 1, InputCluster, 0, OutputCluster);
-		if (err) {
-			LOG_ERR("Fail to broadcast MatchDesc");
-		}
-		break;
-	case AppEvent::DeviceAnnounceRsp:
-		err = sZbShell.ZdoActiveEpReq(event.zdo.addr);
-		if (err) {
-			LOG_ERR("Fail to request active ep");
-		}
-		break;
-	case AppEvent::ActiveEpRsp:
-		err = sZbShell.ZdoSimpleDescReq(event.zdo.addr, event.zdo.ep);
-		if (err) {
-			LOG_ERR("Fail to request simple descriptor");
-		}
-		break;
-	case AppEvent::SimpleDescRsp:
-		err = sZbShell.ZclAttrRead(event.zdo.addr,
-					   event.zdo.ep,
-					   ZB_AF_HA_PROFILE_ID,
-					   ZigbeeShell::kCluster_OnOff,
-					   ZigbeeShell::kOnOffAttr_OnOff);
-		if (err) {
-			LOG_ERR("Fail to request simple descriptor");
-		}
-		break;
-	case AppEvent::StartNetworkSteering:
-		err = sZbShell.NetworkSteering();
-		if (err) {
-			LOG_ERR("Fail to start network steering");
-		}
+#ifdef CONFIG_BRIDGE_BENCH
+	case AppEvent::BenchPing:
+		k_sem_give(&sBenchPingSem);
 		break;
+#endif
 	default:
-		LOG_INF("Unknown event received");
+		sBridge.Dispatch(event);
 		break;
 	}
 }
@@ -534,11 +721,6 @@ void AppTask::FunctionTimerEventHandler()
 	}
 }
 
-void AppTask::LEDStateUpdateHandler(LEDWidget &ledWidget)
-{
-	sAppTask.PostEvent(AppEvent{ AppEvent::UpdateLedState, &ledWidget });
-}
-
 void AppTask::UpdateStatusLED()
 {
 	/* Update the status LED.
@@ -562,6 +744,10 @@ void AppTask::ChipEventHandler(const ChipDeviceEvent *event, intptr_t /* arg */)
 {
 	switch (event->Type) {
 	case DeviceEventType::kCHIPoBLEAdvertisingChange:
+		if (event->CHIPoBLEAdvertisingChange.Result == kActivity_Started && sAppTask.mBootTimes.Commissionable == 0) {
+			sAppTask.mBootTimes.Commissionable = k_uptime_get_32();
+			LOG_INF("Commissionable %u ms after reset", sAppTask.mBootTimes.Commissionable);
+		}
 		sHaveBLEConnections = ConnectivityMgr().NumBLEConnections() != 0;
 		UpdateStatusLED();
 		break;
@@ -588,76 +774,6 @@ void AppTask::ButtonEventHandler(uint32_t buttonState, uint32_t hasChanged)
 	}
 }
 
-void AppTask::ZigbeeEventHandler(ZigbeeShell * shell, ZigbeeShell::Event_t event)
-{
-	LOG_INF("Zigbee event: %d", event);
-	switch (event) {
-	case ZigbeeShell::kEvent_NetworkRejoin:
-		GetAppTask().PostEvent(AppEvent{ AppEvent::NetworkRejoin, shell->mEvent.Bdb});
-		break;
-	case ZigbeeShell::kEvent_DeviceAnnounceRsp:
-		GetAppTask().PostEvent(AppEvent{ AppEvent::DeviceAnnounceRsp, shell->mEvent.Zdo});
-		break;
-	case ZigbeeShell::kEvent_ActiveEpRsp:
-		GetAppTask().PostEvent(AppEvent{ AppEvent::ActiveEpRsp, shell->mEvent.Zdo});
-		break;
-	case ZigbeeShell::kEvent_SimpleDescRsp:
-		LOG_INF("addr:0x%04hx ep:%d dev_id:0x%04hx",
-			shell->mEvent.Zdo.addr,
-			shell->mEvent.Zdo.ep,
-			shell->mEvent.Zdo.dev_id);
-		if (shell->mEvent.Zdo.dev_id != ZB_HA_DIMMABLE_LIGHT_DEVICE_ID) {
-			return;
-		}
-		for (auto &light : Lights)
-		{
-			if ((light.GetZbAddr() == shell->mEvent.Zcl.addr) &&
-				(light.GetZbEp() == shell->mEvent.Zcl.ep)) {
-				LOG_INF("Device existed");
-				return;
-			}
-		}
-		for (auto &light : Lights)
-		{
-			if (!strcmp(light.GetName(), "none")) {
-				AddDeviceEndpoint(&light, &bridgedLightEndpoint, DEVICE_TYPE_LO_ON_OFF_LIGHT);
-				light.SetName("Light");
-				light.SetZbAddr(shell->mEvent.Zdo.addr);
-				light.SetZbEp(shell->mEvent.Zdo.ep);
-				light.SetReachable(true);
-				GetAppTask().PostEvent(AppEvent{ AppEvent::SimpleDescRsp, shell->mEvent.Zdo});
-				break;
-			}
-		}
-		break;
-	case ZigbeeShell::kEvent_ZclAttrRead:
-		for (auto &light : Lights)
-		{
-			if ((light.GetZbAddr() != shell->mEvent.Zcl.addr) ||
-				(light.GetZbEp() != shell->mEvent.Zcl.ep)) {
-				continue;
-			}
-			if (shell->mEvent.Zcl.cluster_id == ZigbeeShell::kCluster_OnOff &&
-				shell->mEvent.Zcl.attr_id == ZigbeeShell::kOnOffAttr_OnOff &&
-				shell->mEvent.Zcl.type == ZigbeeShell::kZclAttrType_BOOL) {
-				if (!strncmp(shell->mEvent.Zcl.value, "True", shell->mEvent.Zcl.len)) {
-					light.SetOnOff(true);
-				} else if (!strncmp(shell->mEvent.Zcl.value, "False", shell->mEvent.Zcl.len)) {
-					light.SetOnOff(false);
-				} else {
-					LOG_ERR("Wrong attr value");
-				}
-				break;
-			}
-		}
-		break;
-	default:
-		LOG_WRN("Unknown event received");
-		break;
-	}
-
-}
-
 void AppTask::CancelFunctionTimer()
 {
 	k_timer_stop(&sFunctionTimer);
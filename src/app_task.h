@@ -7,18 +7,47 @@
 #pragma once
 
 #include "app_event.h"
-#include "led_widget.h"
-#include "zigbee_shell.h"
+#include "zigbee_bridge.h"
 
 #include <platform/CHIPDeviceLayer.h>
 
 struct k_timer;
 
+namespace Bench {
+class Runner;
+} /* namespace Bench */
+
 class AppTask {
 public:
+	/* Milliseconds from reset, 0 until reached */
+	struct BootTimes {
+		uint32_t MatterReady;
+		uint32_t Commissionable;
+		uint32_t ZigbeeReady;
+		uint32_t FirstEndpoint;
+	};
+
+	using OptimisticStats = ZigbeeBridge::OptimisticStats;
+
 	int StartApp();
 
-	void PostEvent(const AppEvent &aEvent);
+	int PostEvent(const AppEvent &aEvent);
+	OptimisticStats &GetOptimisticStats();
+	const DeviceBreaker::Stats &GetBreakerStats() const;
+	uint32_t GetOpenBreakers() const;
+	const LivenessMonitor::Stats &GetLivenessStats() const;
+	const PollScheduler::Stats &GetPollStats() const;
+	const SubscriptionTracker &GetSubscriptions() const;
+	const ReportLimiter::Stats &GetReportStats() const;
+	BootTimes GetBootTimes() const;
+	const AppEventQueue &GetEventQueue() const;
+	const DeviceCmdQueue &GetDeviceCmdQueue() const;
+	DiscoveryQueue::Stats GetDiscoveryStats() const;
+	ZigbeeShell &GetZigbeeShell();
+#ifdef CONFIG_BRIDGE_BENCH
+	/* Cases of the Matter side, run from the caller's thread */
+	void RunBenchmarks(Bench::Runner &runner);
+#endif
 
 private:
 	int Init();
@@ -32,11 +61,9 @@ private:
 	void FunctionTimerEventHandler();
 
 	static void UpdateStatusLED();
-	static void LEDStateUpdateHandler(LEDWidget &ledWidget);
 	static void ChipEventHandler(const chip::DeviceLayer::ChipDeviceEvent *event, intptr_t arg);
 	static void ButtonEventHandler(uint32_t buttonState, uint32_t hasChanged);
 	static void TimerEventHandler(k_timer *timer);
-	static void ZigbeeEventHandler(ZigbeeShell * shell, ZigbeeShell::Event_t event);
 
 	friend AppTask &GetAppTask();
 
@@ -46,6 +73,7 @@ private:
 
 	static AppTask sAppTask;
 	bool mFunctionTimerActive = false;
+	BootTimes mBootTimes = {};
 };
 
 inline AppTask &GetAppTask()
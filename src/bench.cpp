@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "bench.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace Bench {
+namespace {
+constexpr uint32_t kVersion = 1;
+constexpr size_t kLineSize = 192;
+
+/* Nanoseconds per operation in tenths, printed with one decimal */
+uint32_t NsPerOpX10(uint64_t cycles, uint32_t iterations)
+{
+	return static_cast<uint32_t>(timing_cycles_to_ns(cycles) * 10 / iterations);
+}
+} /* namespace */
+
+Runner::Runner(PrintFn print, void *context, const char *filter, uint32_t iterations)
+	: mPrint(print), mContext(context), mFilter(filter), mIterations(iterations ? iterations : 1), mCases(0)
+{
+}
+
+void Runner::Begin(const char *platform)
+{
+	timing_init();
+	timing_start();
+	mCases = 0;
+	Print("{\"suite\":\"bridge\",\"version\":%u,\"platform\":\"%s\",\"timer_hz\":%u,\"iterations\":%u,"
+	      "\"batches\":%u}",
+	      kVersion, platform, static_cast<uint32_t>(timing_freq_get()), mIterations, kBatches);
+}
+
+void Runner::End()
+{
+	timing_stop();
+	Print("{\"suite\":\"bridge\",\"done\":true,\"cases\":%u}", mCases);
+}
+
+void Runner::Skip(const char *name, const char *reason)
+{
+	if (Selected(name)) {
+		Print("{\"bench\":\"%s\",\"skipped\":\"%s\"}", name, reason);
+	}
+}
+
+bool Runner::Selected(const char *name) const
+{
+	return mFilter == nullptr || strstr(name, mFilter) != nullptr;
+}
+
+void Runner::Report(const char *name, uint64_t best, uint64_t total)
+{
+	uint32_t best_ns = NsPerOpX10(best, mIterations);
+	uint32_t mean_ns = NsPerOpX10(total / kBatches, mIterations);
+
+	mCases++;
+	Print("{\"bench\":\"%s\",\"iterations\":%u,\"cycles_per_op\":%u,\"ns_per_op\":%u.%u,"
+	      "\"ns_per_op_mean\":%u.%u}",
+	      name, mIterations, static_cast<uint32_t>((best + mIterations / 2) / mIterations), best_ns / 10,
+	      best_ns % 10, mean_ns / 10, mean_ns % 10);
+}
+
+void Runner::Print(const char *format, ...)
+{
+	char line[kLineSize];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	mPrint(mContext, line);
+}
+
+} /* namespace Bench */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <timing/timing.h>
+
+/*
+ * Microbenchmarks of the bridge hot paths.
+ *
+ * A case runs its body in kBatches batches of a fixed number of
+ * iterations, timed with the timing API: the DWT cycle counter on the
+ * nRF5340, the monotonic clock in the host build. The fastest batch gives
+ * the result, which keeps preemption by other threads out of it, and the
+ * mean of the batches is reported next to it.
+ *
+ * Results are printed as JSON Lines: a header object with the platform
+ * and timer frequency, one object per case and a closing object, e.g.
+ *
+ *   {"suite":"bridge","version":1,"platform":"nrf5340dk_nrf5340_cpuapp","timer_hz":64000000,...}
+ *   {"bench":"parse.zcl_attr_read","iterations":1000,"cycles_per_op":5120,"ns_per_op":80.0,...}
+ *   {"suite":"bridge","done":true,"cases":14}
+ */
+namespace Bench {
+
+constexpr uint32_t kBatches = 5;
+
+class Runner {
+public:
+	typedef void (*PrintFn)(void *context, const char *line);
+
+	/* Only cases whose name contains filter run, all of them without one */
+	Runner(PrintFn print, void *context, const char *filter, uint32_t iterations);
+
+	void Begin(const char *platform);
+	void End();
+
+	template <typename Body> void Run(const char *name, Body &&body)
+	{
+		uint64_t best = UINT64_MAX;
+		uint64_t total = 0;
+
+		if (!Selected(name)) {
+			return;
+		}
+		/* Warm up the caches and any lazily initialized state */
+		body();
+		for (uint32_t batch = 0; batch < kBatches; batch++) {
+			timing_t start = timing_counter_get();
+
+			for (uint32_t i = 0; i < mIterations; i++) {
+				body();
+			}
+
+			timing_t end = timing_counter_get();
+			uint64_t cycles = timing_cycles_get(&start, &end);
+
+			best = cycles < best ? cycles : best;
+			total += cycles;
+		}
+		Report(name, best, total);
+	}
+
+	/* Reports a selected case that cannot run, e.g. without a bridged device */
+	void Skip(const char *name, const char *reason);
+
+private:
+	bool Selected(const char *name) const;
+	void Report(const char *name, uint64_t best, uint64_t total);
+	void Print(const char *format, ...);
+
+	PrintFn mPrint;
+	void *mContext;
+	const char *mFilter;
+	uint32_t mIterations;
+	uint32_t mCases;
+};
+
+/* Keeps the compiler from dropping a computation whose result is unused */
+template <typename T> inline void DoNotOptimize(const T &value)
+{
+	asm volatile("" : : "g"(value) : "memory");
+}
+
+/* Suites of the target-independent code, also run by the host build */
+void RunZigbeeShellBenchmarks(Runner &runner);
+
+} /* namespace Bench */
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "bridge_diagnostics.h"
+#include "thread_stats.h"
+
+#include <lib/support/CHIPMem.h>
+#include <lib/support/CHIPMemString.h>
+#include <platform/Zephyr/DiagnosticDataProviderImpl.h>
+
+using namespace ::chip;
+using namespace ::chip::DeviceLayer;
+
+namespace {
+DiagnosticDataProvider &PlatformProvider()
+{
+	return DiagnosticDataProviderImpl::GetDefaultInstance();
+}
+} /* namespace */
+
+BridgeDiagnosticDataProvider &BridgeDiagnosticDataProvider::GetInstance()
+{
+	static BridgeDiagnosticDataProvider sInstance;
+
+	return sInstance;
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetCurrentHeapFree(uint64_t &currentHeapFree)
+{
+	return PlatformProvider().GetCurrentHeapFree(currentHeapFree);
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetCurrentHeapUsed(uint64_t &currentHeapUsed)
+{
+	return PlatformProvider().GetCurrentHeapUsed(currentHeapUsed);
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetCurrentHeapHighWatermark(uint64_t &currentHeapHighWatermark)
+{
+	return PlatformProvider().GetCurrentHeapHighWatermark(currentHeapHighWatermark);
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetThreadMetrics(ThreadMetrics **threadMetricsOut)
+{
+	static ThreadStats::Info sInfo[ThreadStats::kMaxThreads];
+	ThreadMetrics *head = nullptr;
+	size_t count = ThreadStats::Collect(sInfo, ArraySize(sInfo));
+
+	for (size_t i = 0; i < count; i++) {
+		ThreadMetrics *metrics = Platform::New<ThreadMetrics>();
+
+		if (metrics == nullptr) {
+			ReleaseThreadMetrics(head);
+			return CHIP_ERROR_NO_MEMORY;
+		}
+
+		Platform::CopyString(metrics->NameBuf, sInfo[i].Name);
+		metrics->id = sInfo[i].Id;
+		metrics->name = CharSpan::fromCharString(metrics->NameBuf);
+		metrics->stackFreeCurrent = sInfo[i].StackFreeCurrent;
+		metrics->stackFreeMinimum = sInfo[i].StackFreeMinimum;
+		metrics->stackSize = sInfo[i].StackSize;
+		metrics->Next = head;
+		head = metrics;
+	}
+
+	*threadMetricsOut = head;
+
+	return CHIP_NO_ERROR;
+}
+
+void BridgeDiagnosticDataProvider::ReleaseThreadMetrics(ThreadMetrics *threadMetrics)
+{
+	while (threadMetrics) {
+		ThreadMetrics *next = threadMetrics->Next;
+
+		Platform::Delete(threadMetrics);
+		threadMetrics = next;
+	}
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetRebootCount(uint16_t &rebootCount)
+{
+	return PlatformProvider().GetRebootCount(rebootCount);
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetUpTime(uint64_t &upTime)
+{
+	return PlatformProvider().GetUpTime(upTime);
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetTotalOperationalHours(uint32_t &totalOperationalHours)
+{
+	return PlatformProvider().GetTotalOperationalHours(totalOperationalHours);
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetBootReason(uint8_t &bootReason)
+{
+	return PlatformProvider().GetBootReason(bootReason);
+}
+
+CHIP_ERROR BridgeDiagnosticDataProvider::GetNetworkInterfaces(NetworkInterface **netifpp)
+{
+	return PlatformProvider().GetNetworkInterfaces(netifpp);
+}
+
+void BridgeDiagnosticDataProvider::ReleaseNetworkInterfaces(NetworkInterface *netifp)
+{
+	PlatformProvider().ReleaseNetworkInterfaces(netifp);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <platform/DiagnosticDataProvider.h>
+
+/*
+ * Diagnostic data provider of the bridge.
+ *
+ * Adds the per-thread stack metrics of the Software Diagnostics cluster to
+ * what the Zephyr platform provider already reports, which is used for all
+ * other attributes.
+ */
+class BridgeDiagnosticDataProvider : public chip::DeviceLayer::DiagnosticDataProvider {
+public:
+	static BridgeDiagnosticDataProvider &GetInstance();
+
+	CHIP_ERROR GetCurrentHeapFree(uint64_t &currentHeapFree) override;
+	CHIP_ERROR GetCurrentHeapUsed(uint64_t &currentHeapUsed) override;
+	CHIP_ERROR GetCurrentHeapHighWatermark(uint64_t &currentHeapHighWatermark) override;
+	CHIP_ERROR GetThreadMetrics(chip::DeviceLayer::ThreadMetrics **threadMetricsOut) override;
+	void ReleaseThreadMetrics(chip::DeviceLayer::ThreadMetrics *threadMetrics) override;
+
+	CHIP_ERROR GetRebootCount(uint16_t &rebootCount) override;
+	CHIP_ERROR GetUpTime(uint64_t &upTime) override;
+	CHIP_ERROR GetTotalOperationalHours(uint32_t &totalOperationalHours) override;
+	CHIP_ERROR GetBootReason(uint8_t &bootReason) override;
+	CHIP_ERROR GetNetworkInterfaces(chip::DeviceLayer::NetworkInterface **netifpp) override;
+	void ReleaseNetworkInterfaces(chip::DeviceLayer::NetworkInterface *netifp) override;
+
+private:
+	BridgeDiagnosticDataProvider() = default;
+};
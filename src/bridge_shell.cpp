@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "app_task.h"
+#include "bench.h"
+#include "latency_histogram.h"
+#include "latency_stats.h"
+#include "thread_stats.h"
+#include "trace.h"
+#include "uart_capture.h"
+
+#include <shell/shell.h>
+#include <zephyr.h>
+
+static void PrintHistogram(const struct shell *shell, const char *name, const LatencyHistogram &hist)
+{
+	uint32_t count = hist.Count();
+
+	shell_print(shell, "%s: count %u avg %u us max %u us",
+		    name,
+		    count,
+		    count ? k_cyc_to_us_floor32(static_cast<uint32_t>(hist.Sum() / count)) : 0,
+		    k_cyc_to_us_floor32(hist.Max()));
+	for (size_t i = 0; i < LatencyHistogram::kBucketCount; i++) {
+		if (hist.Bucket(i) == 0) {
+			continue;
+		}
+		shell_print(shell, "  <= %10u us: %u",
+			    k_cyc_to_us_ceil32(LatencyHistogram::BucketLimit(i)), hist.Bucket(i));
+	}
+}
+
+static int CmdOptimistic(const struct shell *shell, size_t argc, char **argv)
+{
+	AppTask::OptimisticStats &stats = GetAppTask().GetOptimisticStats();
+
+	if (argc > 1 && !strcmp(argv[1], "reset")) {
+		stats = {};
+		return 0;
+	}
+
+	shell_print(shell, "confirmed: %u rolled back: %u", stats.Confirmed, stats.RolledBack);
+	PrintHistogram(shell, "optimistic to confirmed", stats.ConfirmLatency);
+
+	return 0;
+}
+
+static int CmdBoot(const struct shell *shell, size_t argc, char **argv)
+{
+	const ZigbeeShell::StartInfo &zigbee = GetAppTask().GetZigbeeShell().GetStartInfo();
+	const AppTask::BootTimes &boot = GetAppTask().GetBootTimes();
+
+	shell_print(shell, "matter server ready: %u ms after reset", boot.MatterReady);
+	shell_print(shell, "commissionable: %u ms after reset", boot.Commissionable);
+	shell_print(shell, "zigbee ncp ready: %u ms after reset, %s start in %u ms", zigbee.readyUptimeMs,
+		    zigbee.warmStart ? "warm" : "cold", zigbee.durationMs);
+	shell_print(shell, "zigbee ncp link: %u baud, flow control %s, %u probes", zigbee.baudRate,
+		    zigbee.flowControl ? "on" : "off", zigbee.linkProbes);
+	shell_print(shell, "first bridged endpoint: %u ms after reset", boot.FirstEndpoint);
+
+	return 0;
+}
+
+static int CmdThreads(const struct shell *shell, size_t argc, char **argv)
+{
+	static ThreadStats::Info info[ThreadStats::kMaxThreads];
+	size_t count = ThreadStats::Collect(info, ARRAY_SIZE(info));
+	const AppEventQueue &queue = GetAppTask().GetEventQueue();
+
+	shell_print(shell, "%-16s %6s %10s %10s %10s", "thread", "cpu%", "stack", "free", "free min");
+	for (size_t i = 0; i < count; i++) {
+		shell_print(shell, "%-16s %4u.%u %10u %10u %10u", info[i].Name,
+			    info[i].CpuPermille / 10, info[i].CpuPermille % 10,
+			    info[i].StackSize, info[i].StackFreeCurrent, info[i].StackFreeMinimum);
+	}
+	shell_print(shell, "%-16s %6s %6s %10s %10s %10s", "event lane", "depth", "max", "posted", "dropped",
+		    "coalesced");
+	for (uint8_t i = 0; i < AppEventQueue::kLaneCount; i++) {
+		AppEventQueue::Lane lane = static_cast<AppEventQueue::Lane>(i);
+		const AppEventQueue::LaneStats &stats = queue.Stats(lane);
+
+		shell_print(shell, "%-16s %6u %3u/%-2u %10u %10u %10u", AppEventQueue::LaneName(lane),
+			    queue.Depth(lane), stats.HighWater, queue.Capacity(lane), stats.Posted,
+			    stats.Dropped, stats.Coalesced);
+	}
+
+	const DeviceCmdQueue &deviceCmds = GetAppTask().GetDeviceCmdQueue();
+	const DeviceCmdQueue::Stats &cmdStats = deviceCmds.GetStats();
+
+	shell_print(shell, "device commands: %u devices waiting (max %u), %u queued, %u refused at %u in flight",
+		    deviceCmds.Active(), cmdStats.ActiveHighWater, cmdStats.Queued, cmdStats.Rejected,
+		    CONFIG_BRIDGE_DEVICE_CMD_LIMIT);
+
+	DiscoveryQueue::Stats discovery = GetAppTask().GetDiscoveryStats();
+
+	shell_print(shell, "discovery: %u queued, %u coalesced, %u dropped, up to %u addresses waiting",
+		    discovery.Queued, discovery.Coalesced, discovery.Dropped, discovery.HighWater);
+
+	const DeviceBreaker::Stats &breakers = GetAppTask().GetBreakerStats();
+
+	shell_print(shell, "device breakers: %u open, opened %u, closed %u, %u probes, %u commands refused",
+		    GetAppTask().GetOpenBreakers(), breakers.Opened, breakers.Closed, breakers.Probes,
+		    breakers.Refused);
+
+	const LivenessMonitor::Stats &liveness = GetAppTask().GetLivenessStats();
+
+	shell_print(shell, "liveness: %u devices, %u probes, %u missed, %u suppressed by traffic, %u ticks deferred",
+		    liveness.Monitored, liveness.Probes, liveness.Missed, liveness.Suppressed, liveness.Deferred);
+
+	const PollScheduler::Stats &polls = GetAppTask().GetPollStats();
+
+	shell_print(shell, "polls: %u devices without reports, %u polls, %u changes found, %u ticks deferred, "
+		    "%u report configurations retried, %u polled after no report, %u subscribed paths",
+		    polls.Devices, polls.Polls, polls.Changes, polls.Deferred, polls.ConfigureRetries, polls.Silent,
+		    GetAppTask().GetSubscriptions().GetPathCount());
+
+	const ReportLimiter::Stats &reports = GetAppTask().GetReportStats();
+
+	shell_print(shell, "reports: %u emitted, %u unwatched reported at once, %u coalesced",
+		    reports.Emitted, reports.Unwatched, reports.Coalesced);
+
+	return 0;
+}
+
+#ifdef CONFIG_BRIDGE_BENCH
+static void PrintBenchLine(void *context, const char *line)
+{
+	shell_print(static_cast<const struct shell *>(context), "%s", line);
+}
+
+static int CmdBench(const struct shell *shell, size_t argc, char **argv)
+{
+	Bench::Runner runner(PrintBenchLine, const_cast<struct shell *>(shell), argc > 1 ? argv[1] : nullptr,
+			     CONFIG_BRIDGE_BENCH_ITERATIONS);
+
+	runner.Begin(CONFIG_BOARD);
+	Bench::RunZigbeeShellBenchmarks(runner);
+	GetAppTask().RunBenchmarks(runner);
+	runner.End();
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_BRIDGE_LATENCY_STATS
+static int CmdLatency(const struct shell *shell, size_t argc, char **argv)
+{
+	LatencyHistogram &rxWake = GetAppTask().GetZigbeeShell().GetRxWakeLatency();
+
+	if (argc > 1 && !strcmp(argv[1], "reset")) {
+		LatencyStats::Reset();
+		rxWake.Reset();
+		return 0;
+	}
+
+	for (uint8_t cls = 0; cls < LatencyStats::kClassCount; cls++) {
+		for (uint8_t stage = 0; stage < LatencyStats::kStageCount; stage++) {
+			const LatencyHistogram &hist = LatencyStats::Get(static_cast<LatencyStats::Stage>(stage),
+									 static_cast<LatencyStats::DeviceClass>(cls));
+			char name[48];
+
+			if (hist.Count() == 0) {
+				continue;
+			}
+			snprintf(name, sizeof(name), "%s %s",
+				 LatencyStats::ClassName(static_cast<LatencyStats::DeviceClass>(cls)),
+				 LatencyStats::StageName(static_cast<LatencyStats::Stage>(stage)));
+			PrintHistogram(shell, name, hist);
+		}
+	}
+	if (rxWake.Count()) {
+		PrintHistogram(shell, "zigbee rx wake to parse", rxWake);
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_BRIDGE_TRACE
+static int CmdTraceDump(const struct shell *shell, size_t argc, char **argv)
+{
+	uint8_t chunk[32];
+	char line[2 * sizeof(chunk) + 1];
+	size_t offset = 0;
+	size_t len;
+
+	/* Decode the lines between the markers with scripts/trace_decode.py */
+	shell_print(shell, "TRACE BEGIN %u", (unsigned int)Trace::Size());
+	while ((len = Trace::Read(offset, chunk, sizeof(chunk))) > 0) {
+		bin2hex(chunk, len, line, sizeof(line));
+		shell_print(shell, "%s", line);
+		offset += len;
+	}
+	shell_print(shell, "TRACE END");
+
+	return 0;
+}
+
+static int CmdTraceClear(const struct shell *shell, size_t argc, char **argv)
+{
+	Trace::Clear();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_trace,
+	SHELL_CMD(dump, NULL, "Dump the binary event trace as hex", CmdTraceDump),
+	SHELL_CMD(clear, NULL, "Clear the binary event trace", CmdTraceClear),
+	SHELL_SUBCMD_SET_END
+);
+#endif
+
+#ifdef CONFIG_BRIDGE_UART_CAPTURE
+static int CmdCaptureDump(const struct shell *shell, size_t argc, char **argv)
+{
+	uint8_t chunk[32];
+	char line[2 * sizeof(chunk) + 1];
+	size_t offset = 0;
+	size_t len;
+
+	/* Replay the lines between the markers with uart_replay of the host build */
+	shell_print(shell, "CAPTURE BEGIN %u", (unsigned int)UartCapture::Size());
+	while ((len = UartCapture::Read(offset, chunk, sizeof(chunk))) > 0) {
+		bin2hex(chunk, len, line, sizeof(line));
+		shell_print(shell, "%s", line);
+		offset += len;
+	}
+	shell_print(shell, "CAPTURE END");
+
+	return 0;
+}
+
+static int CmdCaptureClear(const struct shell *shell, size_t argc, char **argv)
+{
+	UartCapture::Clear();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_capture,
+	SHELL_CMD(dump, NULL, "Dump the Zigbee UART capture as hex", CmdCaptureDump),
+	SHELL_CMD(clear, NULL, "Clear the Zigbee UART capture and capture again", CmdCaptureClear),
+	SHELL_SUBCMD_SET_END
+);
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_bridge,
+#ifdef CONFIG_BRIDGE_BENCH
+	SHELL_CMD_ARG(bench, NULL, "Microbenchmarks as JSON Lines [filter]", CmdBench, 1, 1),
+#endif
+	SHELL_CMD(boot, NULL, "Bring-up times of the bridge", CmdBoot),
+#ifdef CONFIG_BRIDGE_UART_CAPTURE
+	SHELL_CMD(capture, &sub_capture, "Zigbee UART capture", NULL),
+#endif
+#ifdef CONFIG_BRIDGE_LATENCY_STATS
+	SHELL_CMD_ARG(latency, NULL, "Control path latency histograms [reset]", CmdLatency, 1, 1),
+#endif
+	SHELL_CMD_ARG(optimistic, NULL, "Optimistic update statistics [reset]", CmdOptimistic, 1, 1),
+	SHELL_CMD(threads, NULL, "Thread CPU share, stack usage and app event queue", CmdThreads),
+#ifdef CONFIG_BRIDGE_TRACE
+	SHELL_CMD(trace, &sub_trace, "Binary event trace", NULL),
+#endif
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(bridge, &sub_bridge, "Matter bridge commands", NULL);
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+/*
+ * Circuit breaker of a bridged device.
+ *
+ * A powered-off device makes every command to it wait for the Zigbee
+ * timeout. After CONFIG_BRIDGE_BREAKER_FAILURES commands in a row failed
+ * the breaker opens: the app task reports the device unreachable, so
+ * Matter writes to it fail right away, and the LivenessMonitor probes it
+ * with backoff. The first command or probe answered closes it again.
+ *
+ * Used from the app task only.
+ */
+class DeviceBreaker {
+public:
+	struct Stats {
+		uint32_t Opened;
+		uint32_t Closed;
+		uint32_t Probes;
+		/* Queued commands failed without being sent while the breaker was open */
+		uint32_t Refused;
+	};
+
+	/* Record the outcome of a command or probe, true when the breaker closed or opened */
+	bool RecordSuccess()
+	{
+		mFailures = 0;
+		if (!mOpen) {
+			return false;
+		}
+		mOpen = false;
+		return true;
+	}
+
+	bool RecordFailure()
+	{
+		if (mOpen || ++mFailures < CONFIG_BRIDGE_BREAKER_FAILURES) {
+			return false;
+		}
+		mOpen = true;
+		return true;
+	}
+
+	bool IsOpen() const { return mOpen; }
+
+	/* Only answers and timeouts of the device count, not failures of the NCP link */
+	static bool IsDeviceFailure(int err) { return err == -EINVAL || err == -ETIMEDOUT; }
+
+private:
+	uint8_t mFailures = 0;
+	bool mOpen = false;
+};
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "device_cmd_queue.h"
+
+static_assert(CONFIG_BRIDGE_DEVICE_CMD_LIMIT <= UINT8_MAX, "Device command counts are 8-bit");
+
+void DeviceCmdQueue::Init(Slot *slots, size_t count)
+{
+	__ASSERT_NO_MSG(count < kNone);
+
+	mSlots = slots;
+	mCount = count;
+	for (size_t i = 0; i < count; i++) {
+		slots[i] = Slot{};
+	}
+	mHead = kNone;
+	mTail = kNone;
+	mActive = 0;
+	mStats = {};
+}
+
+void DeviceCmdQueue::Append(size_t index)
+{
+	mSlots[index].next = kNone;
+	if (mTail == kNone) {
+		mHead = static_cast<uint16_t>(index);
+	} else {
+		mSlots[mTail].next = static_cast<uint16_t>(index);
+	}
+	mTail = static_cast<uint16_t>(index);
+}
+
+int DeviceCmdQueue::Push(size_t index, const AppEvent &event)
+{
+	Slot &slot = mSlots[index];
+	unsigned int key;
+
+	__ASSERT_NO_MSG(index < mCount);
+	key = irq_lock();
+	if (slot.inFlight == CONFIG_BRIDGE_DEVICE_CMD_LIMIT) {
+		mStats.Rejected++;
+		irq_unlock(key);
+		return -ENOBUFS;
+	}
+
+	slot.cmds[(slot.head + slot.queued) % CONFIG_BRIDGE_DEVICE_CMD_LIMIT] = event;
+	slot.inFlight++;
+	if (slot.queued++ == 0) {
+		Append(index);
+		mActive++;
+		mStats.ActiveHighWater = MAX(mStats.ActiveHighWater, mActive);
+	}
+	mStats.Queued++;
+	irq_unlock(key);
+
+	return 0;
+}
+
+bool DeviceCmdQueue::Pop(AppEvent &event, size_t &index)
+{
+	unsigned int key = irq_lock();
+
+	if (mHead == kNone) {
+		irq_unlock(key);
+		return false;
+	}
+
+	Slot &slot = mSlots[mHead];
+
+	index = mHead;
+	event = slot.cmds[slot.head];
+	slot.head = (slot.head + 1) % CONFIG_BRIDGE_DEVICE_CMD_LIMIT;
+	mHead = slot.next;
+	if (mHead == kNone) {
+		mTail = kNone;
+	}
+	if (--slot.queued == 0) {
+		mActive--;
+	} else {
+		/* The rest waits for the other devices' turn */
+		Append(index);
+	}
+	irq_unlock(key);
+
+	return true;
+}
+
+void DeviceCmdQueue::Complete(size_t index)
+{
+	unsigned int key = irq_lock();
+
+	mSlots[index].inFlight--;
+	irq_unlock(key);
+}
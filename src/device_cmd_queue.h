@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "app_event.h"
+
+#include <zephyr.h>
+
+/*
+ * Outbound commands of the bridged devices, one queue per device.
+ *
+ * The Zigbee shell runs one command at a time, so device commands wait
+ * here for the app task. The devices with queued commands are served in
+ * turn, one command each, so the backlog of a device flooded with writes
+ * delays a command of another device by at most one command per busy
+ * device. A device has at most CONFIG_BRIDGE_DEVICE_CMD_LIMIT commands
+ * accepted and not completed, further ones are refused right away.
+ *
+ * Push() is called from any thread, the other calls from the app task.
+ */
+class DeviceCmdQueue {
+public:
+	struct Slot {
+		AppEvent cmds[CONFIG_BRIDGE_DEVICE_CMD_LIMIT];
+		uint8_t head;
+		uint8_t queued;
+		/* Queued, and taken by Pop() until Complete() */
+		uint8_t inFlight;
+		/* Next device in turn, while this one has queued commands */
+		uint16_t next;
+	};
+
+	struct Stats {
+		uint32_t Queued;
+		uint32_t Rejected;
+		/* Most devices with queued commands at once */
+		uint32_t ActiveHighWater;
+	};
+
+	/* The queue of device index i is slots[i] */
+	void Init(Slot *slots, size_t count);
+
+	/* -ENOBUFS when the device has reached its limit */
+	int Push(size_t index, const AppEvent &event);
+	/* Takes the command of the next device in turn */
+	bool Pop(AppEvent &event, size_t &index);
+	void Complete(size_t index);
+
+	bool Empty() const { return mActive == 0; }
+	uint32_t Active() const { return mActive; }
+	Stats GetStats() const { return mStats; }
+
+private:
+	static constexpr uint16_t kNone = UINT16_MAX;
+
+	/* Puts the device at the end of the turn, with the lock held */
+	void Append(size_t index);
+
+	Slot *mSlots = nullptr;
+	size_t mCount = 0;
+	/* Devices with queued commands, served from the head */
+	uint16_t mHead = kNone;
+	uint16_t mTail = kNone;
+	volatile uint32_t mActive = 0;
+	Stats mStats = {};
+};
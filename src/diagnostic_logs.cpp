@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "diagnostic_logs.h"
+#include "app_task.h"
+#include "latency_stats.h"
+#include "thread_stats.h"
+#include "trace.h"
+
+#include <app-common/zap-generated/cluster-objects.h>
+#include <app/CommandHandlerInterface.h>
+#include <app/InteractionModelEngine.h>
+
+#include <logging/log.h>
+#include <zephyr.h>
+
+LOG_MODULE_DECLARE(app);
+
+using namespace ::chip;
+using namespace ::chip::app::Clusters::DiagnosticLogs;
+
+namespace BridgeDiagnosticLogs {
+namespace {
+/* Largest content the response payload transfer protocol allows */
+constexpr size_t kMaxChunkSize = 1024;
+/* Restart from a fresh snapshot when a transfer is abandoned */
+constexpr uint32_t kSessionTimeoutMs = 60000;
+constexpr uint8_t kCountersVersion = 2;
+constexpr size_t kMaxCounters = 96;
+
+struct CountersHeader {
+	char magic[4];
+	uint8_t version;
+	uint8_t count;
+	uint16_t reserved;
+};
+
+/* Counters block of the current transfer; the trace is read live behind it */
+struct {
+	CountersHeader header;
+	uint32_t values[kMaxCounters];
+} sCounters;
+
+size_t sCountersSize;
+size_t sOffset;
+bool sSessionActive;
+uint32_t sLastRequestMs;
+uint8_t sChunk[kMaxChunkSize];
+
+/* The order of the counters is the one listed in scripts/trace_decode.py */
+void SnapshotCounters()
+{
+	const ZigbeeShell::Stats &zb = GetAppTask().GetZigbeeShell().GetStats();
+	const AppEventQueue &queue = GetAppTask().GetEventQueue();
+	const AppTask::OptimisticStats &optimistic = GetAppTask().GetOptimisticStats();
+	uint8_t count = 0;
+
+	sCounters.values[count++] = k_uptime_get_32();
+	sCounters.values[count++] = zb.rxBytes;
+	sCounters.values[count++] = zb.txBytes;
+	sCounters.values[count++] = zb.rxDroppedBytes;
+	sCounters.values[count++] = zb.commands;
+	sCounters.values[count++] = zb.commandErrors;
+	sCounters.values[count++] = zb.commandTimeouts;
+	sCounters.values[count++] = zb.parserErrors;
+	for (uint8_t lane = 0; lane < AppEventQueue::kLaneCount; lane++) {
+		const AppEventQueue::LaneStats &stats = queue.Stats(static_cast<AppEventQueue::Lane>(lane));
+
+		sCounters.values[count++] = queue.Depth(static_cast<AppEventQueue::Lane>(lane));
+		sCounters.values[count++] = stats.HighWater;
+		sCounters.values[count++] = stats.Posted;
+		sCounters.values[count++] = stats.Dropped;
+		sCounters.values[count++] = stats.Coalesced;
+	}
+	sCounters.values[count++] = optimistic.Confirmed;
+	sCounters.values[count++] = optimistic.RolledBack;
+
+	for (uint8_t stage = 0; stage < LatencyStats::kStageCount; stage++) {
+		LatencyHistogram merged;
+
+#ifdef CONFIG_BRIDGE_LATENCY_STATS
+		for (uint8_t cls = 0; cls < LatencyStats::kClassCount; cls++) {
+			merged.Merge(LatencyStats::Get(static_cast<LatencyStats::Stage>(stage),
+						       static_cast<LatencyStats::DeviceClass>(cls)));
+		}
+#endif
+		sCounters.values[count++] = merged.Count();
+		sCounters.values[count++] = k_cyc_to_us_ceil32(merged.Percentile(50));
+		sCounters.values[count++] = k_cyc_to_us_ceil32(merged.Percentile(99));
+		sCounters.values[count++] = k_cyc_to_us_ceil32(merged.Max());
+	}
+
+	sCounters.values[count++] = ThreadStats::CpuPermille("main");
+	sCounters.values[count++] = ThreadStats::CpuPermille("sysworkq");
+	sCounters.values[count++] = ThreadStats::CpuPermille("CHIP");
+	sCounters.values[count++] = ThreadStats::CpuPermille("zb_rx");
+
+	const LatencyHistogram &rxWake = GetAppTask().GetZigbeeShell().GetRxWakeLatency();
+
+	sCounters.values[count++] = rxWake.Count();
+	sCounters.values[count++] = k_cyc_to_us_ceil32(rxWake.Percentile(50));
+	sCounters.values[count++] = k_cyc_to_us_ceil32(rxWake.Percentile(99));
+	sCounters.values[count++] = k_cyc_to_us_ceil32(rxWake.Max());
+	sCounters.values[count++] = zb.eventPoolExhausted;
+
+	const ZigbeeShell::StartInfo &zbStart = GetAppTask().GetZigbeeShell().GetStartInfo();
+
+	sCounters.values[count++] = zbStart.warmStart;
+	sCounters.values[count++] = zbStart.readyUptimeMs;
+	sCounters.values[count++] = zbStart.durationMs;
+
+	const AppTask::BootTimes &boot = GetAppTask().GetBootTimes();
+
+	sCounters.values[count++] = boot.MatterReady;
+	sCounters.values[count++] = boot.Commissionable;
+	sCounters.values[count++] = boot.FirstEndpoint;
+	sCounters.values[count++] = zb.rxOverflows;
+	sCounters.values[count++] = zb.rxStalls;
+	sCounters.values[count++] = zb.rxResyncs;
+	sCounters.values[count++] = zb.txBusyUs / MAX(sCounters.values[0], 1u);
+	sCounters.values[count++] = zb.txBufferWaits;
+	sCounters.values[count++] = zb.txAborted;
+
+	const DeviceCmdQueue::Stats &deviceCmds = GetAppTask().GetDeviceCmdQueue().GetStats();
+
+	sCounters.values[count++] = deviceCmds.Queued;
+	sCounters.values[count++] = deviceCmds.Rejected;
+	sCounters.values[count++] = deviceCmds.ActiveHighWater;
+
+	const DeviceBreaker::Stats &breakers = GetAppTask().GetBreakerStats();
+
+	sCounters.values[count++] = breakers.Opened;
+	sCounters.values[count++] = breakers.Closed;
+	sCounters.values[count++] = breakers.Probes;
+	sCounters.values[count++] = breakers.Refused;
+
+	const LivenessMonitor::Stats &liveness = GetAppTask().GetLivenessStats();
+
+	sCounters.values[count++] = liveness.Probes;
+	sCounters.values[count++] = liveness.Missed;
+	sCounters.values[count++] = liveness.Suppressed;
+	sCounters.values[count++] = liveness.Deferred;
+
+	const PollScheduler::Stats &polls = GetAppTask().GetPollStats();
+
+	sCounters.values[count++] = polls.Polls;
+	sCounters.values[count++] = polls.Changes;
+	sCounters.values[count++] = polls.Deferred;
+
+	const ReportLimiter::Stats &reports = GetAppTask().GetReportStats();
+
+	sCounters.values[count++] = reports.Emitted;
+	sCounters.values[count++] = reports.Unwatched;
+	sCounters.values[count++] = reports.Coalesced;
+	sCounters.values[count++] = zb.commandLateResponses;
+	sCounters.values[count++] = polls.ConfigureRetries;
+	sCounters.values[count++] = polls.Silent;
+	sCounters.values[count++] = zb.rxOverrunBytes;
+
+	__ASSERT_NO_MSG(count <= kMaxCounters);
+	sCounters.header = { { 'B', 'S', 'T', 'A' }, kCountersVersion, count, 0 };
+	sCountersSize = sizeof(sCounters.header) + count * sizeof(sCounters.values[0]);
+}
+
+size_t ImageSize()
+{
+#ifdef CONFIG_BRIDGE_TRACE
+	return sCountersSize + Trace::Size();
+#else
+	return sCountersSize;
+#endif
+}
+
+size_t ReadImage(size_t offset, uint8_t *buf, size_t len)
+{
+	size_t copied = 0;
+
+	if (offset < sCountersSize) {
+		copied = MIN(len, sCountersSize - offset);
+		memcpy(buf, reinterpret_cast<const uint8_t *>(&sCounters) + offset, copied);
+	}
+#ifdef CONFIG_BRIDGE_TRACE
+	if (copied < len) {
+		copied += Trace::Read(offset + copied - sCountersSize, buf + copied, len - copied);
+	}
+#endif
+
+	return copied;
+}
+
+bool HandleRetrieveLogsRequest(app::CommandHandler *commandObj, const app::ConcreteCommandPath &commandPath,
+			       const Commands::RetrieveLogsRequest::DecodableType &commandData)
+{
+	Commands::RetrieveLogsResponse::Type response;
+	uint32_t now = k_uptime_get_32();
+
+	response.timeStamp = 0;
+	response.timeSinceBoot = now / MSEC_PER_SEC;
+
+	/* Performance data is no crash log; BDX is not supported, so always use the response payload */
+	if (commandData.intent == EMBER_ZCL_LOGS_INTENT_CRASH_LOGS) {
+		response.status = EMBER_ZCL_LOGS_STATUS_NO_LOGS;
+		return commandObj->AddResponseData(commandPath, response) == CHIP_NO_ERROR;
+	}
+
+	if (sSessionActive && (now - sLastRequestMs) > kSessionTimeoutMs) {
+		sSessionActive = false;
+	}
+	sLastRequestMs = now;
+
+	if (!sSessionActive) {
+		SnapshotCounters();
+		sOffset = 0;
+		sSessionActive = true;
+	}
+
+	if (sOffset >= ImageSize()) {
+		/* Transfer complete, the next request starts a new one */
+		sSessionActive = false;
+		response.status = EMBER_ZCL_LOGS_STATUS_NO_LOGS;
+		return commandObj->AddResponseData(commandPath, response) == CHIP_NO_ERROR;
+	}
+
+	size_t len = ReadImage(sOffset, sChunk, sizeof(sChunk));
+
+	sOffset += len;
+	response.status = EMBER_ZCL_LOGS_STATUS_SUCCESS;
+	response.content = ByteSpan(sChunk, len);
+	LOG_DBG("RetrieveLogs chunk %u bytes, %u left", (unsigned int)len, (unsigned int)(ImageSize() - sOffset));
+
+	return commandObj->AddResponseData(commandPath, response) == CHIP_NO_ERROR;
+}
+
+/* Takes the RetrieveLogsRequest commands of every endpoint, the others go on to the generated dispatch */
+class RetrieveLogsHandler : public app::CommandHandlerInterface {
+public:
+	RetrieveLogsHandler() : app::CommandHandlerInterface(NullOptional, app::Clusters::DiagnosticLogs::Id) {}
+
+	void InvokeCommand(HandlerContext &context) override
+	{
+		HandleCommand<Commands::RetrieveLogsRequest::DecodableType>(
+			context, [](HandlerContext &ctx, const Commands::RetrieveLogsRequest::DecodableType &commandData) {
+				if (!HandleRetrieveLogsRequest(&ctx.mCommandHandler, ctx.mRequestPath, commandData)) {
+					ctx.mCommandHandler.AddStatus(ctx.mRequestPath,
+								      Protocols::InteractionModel::Status::Failure);
+				}
+			});
+	}
+};
+
+RetrieveLogsHandler sHandler;
+} /* namespace */
+
+void Init()
+{
+	CHIP_ERROR err = app::InteractionModelEngine::GetInstance()->RegisterCommandHandler(&sHandler);
+
+	if (err != CHIP_NO_ERROR) {
+		LOG_ERR("RegisterCommandHandler() failed: %" CHIP_ERROR_FORMAT, err.Format());
+	}
+}
+
+} /* namespace BridgeDiagnosticLogs */
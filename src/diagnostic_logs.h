@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+/*
+ * Serves the bridge performance data through the DiagnosticLogs cluster.
+ *
+ * The log image is a counters block ("BSTA") followed by the binary event
+ * trace ("BTRC"). Successive RetrieveLogsRequest commands return successive
+ * chunks of it in the response payload; a request past the end returns
+ * NoLogs and the next one starts over with fresh counters. Both parts are
+ * decoded by scripts/trace_decode.py. The command is served on every
+ * endpoint ahead of the SDK stub, by a handler registered with the
+ * interaction model.
+ */
+namespace BridgeDiagnosticLogs {
+
+/* Registers the command handler, once the server is initialized */
+void Init();
+
+} /* namespace BridgeDiagnosticLogs */
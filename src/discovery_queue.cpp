@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "discovery_queue.h"
+
+void DiscoveryQueue::Init(Slot *slots, size_t count)
+{
+	mSlots = slots;
+	mCount = count;
+	for (size_t i = 0; i < count; i++) {
+		slots[i] = Slot{};
+	}
+	mHead = 0;
+	mQueued = 0;
+	mStats = {};
+}
+
+int DiscoveryQueue::Push(uint16_t addr, uint8_t ep)
+{
+	unsigned int key = irq_lock();
+
+	for (uint32_t i = 0; i < mQueued; i++) {
+		const Slot &slot = mSlots[(mHead + i) % mCount];
+
+		if (slot.addr == addr && slot.ep == ep) {
+			mStats.Coalesced++;
+			irq_unlock(key);
+			return 0;
+		}
+	}
+	if (mQueued == mCount) {
+		mStats.Dropped++;
+		irq_unlock(key);
+		return -ENOBUFS;
+	}
+
+	mSlots[(mHead + mQueued) % mCount] = Slot{ addr, ep };
+	mQueued++;
+	mStats.Queued++;
+	mStats.HighWater = MAX(mStats.HighWater, mQueued);
+	irq_unlock(key);
+
+	return 0;
+}
+
+bool DiscoveryQueue::Pop(uint16_t &addr, uint8_t &ep)
+{
+	unsigned int key = irq_lock();
+
+	if (mQueued == 0) {
+		irq_unlock(key);
+		return false;
+	}
+
+	addr = mSlots[mHead].addr;
+	ep = mSlots[mHead].ep;
+	mHead = (mHead + 1) % mCount;
+	mQueued--;
+	if (ep == 0) {
+		mStats.Announces++;
+	}
+	irq_unlock(key);
+
+	return true;
+}
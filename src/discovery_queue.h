@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+/*
+ * Discovery work waiting for the app task, one entry per address.
+ *
+ * A device announce, or a match or active endpoint response, arrives for
+ * every light at once after a rejoin, while the app task waits on a single
+ * shell command. Rather than take an event payload and a discovery lane
+ * entry each, the Zigbee shell thread records the address here and the app
+ * task drains the entries in their order of arrival, one shell command
+ * each. An address already waiting is coalesced, so a repeated announce
+ * takes no more room. Entry 0 of an address is its announce, its active
+ * endpoints are still to be requested; any other is an endpoint whose
+ * simple descriptor is.
+ *
+ * Push() is called from any thread, the other calls from the app task.
+ */
+class DiscoveryQueue {
+public:
+	/* An announce and an endpoint for each of the bridged devices */
+	static constexpr size_t kSlotsPerDevice = 2;
+
+	struct Slot {
+		uint16_t addr;
+		uint8_t ep;
+	};
+
+	struct Stats {
+		uint32_t Queued;
+		uint32_t Coalesced;
+		uint32_t Dropped;
+		/* Most entries waiting at once */
+		uint32_t HighWater;
+		/* Announces taken, their active endpoints requested */
+		uint32_t Announces;
+	};
+
+	/* Room for count entries in slots */
+	void Init(Slot *slots, size_t count);
+
+	/* -ENOBUFS when full, 0 when queued or already waiting */
+	int Push(uint16_t addr, uint8_t ep);
+	/* Takes the oldest entry */
+	bool Pop(uint16_t &addr, uint8_t &ep);
+
+	bool Empty() const { return mQueued == 0; }
+	uint32_t Queued() const { return mQueued; }
+	Stats GetStats() const { return mStats; }
+
+private:
+	Slot *mSlots = nullptr;
+	size_t mCount = 0;
+	size_t mHead = 0;
+	volatile uint32_t mQueued = 0;
+	Stats mStats = {};
+};
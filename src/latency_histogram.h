@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Fixed-bucket log2 histogram of durations in hardware cycles.
+ *
+ * Bucket 0 holds zero-length samples, bucket n holds samples in
+ * [2^(n-1), 2^n) cycles and the last bucket collects everything above.
+ * Recording a sample is a count-leading-zeros and three increments, so
+ * it is cheap enough for the command hot paths.
+ */
+class LatencyHistogram {
+public:
+	static constexpr size_t kBucketCount = 28;
+
+	void Record(uint32_t cycles)
+	{
+		mBuckets[BucketOf(cycles)]++;
+		mCount++;
+		mSum += cycles;
+		if (cycles > mMax) {
+			mMax = cycles;
+		}
+	}
+
+	void Reset() { *this = LatencyHistogram(); }
+
+	void Merge(const LatencyHistogram &other)
+	{
+		for (size_t i = 0; i < kBucketCount; i++) {
+			mBuckets[i] += other.mBuckets[i];
+		}
+		mCount += other.mCount;
+		mSum += other.mSum;
+		if (other.mMax > mMax) {
+			mMax = other.mMax;
+		}
+	}
+
+	uint32_t Count() const { return mCount; }
+	uint64_t Sum() const { return mSum; }
+	uint32_t Max() const { return mMax; }
+	uint32_t Bucket(size_t index) const { return mBuckets[index]; }
+
+	/* Upper bound, in cycles, of the values that land in a bucket. */
+	static uint32_t BucketLimit(size_t index)
+	{
+		return (index == 0) ? 0 : (index >= 32) ? UINT32_MAX : ((1ULL << index) - 1);
+	}
+
+	/* Approximate percentile: the upper bound of the bucket holding it. */
+	uint32_t Percentile(uint8_t percent) const
+	{
+		uint64_t rank = (static_cast<uint64_t>(mCount) * percent + 99) / 100;
+		uint64_t seen = 0;
+
+		for (size_t i = 0; i < kBucketCount; i++) {
+			seen += mBuckets[i];
+			if (seen >= rank && seen > 0) {
+				return (i == kBucketCount - 1) ? mMax : BucketLimit(i);
+			}
+		}
+
+		return 0;
+	}
+
+private:
+	static size_t BucketOf(uint32_t cycles)
+	{
+		size_t index = (cycles == 0) ? 0 : (32 - __builtin_clz(cycles));
+
+		return (index < kBucketCount) ? index : (kBucketCount - 1);
+	}
+
+	uint32_t mBuckets[kBucketCount] = {};
+	uint32_t mCount = 0;
+	uint32_t mMax = 0;
+	uint64_t mSum = 0;
+};
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "latency_stats.h"
+
+namespace LatencyStats {
+namespace {
+LatencyHistogram sHistograms[kStageCount][kClassCount];
+
+const char *const sStageNames[kStageCount] = {
+	"write->report", "write->tx", "tx->done", "done->complete", "end-to-end"
+};
+
+const char *const sClassNames[kClassCount] = {
+	"on/off light", "dimmable light", "color light", "other"
+};
+} /* namespace */
+
+const char *StageName(Stage stage)
+{
+	return sStageNames[stage];
+}
+
+const char *ClassName(DeviceClass cls)
+{
+	return sClassNames[cls];
+}
+
+const LatencyHistogram &Get(Stage stage, DeviceClass cls)
+{
+	return sHistograms[stage][cls];
+}
+
+void Record(Stage stage, DeviceClass cls, uint32_t start, uint32_t end)
+{
+	sHistograms[stage][cls].Record(end - start);
+}
+
+void Reset()
+{
+	for (auto &stage : sHistograms) {
+		for (auto &hist : stage) {
+			hist.Reset();
+		}
+	}
+}
+
+} /* namespace LatencyStats */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "latency_histogram.h"
+
+#include <zephyr.h>
+
+/*
+ * Per-stage latency of the Matter -> Zigbee control path.
+ *
+ * A Matter write is time-stamped when it reaches the attribute write
+ * callback, when its shell command is handed to uart_tx, when the shell
+ * response is parsed and when the resulting state is reported. Each
+ * interval is recorded in a log2 histogram per stage and device class.
+ */
+namespace LatencyStats {
+
+enum Stage : uint8_t {
+	kStage_WriteToReport,
+	kStage_WriteToTx,
+	kStage_TxToDone,
+	kStage_DoneToComplete,
+	kStage_EndToEnd,
+	kStageCount
+};
+
+enum DeviceClass : uint8_t {
+	kClass_OnOffLight,
+	kClass_DimmableLight,
+	kClass_ColorLight,
+	kClass_Other,
+	kClassCount
+};
+
+/* Classify a bridged device by its Zigbee HA device identifier */
+inline DeviceClass ClassOf(uint16_t zbDeviceId)
+{
+	switch (zbDeviceId) {
+	case 0x0100:
+		return kClass_OnOffLight;
+	case 0x0101:
+		return kClass_DimmableLight;
+	case 0x0102:
+		return kClass_ColorLight;
+	default:
+		return kClass_Other;
+	}
+}
+
+const char *StageName(Stage stage);
+const char *ClassName(DeviceClass cls);
+
+const LatencyHistogram &Get(Stage stage, DeviceClass cls);
+void Record(Stage stage, DeviceClass cls, uint32_t start, uint32_t end);
+void Reset();
+
+} /* namespace LatencyStats */
+
+#ifdef CONFIG_BRIDGE_LATENCY_STATS
+#define LATENCY_TIMESTAMP() k_cycle_get_32()
+#define LATENCY_RECORD(stage, cls, start, end) LatencyStats::Record(stage, cls, start, end)
+#else
+#define LATENCY_TIMESTAMP() 0
+#define LATENCY_RECORD(stage, cls, start, end) \
+	do { \
+		ARG_UNUSED(cls); \
+		ARG_UNUSED(start); \
+		ARG_UNUSED(end); \
+	} while (0)
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "liveness_monitor.h"
+
+#include <random/rand32.h>
+
+void LivenessMonitor::Init(Slot *slots, size_t count, RateBudget &budget)
+{
+	Init(slots, count, budget, Config{});
+}
+
+void LivenessMonitor::Init(Slot *slots, size_t count, RateBudget &budget, const Config &config)
+{
+	__ASSERT_NO_MSG(config.tickMs > 0);
+
+	mSlots = slots;
+	mCount = count;
+	for (size_t i = 0; i < count; i++) {
+		slots[i] = Slot{};
+	}
+	mConfig = config;
+	mWheel.Init(Now());
+	mBudget = &budget;
+	mStats = {};
+}
+
+void LivenessMonitor::Schedule(Slot &slot, uint32_t ticks)
+{
+	uint32_t jitter = ticks * mConfig.jitterPercent / 100;
+
+	if (jitter > 0) {
+		ticks = ticks - jitter + sys_rand32_get() % (2 * jitter + 1);
+	}
+	mWheel.Schedule(&slot, ticks);
+}
+
+void LivenessMonitor::Add(size_t index)
+{
+	Slot &slot = mSlots[index];
+
+	__ASSERT_NO_MSG(index < mCount);
+	if (TimingWheel::IsScheduled(&slot)) {
+		return;
+	}
+	mStats.Monitored++;
+	Schedule(slot, Ticks(mConfig.intervalMs));
+}
+
+void LivenessMonitor::Heard(size_t index)
+{
+	Slot &slot = mSlots[index];
+
+	/* Left on the wheel, the probe is postponed when it expires */
+	if (TimingWheel::IsScheduled(&slot) && !slot.missed) {
+		slot.heard = Now();
+		slot.heardValid = true;
+		return;
+	}
+	slot.heardValid = false;
+	slot.missed = false;
+	slot.backoff = 0;
+	Schedule(slot, Ticks(mConfig.intervalMs));
+}
+
+void LivenessMonitor::Missed(size_t index, bool unreachable)
+{
+	Slot &slot = mSlots[index];
+	uint32_t delayMs = mConfig.retryMs;
+
+	if (unreachable) {
+		delayMs = MIN(static_cast<uint64_t>(mConfig.unreachableMs) << slot.backoff, mConfig.backoffMaxMs);
+		if (delayMs < mConfig.backoffMaxMs) {
+			slot.backoff++;
+		}
+	}
+	mStats.Missed++;
+	slot.heardValid = false;
+	slot.missed = true;
+	Schedule(slot, Ticks(delayMs));
+}
+
+bool LivenessMonitor::NextProbe(size_t &index)
+{
+	uint32_t now = Now();
+	TimingWheel::Node *node;
+
+	mWheel.Advance(now);
+	while ((node = mWheel.PeekExpired()) != nullptr) {
+		Slot &slot = *static_cast<Slot *>(node);
+		uint32_t interval = Ticks(mConfig.intervalMs);
+
+		if (slot.heardValid && now - slot.heard < interval) {
+			slot.heardValid = false;
+			mStats.Suppressed++;
+			Schedule(slot, slot.heard + interval - now);
+			continue;
+		}
+		if (!mBudget->Take()) {
+			mStats.Deferred++;
+			return false;
+		}
+
+		mWheel.Cancel(node);
+		mStats.Probes++;
+		index = &slot - mSlots;
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "rate_budget.h"
+#include "timing_wheel.h"
+
+#include <zephyr.h>
+
+/*
+ * Liveness probes of the bridged devices, scheduled on one timing wheel.
+ *
+ * A monitored device is probed once per interval, with a random jitter so
+ * that devices added together drift apart. Traffic from the device in the
+ * meantime, such as a command it answered, postpones the probe instead. A
+ * missed probe is retried sooner, and a device found unreachable is probed
+ * at a delay doubling up to a maximum. Probes start at most at the rate of
+ * the budget they share with the state polls, and at most one per tick, so
+ * the airtime they take is bounded whatever the number of devices; the
+ * others wait their turn.
+ *
+ * The outcome of a probe is given back with Heard() or Missed(), which also
+ * take the outcome of the commands. Used from the app task only.
+ */
+class LivenessMonitor {
+public:
+	struct Config {
+		uint32_t tickMs = CONFIG_BRIDGE_LIVENESS_TICK_MS;
+		/* Probe interval of a device without traffic */
+		uint32_t intervalMs = CONFIG_BRIDGE_LIVENESS_INTERVAL_MS;
+		/* Delay of the retry after a missed probe */
+		uint32_t retryMs = CONFIG_BRIDGE_LIVENESS_RETRY_MS;
+		/* First probe delay of an unreachable device, and the most it doubles to */
+		uint32_t unreachableMs = CONFIG_BRIDGE_BREAKER_PROBE_INTERVAL_MS;
+		uint32_t backoffMaxMs = CONFIG_BRIDGE_LIVENESS_BACKOFF_MAX_MS;
+		uint8_t jitterPercent = CONFIG_BRIDGE_LIVENESS_JITTER_PERCENT;
+	};
+
+	struct Slot : TimingWheel::Node {
+		uint32_t heard;
+		/* Traffic since the probe was scheduled */
+		bool heardValid;
+		/* The last probe or command was missed */
+		bool missed;
+		uint8_t backoff;
+	};
+
+	struct Stats {
+		uint32_t Monitored;
+		uint32_t Probes;
+		/* Probes and commands the device did not answer */
+		uint32_t Missed;
+		/* Probes postponed by traffic from the device */
+		uint32_t Suppressed;
+		/* Ticks a due probe waited for the budget */
+		uint32_t Deferred;
+	};
+
+	/* The state of device index i is slots[i], probed within the budget as set in Kconfig unless given a config */
+	void Init(Slot *slots, size_t count, RateBudget &budget);
+	void Init(Slot *slots, size_t count, RateBudget &budget, const Config &config);
+
+	/* Starts monitoring the device, first probe within an interval */
+	void Add(size_t index);
+	/* The device answered a probe or a command */
+	void Heard(size_t index);
+	/* The device did not answer, unreachable when its breaker is open */
+	void Missed(size_t index, bool unreachable);
+
+	/* Advances to the current time, true with the device to probe now */
+	bool NextProbe(size_t &index);
+
+	const Stats &GetStats() const { return mStats; }
+
+private:
+	uint32_t Now() const { return static_cast<uint32_t>(k_uptime_get() / mConfig.tickMs); }
+	uint32_t Ticks(uint32_t ms) const { return DIV_ROUND_UP(ms, mConfig.tickMs); }
+	/* Schedules the slot ticks ahead, give or take the jitter */
+	void Schedule(Slot &slot, uint32_t ticks);
+
+	Slot *mSlots = nullptr;
+	size_t mCount = 0;
+	Config mConfig;
+	TimingWheel mWheel;
+	RateBudget *mBudget = nullptr;
+	Stats mStats = {};
+};
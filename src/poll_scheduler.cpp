@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "poll_scheduler.h"
+
+void PollScheduler::Init(Slot *slots, size_t count, RateBudget &budget)
+{
+	Init(slots, count, budget, Config{});
+}
+
+void PollScheduler::Init(Slot *slots, size_t count, RateBudget &budget, const Config &config)
+{
+	__ASSERT_NO_MSG(config.tickMs > 0);
+	__ASSERT_NO_MSG(config.minIntervalMs <= config.maxIntervalMs);
+
+	mSlots = slots;
+	mCount = count;
+	for (size_t i = 0; i < count; i++) {
+		slots[i] = Slot{};
+	}
+	mConfig = config;
+	mWheel.Init(Now());
+	mBudget = &budget;
+	mStats = {};
+}
+
+void PollScheduler::Add(size_t index, bool watched)
+{
+	Slot &slot = mSlots[index];
+
+	__ASSERT_NO_MSG(index < mCount);
+	if (slot.polled) {
+		return;
+	}
+	/* The state was just read, the changes are learnt from the fastest interval on */
+	slot.intervalMs = mConfig.minIntervalMs;
+	slot.polled = true;
+	slot.due = kDue_Poll;
+	slot.watched = watched;
+	mStats.Devices++;
+	mWheel.Schedule(&slot, Ticks(IntervalMs(slot)));
+}
+
+void PollScheduler::SetWatched(size_t index, bool watched)
+{
+	Slot &slot = mSlots[index];
+
+	if (slot.watched == watched) {
+		return;
+	}
+	slot.watched = watched;
+	if (!slot.polled || !watched) {
+		return;
+	}
+	/* The new subscriber gets the state fresh, and its changes soon */
+	slot.intervalMs = mConfig.minIntervalMs;
+	if (TimingWheel::IsScheduled(&slot)) {
+		mWheel.Schedule(&slot, 0);
+	}
+}
+
+void PollScheduler::Polled(size_t index, bool changed)
+{
+	Slot &slot = mSlots[index];
+
+	if (changed) {
+		mStats.Changes++;
+		slot.intervalMs = MAX(slot.intervalMs / 2, mConfig.minIntervalMs);
+	} else {
+		slot.intervalMs = MIN(slot.intervalMs + MAX(slot.intervalMs / 4, 1u), mConfig.maxIntervalMs);
+	}
+	mWheel.Schedule(&slot, Ticks(IntervalMs(slot)));
+}
+
+bool PollScheduler::RetryConfigure(size_t index)
+{
+	Slot &slot = mSlots[index];
+
+	__ASSERT_NO_MSG(index < mCount);
+	if (slot.polled || slot.configureRetries >= mConfig.configureRetries) {
+		return false;
+	}
+	slot.configureRetries++;
+	slot.due = kDue_Configure;
+	mStats.ConfigureRetries++;
+	mWheel.Schedule(&slot, Ticks(mConfig.configureRetryMs));
+	return true;
+}
+
+void PollScheduler::CheckReports(size_t index)
+{
+	Slot &slot = mSlots[index];
+
+	__ASSERT_NO_MSG(index < mCount);
+	if (slot.polled) {
+		return;
+	}
+	slot.due = kDue_ReportCheck;
+	mWheel.Schedule(&slot, Ticks(mConfig.reportTimeoutMs));
+}
+
+void PollScheduler::Silent(size_t index, bool watched)
+{
+	if (mSlots[index].polled) {
+		return;
+	}
+	mStats.Silent++;
+	Add(index, watched);
+}
+
+bool PollScheduler::NextPoll(size_t &index, Due_t &due)
+{
+	uint32_t now = Now();
+	TimingWheel::Node *node;
+
+	mWheel.Advance(now);
+	node = mWheel.PeekExpired();
+	if (node == nullptr) {
+		return false;
+	}
+	/* A report check sends nothing to the device */
+	if (static_cast<Slot *>(node)->due != kDue_ReportCheck && !mBudget->Take()) {
+		mStats.Deferred++;
+		return false;
+	}
+
+	mWheel.Cancel(node);
+	index = static_cast<Slot *>(node) - mSlots;
+	due = mSlots[index].due;
+	mStats.Polls += due == kDue_Poll;
+	return true;
+}
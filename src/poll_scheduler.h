@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "rate_budget.h"
+#include "timing_wheel.h"
+
+#include <zephyr.h>
+
+/*
+ * State polls of the bridged devices that cannot report it.
+ *
+ * A device whose report configuration failed is read once per interval,
+ * on a timing wheel. The interval adapts to the device: it halves, down to
+ * the minimum, after a poll found the state changed, and grows by a
+ * quarter, up to the maximum, after a poll found it the same. A device no
+ * Matter subscriber watches is only polled at the idle interval, and one
+ * starting to be watched is polled right away. Polls start at most at the
+ * rate of the budget they share with the liveness probes, and at most one
+ * per tick, whatever the number of devices.
+ *
+ * A device that did not answer its report configuration, rather than
+ * refused it, is asked again on the same wheel and within the same budget,
+ * and polled once out of retries. A device that took it is checked on the
+ * wheel for having reported within the report timeout, and polled once it
+ * has not, as the reports it sends may not be understood.
+ *
+ * The outcome of a poll is given back with Polled(). Used from the app
+ * task only.
+ */
+class PollScheduler {
+public:
+	/* What is due for a device, see NextPoll() */
+	enum Due_t : uint8_t {
+		kDue_Poll,
+		kDue_Configure,
+		kDue_ReportCheck,
+	};
+
+	struct Config {
+		uint32_t tickMs = CONFIG_BRIDGE_POLL_TICK_MS;
+		/* Interval range of a watched device */
+		uint32_t minIntervalMs = CONFIG_BRIDGE_POLL_MIN_INTERVAL_MS;
+		uint32_t maxIntervalMs = CONFIG_BRIDGE_POLL_MAX_INTERVAL_MS;
+		/* Interval of a device no subscriber watches */
+		uint32_t idleIntervalMs = CONFIG_BRIDGE_POLL_IDLE_INTERVAL_MS;
+		/* Retries of a report configuration not answered */
+		uint32_t configureRetryMs = CONFIG_BRIDGE_REPORT_CONFIG_RETRY_MS;
+		uint8_t configureRetries = CONFIG_BRIDGE_REPORT_CONFIG_RETRIES;
+		/* Time a configured device has to report in, its maximum report interval and half as much again */
+		uint32_t reportTimeoutMs = CONFIG_BRIDGE_REPORT_MAX_INTERVAL_S * 1500;
+	};
+
+	struct Slot : TimingWheel::Node {
+		/* Interval adapted to the changes of the device, while watched */
+		uint32_t intervalMs;
+		bool polled;
+		bool watched;
+		Due_t due;
+		uint8_t configureRetries;
+	};
+
+	struct Stats {
+		/* Devices polled */
+		uint32_t Devices;
+		uint32_t Polls;
+		/* Polls that found the state changed */
+		uint32_t Changes;
+		/* Ticks a due poll waited for the budget */
+		uint32_t Deferred;
+		/* Report configurations not answered and asked again */
+		uint32_t ConfigureRetries;
+		/* Configured devices polled after no report within the timeout */
+		uint32_t Silent;
+	};
+
+	/* The state of device index i is slots[i], polled within the budget as set in Kconfig unless given a config */
+	void Init(Slot *slots, size_t count, RateBudget &budget);
+	void Init(Slot *slots, size_t count, RateBudget &budget, const Config &config);
+
+	/* Starts polling the device, which cannot report */
+	void Add(size_t index, bool watched);
+	/* A Matter subscriber started or stopped watching the device */
+	void SetWatched(size_t index, bool watched);
+	/* The poll of the device is done, and found its state changed or not */
+	void Polled(size_t index, bool changed);
+	/* The device did not answer its report configuration, false when out of retries */
+	bool RetryConfigure(size_t index);
+	/* The device took its report configuration, or reported since its last check, and is checked again */
+	void CheckReports(size_t index);
+	/* The device did not report since its last check, and is polled from now on */
+	void Silent(size_t index, bool watched);
+
+	/* Advances to the current time, true with a device and what is due for it, a report check within no budget */
+	bool NextPoll(size_t &index, Due_t &due);
+
+	bool IsPolled(size_t index) const { return mSlots[index].polled; }
+	/* Time until the poll after the next poll of the device */
+	uint32_t GetIntervalMs(size_t index) const { return IntervalMs(mSlots[index]); }
+	const Stats &GetStats() const { return mStats; }
+
+private:
+	uint32_t Now() const { return static_cast<uint32_t>(k_uptime_get() / mConfig.tickMs); }
+	uint32_t Ticks(uint32_t ms) const { return DIV_ROUND_UP(ms, mConfig.tickMs); }
+	uint32_t IntervalMs(const Slot &slot) const
+	{
+		return slot.watched ? slot.intervalMs : MAX(slot.intervalMs, mConfig.idleIntervalMs);
+	}
+
+	Slot *mSlots = nullptr;
+	size_t mCount = 0;
+	Config mConfig;
+	TimingWheel mWheel;
+	RateBudget *mBudget = nullptr;
+	Stats mStats = {};
+};
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+/*
+ * Token bucket of operations per second, refilled with the uptime.
+ *
+ * One budget can be shared by several schedulers, whatever their ticks,
+ * so that together they keep to its rate. The bucket holds at most one
+ * operation, so a budget left unused does not turn into a burst later.
+ * Not thread safe, the owner serializes the calls of all its spenders.
+ */
+class RateBudget {
+public:
+	/* Starts full */
+	void Init(uint32_t perSecond)
+	{
+		mPerMs = perSecond;
+		mTokens = kTokensPerOp;
+		mRefilled = k_uptime_get_32();
+	}
+
+	/* True when an operation fits and is taken */
+	bool Take()
+	{
+		uint32_t now = k_uptime_get_32();
+
+		/* Past a second idle the bucket is full whatever the rate */
+		mTokens = MIN(mTokens + MIN(now - mRefilled, 1000u) * mPerMs, kTokensPerOp);
+		mRefilled = now;
+		if (mTokens < kTokensPerOp) {
+			return false;
+		}
+		mTokens -= kTokensPerOp;
+		return true;
+	}
+
+private:
+	/* Tokens are thousandths of an operation, refilled per millisecond */
+	static constexpr uint32_t kTokensPerOp = 1000;
+
+	uint32_t mPerMs = 0;
+	uint32_t mTokens = 0;
+	uint32_t mRefilled = 0;
+};
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "report_limiter.h"
+
+void ReportLimiter::Init(Slot *slots, size_t count, const SubscriptionTracker &subscriptions)
+{
+	Init(slots, count, subscriptions, Config{});
+}
+
+void ReportLimiter::Init(Slot *slots, size_t count, const SubscriptionTracker &subscriptions, const Config &config)
+{
+	__ASSERT_NO_MSG(config.tickMs > 0);
+
+	mSlots = slots;
+	mCount = count;
+	for (size_t i = 0; i < count; i++) {
+		slots[i] = Slot{};
+	}
+	mSubscriptions = &subscriptions;
+	mConfig = config;
+	mWheel.Init(Now());
+	mStats = {};
+}
+
+uint8_t ReportLimiter::Report(Slot &slot, uint8_t attributes, uint32_t now)
+{
+	uint32_t interval = Ticks(mConfig.minIntervalMs);
+	uint8_t due = 0;
+
+	for (size_t i = 0; i < SubscriptionTracker::kAttributeCount; i++) {
+		if (!(attributes & BIT(i))) {
+			continue;
+		}
+		if ((slot.reportedValid & BIT(i)) && now - slot.reported[i] < interval) {
+			continue;
+		}
+		slot.reported[i] = now;
+		due |= BIT(i);
+	}
+	slot.reportedValid |= due;
+	mStats.Emitted += __builtin_popcount(due);
+
+	return due;
+}
+
+void ReportLimiter::Hold(Slot &slot, uint32_t now)
+{
+	uint32_t interval = Ticks(mConfig.minIntervalMs);
+	uint32_t first = UINT32_MAX;
+
+	for (size_t i = 0; i < SubscriptionTracker::kAttributeCount; i++) {
+		if (slot.pending & BIT(i)) {
+			first = MIN(first, slot.reported[i] + interval - now);
+		}
+	}
+	/* The wheel may be behind now, until the next report tick advances it */
+	mWheel.Schedule(&slot, first + (now - mWheel.Now()));
+}
+
+uint8_t ReportLimiter::Changed(size_t index, uint8_t attributes, uint8_t written)
+{
+	Slot &slot = mSlots[index];
+	uint32_t now = Now();
+	uint8_t subscribed = mSubscriptions->Subscribed(index, attributes);
+	uint8_t unwatched = attributes & ~subscribed;
+	uint8_t held;
+	uint8_t report;
+
+	__ASSERT_NO_MSG(index < mCount);
+	mStats.Unwatched += __builtin_popcount(unwatched);
+	/* The controller that wrote sees its change now, the report held before is part of it */
+	written &= subscribed;
+	slot.pending &= ~written;
+	slot.reportedValid &= ~written;
+	held = subscribed & slot.pending;
+	/* The held report reads the value when it is sent, so it carries this change too */
+	mStats.Coalesced += __builtin_popcount(held);
+
+	report = Report(slot, subscribed & ~held, now);
+	held = subscribed & ~held & ~report;
+	if (held) {
+		slot.pending |= held;
+		Hold(slot, now);
+	}
+
+	return report | unwatched;
+}
+
+bool ReportLimiter::NextReport(size_t &index, uint8_t &attributes)
+{
+	uint32_t now = Now();
+	TimingWheel::Node *node;
+
+	mWheel.Advance(now);
+	while ((node = mWheel.PeekExpired()) != nullptr) {
+		Slot &slot = *static_cast<Slot *>(node);
+		size_t i = &slot - mSlots;
+		uint8_t subscribed = mSubscriptions->Subscribed(i, slot.pending);
+		/* Held for a subscriber that left since */
+		uint8_t unwatched = slot.pending & ~subscribed;
+
+		mWheel.Cancel(node);
+		mStats.Unwatched += __builtin_popcount(unwatched);
+		attributes = unwatched | Report(slot, subscribed, now);
+		slot.pending &= ~attributes;
+		if (slot.pending) {
+			Hold(slot, now);
+		}
+		if (attributes) {
+			index = i;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "subscription_tracker.h"
+#include "timing_wheel.h"
+
+#include <zephyr.h>
+
+/*
+ * Matter reports of the attributes of the bridged devices.
+ *
+ * Every change is reported to the interaction model, which bumps the data
+ * version of its cluster. A change of an attribute no subscription covers
+ * is reported at once, as nothing is sent for it. A subscribed attribute
+ * is reported at most once per minimum interval: a change within the
+ * interval of the previous report is held on a timing wheel until the
+ * interval is over, and the further changes in the meantime are merged
+ * into it, so one report carries the latest value however often a device
+ * flaps. A change a controller wrote is reported at once, and starts a new
+ * interval.
+ *
+ * The attributes are the SubscriptionTracker bits, which are those of
+ * Device::Changed_t. Used with the CHIP stack lock held, as the reports
+ * and the subscription counts are.
+ */
+class ReportLimiter {
+public:
+	struct Config {
+		uint32_t tickMs = CONFIG_BRIDGE_MATTER_REPORT_TICK_MS;
+		/* Shortest time between two reports of an attribute of a device */
+		uint32_t minIntervalMs = CONFIG_BRIDGE_MATTER_REPORT_MIN_INTERVAL_MS;
+	};
+
+	struct Slot : TimingWheel::Node {
+		/* Tick of the last report of each attribute, when reportedValid has its bit */
+		uint32_t reported[SubscriptionTracker::kAttributeCount];
+		uint8_t reportedValid;
+		/* Attributes changed since their last report, held until their interval is over */
+		uint8_t pending;
+	};
+
+	struct Stats {
+		/* Reports of one subscribed attribute of a device */
+		uint32_t Emitted;
+		/* Changes no subscription covers, reported at once */
+		uint32_t Unwatched;
+		/* Changes merged into a held report */
+		uint32_t Coalesced;
+	};
+
+	/* The state of device index i is slots[i], limited as set in Kconfig unless given a config */
+	void Init(Slot *slots, size_t count, const SubscriptionTracker &subscriptions);
+	void Init(Slot *slots, size_t count, const SubscriptionTracker &subscriptions, const Config &config);
+
+	/* The attributes of the device changed, the written ones by a controller, returns the ones to report now */
+	uint8_t Changed(size_t index, uint8_t attributes, uint8_t written = 0);
+
+	/* Advances to the current time, true with a device and its held attributes to report now */
+	bool NextReport(size_t &index, uint8_t &attributes);
+
+	const Stats &GetStats() const { return mStats; }
+
+private:
+	uint32_t Now() const { return static_cast<uint32_t>(k_uptime_get() / mConfig.tickMs); }
+	uint32_t Ticks(uint32_t ms) const { return DIV_ROUND_UP(ms, mConfig.tickMs); }
+	/* The attributes out of the mask whose interval is over at tick now, marked reported */
+	uint8_t Report(Slot &slot, uint8_t attributes, uint32_t now);
+	/* Schedules the slot for the first of its held attributes to be due */
+	void Hold(Slot &slot, uint32_t now);
+
+	Slot *mSlots = nullptr;
+	size_t mCount = 0;
+	const SubscriptionTracker *mSubscriptions = nullptr;
+	Config mConfig;
+	TimingWheel mWheel;
+	Stats mStats = {};
+};
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "shell_matcher.h"
+#include "zigbee_shell.h"
+
+#include <cstring>
+
+namespace {
+/* In the order of ShellMatcher::Marker_t */
+constexpr const char *kMarkerTexts[] = {
+	ZB_SHELL_MSG_PROMPT,
+	ZB_SHELL_MSG_CMD_DONE,
+	ZB_SHELL_MSG_CMD_ERROR,
+	ZB_SHELL_MSG_JOIN_NETWORK,
+	ZB_SHELL_MSG_DEVICE_REJOIN,
+	ZB_SHELL_MSG_REJOIN,
+	ZB_SHELL_MSG_ATTR_REPORT,
+	ZB_SHELL_MSG_ATTR_REPORT_VALUE,
+	"Extended PAN ID: ",
+	"PAN ID: ",
+	"src_addr=",
+	"ep=",
+	"app_dev_id=",
+	"ID: ",
+	"Type: ",
+	"Value: ",
+};
+
+static_assert(ARRAY_SIZE(kMarkerTexts) == ShellMatcher::kMarkerCount, "Missing marker text");
+static_assert(ShellMatcher::kMaxMatches < 0xff, "Match indexes are 8-bit");
+
+constexpr size_t TextLength(const char *text)
+{
+	size_t len = 0;
+
+	while (text[len] != '\0') {
+		len++;
+	}
+	return len;
+}
+
+/* One trie node per marker character, and the root */
+constexpr size_t CountStates()
+{
+	size_t states = 1;
+
+	for (const char *text : kMarkerTexts) {
+		states += TextLength(text);
+	}
+	return states;
+}
+
+/* Characters not in any marker share class 0 */
+constexpr size_t CountClasses()
+{
+	bool used[256] = {};
+	size_t classes = 1;
+
+	for (const char *text : kMarkerTexts) {
+		for (size_t i = 0; text[i] != '\0'; i++) {
+			uint8_t c = static_cast<uint8_t>(text[i]);
+
+			if (!used[c]) {
+				used[c] = true;
+				classes++;
+			}
+		}
+	}
+	return classes;
+}
+
+constexpr size_t kStates = CountStates();
+constexpr size_t kClasses = CountClasses();
+
+static_assert(kStates <= 0xff, "Automaton states are 8-bit");
+
+/*
+ * Aho-Corasick automaton as a full transition table over character
+ * classes, built by the compiler and kept in flash. Following the failure
+ * links is folded into the table, so a scan does one lookup per byte.
+ */
+struct Automaton {
+	uint8_t classOf[256];
+	uint8_t next[kStates][kClasses];
+	/* Marker ending in a state, or kNone */
+	uint8_t output[kStates];
+	/* Nearest state on the failure path with an output, 0 for none */
+	uint8_t outputLink[kStates];
+	uint8_t length[ShellMatcher::kMarkerCount];
+};
+
+constexpr uint8_t kNone = 0xff;
+
+constexpr Automaton BuildAutomaton()
+{
+	Automaton automaton = {};
+	uint8_t fail[kStates] = {};
+	uint8_t queue[kStates] = {};
+	size_t states = 1;
+	size_t classes = 1;
+	size_t head = 0;
+	size_t tail = 0;
+
+	for (size_t s = 0; s < kStates; s++) {
+		automaton.output[s] = kNone;
+	}
+
+	/* Trie of the markers, where 0 is no transition as the root is no child */
+	for (size_t marker = 0; marker < ShellMatcher::kMarkerCount; marker++) {
+		const char *text = kMarkerTexts[marker];
+		size_t state = 0;
+
+		for (size_t i = 0; text[i] != '\0'; i++) {
+			uint8_t c = static_cast<uint8_t>(text[i]);
+
+			if (automaton.classOf[c] == 0) {
+				automaton.classOf[c] = static_cast<uint8_t>(classes++);
+			}
+			if (automaton.next[state][automaton.classOf[c]] == 0) {
+				automaton.next[state][automaton.classOf[c]] = static_cast<uint8_t>(states++);
+			}
+			state = automaton.next[state][automaton.classOf[c]];
+		}
+		automaton.output[state] = static_cast<uint8_t>(marker);
+		automaton.length[marker] = static_cast<uint8_t>(TextLength(text));
+	}
+
+	/* Breadth first, so the failure state of a node is complete before the node */
+	for (size_t c = 0; c < kClasses; c++) {
+		if (automaton.next[0][c] != 0) {
+			queue[tail++] = automaton.next[0][c];
+		}
+	}
+	while (head < tail) {
+		uint8_t state = queue[head++];
+
+		for (size_t c = 0; c < kClasses; c++) {
+			uint8_t child = automaton.next[state][c];
+			uint8_t fallback = automaton.next[fail[state]][c];
+
+			if (child == 0) {
+				automaton.next[state][c] = fallback;
+				continue;
+			}
+			fail[child] = fallback;
+			automaton.outputLink[child] =
+				automaton.output[fallback] != kNone ? fallback : automaton.outputLink[fallback];
+			queue[tail++] = child;
+		}
+	}
+
+	return automaton;
+}
+
+constexpr Automaton kAutomaton = BuildAutomaton();
+} /* namespace */
+
+void ShellMatcher::Scan(const char *data, size_t len)
+{
+	uint8_t state = 0;
+	size_t i;
+
+	mData = data;
+	mCount = 0;
+	memset(mFirst, kNoMatch, sizeof(mFirst));
+	for (i = 0; i < len; i++) {
+		state = kAutomaton.next[state][kAutomaton.classOf[static_cast<uint8_t>(data[i])]];
+
+		uint8_t found = kAutomaton.output[state] != kNone ? state : kAutomaton.outputLink[state];
+
+		for (; found != 0; found = kAutomaton.outputLink[found]) {
+			uint8_t marker = kAutomaton.output[found];
+
+			if (mCount == kMaxMatches) {
+				/* Leave the rest, including the marker ending here, to a scan after parsing */
+				mScanned = i + 1 - kAutomaton.length[marker];
+				while (mCount > 0 && mMatches[mCount - 1].end > mScanned) {
+					mCount--;
+				}
+				for (uint8_t &first : mFirst) {
+					first = first < mCount ? first : kNoMatch;
+				}
+				return;
+			}
+			if (mFirst[marker] == kNoMatch) {
+				mFirst[marker] = static_cast<uint8_t>(mCount);
+			}
+			mMatches[mCount++] = { static_cast<uint16_t>(i + 1), marker };
+		}
+	}
+	mScanned = len;
+}
+
+const char *ShellMatcher::Find(Marker_t marker, const char *from) const
+{
+	if (mFirst[marker] == kNoMatch) {
+		return nullptr;
+	}
+	for (size_t i = mFirst[marker]; i < mCount; i++) {
+		const char *start = GetStart(i);
+
+		if (mMatches[i].marker == marker && (from == nullptr || start >= from)) {
+			return start;
+		}
+	}
+
+	return nullptr;
+}
+
+size_t ShellMatcher::Length(Marker_t marker)
+{
+	return kAutomaton.length[marker];
+}
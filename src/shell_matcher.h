@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Finds all markers of the Zigbee shell output in one pass.
+ *
+ * The markers are the fixed texts the response handlers and notification
+ * parsers look for. They are compiled into an Aho-Corasick automaton at
+ * build time (see shell_matcher.cpp), so a scan reads each byte of the
+ * buffer once, whatever the number of markers. The handlers then look up
+ * the matches instead of searching the buffer again for each marker.
+ *
+ * A marker is added with an entry in Marker_t and its text in
+ * shell_matcher.cpp. A new notification also gets its parser in
+ * ZigbeeShell::sNotifications.
+ */
+class ShellMatcher {
+public:
+	enum Marker_t : uint8_t {
+		kMarker_Prompt,
+		kMarker_Done,
+		kMarker_Error,
+		kMarker_JoinNetwork,
+		kMarker_DeviceRejoin,
+		kMarker_RebootSignal,
+		kMarker_AttrReport,
+		kMarker_AttrReportValue,
+		kMarker_ExtPanId,
+		kMarker_PanId,
+		kMarker_SrcAddr,
+		kMarker_Ep,
+		kMarker_AppDevId,
+		kMarker_AttrId,
+		kMarker_AttrType,
+		kMarker_AttrValue,
+		kMarkerCount
+	};
+
+	/* A scan stops early when this many markers were found, see Scanned() */
+	static constexpr size_t kMaxMatches = 128;
+
+	void Scan(const char *data, size_t len);
+
+	/* First match of marker starting at or after from, its start in the data or nullptr */
+	const char *Find(Marker_t marker, const char *from = nullptr) const;
+
+	/* Matches in the order of their end */
+	size_t Count() const { return mCount; }
+	Marker_t GetMarker(size_t i) const { return static_cast<Marker_t>(mMatches[i].marker); }
+	const char *GetStart(size_t i) const { return mData + mMatches[i].end - Length(GetMarker(i)); }
+	const char *GetEnd(size_t i) const { return mData + mMatches[i].end; }
+
+	/* Bytes scanned, less than the length given to Scan() when kMaxMatches was reached */
+	size_t Scanned() const { return mScanned; }
+
+	static size_t Length(Marker_t marker);
+
+private:
+	static constexpr uint8_t kNoMatch = 0xff;
+
+	struct Match {
+		uint16_t end;
+		uint8_t marker;
+	};
+
+	const char *mData = nullptr;
+	size_t mScanned = 0;
+	size_t mCount = 0;
+	uint8_t mFirst[kMarkerCount];
+	Match mMatches[kMaxMatches];
+};
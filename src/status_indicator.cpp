@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "status_indicator.h"
+
+#include <dk_buttons_and_leds.h>
+
+int StatusIndicator::InitGpio()
+{
+	return dk_leds_init();
+}
+
+void StatusIndicator::Init(uint8_t led)
+{
+	mLed = led;
+	k_timer_init(&mTimer, TimerHandler, nullptr);
+	k_timer_user_data_set(&mTimer, this);
+	Set(false);
+}
+
+void StatusIndicator::Set(bool on)
+{
+	k_timer_stop(&mTimer);
+	mOnTimeMs = 0;
+	mOffTimeMs = 0;
+	Apply(on);
+}
+
+void StatusIndicator::Blink(uint32_t onTimeMs, uint32_t offTimeMs)
+{
+	/* Keep the phase when the same pattern is requested again */
+	if (onTimeMs == mOnTimeMs && offTimeMs == mOffTimeMs) {
+		return;
+	}
+
+	k_timer_stop(&mTimer);
+	mOnTimeMs = onTimeMs;
+	mOffTimeMs = offTimeMs;
+	Apply(true);
+	k_timer_start(&mTimer, K_MSEC(mOnTimeMs), K_NO_WAIT);
+}
+
+void StatusIndicator::Apply(bool on)
+{
+	mOn = on;
+	dk_set_led(mLed, on);
+}
+
+void StatusIndicator::TimerHandler(struct k_timer *timer)
+{
+	StatusIndicator *indicator = static_cast<StatusIndicator *>(k_timer_user_data_get(timer));
+
+	indicator->Apply(!indicator->mOn);
+	k_timer_start(timer, K_MSEC(indicator->mOn ? indicator->mOnTimeMs : indicator->mOffTimeMs), K_NO_WAIT);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+/*
+ * LED driven by its own kernel timer.
+ *
+ * Blink transitions are done in the timer expiry function, so a blinking
+ * LED costs no app events and no thread wake-ups. Callers only set the
+ * pattern, which can be done from any thread.
+ */
+class StatusIndicator {
+public:
+	static int InitGpio();
+
+	void Init(uint8_t led);
+	void Set(bool on);
+	void Blink(uint32_t onTimeMs, uint32_t offTimeMs);
+
+private:
+	static void TimerHandler(struct k_timer *timer);
+	void Apply(bool on);
+
+	struct k_timer mTimer;
+	uint32_t mOnTimeMs = 0;
+	uint32_t mOffTimeMs = 0;
+	uint8_t mLed = 0;
+	bool mOn = false;
+};
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "subscription_tracker.h"
+
+namespace {
+
+/* The attributes of a bridged device the bridge reports */
+struct AttributePath {
+	uint32_t cluster;
+	uint32_t attribute;
+	uint8_t bit;
+};
+
+constexpr AttributePath kAttributePaths[] = {
+	/* Bridged Device Basic: Reachable, NodeLabel */
+	{ 0x0039, 0x0011, SubscriptionTracker::kAttribute_Reachable },
+	{ 0x0039, 0x0005, SubscriptionTracker::kAttribute_Name },
+	/* On/Off: OnOff */
+	{ 0x0006, 0x0000, SubscriptionTracker::kAttribute_OnOff },
+	/* Fixed Label: LabelList */
+	{ 0x0040, 0x0000, SubscriptionTracker::kAttribute_Location },
+};
+
+} /* namespace */
+
+void SubscriptionTracker::Init(Slot *slots, size_t count)
+{
+	mSlots = slots;
+	mCount = count;
+	for (size_t i = 0; i < count; i++) {
+		slots[i] = Slot{};
+	}
+	mAll = {};
+}
+
+void SubscriptionTracker::Update(uint8_t *subscribers, uint8_t attributes, bool add)
+{
+	for (size_t i = 0; i < kAttributeCount; i++) {
+		if (!(attributes & BIT(i))) {
+			continue;
+		}
+		if (add) {
+			__ASSERT_NO_MSG(subscribers[i] < UINT8_MAX);
+			subscribers[i]++;
+		} else {
+			__ASSERT_NO_MSG(subscribers[i] > 0);
+			subscribers[i]--;
+		}
+	}
+}
+
+void SubscriptionTracker::Add(size_t index, uint8_t attributes)
+{
+	__ASSERT_NO_MSG(index == kAllDevices || index < mCount);
+	Update(index == kAllDevices ? mAll.subscribers : mSlots[index].subscribers, attributes, true);
+}
+
+void SubscriptionTracker::Remove(size_t index, uint8_t attributes)
+{
+	__ASSERT_NO_MSG(index == kAllDevices || index < mCount);
+	Update(index == kAllDevices ? mAll.subscribers : mSlots[index].subscribers, attributes, false);
+}
+
+uint8_t SubscriptionTracker::Subscribed(size_t index, uint8_t attributes) const
+{
+	uint8_t subscribed = 0;
+
+	__ASSERT_NO_MSG(index < mCount);
+	for (size_t i = 0; i < kAttributeCount; i++) {
+		if (mSlots[index].subscribers[i] > 0 || mAll.subscribers[i] > 0) {
+			subscribed |= BIT(i);
+		}
+	}
+
+	return subscribed & attributes;
+}
+
+uint32_t SubscriptionTracker::GetPathCount() const
+{
+	uint32_t paths = 0;
+
+	for (size_t i = 0; i < kAttributeCount; i++) {
+		paths += mAll.subscribers[i] > 0;
+		for (size_t j = 0; j < mCount; j++) {
+			paths += mSlots[j].subscribers[i] > 0;
+		}
+	}
+
+	return paths;
+}
+
+uint8_t SubscriptionTracker::AttributesOf(uint32_t cluster, uint32_t attribute)
+{
+	uint8_t attributes = 0;
+
+	for (const AttributePath &path : kAttributePaths) {
+		if ((cluster == kWildcardId || cluster == path.cluster) &&
+		    (attribute == kWildcardId || attribute == path.attribute)) {
+			attributes |= path.bit;
+		}
+	}
+
+	return attributes;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+/*
+ * Matter subscriptions to the attributes of the bridged devices.
+ *
+ * Counts, for each device and each attribute the bridge reports, the
+ * subscriptions whose paths cover it. A path with a wildcard endpoint is
+ * counted once for all devices, including the ones added later. The CHIP
+ * thread updates the counts as subscriptions are established and
+ * terminated, and tells the app task, which reads them to spend the
+ * Zigbee airtime on what someone is watching. The ReportLimiter reads them
+ * with the CHIP stack lock held to report only what someone is watching.
+ */
+class SubscriptionTracker {
+public:
+	/* Bits of the attributes, the same as the Device::Changed_t bits that report them */
+	enum Attribute_t : uint8_t {
+		kAttribute_Reachable = 0x01,
+		kAttribute_OnOff = 0x02,
+		kAttribute_Location = 0x04,
+		kAttribute_Name = 0x08,
+	};
+	static constexpr size_t kAttributeCount = 4;
+	static constexpr uint8_t kAllAttributes = (1 << kAttributeCount) - 1;
+	/* Index of all devices, for a path with a wildcard endpoint */
+	static constexpr size_t kAllDevices = SIZE_MAX;
+	/* Cluster or attribute id of a wildcard path, as in CHIP */
+	static constexpr uint32_t kWildcardId = UINT32_MAX;
+
+	struct Slot {
+		uint8_t subscribers[kAttributeCount];
+	};
+
+	/* The counts of device index i are slots[i] */
+	void Init(Slot *slots, size_t count);
+
+	/* A subscription to the attributes of the device index, or kAllDevices, started or ended */
+	void Add(size_t index, uint8_t attributes);
+	void Remove(size_t index, uint8_t attributes);
+
+	/* The attributes out of the mask with at least one subscriber */
+	uint8_t Subscribed(size_t index, uint8_t attributes) const;
+	/* Number of paths with a subscriber, counting a wildcard endpoint once */
+	uint32_t GetPathCount() const;
+
+	/* The attributes a path covers, from its cluster and attribute ids */
+	static uint8_t AttributesOf(uint32_t cluster, uint32_t attribute);
+
+private:
+	void Update(uint8_t *subscribers, uint8_t attributes, bool add);
+
+	Slot *mSlots = nullptr;
+	size_t mCount = 0;
+	Slot mAll = {};
+};
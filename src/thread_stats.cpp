@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "thread_stats.h"
+
+#include <cstring>
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(app);
+
+namespace ThreadStats {
+namespace {
+struct Sample {
+	const struct k_thread *thread;
+	uint64_t cycles;
+	uint16_t cpuPermille;
+};
+
+Sample sSamples[kMaxThreads];
+size_t sSampleCount;
+uint64_t sLastTotalCycles;
+struct k_work_delayable sSampleWork;
+
+struct CollectContext {
+	Info *info;
+	size_t maxCount;
+	size_t count;
+};
+
+Sample *FindSample(const struct k_thread *thread)
+{
+	for (size_t i = 0; i < sSampleCount; i++) {
+		if (sSamples[i].thread == thread) {
+			return &sSamples[i];
+		}
+	}
+
+	return nullptr;
+}
+
+const char *ThreadName(const struct k_thread *thread)
+{
+	const char *name = k_thread_name_get(const_cast<k_tid_t>(thread));
+
+	return (name != nullptr && name[0] != '\0') ? name : "unknown";
+}
+
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+struct SampleContext {
+	Sample samples[kMaxThreads];
+	size_t count;
+	uint64_t totalDelta;
+};
+
+void SampleThread(const struct k_thread *thread, void *userData)
+{
+	SampleContext *ctx = static_cast<SampleContext *>(userData);
+	k_thread_runtime_stats_t stats;
+	Sample *previous = FindSample(thread);
+
+	if (ctx->count >= kMaxThreads ||
+	    k_thread_runtime_stats_get(const_cast<k_tid_t>(thread), &stats) != 0) {
+		return;
+	}
+
+	Sample &sample = ctx->samples[ctx->count++];
+
+	sample.thread = thread;
+	sample.cycles = stats.execution_cycles;
+	sample.cpuPermille = 0;
+	if (previous != nullptr && ctx->totalDelta > 0) {
+		sample.cpuPermille = static_cast<uint16_t>(
+			MIN(1000, (sample.cycles - previous->cycles) * 1000 / ctx->totalDelta));
+	}
+}
+#endif
+
+void SampleWorkHandler(struct k_work *work)
+{
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+	static SampleContext ctx;
+	k_thread_runtime_stats_t all;
+
+	if (k_thread_runtime_stats_all_get(&all) == 0) {
+		ctx.count = 0;
+		ctx.totalDelta = all.execution_cycles - sLastTotalCycles;
+		sLastTotalCycles = all.execution_cycles;
+		k_thread_foreach(SampleThread, &ctx);
+		memcpy(sSamples, ctx.samples, sizeof(sSamples[0]) * ctx.count);
+		sSampleCount = ctx.count;
+	}
+#endif
+	k_work_schedule(&sSampleWork, K_MSEC(CONFIG_BRIDGE_THREAD_STATS_PERIOD_MS));
+}
+
+void CollectThread(const struct k_thread *thread, void *userData)
+{
+	CollectContext *ctx = static_cast<CollectContext *>(userData);
+	size_t unused = 0;
+
+	if (ctx->count++ >= ctx->maxCount) {
+		return;
+	}
+
+	Info &info = ctx->info[ctx->count - 1];
+	const Sample *sample = FindSample(thread);
+
+	memset(&info, 0, sizeof(info));
+	info.Id = reinterpret_cast<uintptr_t>(thread);
+	strncpy(info.Name, ThreadName(thread), sizeof(info.Name) - 1);
+	info.CpuPermille = sample ? sample->cpuPermille : 0;
+#ifdef CONFIG_THREAD_STACK_INFO
+	info.StackSize = thread->stack_info.size;
+	if (k_thread_stack_space_get(thread, &unused) == 0) {
+		info.StackFreeMinimum = unused;
+	}
+#ifdef CONFIG_ARM
+	/* The saved process stack pointer tells how much is free right now */
+	if (thread != k_current_get()) {
+		info.StackFreeCurrent = thread->callee_saved.psp - thread->stack_info.start;
+	} else {
+		info.StackFreeCurrent = reinterpret_cast<uintptr_t>(&unused) - thread->stack_info.start;
+	}
+#else
+	info.StackFreeCurrent = info.StackFreeMinimum;
+#endif
+#endif
+}
+} /* namespace */
+
+void Init()
+{
+	k_work_init_delayable(&sSampleWork, SampleWorkHandler);
+	k_work_schedule(&sSampleWork, K_NO_WAIT);
+}
+
+size_t Collect(Info *info, size_t maxCount)
+{
+	CollectContext ctx = { info, maxCount, 0 };
+
+	k_thread_foreach(CollectThread, &ctx);
+
+	return MIN(ctx.count, maxCount);
+}
+
+uint16_t CpuPermille(const char *name)
+{
+	for (size_t i = 0; i < sSampleCount; i++) {
+		if (!strcmp(ThreadName(sSamples[i].thread), name)) {
+			return sSamples[i].cpuPermille;
+		}
+	}
+
+	return 0;
+}
+
+} /* namespace ThreadStats */
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zephyr.h>
+
+/*
+ * Per-thread resource usage of the bridge.
+ *
+ * A delayed work item samples the runtime statistics of every thread once
+ * per CONFIG_BRIDGE_THREAD_STATS_PERIOD_MS, so the CPU share of a thread is
+ * the one of the last complete period. Stack usage is measured when the
+ * statistics are collected.
+ */
+namespace ThreadStats {
+
+static constexpr size_t kMaxThreads = 24;
+static constexpr size_t kNameSize = 16;
+
+struct Info {
+	uint64_t Id;
+	char Name[kNameSize];
+	uint32_t StackSize;
+	uint32_t StackFreeCurrent;
+	uint32_t StackFreeMinimum;
+	/* Share of the CPU in the last sampling period, in 1/1000 */
+	uint16_t CpuPermille;
+};
+
+void Init();
+
+/* Fill up to maxCount entries and return the number of threads found */
+size_t Collect(Info *info, size_t maxCount);
+
+/* CPU share of the thread with the given name in the last period, in 1/1000 */
+uint16_t CpuPermille(const char *name);
+
+} /* namespace ThreadStats */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "timing_wheel.h"
+
+void TimingWheel::Init(uint32_t now)
+{
+	for (auto &level : mSlots) {
+		for (Node &slot : level) {
+			InitList(&slot);
+		}
+	}
+	InitList(&mExpired);
+	mNow = now;
+}
+
+void TimingWheel::Append(Node *head, Node *node)
+{
+	node->next = head;
+	node->prev = head->prev;
+	head->prev->next = node;
+	head->prev = node;
+}
+
+void TimingWheel::Unlink(Node *node)
+{
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->next = nullptr;
+	node->prev = nullptr;
+}
+
+void TimingWheel::Insert(Node *node)
+{
+	uint32_t delta = node->expires - mNow;
+	uint32_t level = 0;
+
+	/* A level spans kSlots slots of the level below, so the slot is found from the expiry alone */
+	while (level + 1 < kLevels && delta >= (1u << (kLevelBits * (level + 1)))) {
+		level++;
+	}
+	Append(&mSlots[level][(node->expires >> (kLevelBits * level)) & (kSlots - 1)], node);
+}
+
+void TimingWheel::Schedule(Node *node, uint32_t ticks)
+{
+	if (IsScheduled(node)) {
+		Unlink(node);
+	}
+	node->expires = mNow + MIN(MAX(ticks, 1u), kMaxTicks);
+	Insert(node);
+}
+
+void TimingWheel::Cancel(Node *node)
+{
+	if (IsScheduled(node)) {
+		Unlink(node);
+	}
+}
+
+void TimingWheel::Cascade(uint32_t level)
+{
+	Node *slot = &mSlots[level][(mNow >> (kLevelBits * level)) & (kSlots - 1)];
+
+	while (slot->next != slot) {
+		Node *node = slot->next;
+
+		Unlink(node);
+		Insert(node);
+	}
+}
+
+void TimingWheel::Advance(uint32_t now)
+{
+	while (static_cast<int32_t>(now - mNow) > 0) {
+		Node *slot;
+
+		mNow++;
+		/* The slots above the lowest one are due when the levels below wrap, highest first */
+		for (uint32_t level = kLevels - 1; level > 0; level--) {
+			if ((mNow & ((1u << (kLevelBits * level)) - 1)) == 0) {
+				Cascade(level);
+			}
+		}
+
+		slot = &mSlots[0][mNow & (kSlots - 1)];
+		while (slot->next != slot) {
+			Node *node = slot->next;
+
+			Unlink(node);
+			Append(&mExpired, node);
+		}
+	}
+}
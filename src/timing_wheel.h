@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <zephyr.h>
+
+/*
+ * Hierarchical timing wheel of intrusive nodes.
+ *
+ * Three levels of 64 slots cover 64, 4096 and 262144 ticks. A node is
+ * linked into the slot of its expiry tick on the lowest level that
+ * reaches it, so scheduling and cancelling are O(1) whatever the number
+ * of nodes. When the lower level wraps, the next slot of the level above
+ * is redistributed below it. Expired nodes are moved to a list, in the
+ * order of their expiry, where they stay until taken or rescheduled.
+ *
+ * Not thread safe, the owner serializes the calls.
+ */
+class TimingWheel {
+public:
+	struct Node {
+		Node *next;
+		Node *prev;
+		uint32_t expires;
+	};
+
+	static constexpr uint32_t kLevelBits = 6;
+	static constexpr uint32_t kSlots = 1 << kLevelBits;
+	static constexpr uint32_t kLevels = 3;
+	/* Longer delays are cut to this */
+	static constexpr uint32_t kMaxTicks = (1 << (kLevelBits * kLevels)) - 1;
+
+	void Init(uint32_t now);
+
+	/* Expires ticks after the current tick, at least one, rescheduling a scheduled node */
+	void Schedule(Node *node, uint32_t ticks);
+	/* Takes the node off the wheel or the expired list */
+	void Cancel(Node *node);
+	static bool IsScheduled(const Node *node) { return node->next != nullptr; }
+
+	/* Moves the nodes expiring up to tick now to the expired list */
+	void Advance(uint32_t now);
+	/* The node expired first, or nullptr, left on the list */
+	Node *PeekExpired() const { return mExpired.next != &mExpired ? mExpired.next : nullptr; }
+
+	uint32_t Now() const { return mNow; }
+
+private:
+	static void InitList(Node *head) { head->next = head->prev = head; }
+	static void Append(Node *head, Node *node);
+	static void Unlink(Node *node);
+
+	/* Links the node into its slot for the current tick */
+	void Insert(Node *node);
+	/* Reinserts the nodes of a slot on the levels below */
+	void Cascade(uint32_t level);
+
+	Node mSlots[kLevels][kSlots];
+	Node mExpired;
+	uint32_t mNow;
+};
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "trace.h"
+
+#include <cstring>
+#include <zephyr.h>
+#include <sys/atomic.h>
+
+namespace Trace {
+namespace {
+constexpr size_t kRingCount = CONFIG_BRIDGE_TRACE_RING_COUNT;
+constexpr size_t kRingSize = CONFIG_BRIDGE_TRACE_RING_SIZE;
+constexpr size_t kOwnerNameSize = 16;
+constexpr uint8_t kVersion = 1;
+
+static_assert(kRingCount >= 3, "Trace needs an ISR ring, a shared ring and at least one thread ring");
+static_assert((kRingSize & (kRingSize - 1)) == 0, "Trace ring size must be a power of two");
+
+/* Ring 0 is written from interrupts, the last one by threads that found no free ring */
+constexpr size_t kIsrRing = 0;
+constexpr size_t kSharedRing = kRingCount - 1;
+
+struct Ring {
+	atomic_t owner;
+	atomic_t head;
+	Record records[kRingSize];
+};
+
+struct ImageHeader {
+	char magic[4];
+	uint8_t version;
+	uint8_t ringCount;
+	uint8_t recordSize;
+	uint8_t reserved;
+	uint32_t cyclesPerSecond;
+};
+
+struct RingHeader {
+	char owner[kOwnerNameSize];
+	uint32_t head;
+	uint32_t capacity;
+};
+
+constexpr size_t kRingImageSize = sizeof(RingHeader) + sizeof(Record) * kRingSize;
+
+Ring sRings[kRingCount];
+
+Ring &CurrentRing()
+{
+	if (k_is_in_isr()) {
+		return sRings[kIsrRing];
+	}
+
+	atomic_val_t self = reinterpret_cast<atomic_val_t>(k_current_get());
+
+	for (size_t i = kIsrRing + 1; i < kSharedRing; i++) {
+		if (atomic_get(&sRings[i].owner) == self) {
+			return sRings[i];
+		}
+	}
+	/* A ring released before the one of the thread could be claimed twice, so it is claimed after the search */
+	for (size_t i = kIsrRing + 1; i < kSharedRing; i++) {
+		if (atomic_cas(&sRings[i].owner, 0, self)) {
+			return sRings[i];
+		}
+	}
+
+	return sRings[kSharedRing];
+}
+
+bool IsShared(const Ring &ring)
+{
+	return &ring == &sRings[kIsrRing] || &ring == &sRings[kSharedRing];
+}
+
+void FillRingHeader(size_t index, RingHeader &header)
+{
+	const Ring &ring = sRings[index];
+	k_tid_t owner = reinterpret_cast<k_tid_t>(atomic_get(&ring.owner));
+	const char *name = (index == kIsrRing) ? "isr" : (index == kSharedRing) ? "shared" : "";
+
+	memset(&header, 0, sizeof(header));
+#ifdef CONFIG_THREAD_NAME
+	if (owner != nullptr) {
+		name = k_thread_name_get(owner);
+	}
+#endif
+	strncpy(header.owner, name, sizeof(header.owner) - 1);
+	header.head = atomic_get(&ring.head);
+	header.capacity = kRingSize;
+}
+
+size_t CopyWindow(const void *src, size_t srcSize, size_t offset, uint8_t *buf, size_t len)
+{
+	if (offset >= srcSize) {
+		return 0;
+	}
+	len = MIN(len, srcSize - offset);
+	memcpy(buf, static_cast<const uint8_t *>(src) + offset, len);
+
+	return len;
+}
+} /* namespace */
+
+void Emit(EventId id, uint16_t arg0, uint32_t arg1, uint32_t arg2)
+{
+	Ring &ring = CurrentRing();
+	bool shared = IsShared(ring);
+	uint32_t slot = shared ? atomic_inc(&ring.head) : atomic_get(&ring.head);
+	Record &record = ring.records[slot & (kRingSize - 1)];
+
+	/* The id commits the record, a reader of a shared ring sees the slot empty until it is complete */
+	record.Id = kEvent_None;
+	compiler_barrier();
+	record.Timestamp = k_cycle_get_32();
+	record.Arg0 = arg0;
+	record.Arg1 = arg1;
+	record.Arg2 = arg2;
+	compiler_barrier();
+	/* Writers that went a whole lap round the ring meanwhile may have mixed their stores into it */
+	if (!shared || static_cast<uint32_t>(atomic_get(&ring.head)) - slot <= kRingSize) {
+		record.Id = id;
+	}
+
+	/* A ring owned by one thread is published only after the record is complete */
+	if (!shared) {
+		atomic_set(&ring.head, slot + 1);
+	}
+}
+
+void ReleaseRing()
+{
+	atomic_val_t self = reinterpret_cast<atomic_val_t>(k_current_get());
+
+	for (size_t i = kIsrRing + 1; i < kSharedRing; i++) {
+		if (atomic_cas(&sRings[i].owner, self, 0)) {
+			return;
+		}
+	}
+}
+
+void Clear()
+{
+	for (auto &ring : sRings) {
+		atomic_set(&ring.head, 0);
+		memset(ring.records, 0, sizeof(ring.records));
+	}
+}
+
+size_t Size()
+{
+	return sizeof(ImageHeader) + kRingCount * kRingImageSize;
+}
+
+size_t Read(size_t offset, uint8_t *buf, size_t len)
+{
+	size_t copied = 0;
+
+	if (offset < sizeof(ImageHeader)) {
+		ImageHeader header = { { 'B', 'T', 'R', 'C' },
+				       kVersion,
+				       kRingCount,
+				       sizeof(Record),
+				       0,
+				       sys_clock_hw_cycles_per_sec() };
+
+		copied = CopyWindow(&header, sizeof(header), offset, buf, len);
+	}
+
+	while (copied < len && offset + copied < Size()) {
+		size_t pos = offset + copied - sizeof(ImageHeader);
+		size_t index = pos / kRingImageSize;
+		size_t ringOffset = pos % kRingImageSize;
+
+		if (ringOffset < sizeof(RingHeader)) {
+			RingHeader header;
+
+			FillRingHeader(index, header);
+			copied += CopyWindow(&header, sizeof(header), ringOffset, buf + copied, len - copied);
+		} else {
+			copied += CopyWindow(sRings[index].records, sizeof(sRings[index].records),
+					     ringOffset - sizeof(RingHeader), buf + copied, len - copied);
+		}
+	}
+
+	return copied;
+}
+
+} /* namespace Trace */
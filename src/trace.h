@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zephyr.h>
+
+/*
+ * Binary event trace for the bridge hot paths.
+ *
+ * Each event is a fixed 16-byte record (cycle timestamp, event id and three
+ * integer arguments) written into a ring buffer owned by the calling thread,
+ * so emitting one costs a few stores and no formatting. Interrupt handlers
+ * and threads that find no free ring share rings with atomic slot
+ * reservation, and a thread that exits gives its ring back. The event id of
+ * a record is written last, so a record still being written, or cut by a
+ * writer that reused its slot, reads as kEvent_None and is skipped. The
+ * rings overwrite their oldest records and can be read out
+ * at any time through Read(); scripts/trace_decode.py turns a dump into a
+ * timeline. Keep the event ids below in sync with that script.
+ */
+namespace Trace {
+
+enum EventId : uint16_t {
+	kEvent_None = 0,
+	kEvent_ReadOnOff,		/* endpoint, attribute id, max read length */
+	kEvent_ReadBridgedBasic,	/* endpoint, attribute id, max read length */
+	kEvent_WriteOnOff,		/* endpoint, attribute id, value */
+	kEvent_DeviceOnOff,		/* endpoint, on */
+	kEvent_DeviceOnOffPending,	/* endpoint, on, sequence */
+	kEvent_DeviceRollback,		/* endpoint, on, sequence */
+	kEvent_UartRx,			/* length, ring buffer bytes used */
+	kEvent_UartTx,			/* length */
+	kEvent_ShellParsed,		/* bytes parsed, bytes available */
+	kEvent_ZclCmd,			/* short address, endpoint << 16 | cluster, command id */
+	kEvent_ZclAttrRead,		/* short address, endpoint << 16 | cluster, attribute id */
+	kEvent_ZclAttrValue,		/* attribute id, type, value length */
+	kEvent_ZigbeeEvent,		/* ZigbeeShell::Event_t */
+	kEvent_UartRxStall,		/* RX buffers held, flow control */
+	kEvent_ShellResync,		/* bytes dropped, cause */
+	kEventCount
+};
+
+struct Record {
+	uint32_t Timestamp;
+	uint16_t Id;
+	uint16_t Arg0;
+	uint32_t Arg1;
+	uint32_t Arg2;
+};
+
+static_assert(sizeof(Record) == 16, "Trace record layout is shared with scripts/trace_decode.py");
+
+void Emit(EventId id, uint16_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0);
+
+/* Frees the ring of the calling thread before it exits, its records stay until the next owner overwrites them */
+void ReleaseRing();
+
+/* Drop all recorded events */
+void Clear();
+
+/*
+ * The trace is read as one serialized image:
+ *
+ *   header: "BTRC", version, ring count, record size, 0, cycles per second
+ *   per ring: owner thread name (16 bytes), head, capacity, records
+ *
+ * Read() copies a window of that image without stopping the writers, so
+ * a dump can be taken in chunks from any context.
+ */
+size_t Size();
+size_t Read(size_t offset, uint8_t *buf, size_t len);
+
+} /* namespace Trace */
+
+#ifdef CONFIG_BRIDGE_TRACE
+#define TRACE(...) Trace::Emit(__VA_ARGS__)
+#define TRACE_RELEASE_RING() Trace::ReleaseRing()
+#else
+#define TRACE(...)
+#define TRACE_RELEASE_RING()
+#endif
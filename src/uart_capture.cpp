@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "uart_capture.h"
+
+#include <cstring>
+#include <zephyr.h>
+
+namespace UartCapture {
+namespace {
+constexpr size_t kBufferSize = CONFIG_BRIDGE_UART_CAPTURE_SIZE;
+constexpr uint8_t kVersion = 1;
+
+static_assert(kBufferSize % 4 == 0, "Capture buffer size must be a multiple of four");
+
+struct ImageHeader {
+	char magic[4];
+	uint8_t version;
+	uint8_t reserved[3];
+	uint32_t cyclesPerSecond;
+	uint32_t length;
+	uint32_t dropped;
+};
+
+uint32_t sBuffer[kBufferSize / sizeof(uint32_t)];
+size_t sLength;
+uint32_t sDropped;
+
+size_t CopyWindow(const void *src, size_t srcSize, size_t offset, uint8_t *buf, size_t len)
+{
+	if (offset >= srcSize) {
+		return 0;
+	}
+	len = MIN(len, srcSize - offset);
+	memcpy(buf, static_cast<const uint8_t *>(src) + offset, len);
+
+	return len;
+}
+} /* namespace */
+
+void Append(Direction direction, const uint8_t *data, size_t len)
+{
+	size_t size = sizeof(Record) + ROUND_UP(len, 4);
+	/* Written from the UART interrupt and from threads */
+	unsigned int key = irq_lock();
+
+	if (len > UINT16_MAX || sLength + size > kBufferSize) {
+		sDropped++;
+	} else {
+		uint8_t *pos = reinterpret_cast<uint8_t *>(sBuffer) + sLength;
+		Record record = { k_cycle_get_32(), static_cast<uint16_t>(len), direction, 0 };
+
+		memcpy(pos, &record, sizeof(record));
+		memcpy(pos + sizeof(record), data, len);
+		sLength += size;
+	}
+	irq_unlock(key);
+}
+
+void Clear()
+{
+	unsigned int key = irq_lock();
+
+	sLength = 0;
+	sDropped = 0;
+	irq_unlock(key);
+}
+
+size_t Size()
+{
+	return sizeof(ImageHeader) + sLength;
+}
+
+size_t Read(size_t offset, uint8_t *buf, size_t len)
+{
+	unsigned int key = irq_lock();
+	ImageHeader header = { { 'B', 'C', 'A', 'P' },
+			       kVersion,
+			       { 0 },
+			       sys_clock_hw_cycles_per_sec(),
+			       static_cast<uint32_t>(sLength),
+			       sDropped };
+	size_t copied = 0;
+
+	if (offset < sizeof(header)) {
+		copied = CopyWindow(&header, sizeof(header), offset, buf, len);
+	}
+	copied += CopyWindow(sBuffer, sLength, offset + copied - sizeof(header), buf + copied, len - copied);
+	irq_unlock(key);
+
+	return copied;
+}
+
+} /* namespace UartCapture */
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Capture of the raw Zigbee NCP UART traffic.
+ *
+ * Every RX chunk delivered by the UART driver and every command written
+ * to the NCP is appended with its cycle timestamp to a RAM buffer. The
+ * capture stops when the buffer is full, so it always holds the traffic
+ * from boot or from the last Clear(), which is what a replay needs to
+ * rebuild the parser state. The uart_replay tool of the host build feeds
+ * a capture back into the transport to check and time the parser.
+ */
+namespace UartCapture {
+
+enum Direction : uint8_t {
+	kDirection_Rx = 1,
+	kDirection_Tx = 2,
+};
+
+/* Followed by Length bytes of data, padded to a multiple of four */
+struct Record {
+	uint32_t Timestamp;
+	uint16_t Length;
+	uint8_t Direction;
+	uint8_t Reserved;
+};
+
+static_assert(sizeof(Record) == 8, "Capture record layout is shared with sim/app/capture_file.cpp");
+
+void Append(Direction direction, const uint8_t *data, size_t len);
+
+/* Drop the captured traffic and start capturing again */
+void Clear();
+
+/*
+ * The capture is read as one serialized image:
+ *
+ *   header: "BCAP", version, 0, 0, 0, cycles per second, records length,
+ *           records dropped because the buffer was full
+ *   records
+ */
+size_t Size();
+size_t Read(size_t offset, uint8_t *buf, size_t len);
+
+} /* namespace UartCapture */
+
+#ifdef CONFIG_BRIDGE_UART_CAPTURE
+#define UART_CAPTURE(...) UartCapture::Append(__VA_ARGS__)
+#else
+#define UART_CAPTURE(...)
+#endif
@@ -0,0 +1,684 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "zigbee_bridge.h"
+#include "latency_stats.h"
+#include "trace.h"
+
+#include <logging/log.h>
+
+LOG_MODULE_DECLARE(app);
+
+#define ZB_HA_DIMMABLE_LIGHT_DEVICE_ID  0x0101
+#define ZB_AF_HA_PROFILE_ID		0x0104
+
+ZigbeeBridge *ZigbeeBridge::sInstance;
+
+void ZigbeeBridge::Init(const Storage &storage, Delegate &delegate)
+{
+	Init(storage, delegate, Config{});
+}
+
+void ZigbeeBridge::Init(const Storage &storage, Delegate &delegate, const Config &config)
+{
+	sInstance = this;
+	mDelegate = &delegate;
+	mDevices = storage.devices;
+	mCount = storage.count;
+	mBreakers = storage.breakers;
+	mReported = storage.reported;
+	mStateRead = storage.stateRead;
+	mStateOn = storage.stateOn;
+
+	mEventQueue.Init();
+	mDeviceCmdQueue.Init(storage.cmdSlots, storage.count);
+	mDiscovery.Init(storage.discoverySlots, storage.count * DiscoveryQueue::kSlotsPerDevice);
+	mReadBudget.Init(config.readsPerSecond);
+	mLiveness.Init(storage.livenessSlots, storage.count, mReadBudget, config.liveness);
+	mPoll.Init(storage.pollSlots, storage.count, mReadBudget, config.poll);
+	mSubscriptions.Init(storage.subscriptionSlots, storage.count);
+	mReports.Init(storage.reportSlots, storage.count, mSubscriptions, config.report);
+
+	/* Whenever a bridged device changes its state */
+	for (size_t i = 0; i < mCount; i++) {
+		mDevices[i].SetChangeCallback([this](Device *dev, Device::Changed_t changed) { StatusChanged(dev, changed); });
+	}
+
+	k_timer_init(&mLivenessTimer, LivenessTimerHandler, nullptr);
+	k_timer_start(&mLivenessTimer, K_MSEC(config.liveness.tickMs), K_MSEC(config.liveness.tickMs));
+	k_timer_init(&mPollTimer, PollTimerHandler, nullptr);
+	k_timer_start(&mPollTimer, K_MSEC(config.poll.tickMs), K_MSEC(config.poll.tickMs));
+	k_timer_init(&mReportTimer, ReportTimerHandler, nullptr);
+	k_timer_start(&mReportTimer, K_MSEC(config.report.tickMs), K_MSEC(config.report.tickMs));
+}
+
+void ZigbeeBridge::Start()
+{
+	mShell.SetEventCallback(ZigbeeEventHandler);
+	mShell.StartAsync();
+}
+
+int ZigbeeBridge::PostEvent(const AppEvent &event)
+{
+	AppEventQueue::Lane lane = AppEventQueue::kLane_Control;
+	int ret;
+
+	switch (event.Type) {
+	case AppEvent::NetworkRejoin:
+	case AppEvent::SimpleDescRsp:
+		lane = AppEventQueue::kLane_Discovery;
+		break;
+	case AppEvent::LivenessTimer:
+	case AppEvent::PollTimer:
+	case AppEvent::SubscriptionsChanged:
+	case AppEvent::ReportTimer:
+		lane = AppEventQueue::kLane_Housekeeping;
+		break;
+	default:
+		break;
+	}
+
+	ret = mEventQueue.Post(event, lane);
+	if (ret) {
+		LOG_WRN("App event %u dropped, %s lane full", event.Type,
+			AppEventQueue::LaneName(lane));
+	}
+
+	return ret;
+}
+
+void ZigbeeBridge::ReleaseEvent(const AppEvent &event)
+{
+	switch (event.Type) {
+	case AppEvent::NetworkRejoin:
+	case AppEvent::SimpleDescRsp:
+	case AppEvent::StartNetworkSteering:
+	case AppEvent::ZigbeeReady:
+		ZigbeeShell::UnrefEvent(event.Zigbee);
+		break;
+	default:
+		break;
+	}
+}
+
+void ZigbeeBridge::PostZigbeeEvent(AppEvent::ZigbeeShellEventType type, ZigbeeShell::EventPayload *payload)
+{
+	/* The reference taken here is owned by the queued event */
+	ZigbeeShell::RefEvent(payload);
+	if (sInstance->PostEvent(AppEvent{ type, payload })) {
+		ZigbeeShell::UnrefEvent(payload);
+	}
+}
+
+void ZigbeeBridge::Dispatch(const AppEvent &event)
+{
+	int err;
+
+	switch (event.Type) {
+	case AppEvent::DiscoveryReady:
+		if (!mZigbeeReady) {
+			/* The entries wait for the NCP, ZigbeeReadyHandler() takes them */
+			return;
+		}
+		break;
+	case AppEvent::SimpleDescRsp:
+	case AppEvent::StartNetworkSteering:
+		if (!mZigbeeReady) {
+			/* Discovery is restarted by the network rejoin handled once the NCP is ready */
+			LOG_WRN("Zigbee NCP not ready, event %u ignored", event.Type);
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+
+	switch (event.Type) {
+	case AppEvent::LivenessTimer:
+		LivenessProbeHandler();
+		break;
+	case AppEvent::PollTimer:
+		PollHandler();
+		break;
+	case AppEvent::SubscriptionsChanged:
+		SubscriptionsChangedHandler();
+		break;
+	case AppEvent::ReportTimer:
+		ReportHandler();
+		break;
+	case AppEvent::NetworkRejoin:
+		NetworkRejoinHandler();
+		break;
+	case AppEvent::DiscoveryReady:
+		DiscoveryReadyHandler();
+		break;
+	case AppEvent::StateReady:
+		StateReadyHandler();
+		break;
+	case AppEvent::SimpleDescRsp:
+		SimpleDescRspHandler(event);
+		break;
+	case AppEvent::ZigbeeReady:
+		ZigbeeReadyHandler();
+		break;
+	case AppEvent::StartNetworkSteering:
+		err = mShell.NetworkSteering();
+		if (err) {
+			LOG_ERR("Fail to start network steering");
+		}
+		break;
+	case AppEvent::DeviceCmdReady:
+		DeviceCmdReadyHandler();
+		break;
+	default:
+		LOG_INF("Unknown event received");
+		break;
+	}
+}
+
+void ZigbeeBridge::ZigbeeReadyHandler()
+{
+	mZigbeeReady = true;
+	mZigbeeReadyMs = mShell.GetStartInfo().readyUptimeMs;
+	if (mNetworkRejoinPending) {
+		NetworkRejoinHandler();
+	}
+	if (!mDiscovery.Empty()) {
+		PostDiscoveryReady();
+	}
+}
+
+void ZigbeeBridge::PostDiscoveryReady()
+{
+	mEventQueue.Post(AppEvent{ AppEvent::DiscoveryReady }, AppEventQueue::kLane_Discovery,
+			 AppEvent::kCoalesce_DiscoveryReady);
+}
+
+void ZigbeeBridge::DiscoveryReadyHandler()
+{
+	uint16_t addr;
+	uint8_t ep;
+	int err;
+
+	if (!mDiscovery.Pop(addr, ep)) {
+		return;
+	}
+	/* Let the other lanes in between the requests */
+	if (!mDiscovery.Empty()) {
+		PostDiscoveryReady();
+	}
+	if (ep == 0) {
+		err = mShell.ZdoActiveEpReq(addr);
+		if (err) {
+			LOG_ERR("Fail to request active ep");
+		}
+		return;
+	}
+	err = mShell.ZdoSimpleDescReq(addr, ep);
+	if (err) {
+		LOG_ERR("Fail to request simple descriptor");
+	}
+}
+
+void ZigbeeBridge::QueueDiscovery(uint16_t addr, uint8_t ep)
+{
+	if (mDiscovery.Push(addr, ep)) {
+		LOG_WRN("Discovery of 0x%04hx dropped, %u addresses waiting", addr, mDiscovery.Queued());
+		return;
+	}
+	/* One wake-up is queued at most, it takes the next entry in turn */
+	PostDiscoveryReady();
+}
+
+void ZigbeeBridge::NetworkRejoinHandler()
+{
+	uint16_t InputCluster[] = {ZigbeeShell::Cluster_t::kCluster_OnOff};
+	int err;
+
+	/* The NCP reports the rejoin while it is still being started */
+	if (!mZigbeeReady) {
+		mNetworkRejoinPending = true;
+		return;
+	}
+	mNetworkRejoinPending = false;
+
+	err = mShell.ZdoMatchDesc(0xfffd, 0xfffd, ZB_AF_HA_PROFILE_ID, 1, InputCluster, 0, nullptr);
+	if (err) {
+		LOG_ERR("Fail to broadcast MatchDesc");
+	}
+}
+
+void ZigbeeBridge::SimpleDescRspHandler(const AppEvent &event)
+{
+	const ZigbeeShell::ZdoEvent &zdo = event.Zigbee->Zdo;
+	Device *added = nullptr;
+	int err;
+
+	if (zdo.dev_id != ZB_HA_DIMMABLE_LIGHT_DEVICE_ID) {
+		return;
+	}
+	for (size_t i = 0; i < mCount; i++) {
+		Device &light = mDevices[i];
+
+		if (IsBridged(light) && light.GetZbAddr() == zdo.addr && light.GetZbEp() == zdo.ep) {
+			LOG_INF("Device existed");
+			/* It announced itself, so it is reachable again */
+			mDelegate->Lock();
+			UpdateBreaker(&light, 0);
+			mDelegate->Unlock();
+			return;
+		}
+	}
+
+	mDelegate->Lock();
+	for (size_t i = 0; i < mCount; i++) {
+		Device &light = mDevices[i];
+
+		if (!IsBridged(light)) {
+			mDelegate->AddEndpoint(light);
+			light.SetName("Light");
+			light.SetZbAddr(zdo.addr);
+			light.SetZbEp(zdo.ep);
+			light.SetZbDevId(zdo.dev_id);
+			light.SetReachable(true);
+			mLiveness.Add(i);
+			added = &light;
+			break;
+		}
+	}
+	mDelegate->Unlock();
+
+	if (added == nullptr) {
+		LOG_WRN("No endpoint left for 0x%04hx", zdo.addr);
+		return;
+	}
+	if (mFirstEndpointMs == 0) {
+		mFirstEndpointMs = k_uptime_get_32();
+		LOG_INF("First bridged endpoint added %u ms after reset", mFirstEndpointMs);
+	}
+
+	err = mShell.ZclAttrRead(zdo.addr, zdo.ep, ZB_AF_HA_PROFILE_ID, ZigbeeShell::kCluster_OnOff,
+				 ZigbeeShell::kOnOffAttr_OnOff);
+	if (err) {
+		LOG_ERR("Fail to read OnOff attribute");
+	}
+	StateReadyHandler();
+
+	ConfigureReporting(IndexOf(*added));
+}
+
+void ZigbeeBridge::ConfigureReporting(size_t index)
+{
+	Device *dev = &mDevices[index];
+	int err;
+
+	err = mShell.ZclSubscribe(dev->GetZbAddr(), dev->GetZbEp(), ZB_AF_HA_PROFILE_ID, ZigbeeShell::kCluster_OnOff,
+				  ZigbeeShell::kOnOffAttr_OnOff, ZigbeeShell::kZclAttrType_BOOL,
+				  CONFIG_BRIDGE_REPORT_MIN_INTERVAL_S, CONFIG_BRIDGE_REPORT_MAX_INTERVAL_S);
+	if (!err) {
+		atomic_clear_bit(mReported, index);
+		mPoll.CheckReports(index);
+		return;
+	}
+	/* Only a device that refused is known not to report, one that did not answer is asked again */
+	if (err != -EINVAL && mPoll.RetryConfigure(index)) {
+		LOG_INF("0x%04hx did not answer its report configuration: %d, retried", dev->GetZbAddr(), err);
+		return;
+	}
+	LOG_INF("0x%04hx does not report its state, polled", dev->GetZbAddr());
+	mPoll.Add(index, mSubscriptions.Subscribed(index, SubscriptionTracker::kAttribute_OnOff));
+}
+
+int ZigbeeBridge::WriteOnOff(Device &dev, bool on, uint32_t timestamp)
+{
+	uint16_t seq;
+	int ret;
+
+	if (!dev.IsReachable()) {
+		return -EHOSTUNREACH;
+	}
+
+	/* Report the target state right away and let the app task send the
+	 * Zigbee command. It confirms or rolls back the state once it is done. */
+	seq = dev.SetOnOffPending(on);
+
+	LATENCY_RECORD(LatencyStats::kStage_WriteToReport, LatencyStats::ClassOf(dev.GetZbDevId()), timestamp,
+		       LATENCY_TIMESTAMP());
+
+	ret = mDeviceCmdQueue.Push(IndexOf(dev), AppEvent{ AppEvent::DeviceOnOffCmd, &dev, seq, on, timestamp });
+	if (ret) {
+		LOG_WRN("Command to %s refused, %u in flight", dev.GetName(), CONFIG_BRIDGE_DEVICE_CMD_LIMIT);
+		dev.RollbackOnOff(seq);
+		mOptimisticStats.RolledBack++;
+		return ret;
+	}
+	/* One wake-up is queued at most, it takes the next command in turn */
+	mEventQueue.Post(AppEvent{ AppEvent::DeviceCmdReady }, AppEventQueue::kLane_Control,
+			 AppEvent::kCoalesce_DeviceCmdReady);
+
+	return 0;
+}
+
+void ZigbeeBridge::UpdateSubscription(size_t index, uint8_t attributes, bool add)
+{
+	if (!add) {
+		mSubscriptions.Remove(index, attributes);
+	} else {
+		mSubscriptions.Add(index, attributes);
+		/* A change while it was set up may be missing from its priming report */
+		if (index != SubscriptionTracker::kAllDevices) {
+			mDelegate->Report(mDevices[index], attributes);
+		} else {
+			for (size_t i = 0; i < mCount; i++) {
+				if (IsBridged(mDevices[i])) {
+					mDelegate->Report(mDevices[i], attributes);
+				}
+			}
+		}
+	}
+	mEventQueue.Post(AppEvent{ AppEvent::SubscriptionsChanged }, AppEventQueue::kLane_Housekeeping,
+			 AppEvent::kCoalesce_SubscriptionsChanged);
+}
+
+void ZigbeeBridge::StatusChanged(Device *dev, Device::Changed_t attributes)
+{
+	/* The state changes while a command is pending only when a controller wrote it */
+	uint8_t written = dev->IsOnOffPending() ? (attributes & Device::kChanged_State) : 0;
+	/* Changes of subscribed attributes in a burst are held for one report */
+	uint8_t report = mReports.Changed(IndexOf(*dev), attributes, written);
+
+	if (report) {
+		mDelegate->Report(*dev, report);
+	}
+}
+
+void ZigbeeBridge::DeviceCmdReadyHandler()
+{
+	AppEvent cmd;
+	size_t index;
+
+	if (!mDeviceCmdQueue.Pop(cmd, index)) {
+		return;
+	}
+	/* Let the other lanes in between the commands */
+	if (!mDeviceCmdQueue.Empty()) {
+		mEventQueue.Post(AppEvent{ AppEvent::DeviceCmdReady }, AppEventQueue::kLane_Control,
+				 AppEvent::kCoalesce_DeviceCmdReady);
+	}
+	if (mBreakers[index].IsOpen()) {
+		/* Queued before the device was found unreachable */
+		mDelegate->Lock();
+		cmd.DeviceCmdEvent.Dev->RollbackOnOff(cmd.DeviceCmdEvent.Seq);
+		mOptimisticStats.RolledBack++;
+		mDelegate->Unlock();
+		mBreakerStats.Refused++;
+		mDelegate->CommandCompleted(cmd, -EHOSTUNREACH);
+	} else {
+		DeviceOnOffCmdHandler(cmd);
+	}
+	mDeviceCmdQueue.Complete(index);
+}
+
+void ZigbeeBridge::DeviceOnOffCmdHandler(const AppEvent &event)
+{
+	Device *dev = event.DeviceCmdEvent.Dev;
+	LatencyStats::DeviceClass cls = LatencyStats::ClassOf(dev->GetZbDevId());
+	uint32_t done, complete;
+	int err;
+
+	err = mShell.ZclCmd(dev->GetZbAddr(),
+			    dev->GetZbEp(),
+			    ZigbeeShell::kCluster_OnOff,
+			    event.DeviceCmdEvent.On ? ZigbeeShell::kOnOffCmd_On : ZigbeeShell::kOnOffCmd_Off);
+	done = err ? LATENCY_TIMESTAMP() : mShell.GetCmdDoneTimestamp();
+	LATENCY_RECORD(LatencyStats::kStage_WriteToTx, cls, event.DeviceCmdEvent.Timestamp, mShell.GetCmdTxTimestamp());
+	LATENCY_RECORD(LatencyStats::kStage_TxToDone, cls, mShell.GetCmdTxTimestamp(), done);
+
+	/* The device state is reported from here, so it needs the lock */
+	mDelegate->Lock();
+	UpdateBreaker(dev, err);
+	if (err) {
+		LOG_ERR("OnOff command to 0x%04hx failed: %d, rolling back", dev->GetZbAddr(), err);
+		dev->RollbackOnOff(event.DeviceCmdEvent.Seq);
+		mOptimisticStats.RolledBack++;
+	} else if (dev->ConfirmOnOff(event.DeviceCmdEvent.Seq, event.DeviceCmdEvent.On)) {
+		mOptimisticStats.ConfirmLatency.Record(k_cycle_get_32() - dev->GetPendingSince());
+		mOptimisticStats.Confirmed++;
+	}
+	mDelegate->Unlock();
+
+	complete = LATENCY_TIMESTAMP();
+	LATENCY_RECORD(LatencyStats::kStage_DoneToComplete, cls, done, complete);
+	LATENCY_RECORD(LatencyStats::kStage_EndToEnd, cls, event.DeviceCmdEvent.Timestamp, complete);
+	mDelegate->CommandCompleted(event, err);
+}
+
+void ZigbeeBridge::LivenessProbeHandler()
+{
+	Device *dev;
+	size_t index;
+	int err;
+
+	if (!mLiveness.NextProbe(index)) {
+		return;
+	}
+
+	dev = &mDevices[index];
+	if (mBreakers[index].IsOpen()) {
+		mBreakerStats.Probes++;
+	}
+	err = mShell.ZclAttrRead(dev->GetZbAddr(), dev->GetZbEp(), ZB_AF_HA_PROFILE_ID, ZigbeeShell::kCluster_OnOff,
+				 ZigbeeShell::kOnOffAttr_OnOff);
+	mDelegate->Lock();
+	UpdateBreaker(dev, err);
+	mDelegate->Unlock();
+}
+
+void ZigbeeBridge::PollHandler()
+{
+	Device *dev;
+	PollScheduler::Due_t due;
+	size_t index;
+	bool wasOn;
+	int err;
+
+	/* The report checks read nothing from the devices, they all run now */
+	for (;;) {
+		if (!mPoll.NextPoll(index, due)) {
+			return;
+		}
+		if (due != PollScheduler::kDue_ReportCheck) {
+			break;
+		}
+		if (atomic_test_and_clear_bit(mReported, index)) {
+			mPoll.CheckReports(index);
+			continue;
+		}
+		/* Its reports may not be understood, or it lost its configuration */
+		LOG_WRN("0x%04hx did not report its state in time, polled", mDevices[index].GetZbAddr());
+		mPoll.Silent(index, mSubscriptions.Subscribed(index, SubscriptionTracker::kAttribute_OnOff));
+	}
+	if (due == PollScheduler::kDue_Configure) {
+		ConfigureReporting(index);
+		return;
+	}
+
+	dev = &mDevices[index];
+	/* The liveness probes alone find out when an unreachable device answers again */
+	if (mBreakers[index].IsOpen()) {
+		mPoll.Polled(index, false);
+		return;
+	}
+	wasOn = dev->IsOn();
+	err = mShell.ZclAttrRead(dev->GetZbAddr(), dev->GetZbEp(), ZB_AF_HA_PROFILE_ID, ZigbeeShell::kCluster_OnOff,
+				 ZigbeeShell::kOnOffAttr_OnOff);
+	/* The response left its state before the read returned */
+	StateReadyHandler();
+	mDelegate->Polled(*dev);
+	mPoll.Polled(index, !err && dev->IsOn() != wasOn);
+	mDelegate->Lock();
+	UpdateBreaker(dev, err);
+	mDelegate->Unlock();
+}
+
+void ZigbeeBridge::SubscriptionsChangedHandler()
+{
+	for (size_t i = 0; i < mCount; i++) {
+		if (mPoll.IsPolled(i)) {
+			mPoll.SetWatched(i, mSubscriptions.Subscribed(i, SubscriptionTracker::kAttribute_OnOff));
+		}
+	}
+}
+
+void ZigbeeBridge::ReportHandler()
+{
+	size_t index;
+	uint8_t attributes;
+
+	mDelegate->Lock();
+	while (mReports.NextReport(index, attributes)) {
+		mDelegate->Report(mDevices[index], attributes);
+	}
+	mDelegate->Unlock();
+}
+
+void ZigbeeBridge::UpdateBreaker(Device *dev, int err)
+{
+	size_t index = IndexOf(*dev);
+	DeviceBreaker &breaker = mBreakers[index];
+
+	if (!err) {
+		if (breaker.RecordSuccess()) {
+			LOG_INF("0x%04hx answers again", dev->GetZbAddr());
+			mBreakerStats.Closed++;
+			mOpenBreakers--;
+			dev->SetReachable(true);
+		}
+		mLiveness.Heard(index);
+		return;
+	}
+
+	if (DeviceBreaker::IsDeviceFailure(err) && breaker.RecordFailure()) {
+		LOG_WRN("0x%04hx failed %u commands in a row, unreachable", dev->GetZbAddr(),
+			CONFIG_BRIDGE_BREAKER_FAILURES);
+		mBreakerStats.Opened++;
+		mOpenBreakers++;
+		dev->SetReachable(false);
+	}
+	mLiveness.Missed(index, breaker.IsOpen());
+}
+
+void ZigbeeBridge::ZclAttrHandler(const ZigbeeShell::EventPayload &payload)
+{
+	const ZigbeeShell::ZclEvent &zcl = payload.Zcl;
+
+	for (size_t i = 0; i < mCount; i++) {
+		Device &light = mDevices[i];
+
+		/* A report does not give the endpoint */
+		if (!IsBridged(light) || light.GetZbAddr() != zcl.addr || (zcl.ep != 0 && light.GetZbEp() != zcl.ep)) {
+			continue;
+		}
+		if (payload.type == ZigbeeShell::kEvent_ZclAttrReport) {
+			atomic_set_bit(mReported, i);
+		}
+		if (zcl.cluster_id == ZigbeeShell::kCluster_OnOff &&
+		    zcl.attr_id == ZigbeeShell::kOnOffAttr_OnOff &&
+		    zcl.type == ZigbeeShell::kZclAttrType_BOOL) {
+			/* The shell thread must not wait for the lock, the app task applies the latest state */
+			if (!strncmp(zcl.value, "True", zcl.len)) {
+				atomic_set_bit(mStateOn, i);
+			} else if (!strncmp(zcl.value, "False", zcl.len)) {
+				atomic_clear_bit(mStateOn, i);
+			} else {
+				LOG_ERR("Wrong attr value");
+				break;
+			}
+			atomic_set_bit(mStateRead, i);
+			mEventQueue.Post(AppEvent{ AppEvent::StateReady }, AppEventQueue::kLane_Control,
+					 AppEvent::kCoalesce_StateReady);
+			break;
+		}
+	}
+}
+
+void ZigbeeBridge::StateReadyHandler()
+{
+	bool locked = false;
+
+	for (size_t i = 0; i < mCount; i++) {
+		if (!atomic_test_and_clear_bit(mStateRead, i)) {
+			continue;
+		}
+		if (!locked) {
+			mDelegate->Lock();
+			locked = true;
+		}
+		mDevices[i].SetOnOff(atomic_test_bit(mStateOn, i));
+		mDelegate->StateRead(mDevices[i]);
+	}
+	if (locked) {
+		mDelegate->Unlock();
+	}
+}
+
+void ZigbeeBridge::ZigbeeEventHandler(ZigbeeShell *shell, ZigbeeShell::EventPayload *payload)
+{
+	const ZigbeeShell::ZdoEvent &zdo = payload->Zdo;
+
+	ARG_UNUSED(shell);
+
+	TRACE(Trace::kEvent_ZigbeeEvent, payload->type);
+	switch (payload->type) {
+	case ZigbeeShell::kEvent_NetworkRejoin:
+		PostZigbeeEvent(AppEvent::NetworkRejoin, payload);
+		break;
+	case ZigbeeShell::kEvent_DeviceAnnounceRsp:
+		sInstance->QueueDiscovery(zdo.addr, 0);
+		break;
+	case ZigbeeShell::kEvent_ActiveEpRsp:
+		sInstance->QueueDiscovery(zdo.addr, zdo.ep);
+		break;
+	case ZigbeeShell::kEvent_SimpleDescRsp:
+		LOG_INF("addr:0x%04hx ep:%d dev_id:0x%04hx", zdo.addr, zdo.ep, zdo.dev_id);
+		PostZigbeeEvent(AppEvent::SimpleDescRsp, payload);
+		break;
+	case ZigbeeShell::kEvent_Ready:
+		PostZigbeeEvent(AppEvent::ZigbeeReady, payload);
+		break;
+	case ZigbeeShell::kEvent_ZclAttrRead:
+	case ZigbeeShell::kEvent_ZclAttrReport:
+		sInstance->ZclAttrHandler(*payload);
+		break;
+	default:
+		LOG_WRN("Unknown event received");
+		break;
+	}
+}
+
+void ZigbeeBridge::LivenessTimerHandler(k_timer *timer)
+{
+	ARG_UNUSED(timer);
+
+	sInstance->mEventQueue.Post(AppEvent{ AppEvent::LivenessTimer }, AppEventQueue::kLane_Housekeeping,
+				    AppEvent::kCoalesce_LivenessTimer);
+}
+
+void ZigbeeBridge::PollTimerHandler(k_timer *timer)
+{
+	ARG_UNUSED(timer);
+
+	sInstance->mEventQueue.Post(AppEvent{ AppEvent::PollTimer }, AppEventQueue::kLane_Housekeeping,
+				    AppEvent::kCoalesce_PollTimer);
+}
+
+void ZigbeeBridge::ReportTimerHandler(k_timer *timer)
+{
+	ARG_UNUSED(timer);
+
+	sInstance->mEventQueue.Post(AppEvent{ AppEvent::ReportTimer }, AppEventQueue::kLane_Housekeeping,
+				    AppEvent::kCoalesce_ReportTimer);
+}
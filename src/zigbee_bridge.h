@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include "Device.h"
+#include "app_event.h"
+#include "app_event_queue.h"
+#include "device_breaker.h"
+#include "device_cmd_queue.h"
+#include "discovery_queue.h"
+#include "latency_histogram.h"
+#include "liveness_monitor.h"
+#include "poll_scheduler.h"
+#include "rate_budget.h"
+#include "report_limiter.h"
+#include "subscription_tracker.h"
+#include "zigbee_shell.h"
+
+#include <zephyr.h>
+#include <sys/atomic.h>
+
+/*
+ * Zigbee side of the bridge, shared by AppTask and the host build.
+ *
+ * Notifications of the Zigbee shell are posted to the app event queue and
+ * handled by Dispatch() on the app task, which drives the discovery of the
+ * lights. A discovered light takes a free Device and is given a Matter
+ * endpoint by the delegate. Matter writes of its On/Off state are applied
+ * at once and queued as Zigbee commands in the DeviceCmdQueue, which
+ * confirm or roll the state back when they complete. A light whose
+ * DeviceBreaker is open is unreachable and refuses them. The
+ * LivenessMonitor probes the lights, and the PollScheduler reads the state
+ * of the lights that cannot report it, as often as their subscribers need.
+ * Changes of the lights go through the ReportLimiter before the delegate
+ * reports them to Matter.
+ */
+class ZigbeeBridge {
+public:
+	/* Matter side of the bridge, the CHIP glue of AppTask or the host simulation */
+	class Delegate {
+	public:
+		/* Held around every change of the devices, the CHIP stack lock on the target */
+		virtual void Lock() = 0;
+		virtual void Unlock() = 0;
+		/* Gives a newly bridged device its endpoint, with the lock held */
+		virtual void AddEndpoint(Device &dev) = 0;
+		/* Reports the attributes of the device, as Device::Changed_t bits, with the lock held */
+		virtual void Report(Device &dev, uint8_t attributes) = 0;
+		/* The On/Off command completed, or was refused, with err 0 on success */
+		virtual void CommandCompleted(const AppEvent &cmd, int err) { ARG_UNUSED(cmd); ARG_UNUSED(err); }
+		/* The device read or reported its On/Off state, with the lock held */
+		virtual void StateRead(Device &dev) { ARG_UNUSED(dev); }
+		/* The state of a device that does not report was polled */
+		virtual void Polled(Device &dev) { ARG_UNUSED(dev); }
+
+	protected:
+		~Delegate() = default;
+	};
+
+	/* State of device i is entry i of each array, for count devices */
+	struct Storage {
+		Device *devices;
+		DeviceCmdQueue::Slot *cmdSlots;
+		DeviceBreaker *breakers;
+		LivenessMonitor::Slot *livenessSlots;
+		PollScheduler::Slot *pollSlots;
+		SubscriptionTracker::Slot *subscriptionSlots;
+		ReportLimiter::Slot *reportSlots;
+		/* DiscoveryQueue::kSlotsPerDevice * count entries */
+		DiscoveryQueue::Slot *discoverySlots;
+		/* ATOMIC_BITMAP_SIZE(count) words each */
+		atomic_t *reported;
+		atomic_t *stateRead;
+		atomic_t *stateOn;
+		size_t count;
+	};
+
+	struct Config {
+		LivenessMonitor::Config liveness;
+		PollScheduler::Config poll;
+		ReportLimiter::Config report;
+		/* Shared by the liveness probes and the state polls */
+		uint16_t readsPerSecond = CONFIG_BRIDGE_ZIGBEE_READS_PER_S;
+	};
+
+	struct OptimisticStats {
+		LatencyHistogram ConfirmLatency;
+		uint32_t Confirmed;
+		uint32_t RolledBack;
+	};
+
+	explicit ZigbeeBridge(ZigbeeShell &shell) : mShell(shell) {}
+
+	/* Sets up the queues and the schedulers as set in Kconfig unless given a config, and starts their timers */
+	void Init(const Storage &storage, Delegate &delegate);
+	void Init(const Storage &storage, Delegate &delegate, const Config &config);
+	/* Brings up the Zigbee NCP, ZigbeeReady follows */
+	void Start();
+
+	int PostEvent(const AppEvent &event);
+	/* Handles an event of the bridge on the app task, then ReleaseEvent() drops what it holds */
+	void Dispatch(const AppEvent &event);
+	static void ReleaseEvent(const AppEvent &event);
+	/* Notifications of the Zigbee shell, on its RX thread */
+	static void ZigbeeEventHandler(ZigbeeShell *shell, ZigbeeShell::EventPayload *payload);
+
+	/* A Matter write of the On/Off state, with the lock held; -EHOSTUNREACH while the device is unreachable */
+	int WriteOnOff(Device &dev, bool on, uint32_t timestamp);
+	/* A subscription to the attributes of the device index, or kAllDevices, started or ended, with the lock held */
+	void UpdateSubscription(size_t index, uint8_t attributes, bool add);
+	/* The attributes of the device changed, reported unless the limiter holds them, with the lock held */
+	void StatusChanged(Device *dev, Device::Changed_t attributes);
+
+	/* The device took an endpoint, with the lock held or from the app task */
+	static bool IsBridged(const Device &dev) { return dev.GetZbAddr() != 0; }
+	size_t IndexOf(const Device &dev) const { return &dev - mDevices; }
+	bool IsPolled(size_t index) const { return mPoll.IsPolled(index); }
+
+	OptimisticStats &GetOptimisticStats() { return mOptimisticStats; }
+	const DeviceBreaker::Stats &GetBreakerStats() const { return mBreakerStats; }
+	uint32_t GetOpenBreakers() const { return mOpenBreakers; }
+	const LivenessMonitor::Stats &GetLivenessStats() const { return mLiveness.GetStats(); }
+	const PollScheduler::Stats &GetPollStats() const { return mPoll.GetStats(); }
+	const SubscriptionTracker &GetSubscriptions() const { return mSubscriptions; }
+	const ReportLimiter::Stats &GetReportStats() const { return mReports.GetStats(); }
+	const AppEventQueue &GetEventQueue() const { return mEventQueue; }
+	AppEventQueue &GetEventQueue() { return mEventQueue; }
+	const DeviceCmdQueue &GetDeviceCmdQueue() const { return mDeviceCmdQueue; }
+	DiscoveryQueue::Stats GetDiscoveryStats() const { return mDiscovery.GetStats(); }
+	ZigbeeShell &GetZigbeeShell() { return mShell; }
+	/* Milliseconds from reset, 0 until reached */
+	uint32_t GetZigbeeReadyMs() const { return mZigbeeReadyMs; }
+	uint32_t GetFirstEndpointMs() const { return mFirstEndpointMs; }
+
+private:
+	void DeviceCmdReadyHandler();
+	void DeviceOnOffCmdHandler(const AppEvent &event);
+	void LivenessProbeHandler();
+	void PollHandler();
+	/* Polls the devices that cannot report as often as their subscribers need */
+	void SubscriptionsChangedHandler();
+	/* Sends the reports held back by the ReportLimiter whose interval is over */
+	void ReportHandler();
+	/* Feeds the result of a command or probe to the device's breaker and liveness, with the lock held */
+	void UpdateBreaker(Device *dev, int err);
+	void ZigbeeReadyHandler();
+	/* Requests the active endpoints or the simple descriptor of the next address waiting */
+	void DiscoveryReadyHandler();
+	void PostDiscoveryReady();
+	/* An announce, or ep 0, or an endpoint found, from the shell thread */
+	void QueueDiscovery(uint16_t addr, uint8_t ep);
+	void NetworkRejoinHandler();
+	void SimpleDescRspHandler(const AppEvent &event);
+	/* Has the device report its On/Off state, or polls it when it cannot */
+	void ConfigureReporting(size_t index);
+	void ZclAttrHandler(const ZigbeeShell::EventPayload &payload);
+	/* Applies the On/Off states left by ZclAttrHandler(), on the app task */
+	void StateReadyHandler();
+
+	static void PostZigbeeEvent(AppEvent::ZigbeeShellEventType type, ZigbeeShell::EventPayload *payload);
+	static void LivenessTimerHandler(k_timer *timer);
+	static void PollTimerHandler(k_timer *timer);
+	static void ReportTimerHandler(k_timer *timer);
+
+	static ZigbeeBridge *sInstance;
+
+	ZigbeeShell &mShell;
+	Delegate *mDelegate = nullptr;
+	Device *mDevices = nullptr;
+	size_t mCount = 0;
+	AppEventQueue mEventQueue;
+	DeviceCmdQueue mDeviceCmdQueue;
+	DiscoveryQueue mDiscovery;
+	DeviceBreaker *mBreakers = nullptr;
+	RateBudget mReadBudget;
+	LivenessMonitor mLiveness;
+	PollScheduler mPoll;
+	/* Devices that reported since the last check of their reports, set from the shell thread */
+	atomic_t *mReported = nullptr;
+	/* On/Off states read or reported and not applied yet, set from the shell thread */
+	atomic_t *mStateRead = nullptr;
+	atomic_t *mStateOn = nullptr;
+	SubscriptionTracker mSubscriptions;
+	ReportLimiter mReports;
+	/* Advance the liveness probes, the state polls and the held reports, one tick per expiry */
+	struct k_timer mLivenessTimer;
+	struct k_timer mPollTimer;
+	struct k_timer mReportTimer;
+	OptimisticStats mOptimisticStats = {};
+	DeviceBreaker::Stats mBreakerStats = {};
+	uint32_t mOpenBreakers = 0;
+	bool mZigbeeReady = false;
+	bool mNetworkRejoinPending = false;
+	uint32_t mZigbeeReadyMs = 0;
+	uint32_t mFirstEndpointMs = 0;
+};
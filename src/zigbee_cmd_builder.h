@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Typed builder of Zigbee shell commands, written straight into the TX
+ * buffer.
+ *
+ * The fixed text is copied as literals of known length and only the
+ * numeric fields are encoded at run time. Each step returns a builder
+ * whose type carries the longest text written so far, so End() checks at
+ * compile time that the command with its CR LF always fits the buffer:
+ *
+ *   len = BuildZigbeeCmd(buf).Text("zdo active_ep ").Hex16(addr).End();
+ */
+template <size_t Capacity, size_t MaxLen> class ZigbeeCmdBuilder {
+public:
+	ZigbeeCmdBuilder(char *start, char *pos) : mStart(start), mPos(pos) {}
+
+	template <size_t N> ZigbeeCmdBuilder<Capacity, MaxLen + N - 1> Text(const char (&text)[N]) const
+	{
+		memcpy(mPos, text, N - 1);
+		return { mStart, mPos + N - 1 };
+	}
+
+	/* As "0x%04hx" */
+	ZigbeeCmdBuilder<Capacity, MaxLen + 6> Hex16(uint16_t value) const
+	{
+		mPos[0] = '0';
+		mPos[1] = 'x';
+		for (int i = 0; i < 4; i++) {
+			mPos[2 + i] = HexDigit(value >> (12 - 4 * i));
+		}
+		return { mStart, mPos + 6 };
+	}
+
+	/* As "%d" */
+	ZigbeeCmdBuilder<Capacity, MaxLen + 3> Dec8(uint8_t value) const
+	{
+		char *pos = mPos;
+
+		if (value >= 100) {
+			*pos++ = '0' + value / 100;
+		}
+		if (value >= 10) {
+			*pos++ = '0' + value / 10 % 10;
+		}
+		*pos++ = '0' + value % 10;
+		return { mStart, pos };
+	}
+
+	/* As "%hu" */
+	ZigbeeCmdBuilder<Capacity, MaxLen + 5> Dec16(uint16_t value) const
+	{
+		char digits[5];
+		size_t count = 0;
+
+		do {
+			digits[count++] = '0' + value % 10;
+			value /= 10;
+		} while (value > 0);
+		for (size_t i = 0; i < count; i++) {
+			mPos[i] = digits[count - 1 - i];
+		}
+		return { mStart, mPos + count };
+	}
+
+	/* Each value as "%hx " */
+	template <size_t MaxCount>
+	ZigbeeCmdBuilder<Capacity, MaxLen + MaxCount * 5> HexList(const uint16_t *values, size_t count) const
+	{
+		char *pos = mPos;
+
+		for (size_t i = 0; i < count && i < MaxCount; i++) {
+			int shift = 12;
+
+			while (shift > 0 && (values[i] >> shift) == 0) {
+				shift -= 4;
+			}
+			for (; shift >= 0; shift -= 4) {
+				*pos++ = HexDigit(values[i] >> shift);
+			}
+			*pos++ = ' ';
+		}
+		return { mStart, pos };
+	}
+
+	/* Terminates the command with CR LF and returns its length */
+	size_t End() const
+	{
+		static_assert(MaxLen + 2 <= Capacity, "Zigbee shell command can exceed the TX buffer");
+
+		mPos[0] = '\r';
+		mPos[1] = '\n';
+		mPos[2] = '\0';
+		return mPos + 2 - mStart;
+	}
+
+private:
+	static char HexDigit(unsigned int value) { return "0123456789abcdef"[value & 0xf]; }
+
+	char *mStart;
+	char *mPos;
+};
+
+/* The last byte of the buffer is kept for the terminating NUL */
+template <size_t N> ZigbeeCmdBuilder<N - 1, 0> BuildZigbeeCmd(char (&buf)[N])
+{
+	return { buf, buf };
+}
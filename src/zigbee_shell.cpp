@@ -5,16 +5,142 @@
  */
 
 #include "zigbee_shell.h"
+#include "latency_stats.h"
+#include "trace.h"
+#include "uart_capture.h"
+#include <ctype.h>
 #include <logging/log.h>
 #include <drivers/uart.h>
 
 LOG_MODULE_DECLARE(zigbee_shell);
 
+/* Responses of the Zigbee shell are parsed here rather than on the system workqueue */
+K_THREAD_STACK_DEFINE(sRxThreadStack, CONFIG_ZIGBEE_SHELL_THREAD_STACK_SIZE);
+K_THREAD_STACK_DEFINE(sStartThreadStack, CONFIG_ZIGBEE_SHELL_START_STACK_SIZE);
+K_MEM_SLAB_DEFINE(sEventSlab, sizeof(ZigbeeShell::EventPayload), CONFIG_ZIGBEE_SHELL_EVENT_POOL_SIZE, 4);
+
+/* Start of the status line ending the pending response, or end when it is still to come */
+static const char *ResponseEnd(const ShellMatcher &matcher, const char *end)
+{
+	const char *done = matcher.Find(ShellMatcher::kMarker_Done);
+	const char *error = matcher.Find(ShellMatcher::kMarker_Error);
+
+	if (done != nullptr && done < end) {
+		end = done;
+	}
+	if (error != nullptr && error < end) {
+		end = error;
+	}
+
+	return end;
+}
+
+/* Offset after the last line break in [from, to) of data, or from when there is none */
+static size_t LastLineEnd(const char *data, size_t from, size_t to)
+{
+	while (to > from) {
+		if (data[to - 1] == '\n') {
+			return to;
+		}
+		to--;
+	}
+
+	return from;
+}
+
+/* Offset after the status line marker at rspEnd, the end of a response ResponseEnd() found */
+static size_t StatusEnd(const ShellMatcher &matcher, const char *data, const char *rspEnd)
+{
+	bool done = (rspEnd == matcher.Find(ShellMatcher::kMarker_Done));
+
+	return rspEnd - data + strlen(done ? ZB_SHELL_MSG_CMD_DONE : ZB_SHELL_MSG_CMD_ERROR);
+}
+
+/*
+ * Result of a command ended by the "Error" line at error: -ETIMEDOUT when
+ * the NCP gave up waiting for the device, -EINVAL when the command failed
+ * otherwise, such as refused by the device, or 0 while the line is not
+ * complete yet.
+ */
+static int ErrorResult(const char *error, const char *end)
+{
+	static const char *const kTimeouts[] = { "Timeout", "timed out" };
+	const char *eol = static_cast<const char *>(memchr(error, '\n', end - error));
+
+	if (eol == nullptr) {
+		return 0;
+	}
+	for (const char *p = error; p < eol; p++) {
+		for (const char *timeout : kTimeouts) {
+			if (!strncmp(p, timeout, strlen(timeout))) {
+				return -ETIMEDOUT;
+			}
+		}
+	}
+
+	return -EINVAL;
+}
+
+/* Whether only line breaks and prompts come before the line of marker, so nothing a handler waits for */
+static bool StartsLine(const char *p, const char *marker)
+{
+	while (p < marker) {
+		if (*p == '\r' || *p == '\n' || *p == ' ') {
+			p++;
+		} else if (!strncmp(p, ZB_SHELL_MSG_PROMPT, strlen(ZB_SHELL_MSG_PROMPT))) {
+			p += strlen(ZB_SHELL_MSG_PROMPT);
+		} else {
+			break;
+		}
+	}
+
+	return memchr(p, '\n', marker - p) == nullptr;
+}
+
+ZigbeeShell::EventPayload *ZigbeeShell::AllocEvent(Event_t type)
+{
+	void *block;
+
+	if (k_mem_slab_alloc(&sEventSlab, &block, K_NO_WAIT)) {
+		LOG_ERR("Zigbee event pool exhausted, event %d dropped", type);
+		mStats.eventPoolExhausted++;
+		return nullptr;
+	}
+
+	EventPayload *payload = static_cast<EventPayload *>(block);
+
+	memset(payload, 0, sizeof(*payload));
+	atomic_set(&payload->refCount, 1);
+	payload->type = type;
+
+	return payload;
+}
+
+void ZigbeeShell::RefEvent(EventPayload *payload)
+{
+	atomic_inc(&payload->refCount);
+}
+
+void ZigbeeShell::UnrefEvent(EventPayload *payload)
+{
+	if (payload != nullptr && atomic_dec(&payload->refCount) == 1) {
+		k_mem_slab_free(&sEventSlab, reinterpret_cast<void **>(&payload));
+	}
+}
+
+void ZigbeeShell::NotifyEvent(EventPayload *payload)
+{
+	mEvent_CB(this, payload);
+	UnrefEvent(payload);
+}
+
 size_t ZigbeeShell::ShellRspHandler(ZigbeeShell *shell, const char *data, size_t len)
 {
-	char *p;
+	const char *p;
 
-	p = strstr(data, ZB_SHELL_MSG_PROMPT);
+	ARG_UNUSED(len);
+
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Prompt);
 	if (p != NULL) {
 		LOG_DBG("Shell command finished");
 		return p - data + strlen(ZB_SHELL_MSG_PROMPT);
@@ -25,120 +151,196 @@ size_t ZigbeeShell::ShellRspHandler(ZigbeeShell *shell, const char *data, size_t
 
 size_t ZigbeeShell::GeneralRspHandler(ZigbeeShell *shell, const char *data, size_t len)
 {
-	char *p;
+	const char *p;
+	int err;
 
-	p = strstr((char *)data, ZB_SHELL_MSG_CMD_DONE);
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Done);
 	if (p != NULL) {
 		LOG_DBG("General command finished - Done");
 		shell->mZigbeeCmd.result = 0;
 		return p - data + strlen(ZB_SHELL_MSG_CMD_DONE);
 	}
-	p = strstr((char *)data, ZB_SHELL_MSG_CMD_ERROR);
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Error);
 	if (p != NULL) {
+		err = ErrorResult(p, data + len);
+		if (err == 0) {
+			LOG_DBG("Wait for the rest of the error");
+			return 0;
+		}
 		LOG_ERR("General command finished - Error");
-		shell->mZigbeeCmd.result = -EINVAL;
+		shell->mZigbeeCmd.result = err;
 		return p - data + strlen(ZB_SHELL_MSG_CMD_ERROR);
 	}
 
 	return 0;
 }
 
+size_t ZigbeeShell::ValueRspHandler(ZigbeeShell *shell, const char *data, size_t len)
+{
+	const char *done, *error, *start, *end;
+	size_t valueLen;
+
+	ARG_UNUSED(len);
+
+	done = shell->mMatcher.Find(ShellMatcher::kMarker_Done);
+	error = shell->mMatcher.Find(ShellMatcher::kMarker_Error);
+	if (error != NULL && (done == NULL || error < done)) {
+		LOG_DBG("Value command finished - Error");
+		shell->mZigbeeCmd.result = -EINVAL;
+		return error - data + strlen(ZB_SHELL_MSG_CMD_ERROR);
+	}
+	if (done == NULL) {
+		LOG_DBG("Wait for more response");
+		return 0;
+	}
+
+	/* The value is the last non-empty line before "Done" */
+	end = done;
+	while (end > data && isspace((unsigned char)end[-1])) {
+		end--;
+	}
+	start = end;
+	while (start > data && start[-1] != '\n' && start[-1] != '\r') {
+		start--;
+	}
+	if (!strncmp(start, ZB_SHELL_MSG_PROMPT, strlen(ZB_SHELL_MSG_PROMPT))) {
+		start += strlen(ZB_SHELL_MSG_PROMPT);
+	}
+	/* The space after a prompt consumed with the previous command is left in front */
+	while (start < end && isspace((unsigned char)*start)) {
+		start++;
+	}
+	valueLen = MIN((size_t)(end - start), sizeof(shell->mZigbeeCmd.response) - 1);
+	memcpy(shell->mZigbeeCmd.response, start, valueLen);
+	shell->mZigbeeCmd.response[valueLen] = '\0';
+	shell->mZigbeeCmd.result = 0;
+
+	return done - data + strlen(ZB_SHELL_MSG_CMD_DONE);
+}
+
 size_t ZigbeeShell::ZclAttrReadRspHandler(ZigbeeShell *shell,const char *data, size_t len)
 {
-	char *p, *end;
+	const char *p;
+	char *end;
 	int attr_id;
 	uint8_t type;
 	size_t ret;
+	int err;
 
-	p = strstr((char *)data, ZB_SHELL_MSG_CMD_ERROR);
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Error);
 	if (p != NULL) {
+		err = ErrorResult(p, data + len);
+		if (err == 0) {
+			LOG_DBG("Wait for the rest of the error");
+			return 0;
+		}
 		LOG_ERR("Zcl attr read finished - Error");
+		shell->mZigbeeCmd.result = err;
 		return p - data + strlen(ZB_SHELL_MSG_CMD_ERROR);
 	}
-	p = strstr((char *)data, ZB_SHELL_MSG_CMD_DONE);
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Done);
 	if (p == NULL) {
 		LOG_DBG("Wait for more response");
 		return 0;
 	}
 	ret = p - data + strlen(ZB_SHELL_MSG_CMD_DONE);
-	p = strstr(data, "ID: ");
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_AttrId);
 	if (p == NULL) {
 		LOG_WRN("attr id missed");
+		shell->mStats.parserErrors++;
 		return ret;
 	} else {
 		p = p + strlen("ID: ");
 		attr_id = strtol(p, &end, 10);
 		if (p == end) {
 			LOG_WRN("Can't get attr id");
+			shell->mStats.parserErrors++;
 			return ret;
 		}
 	}
-	p = strstr(data, "Type: ");
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_AttrType, p);
 	if (p == NULL) {
 		LOG_WRN("attr type missed");
+		shell->mStats.parserErrors++;
 		return ret;
 	} else {
 		p = p + strlen("Type: ");
 		type = strtol(p, &end, 16);
 		if (p == end) {
 			LOG_WRN("Can't get attr type");
+			shell->mStats.parserErrors++;
 			return ret;
 		}
 	}
-	p = strstr(data, "Value: ");
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_AttrValue, p);
 	if (p == NULL) {
 		LOG_WRN("Attr Value missed");
+		shell->mStats.parserErrors++;
 		return ret;
 	}
 
-	char *value_end = nullptr;
+	const char *value_end = nullptr;
 
 	p = p + strlen("Value: ");
 	value_end = strstr(p, "\r\n");
 	if (value_end == NULL) {
 		LOG_WRN("Can't get attr value");
+		shell->mStats.parserErrors++;
 		return ret;
 	}
 	if ((value_end - p) > ZB_ZCL_MAX_ATTR_SIZE) {
 		LOG_ERR("Fail to parse attr value");
+		shell->mStats.parserErrors++;
 		return 0;
 	}
-	memset(shell->mEvent.Zcl.value, 0, sizeof(shell->mEvent.Zcl.value));
-	shell->mEvent.Zcl.len = value_end - p;
-	shell->mEvent.Zcl.type = type;
-	strncpy(shell->mEvent.Zcl.value, p, shell->mEvent.Zcl.len);
-	LOG_INF("ID: %d Type: %x Value: %s", attr_id, type, shell->mEvent.Zcl.value);
-	shell->mEvent_CB(shell, kEvent_ZclAttrRead);
+	EventPayload *event = shell->AllocEvent(kEvent_ZclAttrRead);
+
+	if (event == nullptr) {
+		return ret;
+	}
+	event->Zcl = shell->mZigbeeCmd.zclRead;
+	event->Zcl.len = value_end - p;
+	event->Zcl.type = type;
+	strncpy(event->Zcl.value, p, event->Zcl.len);
+	TRACE(Trace::kEvent_ZclAttrValue, attr_id, type, event->Zcl.len);
+	shell->NotifyEvent(event);
 
 	return ret;
 }
 
 size_t ZigbeeShell::ZdoActiveEpRspHandler(ZigbeeShell *shell, const char *data, size_t len)
 {
-	const char *p;
+	const char *p, *end;
 	uint16_t dev_addr;
 	size_t ret;
 
-	p = strstr((char *)data, ZB_SHELL_MSG_CMD_ERROR);
+	ARG_UNUSED(len);
+
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Error);
 	if (p != NULL) {
 		LOG_ERR("Zdo active endpoint request finished - Error");
 		return p - data + strlen(ZB_SHELL_MSG_CMD_ERROR);
 	}
-	p = strstr((char *)data, ZB_SHELL_MSG_CMD_DONE);
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Done);
 	if (p == NULL) {
+		/* Match descriptor responses can outgrow the parser buffer, their complete lines are reported as they come */
 		LOG_DBG("Wait for more response");
-		return 0;
+		ret = 0;
+		shell->mZigbeeCmd.streamed = LastLineEnd(data, 0, shell->mMatcher.Scanned());
+		end = data + shell->mZigbeeCmd.streamed;
+	} else {
+		ret = p - data + strlen(ZB_SHELL_MSG_CMD_DONE);
+		end = p;
 	}
-	ret = p - data + strlen(ZB_SHELL_MSG_CMD_DONE);
 	p = data;
 	for (;;) {
-		p = strstr(p, "src_addr=");
-		if (p == NULL) {
+		p = shell->mMatcher.Find(ShellMatcher::kMarker_SrcAddr, p);
+		if (p == NULL || p >= end) {
 			break;
 		} else {
 			p = p + strlen("src_addr=");
 			dev_addr = strtol(p, NULL, 16);
-			p = strstr(p, "ep=");
+			p = shell->mMatcher.Find(ShellMatcher::kMarker_Ep, p);
 			if (p == NULL) {
 				break;
 			} else {
@@ -151,9 +353,13 @@ size_t ZigbeeShell::ZdoActiveEpRspHandler(ZigbeeShell *shell, const char *data,
 					if (p == end) {
 						break;
 					}
-					shell->mEvent.Zdo.addr = dev_addr;
-					shell->mEvent.Zdo.ep = ep;
-					shell->mEvent_CB(shell, kEvent_ActiveEpRsp);
+					EventPayload *event = shell->AllocEvent(kEvent_ActiveEpRsp);
+
+					if (event != nullptr) {
+						event->Zdo.addr = dev_addr;
+						event->Zdo.ep = ep;
+						shell->NotifyEvent(event);
+					}
 					if (*end == ',') {
 						p = end + 1;
 					} else {
@@ -168,28 +374,30 @@ size_t ZigbeeShell::ZdoActiveEpRspHandler(ZigbeeShell *shell, const char *data,
 
 size_t ZigbeeShell::ZdoSimpleDescRspHandler(ZigbeeShell *shell, const char *data, size_t len)
 {
-	char *p;
+	const char *p;
 	uint16_t dev_addr;
 	size_t ret;
 
-	p = strstr((char *)data, ZB_SHELL_MSG_CMD_ERROR);
+	ARG_UNUSED(len);
+
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Error);
 	if (p != NULL) {
 		LOG_ERR("Zdo simple descriptor request finished - Error");
 		return p - data + strlen(ZB_SHELL_MSG_CMD_ERROR);
 	}
-	p = strstr((char *)data, ZB_SHELL_MSG_CMD_DONE);
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Done);
 	if (p == NULL) {
 		LOG_DBG("Wait for more response");
 		return 0;
 	}
 	ret = p - data + strlen(ZB_SHELL_MSG_CMD_DONE);
-	p = strstr(data, "src_addr=");
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_SrcAddr);
 	if (p == NULL) {
 		return ret;
 	} else {
 		dev_addr = strtol(p + strlen("src_addr="), NULL, 16);
 	}
-	p = strstr(data, "ep=");
+	p = shell->mMatcher.Find(ShellMatcher::kMarker_Ep);
 	if (p == NULL) {
 		return ret;
 	} else {
@@ -200,197 +408,638 @@ size_t ZigbeeShell::ZdoSimpleDescRspHandler(ZigbeeShell *shell, const char *data
 		p = p + strlen("ep=");
 		ep = strtol(p, &end, 10);
 		if (p != end) {
-			p = strstr(data, "app_dev_id=");
+			p = shell->mMatcher.Find(ShellMatcher::kMarker_AppDevId);
+			if (p == NULL) {
+				return ret;
+			}
 			p = p + strlen("app_dev_id=");
 			dev_id = strtol(p, &end, 16);
 			if (p != end) {
 				LOG_INF("addr: 0x%4hx, active ep: %d device id: %04hx",
 					dev_addr, ep, dev_id);
-				shell->mEvent.Zdo.addr = dev_addr;
-				shell->mEvent.Zdo.ep = ep;
-				shell->mEvent.Zdo.dev_id = dev_id;
-				shell->mEvent_CB(shell, kEvent_SimpleDescRsp);
+				EventPayload *event = shell->AllocEvent(kEvent_SimpleDescRsp);
+
+				if (event != nullptr) {
+					event->Zdo.addr = dev_addr;
+					event->Zdo.ep = ep;
+					event->Zdo.dev_id = dev_id;
+					shell->NotifyEvent(event);
+				}
 			}
 		}
 	}
 	return ret;
 }
 
-void ZigbeeShell::UartWorkHandler(struct k_work *work)
+void ZigbeeShell::RxThreadMain(void *arg1, void *arg2, void *arg3)
 {
-	size_t ret = 0, parsed = 0, total_parsed = 0;
+	ZigbeeShell *shell = static_cast<ZigbeeShell *>(arg1);
+	uint32_t wake;
+
+	ARG_UNUSED(arg2);
+	ARG_UNUSED(arg3);
+
+	for (;;) {
+		k_sem_take(&shell->mRxSem, K_FOREVER);
+		wake = shell->mRxWakeTimestamp;
+		atomic_clear(&shell->mRxWakePending);
+#ifdef CONFIG_BRIDGE_LATENCY_STATS
+		shell->mRxWakeLatency.Record(k_cycle_get_32() - wake);
+#else
+		ARG_UNUSED(wake);
+#endif
+		shell->ProcessRx();
+	}
+}
 
-	ZigbeeShell *c = reinterpret_cast<ZigbeeShell*>((reinterpret_cast<char*>(work) - reinterpret_cast<int>((&(static_cast<ZigbeeShell*>(0)->mUartWork)))));
-	if (c->mZigbeeCmd.handler == nullptr) {
-		k_sem_give(&c->mCmdSem);
+void ZigbeeShell::ProcessRx()
+{
+	size_t len = 0, parsed = 0, total_parsed = 0, moved = 0;
+	const char *rspEnd, *gap, *eol;
+	ZigbeeResponseHandler handler;
+	unsigned int key;
+	uint32_t seq;
+	bool active, stale, dropped;
+
+	key = irq_lock();
+	handler = mZigbeeCmd.handler;
+	irq_unlock(key);
+	if (handler == nullptr) {
+		k_sem_give(&mCmdSem);
 		return;
 	}
-	memset(c->mParserBuffer, 0, sizeof(c->mParserBuffer));
-	ret = ring_buf_peek(&c->mShellRspRb, (uint8_t *)c->mParserBuffer, UNPARSED_BUF_LEN);
-	if (ret == 0 || ret > UNPARSED_BUF_LEN) {
-		LOG_ERR("Fail to peek ring buffer");
-	}
-	LOG_HEXDUMP_DBG(c->mParserBuffer, ret, "data to parse");
-	parsed = c->mZigbeeCmd.handler(c, c->mParserBuffer, ret);
-	if (parsed > 0) {
-		k_sem_give(&c->mCmdSem);
-	}
-	total_parsed = (parsed > total_parsed) ? parsed : total_parsed;
-
-	parsed = c->ParseShellMessage(c->mParserBuffer);
-	total_parsed = (parsed > total_parsed) ? parsed : total_parsed;
-	if (total_parsed > 0) {
-		/* Remove parsed data from ring buffer */
-		ret = ring_buf_get(&c->mShellRspRb, NULL, total_parsed);
-		if(ret != total_parsed) {
-			LOG_ERR("Fail to release from ring buffer");
-		} else {
-			LOG_INF("Release %d from buffer", ret);
+	for (;;) {
+		/* Kept NUL terminated for the field parsers */
+		len = ring_buf_peek(&mShellRspRb, (uint8_t *)mParserBuffer, UNPARSED_BUF_LEN - 1);
+		mParserBuffer[len] = '\0';
+		if (len == 0) {
+			break;
+		}
+		if (mRxResync) {
+			/* The line cut by a gap is dropped up to its end */
+			eol = static_cast<const char *>(memchr(mParserBuffer, '\n', len));
+			mRxResync = (eol == nullptr);
+			total_parsed = (eol != nullptr) ? eol + 1 - mParserBuffer : len;
+			mStats.rxDroppedBytes += total_parsed;
+			RxConsume(total_parsed);
+			continue;
+		}
+		/* The bytes before a gap are parsed on their own */
+		gap = static_cast<const char *>(memchr(mParserBuffer, kRxGap, len));
+		if (gap != nullptr) {
+			len = gap - mParserBuffer;
+			mParserBuffer[len] = '\0';
+		}
+		/* One pass finds the markers for the response handler and the notifications */
+		mMatcher.Scan(mParserBuffer, len);
+		/* Events in the order of the output whatever the chunking, notifications before the response first */
+		rspEnd = ResponseEnd(mMatcher, mParserBuffer + len);
+		mIncompleteLen = len;
+		total_parsed = ParseShellMessage(mParserBuffer, 0, rspEnd);
+		/* The command is only read here, SendCmd() may time it out meanwhile */
+		key = irq_lock();
+		stale = (mZigbeeCmd.stale > 0);
+		active = mZigbeeCmd.pending && !stale;
+		mZigbeeCmd.running = active;
+		handler = mZigbeeCmd.handler;
+		seq = mZigbeeCmd.seq;
+		irq_unlock(key);
+		dropped = false;
+		if (stale && rspEnd < mParserBuffer + len) {
+			/* Late response of a command that timed out, it must not complete the next one */
+			total_parsed = StatusEnd(mMatcher, mParserBuffer, rspEnd);
+			key = irq_lock();
+			mZigbeeCmd.stale--;
+			irq_unlock(key);
+			mStats.commandLateResponses++;
+			dropped = true;
+		} else if (active) {
+			mZigbeeCmd.streamed = 0;
+			parsed = handler(this, mParserBuffer, len);
+			key = irq_lock();
+			if (parsed > 0 && mZigbeeCmd.pending && mZigbeeCmd.seq == seq) {
+				if (mZigbeeCmd.lost) {
+					mZigbeeCmd.result = -EIO;
+				}
+				mZigbeeCmd.pending = false;
+				/* The NCP runs commands in turn, so those before it ended as well */
+				mZigbeeCmd.stale = 0;
+				mZigbeeCmd.doneTimestamp = LATENCY_TIMESTAMP();
+				k_sem_give(&mCmdSem);
+			} else if (parsed > 0 && EndsOnStatus(handler)) {
+				/* Timed out while its response was parsed, which was the late one */
+				mZigbeeCmd.stale--;
+				mStats.commandLateResponses++;
+			}
+			mZigbeeCmd.running = false;
+			k_sem_give(&mHandlerDoneSem);
+			irq_unlock(key);
+			parsed = (parsed > mZigbeeCmd.streamed) ? parsed : mZigbeeCmd.streamed;
+			total_parsed = (parsed > total_parsed) ? parsed : total_parsed;
+		}
+		total_parsed = ParseShellMessage(mParserBuffer, total_parsed, mParserBuffer + len);
+		/* After a late response the rest may be the response of the next command */
+		if (!active && !dropped) {
+			/* Output no command waits for, such as attribute reports, once its notifications are parsed */
+			total_parsed = LastLineEnd(mParserBuffer, total_parsed, mMatcher.Scanned());
+		}
+		/* Not the first line of a report whose second line is still to come */
+		total_parsed = MIN(total_parsed, mIncompleteLen);
+		TRACE(Trace::kEvent_ShellParsed, total_parsed, len);
+
+		if (gap != nullptr) {
+			/* What was not parsed before the gap is cut, and so is the line after it */
+			RxResync(len - total_parsed, 0);
+			total_parsed = len + 1;
+			mRxResync = true;
+		} else if (total_parsed == 0 && len == UNPARSED_BUF_LEN - 1) {
+			/* The buffer is full of lines no handler can complete, only its last line is kept */
+			parsed = LastLineEnd(mParserBuffer, 0, mMatcher.Scanned());
+			total_parsed = (parsed > 0) ? parsed : len;
+			mRxResync = (parsed == 0);
+			RxResync(total_parsed, 1);
+		}
+		if (total_parsed == 0) {
+			break;
+		}
+		moved = RxConsume(total_parsed);
+		/* Markers past the match limit are found by scanning again after what was parsed */
+		if (moved == 0 && gap == nullptr && !mRxResync && !dropped && mMatcher.Scanned() == len) {
+			break;
 		}
 	}
 }
 
-int ZigbeeShell::WriteCmd(const char *cmd, ZigbeeResponseHandler rspHandler)
+void ZigbeeShell::ForgetStale()
 {
-	int err = 0;
-	size_t len;
-
-	len = strlen(cmd);
-	if (len + 2 > MAX_ZIGBEE_CMD_LEN) {
-		LOG_INF("Not enough buffer to put Zigbee shell command");
-		return -ENOMEM;
-	}
-	memset(mZigbeeCmd.command, 0, sizeof(mZigbeeCmd.command));
-	memcpy(mZigbeeCmd.command, cmd, len);
-	mZigbeeCmd.command[len] = '\r';
-	mZigbeeCmd.command[len + 1] = '\n';
-	mZigbeeCmd.handler = rspHandler;
-	err = uart_tx(mUartDev, (const uint8_t *)mZigbeeCmd.command, strlen(mZigbeeCmd.command), 10);
-	if (err) {
-		LOG_ERR("uart_tx fail: %d", err);
+	unsigned int key = irq_lock();
+
+	mZigbeeCmd.stale = 0;
+	irq_unlock(key);
+}
+
+void ZigbeeShell::RxResync(size_t dropped, uint32_t cause)
+{
+	LOG_WRN("Zigbee shell output resynchronized, %zu bytes dropped", dropped);
+	mStats.rxResyncs++;
+	mStats.rxDroppedBytes += dropped;
+	mZigbeeCmd.lost |= mZigbeeCmd.pending;
+	TRACE(Trace::kEvent_ShellResync, dropped, cause);
+}
+
+size_t ZigbeeShell::RxConsume(size_t len)
+{
+	/* Remove parsed data from ring buffer */
+	if (ring_buf_get(&mShellRspRb, NULL, len) != len) {
+		LOG_ERR("Fail to release from ring buffer");
+		mStats.parserErrors++;
+	}
+	mNotifiedLen = (mNotifiedLen > len) ? mNotifiedLen - len : 0;
+
+	/* Bytes waiting in the RX buffers take the room made */
+	return RxDrain();
+}
+
+ZigbeeShell::CmdBuffer &ZigbeeShell::AcquireTx()
+{
+	if (k_sem_take(&mTxFreeSem, K_NO_WAIT)) {
+		/* Freed by UART_TX_DONE or UART_TX_ABORTED at the latest after the TX timeout */
+		mStats.txBufferWaits++;
+		k_sem_take(&mTxFreeSem, K_FOREVER);
+	}
+
+	return mTxBuf[mTxQueued % CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT].data;
+}
+
+void ZigbeeShell::TxStart()
+{
+	unsigned int key = irq_lock();
+
+	/* One buffer on the line at a time, the next is handed over on UART_TX_DONE */
+	while (mTxStarted == mTxDone && mTxStarted != mTxQueued) {
+		TxBuffer &buf = mTxBuf[mTxStarted % CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT];
+		int err;
+
+		mTxStarted++;
+		mTxStartCycles = k_cycle_get_32();
+		err = uart_tx(mUartDev, reinterpret_cast<const uint8_t *>(buf.data), buf.len,
+			      CONFIG_ZIGBEE_SHELL_TX_TIMEOUT_MS);
+		if (err) {
+			LOG_ERR("uart_tx fail: %d", err);
+			mStats.txAborted++;
+			buf.aborted = true;
+			mTxDone++;
+			k_sem_give(&mTxFreeSem);
+		}
+	}
+	irq_unlock(key);
+}
+
+void ZigbeeShell::TxComplete(bool aborted)
+{
+	unsigned int key = irq_lock();
+
+	mStats.txBusyUs += k_cyc_to_us_floor32(k_cycle_get_32() - mTxStartCycles);
+	mTxBuf[mTxDone % CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT].aborted = aborted;
+	mTxDone++;
+	k_sem_give(&mTxFreeSem);
+	irq_unlock(key);
+	TxStart();
+}
+
+int ZigbeeShell::SendCmd(size_t len, ZigbeeResponseHandler rspHandler, k_timeout_t timeout)
+{
+	TxBuffer &buf = mTxBuf[mTxQueued % CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT];
+	unsigned int key;
+	bool running, late;
+
+	buf.len = len;
+	buf.aborted = false;
+	/* A handler the RX thread still runs for a command that timed out returns first */
+	do {
+		key = irq_lock();
+		running = mZigbeeCmd.running;
+		if (running) {
+			/* Given once it returns, after this lock is released */
+			k_sem_reset(&mHandlerDoneSem);
+		} else {
+			mZigbeeCmd.seq++;
+			mZigbeeCmd.handler = rspHandler;
+			mZigbeeCmd.result = 0;
+			mZigbeeCmd.pending = (rspHandler != nullptr);
+			mZigbeeCmd.lost = false;
+			mZigbeeCmd.response[0] = '\0';
+		}
+		irq_unlock(key);
+		if (running) {
+			k_sem_take(&mHandlerDoneSem, K_FOREVER);
+		}
+	} while (running);
+	/* Drop a completion left over from a command that timed out */
+	k_sem_reset(&mCmdSem);
+	mZigbeeCmd.txTimestamp = LATENCY_TIMESTAMP();
+	mStats.commands++;
+	mStats.txBytes += len;
+	TRACE(Trace::kEvent_UartTx, len);
+	UART_CAPTURE(UartCapture::kDirection_Tx, (const uint8_t *)buf.data, len);
+	key = irq_lock();
+	mTxQueued++;
+	irq_unlock(key);
+	TxStart();
+	if (k_sem_take(&mCmdSem, timeout)) {
+		key = irq_lock();
+		late = mZigbeeCmd.pending;
+		mZigbeeCmd.pending = false;
+		/* Unless the NCP never got it whole, or the status line may be what a gap cut */
+		if (late && EndsOnStatus(rspHandler) && !buf.aborted && !mZigbeeCmd.lost) {
+			mZigbeeCmd.stale++;
+		}
+		irq_unlock(key);
+		/* Unless it completed between the timeout and the lock */
+		if (late || rspHandler == nullptr) {
+			/* The buffer is only taken again after the next command, so it is still intact */
+			LOG_ERR("Zigbee shell command timed out: %.*s", (int)len - 2, buf.data);
+			mStats.commandTimeouts++;
+			return -ETIMEDOUT;
+		}
+	}
+	if (mZigbeeCmd.result) {
+		mStats.commandErrors++;
 	}
-	k_sem_take(&mCmdSem, K_FOREVER);
 
 	return mZigbeeCmd.result;
 }
 
 void ZigbeeShell::UartCallback(const struct device *dev, struct uart_event *evt, void *user_data)
 {
-	int err;
-	static uint16_t pos;
-	uint32_t ret;
 	ZigbeeShell *shell = reinterpret_cast<ZigbeeShell *>(user_data);
+	size_t index;
+
+	ARG_UNUSED(dev);
 
 	switch (evt->type) {
 	case UART_TX_DONE:
-		LOG_DBG("Tx sent %d bytes", evt->data.tx.len);
+		LOG_DBG("Tx sent %zu bytes", evt->data.tx.len);
+		shell->TxComplete(false);
 		break;
 
 	case UART_TX_ABORTED:
-		LOG_ERR("Tx aborted");
+		LOG_ERR("Tx aborted after %zu bytes", evt->data.tx.len);
+		shell->mStats.txAborted++;
+		shell->TxComplete(true);
 		break;
 
 	case UART_RX_RDY:
-		LOG_HEXDUMP_DBG(evt->data.rx.buf, evt->data.rx.len, "Uart RX");
-		if (evt->data.rx.len > ring_buf_space_get(&shell->mShellRspRb)) {
-			LOG_ERR("Not enough buffer to store data! Drop old data.");
-			ret = ring_buf_get(&shell->mShellRspRb,
-					   NULL,
-					   evt->data.rx.len - ring_buf_space_get(&shell->mShellRspRb));
-			LOG_ERR("Drop %d of ring buffer", ret);
-		}
-		/* Store received data to the ring buffer. */
-		ret = ring_buf_put(&shell->mShellRspRb, evt->data.rx.buf + pos, evt->data.rx.len);
-		if (ret != evt->data.rx.len) {
-			LOG_ERR("Fail to put to ring buffer");
-		}
-		k_work_submit(&shell->mUartWork);
-		pos += evt->data.rx.len;
+		index = (evt->data.rx.buf - shell->mUartRxBuf[0]) / CONFIG_ZIGBEE_SHELL_RX_BUF_SIZE;
+		UART_CAPTURE(UartCapture::kDirection_Rx, evt->data.rx.buf + evt->data.rx.offset, evt->data.rx.len);
+		shell->mRxBufState[index].received = evt->data.rx.offset + evt->data.rx.len;
+		shell->mStats.rxBytes += evt->data.rx.len;
+		shell->RxDrain();
+		if (shell->mRxBufState[index].stored < shell->mRxBufState[index].received) {
+			LOG_DBG("Ring buffer full, bytes wait in RX buffer %zu", index);
+			shell->mStats.rxOverflows++;
+		}
+		TRACE(Trace::kEvent_UartRx, evt->data.rx.len,
+		      ring_buf_capacity_get(&shell->mShellRspRb) - ring_buf_space_get(&shell->mShellRspRb));
+		if (atomic_cas(&shell->mRxWakePending, 0, 1)) {
+			shell->mRxWakeTimestamp = LATENCY_TIMESTAMP();
+		}
+		k_sem_give(&shell->mRxSem);
 		break;
 
 	case UART_RX_BUF_REQUEST:
-	{
-		pos = 0;
-		LOG_DBG("RX_REQUEST: %p", shell->mNextUartBuf);
-		err = uart_rx_buf_rsp(shell->mUartDev,
-				      shell->mNextUartBuf,
-				      sizeof(shell->mUartRxBuf[0]));
-		if (err) {
-			LOG_WRN("UART RX buf rsp: %d", err);
-		}
+		shell->mRxStarved = true;
+		shell->RxProvideBuffer();
 		break;
-	}
 
 	case UART_RX_BUF_RELEASED:
 		LOG_DBG("RX_RELEASED: %p", evt->data.rx_buf.buf);
-		shell->mNextUartBuf = evt->data.rx_buf.buf;
+		index = (evt->data.rx_buf.buf - shell->mUartRxBuf[0]) / CONFIG_ZIGBEE_SHELL_RX_BUF_SIZE;
+		shell->mRxBufState[index].released = true;
+		shell->RxDrain();
 		break;
 
 	case UART_RX_DISABLED:
-		LOG_ERR("RX_DISABLED");
+		shell->mRxEnabled = false;
+		if (shell->mRxStarved) {
+			/* Only left without a buffer with flow control, which holds the NCP off meanwhile */
+			LOG_WRN("UART RX stalled, all buffers wait for the parser");
+			shell->mStats.rxStalls++;
+			shell->mRxLoss |= !shell->mRxFlowControl;
+			TRACE(Trace::kEvent_UartRxStall, shell->mRxTail - shell->mRxHead, shell->mRxFlowControl);
+		} else {
+			LOG_ERR("RX_DISABLED");
+			shell->mRxStarved = true;
+		}
+		/* Started again with the first buffer free */
+		shell->RxProvideBuffer();
 		break;
 
 	case UART_RX_STOPPED:
-		LOG_ERR("RX_STOPPED");
+		LOG_ERR("RX_STOPPED: %d", evt->data.rx_stop.reason);
+		shell->mRxLoss = true;
 		break;
 	}
 }
 
-size_t ZigbeeShell::ParseShellMessage(const char * szMsg)
+void ZigbeeShell::RxProvideBuffer()
 {
-	size_t parsed = 0, total_parsed = 0;
-	char *p, *end;
+	unsigned int key = irq_lock();
+	size_t index = mRxTail % CONFIG_ZIGBEE_SHELL_RX_BUF_COUNT;
+	int err;
 
-	/* Parse network join message */
-	p = strstr(szMsg, ZB_SHELL_MSG_JOIN_NETWORK);
-	if (p != nullptr) {
-		p = strstr(p, "Extended PAN ID: ");
-		if (p != nullptr) {
-			p = p + strlen("Extended PAN ID: ");
-			memcpy(this->mEvent.Bdb.ext_pan_id, p, EXT_PAN_ID_SIZE);
-			this->mEvent.Bdb.ext_pan_id[EXT_PAN_ID_SIZE] = 0;
-			p = strstr(p, "PAN ID: ");
-			if (p != nullptr) {
-				p = p + strlen("PAN ID: ");
-				this->mEvent.Bdb.pan_id = strtol(p, &end, 16);
-				if (p != end) {
-					LOG_INF("Joined network. Ext PAN ID: %s, PAN ID: 0x%04hx",
-							this->mEvent.Bdb.ext_pan_id, this->mEvent.Bdb.pan_id);
-					p = strstr(szMsg, ZB_SHELL_MSG_REJOIN);
-					if (p != nullptr) {
-						this->mEvent_CB(this, kEvent_NetworkRejoin);
-					} else {
-						this->mEvent_CB(this, kEvent_NetworkSteering);
-					}
-					parsed = end - szMsg;
-				}
+	if (!mRxStarved) {
+		irq_unlock(key);
+		return;
+	}
+	/* A stopped receiver holds the NCP off with flow control, without it the receiver is kept going */
+	if (mRxTail - mRxHead == CONFIG_ZIGBEE_SHELL_RX_BUF_COUNT && (mRxFlowControl || !RxReclaim())) {
+		irq_unlock(key);
+		return;
+	}
+	mRxBufState[index] = {};
+	mRxBufState[index].gapBefore = mRxLoss && !mRxEnabled;
+	if (mRxEnabled) {
+		err = uart_rx_buf_rsp(mUartDev, mUartRxBuf[index], CONFIG_ZIGBEE_SHELL_RX_BUF_SIZE);
+	} else {
+		err = uart_rx_enable(mUartDev, mUartRxBuf[index], CONFIG_ZIGBEE_SHELL_RX_BUF_SIZE,
+				     CONFIG_ZIGBEE_SHELL_RX_TIMEOUT_US);
+	}
+	/* A receiver stopping at the end of its buffer is started again on UART_RX_DISABLED */
+	if (err) {
+		LOG_DBG("UART RX buffer not taken: %d", err);
+		irq_unlock(key);
+		return;
+	}
+	if (!mRxEnabled) {
+		mRxEnabled = true;
+		mRxLoss = false;
+	}
+	mRxStarved = false;
+	mRxTail++;
+	irq_unlock(key);
+}
+
+bool ZigbeeShell::RxReclaim()
+{
+	RxBufState &state = mRxBufState[mRxHead % CONFIG_ZIGBEE_SHELL_RX_BUF_COUNT];
+
+	if (!state.released) {
+		return false;
+	}
+	/* A released buffer left waiting has bytes the ring buffer had no room for, they make a gap */
+	mStats.rxOverrunBytes += state.received - state.stored;
+	mRxHead++;
+	mRxBufState[mRxHead % CONFIG_ZIGBEE_SHELL_RX_BUF_COUNT].gapBefore = true;
+	TRACE(Trace::kEvent_UartRxStall, state.received - state.stored, mRxFlowControl);
+
+	return true;
+}
+
+size_t ZigbeeShell::RxDrain()
+{
+	unsigned int key = irq_lock();
+	size_t moved = 0;
+
+	while (mRxHead != mRxTail) {
+		size_t index = mRxHead % CONFIG_ZIGBEE_SHELL_RX_BUF_COUNT;
+		RxBufState &state = mRxBufState[index];
+		uint32_t put;
+
+		if (state.gapBefore) {
+			const uint8_t gap = kRxGap;
+
+			if (ring_buf_put(&mShellRspRb, &gap, 1) == 0) {
+				break;
 			}
+			state.gapBefore = false;
+			moved++;
 		}
+		put = ring_buf_put(&mShellRspRb, mUartRxBuf[index] + state.stored, state.received - state.stored);
+		state.stored += put;
+		moved += put;
+		if (state.stored < state.received || !state.released) {
+			break;
+		}
+		mRxHead++;
+		RxProvideBuffer();
+	}
+	irq_unlock(key);
+
+	return moved;
+}
+
+/* Notifications the NCP prints on its own, each a log line starting at its marker */
+const ZigbeeShell::Notification ZigbeeShell::sNotifications[] = {
+	{ ShellMatcher::kMarker_JoinNetwork, &ZigbeeShell::ParseJoinNetwork, 1 },
+	{ ShellMatcher::kMarker_DeviceRejoin, &ZigbeeShell::ParseDeviceAnnounce, 1 },
+	{ ShellMatcher::kMarker_AttrReport, &ZigbeeShell::ParseAttrReport, 2 },
+};
+
+size_t ZigbeeShell::ParseShellMessage(const char *szMsg, size_t parsed, const char *until)
+{
+	for (size_t i = 0; i < mMatcher.Count(); i++) {
+		const char *marker = mMatcher.GetStart(i);
+
+		if (marker < szMsg + mNotifiedLen || marker >= until) {
+			continue;
+		}
+		for (const Notification &notification : sNotifications) {
+			if (mMatcher.GetMarker(i) != notification.marker) {
+				continue;
+			}
+
+			const char *lineEnd = strchr(mMatcher.GetEnd(i), '\n');
+
+			for (uint8_t line = 1; line < notification.lines && lineEnd != nullptr; line++) {
+				lineEnd = strchr(lineEnd + 1, '\n');
+			}
+
+			/* The rest of the line is still to come */
+			if (lineEnd == nullptr) {
+				mIncompleteLen = LastLineEnd(szMsg, 0, marker - szMsg);
+				LOG_DBG("%zu bytes parsed", parsed);
+				return parsed;
+			}
+			(this->*notification.parse)(marker, lineEnd);
+			/* Lines of a response still to complete stay for its handler */
+			if (StartsLine(szMsg + parsed, marker)) {
+				parsed = lineEnd + 1 - szMsg;
+			}
+			mNotifiedLen = lineEnd + 1 - szMsg;
+		}
+	}
+	LOG_DBG("%zu bytes parsed", parsed);
+
+	return parsed;
+}
+
+void ZigbeeShell::ParseJoinNetwork(const char *marker, const char *lineEnd)
+{
+	struct BdbEvent bdb;
+	const char *p;
+	char *end;
+
+	p = mMatcher.Find(ShellMatcher::kMarker_ExtPanId, marker);
+	if (p == nullptr || p > lineEnd) {
+		return;
+	}
+	p = p + strlen("Extended PAN ID: ");
+	memcpy(bdb.ext_pan_id, p, EXT_PAN_ID_SIZE);
+	bdb.ext_pan_id[EXT_PAN_ID_SIZE] = 0;
+	/* "PAN ID: " also ends "Extended PAN ID: ", which starts before p */
+	p = mMatcher.Find(ShellMatcher::kMarker_PanId, p);
+	if (p == nullptr || p > lineEnd) {
+		return;
+	}
+	p = p + strlen("PAN ID: ");
+	bdb.pan_id = strtol(p, &end, 16);
+	if (p == end) {
+		return;
+	}
+	LOG_INF("Joined network. Ext PAN ID: %s, PAN ID: 0x%04hx", bdb.ext_pan_id, bdb.pan_id);
+	p = mMatcher.Find(ShellMatcher::kMarker_RebootSignal, marker);
+
+	EventPayload *event =
+		AllocEvent((p != nullptr && p < lineEnd) ? kEvent_NetworkRejoin : kEvent_NetworkSteering);
+
+	if (event != nullptr) {
+		event->Bdb = bdb;
+		NotifyEvent(event);
 	}
-	total_parsed = (parsed > total_parsed) ? parsed : total_parsed;
-	/* Device annoucement message */
-	p = strstr(szMsg, ZB_SHELL_MSG_DEVICE_REJOIN);
-	if ((p != nullptr) && (p > szMsg)) {
-		uint16_t dev_addr;
+}
+
+void ZigbeeShell::ParseDeviceAnnounce(const char *marker, const char *lineEnd)
+{
+	uint16_t dev_addr;
 
-		parsed = p - mParserBuffer + strlen(ZB_SHELL_MSG_DEVICE_REJOIN) + strlen("xxxx)");
-		dev_addr = strtol(p + strlen(ZB_SHELL_MSG_DEVICE_REJOIN), NULL, 16);
-		LOG_INF("DEV announce: 0x%04hx", dev_addr);
-		this->mEvent.Zdo.addr = dev_addr;
-		this->mEvent_CB(this, kEvent_DeviceAnnounceRsp);
+	ARG_UNUSED(lineEnd);
+
+	dev_addr = strtol(marker + strlen(ZB_SHELL_MSG_DEVICE_REJOIN), NULL, 16);
+	LOG_INF("DEV announce: 0x%04hx", dev_addr);
+	EventPayload *event = AllocEvent(kEvent_DeviceAnnounceRsp);
+
+	if (event != nullptr) {
+		event->Zdo.addr = dev_addr;
+		NotifyEvent(event);
 	}
-	total_parsed = (parsed > total_parsed) ? parsed : total_parsed;
-	LOG_DBG("%d bytes parsed", total_parsed);
+}
 
-	return total_parsed;
+/* Skips the text expected at p, nullptr when another one is there */
+static const char *SkipText(const char *p, const char *text)
+{
+	size_t len = strlen(text);
+
+	return strncmp(p, text, len) == 0 ? p + len : nullptr;
+}
+
+void ZigbeeShell::ParseAttrReport(const char *marker, const char *lineEnd)
+{
+	struct ZclEvent zcl = {};
+	const char *p = marker + strlen(ZB_SHELL_MSG_ATTR_REPORT);
+	const char *value_end = lineEnd;
+	char *end;
+
+	/* <addr>, then on the next line <profile> Cluster: 0x<cluster> Attribute: 0x<attr> Type: <type> Value: <value> */
+	zcl.addr = strtol(p, &end, 16);
+	p = mMatcher.Find(ShellMatcher::kMarker_AttrReportValue, end);
+	if (p != nullptr && p < lineEnd) {
+		strtol(p + strlen(ZB_SHELL_MSG_ATTR_REPORT_VALUE), &end, 16);
+		p = SkipText(end, " Cluster: 0x");
+	} else {
+		p = nullptr;
+	}
+	if (p != nullptr) {
+		zcl.cluster_id = strtol(p, &end, 16);
+		p = SkipText(end, " Attribute: 0x");
+	}
+	if (p != nullptr) {
+		zcl.attr_id = strtol(p, &end, 16);
+		p = SkipText(end, " Type: ");
+	}
+	if (p != nullptr) {
+		zcl.type = strtol(p, &end, 10);
+		p = SkipText(end, " Value: ");
+	}
+	if (p == nullptr) {
+		LOG_WRN("Can't parse attr report");
+		mStats.parserErrors++;
+		return;
+	}
+	if (value_end > p && value_end[-1] == '\r') {
+		value_end--;
+	}
+	if (value_end - p > ZB_ZCL_MAX_ATTR_SIZE) {
+		LOG_ERR("Fail to parse attr value");
+		mStats.parserErrors++;
+		return;
+	}
+	zcl.len = value_end - p;
+	memcpy(zcl.value, p, zcl.len);
+
+	EventPayload *event = AllocEvent(kEvent_ZclAttrReport);
+
+	if (event != nullptr) {
+		event->Zcl = zcl;
+		NotifyEvent(event);
+	}
 }
 
 ZigbeeShell::ZigbeeShell(void)
+	: mRxHead(0), mRxTail(0), mRxEnabled(false), mRxStarved(false), mRxLoss(false), mRxFlowControl(false),
+	  mRxResync(false), mTxDone(0), mTxStarted(0), mTxQueued(0), mTxStartCycles(0)
 {
+	struct uart_config config;
 	int err;
 
-	k_work_init(&mUartWork, UartWorkHandler);
 	k_sem_init(&mCmdSem, 0, 1);
+	k_sem_init(&mHandlerDoneSem, 0, 1);
+	k_sem_init(&mTxFreeSem, CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT, CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT);
+	k_sem_init(&mRxSem, 0, 1);
+	atomic_clear(&mRxWakePending);
+	k_thread_create(&mRxThread, sRxThreadStack, K_THREAD_STACK_SIZEOF(sRxThreadStack), RxThreadMain, this,
+			nullptr, nullptr, CONFIG_ZIGBEE_SHELL_THREAD_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&mRxThread, "zb_rx");
 
 	mUartDev = device_get_binding(CONFIG_ZIGBEE_SHELL_DEVICE_NAME);
 	if (!mUartDev) {
@@ -400,30 +1049,240 @@ ZigbeeShell::ZigbeeShell(void)
 	if (err != 0) {
 		LOG_ERR("Failed to set callback: %d", err);
 	}
-	mNextUartBuf = mUartRxBuf[1];
-	err = uart_rx_enable(mUartDev, mUartRxBuf[0], UART_BUF_SIZE, 50000);
-	if (err != 0) {
-		LOG_ERR("Failed to enable RX: %d", err);
-	}
-	ring_buf_init(&mShellRspRb, sizeof(mShellRspBuffer), mShellRspBuffer);
-
-	k_sleep(K_MSEC(10));
+	/* A stalled receiver loses no byte when the NCP is held off with RTS */
+	mRxFlowControl = (uart_config_get(mUartDev, &config) == 0 && config.flow_ctrl == UART_CFG_FLOW_CTRL_RTS_CTS);
+	LOG_INF("UART flow control %s", mRxFlowControl ? "on" : "off");
 
-	err = WriteCmd("kernel reboot cold", nullptr);
-	if (err) {
-		LOG_ERR("Fail to reboot Zigbee shell");
+	ring_buf_init(&mShellRspRb, sizeof(mShellRspBuffer), mShellRspBuffer);
+	mRxStarved = true;
+	RxProvideBuffer();
+	if (!mRxEnabled) {
+		LOG_ERR("Failed to enable RX");
 	}
+}
 
-	k_sleep(K_MSEC(100));
+ZigbeeShell::ZigbeeShell(Detached)
+	: mZigbeeCmd(), mUartDev(nullptr), mRxHead(0), mRxTail(0), mRxEnabled(false), mRxStarved(false),
+	  mRxLoss(false), mRxFlowControl(false), mRxResync(false), mTxDone(0), mTxStarted(0), mTxQueued(0),
+	  mTxStartCycles(0), mRxWakeTimestamp(0), mNotifiedLen(0), mIncompleteLen(0), mEvent_CB(nullptr)
+{
+	k_sem_init(&mCmdSem, 0, 1);
+	k_sem_init(&mHandlerDoneSem, 0, 1);
+	k_sem_init(&mTxFreeSem, CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT, CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT);
+	k_sem_init(&mRxSem, 0, 1);
+	atomic_clear(&mRxWakePending);
+	ring_buf_init(&mShellRspRb, sizeof(mShellRspBuffer), mShellRspBuffer);
+}
+
+int ZigbeeShell::ConfigureShell(void)
+{
+	int err;
 
 	err = WriteCmd("shell colors off", ShellRspHandler);
 	if (err) {
 		LOG_ERR("Fail to shell color");
+		return err;
 	}
 	err = WriteCmd("shell echo off", ShellRspHandler);
 	if (err) {
 		LOG_ERR("Fail to set echo");
 	}
+
+	return err;
+}
+
+#ifdef CONFIG_ZIGBEE_SHELL_LINK_SETUP
+bool ZigbeeShell::ProbeLink(struct uart_config &config, uint32_t baudRate, bool flowControl)
+{
+	unsigned int key;
+	int err;
+
+	config.baudrate = baudRate;
+	config.flow_ctrl = flowControl ? UART_CFG_FLOW_CTRL_RTS_CTS : UART_CFG_FLOW_CTRL_NONE;
+	err = uart_configure(mUartDev, &config);
+	if (err) {
+		LOG_DBG("UART %u baud, flow control %d not supported: %d", baudRate, flowControl, err);
+		return false;
+	}
+	key = irq_lock();
+	mRxFlowControl = flowControl;
+	irq_unlock(key);
+	mStartInfo.linkProbes++;
+
+	/* Bytes garbled at another rate are dropped with the response they cut, then it is sent again */
+	err = WriteCmd("shell echo off", ShellRspHandler, K_MSEC(CONFIG_ZIGBEE_SHELL_LINK_PROBE_TIMEOUT_MS));
+	if (err == -EIO) {
+		err = WriteCmd("shell echo off", ShellRspHandler, K_MSEC(CONFIG_ZIGBEE_SHELL_LINK_PROBE_TIMEOUT_MS));
+	}
+
+	return err == 0;
+}
+
+int ZigbeeShell::SetupLink(void)
+{
+	struct uart_config initial, config;
+	const char *rates = CONFIG_ZIGBEE_SHELL_BAUD_RATES;
+	uint32_t baudRate = 0;
+	char *end;
+	int err;
+
+	err = uart_config_get(mUartDev, &initial);
+	if (err) {
+		LOG_ERR("Failed to get the UART configuration: %d", err);
+		return err;
+	}
+	config = initial;
+	/* What the NCP sent at another rate was garbled */
+	ForgetStale();
+
+	/* The NCP sends at the rate of its own configuration, found by probing from the fastest */
+	for (;;) {
+		uint32_t rate = strtoul(rates, &end, 10);
+
+		if (end == rates) {
+			break;
+		}
+		rates = end;
+		if (ProbeLink(config, rate, false)) {
+			baudRate = rate;
+			break;
+		}
+	}
+	if (baudRate == 0) {
+		LOG_WRN("NCP answered at no baud rate of the list, keeping %u", initial.baudrate);
+		ProbeLink(initial, initial.baudrate, initial.flow_ctrl == UART_CFG_FLOW_CTRL_RTS_CTS);
+		return -EIO;
+	}
+#ifdef CONFIG_ZIGBEE_SHELL_FLOW_CONTROL
+	/* Without RTS/CTS wired on both sides nothing goes through, so the link is left without */
+	if (!ProbeLink(config, baudRate, true)) {
+		LOG_WRN("NCP does not answer with flow control, left off");
+		ProbeLink(config, baudRate, false);
+	}
+#endif
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_ZIGBEE_SHELL_WARM_START
+bool ZigbeeShell::ProbeWarmStart(void)
+{
+	k_timeout_t timeout = K_MSEC(CONFIG_ZIGBEE_SHELL_PROBE_TIMEOUT_MS);
+
+	if (WriteCmd("bdb role", ValueRspHandler, timeout) || strcmp(mZigbeeCmd.response, "zc")) {
+		LOG_INF("NCP role \"%s\", cold start", mZigbeeCmd.response);
+		return false;
+	}
+	/* A coordinator that formed its network has the short address 0x0000 */
+	if (WriteCmd("zdo short", ValueRspHandler, timeout) || strcmp(mZigbeeCmd.response, "0000")) {
+		LOG_INF("NCP short address \"%s\", cold start", mZigbeeCmd.response);
+		return false;
+	}
+	if (WriteCmd("bdb extpanid", ValueRspHandler, timeout) ||
+	    strspn(mZigbeeCmd.response, "0") == strlen(mZigbeeCmd.response)) {
+		LOG_INF("NCP has no network, cold start");
+		return false;
+	}
+	if (strlen(CONFIG_ZIGBEE_SHELL_EXT_PAN_ID) > 0 &&
+	    strcasecmp(mZigbeeCmd.response, CONFIG_ZIGBEE_SHELL_EXT_PAN_ID)) {
+		LOG_INF("NCP on network %s, expected %s, cold start", mZigbeeCmd.response,
+			CONFIG_ZIGBEE_SHELL_EXT_PAN_ID);
+		return false;
+	}
+
+	return true;
+}
+#endif
+
+int ZigbeeShell::Start(void)
+{
+	uint32_t start = k_uptime_get_32();
+	struct uart_config config;
+	int err;
+
+	k_sleep(K_MSEC(10));
+
+#ifdef CONFIG_ZIGBEE_SHELL_LINK_SETUP
+	SetupLink();
+#endif
+	mStartInfo.baudRate = 0;
+	if (uart_config_get(mUartDev, &config) == 0) {
+		mStartInfo.baudRate = config.baudrate;
+	}
+	mStartInfo.flowControl = mRxFlowControl;
+	LOG_INF("Zigbee NCP link at %u baud, flow control %s", mStartInfo.baudRate,
+		mStartInfo.flowControl ? "on" : "off");
+
+#ifdef CONFIG_ZIGBEE_SHELL_WARM_START
+	/* Nothing sent before the start is answered after it */
+	ForgetStale();
+	/* Colors and echo are already off on a running NCP, then these are quick no-ops */
+	mStartInfo.warmStart = !ConfigureShell() && ProbeWarmStart();
+#endif
+	if (!mStartInfo.warmStart) {
+		err = WriteCmd("kernel reboot cold", nullptr);
+		if (err) {
+			LOG_ERR("Fail to reboot Zigbee shell");
+		}
+
+		k_sleep(K_MSEC(100));
+		/* The responses of the commands that timed out before the reboot never come */
+		ForgetStale();
+
+		ConfigureShell();
+		err = BdbStart();
+		if (err) {
+			return err;
+		}
+	} else {
+		/* No rejoin signal comes from a running NCP, so announce the network to start discovery */
+		EventPayload *event = AllocEvent(kEvent_NetworkRejoin);
+
+		if (event != nullptr) {
+			/* Left NUL terminated by AllocEvent() */
+			memcpy(event->Bdb.ext_pan_id, mZigbeeCmd.response,
+			       MIN(strlen(mZigbeeCmd.response), (size_t)EXT_PAN_ID_SIZE));
+			NotifyEvent(event);
+		}
+	}
+
+	mStartInfo.readyUptimeMs = k_uptime_get_32();
+	mStartInfo.durationMs = mStartInfo.readyUptimeMs - start;
+	LOG_INF("Zigbee NCP ready %u ms after boot (%s start in %u ms)", mStartInfo.readyUptimeMs,
+		mStartInfo.warmStart ? "warm" : "cold", mStartInfo.durationMs);
+
+	return 0;
+}
+
+void ZigbeeShell::StartThreadMain(void *arg1, void *arg2, void *arg3)
+{
+	ZigbeeShell *shell = static_cast<ZigbeeShell *>(arg1);
+	int err;
+
+	ARG_UNUSED(arg2);
+	ARG_UNUSED(arg3);
+
+	err = shell->Start();
+	if (err) {
+		LOG_ERR("Zigbee NCP start failed: %d", err);
+	} else {
+		EventPayload *event = shell->AllocEvent(kEvent_Ready);
+
+		if (event != nullptr) {
+			shell->NotifyEvent(event);
+		}
+	}
+	/* The thread ends here, its trace ring is left to the threads that come later */
+	TRACE_RELEASE_RING();
+}
+
+void ZigbeeShell::StartAsync(void)
+{
+	/* Runs Start() next to the caller, which learns the outcome from the kEvent_Ready event */
+	k_thread_create(&mStartThread, sStartThreadStack, K_THREAD_STACK_SIZEOF(sStartThreadStack), StartThreadMain,
+			this, nullptr, nullptr, k_thread_priority_get(k_current_get()), 0, K_NO_WAIT);
+	k_thread_name_set(&mStartThread, "zb_start");
 }
 
 int ZigbeeShell::BdbStart(void)
@@ -453,38 +1312,20 @@ int ZigbeeShell::NetworkSteering(void)
 
 int ZigbeeShell::ZdoActiveEpReq(uint16_t addr)
 {
-	int err = 0;
-	char cmd[MAX_ZIGBEE_CMD_LEN];
-
 	LOG_INF("Request active endpoint of addr: 0x%04hx", addr);
-	sprintf(cmd, "zdo active_ep 0x%04hx", addr);
-	err = WriteCmd(cmd, ZdoActiveEpRspHandler);
-
-	return err;
+	return SendCmd(EncodeZdoActiveEpReq(AcquireTx(), addr), ZdoActiveEpRspHandler);
 }
 
 int ZigbeeShell::ZdoSimpleDescReq(uint16_t addr, uint8_t ep)
 {
-	int err = 0;
-	char cmd[MAX_ZIGBEE_CMD_LEN];
-
 	LOG_INF("Request simple descriptor of addr: 0x%04hx ep: %d ", addr, ep);
-	sprintf(cmd, "zdo simple_desc_req 0x%04hx %d", addr, ep);
-	err = WriteCmd(cmd, ZdoSimpleDescRspHandler);
-
-	return err;
+	return SendCmd(EncodeZdoSimpleDescReq(AcquireTx(), addr, ep), ZdoSimpleDescRspHandler);
 }
 
 int ZigbeeShell::ZclCmd(uint16_t addr, uint8_t ep, uint16_t cluster, uint16_t cmd_id)
 {
-	int err = 0;
-	char cmd[MAX_ZIGBEE_CMD_LEN];
-
-	LOG_INF("Send ZCL cmd. addr: 0x%04hx ep: %d cluster: 0x%04hx cmd_id: 0x%04hx", addr, ep, cluster, cmd_id);
-	sprintf(cmd, "zcl cmd -d 0x%04hx %d 0x%04hx 0x%04hx", addr, ep, cluster, cmd_id);
-	err = WriteCmd(cmd, GeneralRspHandler);
-
-	return err;
+	TRACE(Trace::kEvent_ZclCmd, addr, (ep << 16) | cluster, cmd_id);
+	return SendCmd(EncodeZclCmd(AcquireTx(), addr, ep, cluster, cmd_id), GeneralRspHandler);
 }
 
 int ZigbeeShell::ZclAttrRead(uint16_t addr,
@@ -493,18 +1334,24 @@ int ZigbeeShell::ZclAttrRead(uint16_t addr,
 			     enum Cluster_t cluster_id,
 			     uint16_t attr_id)
 {
-	int err = 0;
-	char cmd[MAX_ZIGBEE_CMD_LEN];
-
-	LOG_INF("Read ZCL attr addr: 0x%04hx ep: %d cluster: 0x%04hx attr_id: 0x%04hx", addr, ep, cluster_id, attr_id);
-	sprintf(cmd, "zcl attr read 0x%04hx %d 0x%04hx 0x%04hx 0x%04hx", addr, ep, cluster_id, profile_id, attr_id);
-	mEvent.Zcl.addr = addr;
-	mEvent.Zcl.ep = ep;
-	mEvent.Zcl.cluster_id = cluster_id;
-	mEvent.Zcl.attr_id = attr_id;
-	err = WriteCmd(cmd, ZclAttrReadRspHandler);
+	TRACE(Trace::kEvent_ZclAttrRead, addr, (ep << 16) | cluster_id, attr_id);
+	memset(&mZigbeeCmd.zclRead, 0, sizeof(mZigbeeCmd.zclRead));
+	mZigbeeCmd.zclRead.addr = addr;
+	mZigbeeCmd.zclRead.ep = ep;
+	mZigbeeCmd.zclRead.cluster_id = cluster_id;
+	mZigbeeCmd.zclRead.attr_id = attr_id;
+
+	return SendCmd(EncodeZclAttrRead(AcquireTx(), addr, ep, profile_id, cluster_id, attr_id),
+		       ZclAttrReadRspHandler);
+}
 
-	return err;
+int ZigbeeShell::ZclSubscribe(uint16_t addr, uint8_t ep, uint16_t profile_id, enum Cluster_t cluster_id,
+			      uint16_t attr_id, enum ZclAttrType_t type, uint16_t min_interval_s, uint16_t max_interval_s)
+{
+	/* The device answers with the status of the report configuration, an error when it cannot report */
+	return SendCmd(EncodeZclSubscribe(AcquireTx(), addr, ep, profile_id, cluster_id, attr_id, type, min_interval_s,
+					  max_interval_s),
+		       GeneralRspHandler);
 }
 
 int ZigbeeShell::ZdoMatchDesc(uint16_t dst_addr,
@@ -515,23 +1362,103 @@ int ZigbeeShell::ZdoMatchDesc(uint16_t dst_addr,
 			      uint8_t out_cluster_cnt,
 			      uint16_t *out_clusters)
 {
-	int err = 0;
-	char cmd[MAX_ZIGBEE_CMD_LEN], in_cluster_str[32], out_cluster_str[32];
-
-	memset(cmd, 0, sizeof(cmd));
-	memset(in_cluster_str, 0, sizeof(in_cluster_str));
-	memset(out_cluster_str, 0, sizeof(out_cluster_str));
-	for (auto i = 0; i < in_cluster_cnt; i++) {
-		sprintf(in_cluster_str + 2*i, "%hx ", *(in_clusters + 2*i));
+	if (in_cluster_cnt > ZDO_MATCH_DESC_MAX_CLUSTERS || out_cluster_cnt > ZDO_MATCH_DESC_MAX_CLUSTERS) {
+		LOG_ERR("Too many clusters to match: %u in, %u out", in_cluster_cnt, out_cluster_cnt);
+		return -EINVAL;
 	}
-	for (auto i = 0; i < out_cluster_cnt; i++) {
-		sprintf(out_cluster_str + 2*i, "%hx ", *(out_clusters + 2*i));
-	}
-	sprintf(cmd, "zdo match_desc 0x%04hx 0x%04hx 0x%04hx %d %s %d %s -t 5",
-		dst_addr, req_addr, profile_id, in_cluster_cnt, in_cluster_str, out_cluster_cnt, out_cluster_str);
-	err = WriteCmd(cmd, ZdoActiveEpRspHandler);
 
-	return err;
+	return SendCmd(EncodeZdoMatchDesc(AcquireTx(), dst_addr, req_addr, profile_id, in_cluster_cnt,
+					  in_clusters, out_cluster_cnt, out_clusters),
+		       ZdoActiveEpRspHandler);
+}
+
+size_t ZigbeeShell::EncodeZdoActiveEpReq(CmdBuffer &cmd, uint16_t addr)
+{
+	return BuildZigbeeCmd(cmd).Text("zdo active_ep ").Hex16(addr).End();
+}
+
+size_t ZigbeeShell::EncodeZdoSimpleDescReq(CmdBuffer &cmd, uint16_t addr, uint8_t ep)
+{
+	return BuildZigbeeCmd(cmd).Text("zdo simple_desc_req ").Hex16(addr).Text(" ").Dec8(ep).End();
+}
+
+size_t ZigbeeShell::EncodeZclCmd(CmdBuffer &cmd, uint16_t addr, uint8_t ep, uint16_t cluster, uint16_t cmd_id)
+{
+	return BuildZigbeeCmd(cmd)
+		.Text("zcl cmd -d ")
+		.Hex16(addr)
+		.Text(" ")
+		.Dec8(ep)
+		.Text(" ")
+		.Hex16(cluster)
+		.Text(" ")
+		.Hex16(cmd_id)
+		.End();
+}
+
+size_t ZigbeeShell::EncodeZclAttrRead(CmdBuffer &cmd, uint16_t addr, uint8_t ep, uint16_t profile_id,
+				      uint16_t cluster_id, uint16_t attr_id)
+{
+	return BuildZigbeeCmd(cmd)
+		.Text("zcl attr read ")
+		.Hex16(addr)
+		.Text(" ")
+		.Dec8(ep)
+		.Text(" ")
+		.Hex16(cluster_id)
+		.Text(" ")
+		.Hex16(profile_id)
+		.Text(" ")
+		.Hex16(attr_id)
+		.End();
+}
+
+size_t ZigbeeShell::EncodeZclSubscribe(CmdBuffer &cmd, uint16_t addr, uint8_t ep, uint16_t profile_id,
+				       uint16_t cluster_id, uint16_t attr_id, uint8_t type, uint16_t min_interval_s,
+				       uint16_t max_interval_s)
+{
+	return BuildZigbeeCmd(cmd)
+		.Text("zcl subscribe on ")
+		.Hex16(addr)
+		.Text(" ")
+		.Dec8(ep)
+		.Text(" ")
+		.Hex16(cluster_id)
+		.Text(" ")
+		.Hex16(profile_id)
+		.Text(" ")
+		.Hex16(attr_id)
+		.Text(" ")
+		.Dec8(type)
+		.Text(" ")
+		.Dec16(min_interval_s)
+		.Text(" ")
+		.Dec16(max_interval_s)
+		.End();
+}
+
+size_t ZigbeeShell::EncodeZdoMatchDesc(CmdBuffer &cmd, uint16_t dst_addr, uint16_t req_addr, uint16_t profile_id,
+				       uint8_t in_cluster_cnt, const uint16_t *in_clusters, uint8_t out_cluster_cnt,
+				       const uint16_t *out_clusters)
+{
+	/* Each cluster list ends with a space, so the lists are followed by two */
+	return BuildZigbeeCmd(cmd)
+		.Text("zdo match_desc ")
+		.Hex16(dst_addr)
+		.Text(" ")
+		.Hex16(req_addr)
+		.Text(" ")
+		.Hex16(profile_id)
+		.Text(" ")
+		.Dec8(in_cluster_cnt)
+		.Text(" ")
+		.HexList<ZDO_MATCH_DESC_MAX_CLUSTERS>(in_clusters, in_cluster_cnt)
+		.Text(" ")
+		.Dec8(out_cluster_cnt)
+		.Text(" ")
+		.HexList<ZDO_MATCH_DESC_MAX_CLUSTERS>(out_clusters, out_cluster_cnt)
+		.Text(" -t 5")
+		.End();
 }
 
 void ZigbeeShell::SetEventCallback(zigbee_event_handler_t zigbee_event_handler)
@@ -6,8 +6,13 @@
 
 #pragma once
 
+#include "latency_histogram.h"
+#include "shell_matcher.h"
+#include "zigbee_cmd_builder.h"
+
 #include <functional>
 #include <zephyr.h>
+#include <sys/atomic.h>
 #include <sys/ring_buffer.h>
 
 #define ZB_SHELL_MSG_PROMPT "uart:~$"
@@ -16,13 +21,26 @@
 #define ZB_SHELL_MSG_DEVICE_REJOIN "rejoined (short: 0x"
 #define ZB_SHELL_MSG_JOIN_NETWORK "Joined network successfully"
 #define ZB_SHELL_MSG_REJOIN "on reboot signal"
+/*
+ * Attribute report of "zcl subscribe on", logged by the shell in two lines:
+ * "Received value updates from the remote node 0x<addr>" then
+ * "Profile: 0x<profile> Cluster: 0x<cluster> Attribute: 0x<attr> Type: <type> Value: <value>",
+ * with the type in decimal. The report does not give the endpoint.
+ */
+#define ZB_SHELL_MSG_ATTR_REPORT "Received value updates from the remote node 0x"
+#define ZB_SHELL_MSG_ATTR_REPORT_VALUE "Profile: 0x"
 
 #define UNPARSED_BUF_LEN 1024
 #define MAX_ZIGBEE_CMD_LEN 128
-#define UART_BUF_SIZE	256
-#define UART_RX_BUF_NUM	2
 #define ZB_ZCL_MAX_ATTR_SIZE 40
 #define EXT_PAN_ID_SIZE 16
+/* Clusters of each list of a match descriptor request */
+#define ZDO_MATCH_DESC_MAX_CLUSTERS 6
+
+namespace Bench {
+class Runner;
+void RunZigbeeShellBenchmarks(Runner &runner);
+} /* namespace Bench */
 
 class ZigbeeShell
 {
@@ -34,7 +52,9 @@ public:
 		kEvent_DeviceAnnounceRsp,
 		kEvent_ActiveEpRsp,
 		kEvent_SimpleDescRsp,
-		kEvent_ZclAttrRead
+		kEvent_ZclAttrRead,
+		kEvent_ZclAttrReport,
+		kEvent_Ready
 	};
 	enum Cluster_t : uint16_t
 	{
@@ -46,6 +66,12 @@ public:
 	{
 		kOnOffAttr_OnOff = 0x0000
 	};
+	/* On/Off cluster command identifiers */
+	enum OnOffCmd_t : uint16_t
+	{
+		kOnOffCmd_Off = 0x00,
+		kOnOffCmd_On = 0x01
+	};
 	enum ZclAttrType_t : uint8_t
 	{
 		kZclAttrType_BOOL = 0x10
@@ -62,6 +88,7 @@ public:
 	};
 	struct ZclEvent {
 		uint16_t addr;
+		/* 0 for a report, any endpoint of the device */
 		uint8_t ep;
 		uint16_t cluster_id;
 		uint16_t attr_id;
@@ -69,16 +96,67 @@ public:
 		char value[ZB_ZCL_MAX_ATTR_SIZE + 1];
 		size_t len;
 	};
-	union {
-		struct BdbEvent Bdb;
-		struct ZdoEvent Zdo;
-		struct ZclEvent Zcl;
-	} mEvent;
+	/*
+	 * Parsed notification or response, allocated from a fixed pool and
+	 * shared by reference count. A payload passed to the event callback
+	 * is released by the shell when the callback returns, so a receiver
+	 * keeping it must take its own reference.
+	 */
+	struct EventPayload {
+		atomic_t refCount;
+		Event_t type;
+		union {
+			struct BdbEvent Bdb;
+			struct ZdoEvent Zdo;
+			struct ZclEvent Zcl;
+		};
+	};
 
-	typedef void (*zigbee_event_handler_t)(ZigbeeShell *, Event_t);
+	typedef void (*zigbee_event_handler_t)(ZigbeeShell *, EventPayload *);
+
+	/* Transport counters, never reset */
+	struct Stats {
+		uint32_t rxBytes;
+		uint32_t txBytes;
+		/* Time the UART was transmitting, for the TX utilization */
+		uint32_t txBusyUs;
+		/* Commands that waited for a TX buffer still on the line */
+		uint32_t txBufferWaits;
+		uint32_t txAborted;
+		/* Received bytes the parser discarded to resynchronize */
+		uint32_t rxDroppedBytes;
+		/* RX chunks that found the response ring buffer full and waited in their DMA buffer */
+		uint32_t rxOverflows;
+		/* Receiver stopped with all DMA buffers waiting for the parser */
+		uint32_t rxStalls;
+		/* Parser restarts at a line boundary, after bytes lost on the line or a full buffer */
+		uint32_t rxResyncs;
+		uint32_t commands;
+		uint32_t commandErrors;
+		uint32_t commandTimeouts;
+		/* Responses of commands that timed out, dropped when they came */
+		uint32_t commandLateResponses;
+		uint32_t parserErrors;
+		uint32_t eventPoolExhausted;
+		/* Bytes dropped from a DMA buffer given back to the receiver while the ring buffer was full */
+		uint32_t rxOverrunBytes;
+	};
+
+	/* How the NCP was brought up by Start() */
+	struct StartInfo {
+		bool warmStart;
+		uint32_t readyUptimeMs;
+		uint32_t durationMs;
+		/* UART link chosen by the link setup */
+		uint32_t baudRate;
+		bool flowControl;
+		/* Link configurations probed until the NCP answered */
+		uint8_t linkProbes;
+	};
 
 	ZigbeeShell();
-	int BdbStart();
+	int Start();
+	void StartAsync();
 	int NetworkSteering();
 	int ZdoActiveEpReq(uint16_t addr);
 	int ZdoSimpleDescReq(uint16_t addr, uint8_t ep);
@@ -88,6 +166,9 @@ public:
 			uint16_t profile_id,
 			enum Cluster_t cluster_id,
 			uint16_t attr_id);
+	/* Configures the device to report the attribute, -EINVAL when it cannot, -ETIMEDOUT when it did not answer */
+	int ZclSubscribe(uint16_t addr, uint8_t ep, uint16_t profile_id, enum Cluster_t cluster_id, uint16_t attr_id,
+			 enum ZclAttrType_t type, uint16_t min_interval_s, uint16_t max_interval_s);
 	int ZdoMatchDesc(uint16_t dst_addr,
 			 uint16_t req_addr,
 			 uint16_t profile_id,
@@ -96,33 +177,195 @@ public:
 			 uint8_t out_cluster_cnt,
 			 uint16_t *out_clusters);
 	void SetEventCallback(zigbee_event_handler_t zigbee_event_handler);
+	static void RefEvent(EventPayload *payload);
+	static void UnrefEvent(EventPayload *payload);
+	/* Cycle counter when the last command was sent and its response parsed */
+	uint32_t GetCmdTxTimestamp() const { return mZigbeeCmd.txTimestamp; }
+	uint32_t GetCmdDoneTimestamp() const { return mZigbeeCmd.doneTimestamp; }
+	const Stats &GetStats() const { return mStats; }
+	const StartInfo &GetStartInfo() const { return mStartInfo; }
+	/* Time from the UART interrupt to the start of parsing on the RX thread */
+	LatencyHistogram &GetRxWakeLatency() { return mRxWakeLatency; }
 
 private:
+	friend void Bench::RunZigbeeShellBenchmarks(Bench::Runner &runner);
+
 	typedef size_t (*ZigbeeResponseHandler)(ZigbeeShell *shell, const char *data, size_t len);
 
+	/* Command with its CR LF and a terminating NUL */
+	typedef char CmdBuffer[MAX_ZIGBEE_CMD_LEN + 1];
+
 	struct k_sem mCmdSem;
+	/* Given by the RX thread when a response handler returns */
+	struct k_sem mHandlerDoneSem;
 	struct ZigbeeCmd {
-		char command[MAX_ZIGBEE_CMD_LEN + 1];
 		ZigbeeResponseHandler handler;
 		int result;
+		/* Last line of output before "Done", for commands reading a value */
+		char response[MAX_ZIGBEE_CMD_LEN + 1];
+		/* Attribute a ZCL read response belongs to */
+		struct ZclEvent zclRead;
+		uint32_t txTimestamp;
+		uint32_t doneTimestamp;
+		/* Bytes of an unfinished response its handler already reported */
+		size_t streamed;
+		/* Tags the command, a response parsed for an older one does not complete it */
+		uint32_t seq;
+		/* Sent and its response not complete yet */
+		bool pending;
+		/* Its response handler runs on the RX thread */
+		bool running;
+		/* Part of the response was lost, it completes with -EIO */
+		bool lost;
+		/* Commands timed out, their output is dropped up to the status line ending it */
+		uint32_t stale;
 	};
 	struct ZigbeeCmd mZigbeeCmd;
+	/* No late response is waited for once the NCP output before was cut or flushed */
+	void ForgetStale();
+	/* Parsers and command formatting only, without UART and threads, for the benchmarks */
+	struct Detached {};
+	explicit ZigbeeShell(Detached);
+
+	/*
+	 * The UART receives into DMA buffers handed to the driver in turn. The
+	 * bytes of a buffer are copied into mShellRspRb as it has room, and the
+	 * buffer is handed out again once released by the driver and copied.
+	 * When all buffers wait for the parser with flow control, the buffer
+	 * request is left unanswered and the receiver stops, holding the NCP
+	 * off with RTS. Without flow control the oldest buffer is given back
+	 * with its bytes dropped instead, so the receiver always has one. Bytes
+	 * dropped, or lost on a receive error, leave a kRxGap byte in their
+	 * place.
+	 */
+	struct RxBufState {
+		uint16_t received;
+		uint16_t stored;
+		bool released;
+		/* Bytes were lost on the line before the ones of this buffer */
+		bool gapBefore;
+	};
+	static constexpr char kRxGap = 0x18;
+
 	const struct device *mUartDev;
-	uint8_t *mNextUartBuf;
-	uint8_t mUartRxBuf[UART_RX_BUF_NUM][UART_BUF_SIZE];
+	uint8_t mUartRxBuf[CONFIG_ZIGBEE_SHELL_RX_BUF_COUNT][CONFIG_ZIGBEE_SHELL_RX_BUF_SIZE];
+	RxBufState mRxBufState[CONFIG_ZIGBEE_SHELL_RX_BUF_COUNT];
+	/* Sequence numbers of the oldest buffer in use and the next one to hand out */
+	uint32_t mRxHead;
+	uint32_t mRxTail;
+	bool mRxEnabled;
+	bool mRxStarved;
+	bool mRxLoss;
+	bool mRxFlowControl;
+	/* The parser skips to the next line after a gap */
+	bool mRxResync;
 	struct ring_buf mShellRspRb;
 	static void UartCallback(const struct device *dev, struct uart_event *evt, void *user_data);
+	void RxProvideBuffer();
+	/* Frees the oldest buffer for the receiver, dropping what it holds, false while the driver has it */
+	bool RxReclaim();
+	/* Copies received bytes into the ring buffer, returns their number */
+	size_t RxDrain();
+	/* Releases parsed bytes from the ring buffer and drains the RX buffers into the room made */
+	size_t RxConsume(size_t len);
+	void RxResync(size_t dropped, uint32_t cause);
+
+	/*
+	 * Commands are encoded in TX buffers taken in turn by AcquireTx(), and
+	 * handed to the UART one after the other as the previous one is sent.
+	 * A buffer is taken again only after its UART_TX_DONE, so the next
+	 * command is encoded while the previous one can still be on the line.
+	 */
+	struct TxBuffer {
+		CmdBuffer data;
+		size_t len;
+		/* Not sent whole, the NCP does not answer it */
+		bool aborted;
+	};
+	TxBuffer mTxBuf[CONFIG_ZIGBEE_SHELL_TX_BUF_COUNT];
+	/* Sequence numbers of the buffers sent, handed to the UART and queued */
+	uint32_t mTxDone;
+	uint32_t mTxStarted;
+	uint32_t mTxQueued;
+	uint32_t mTxStartCycles;
+	/* Counts the free TX buffers */
+	struct k_sem mTxFreeSem;
+	CmdBuffer &AcquireTx();
+	void TxStart();
+	void TxComplete(bool aborted);
+
 	uint8_t mShellRspBuffer[UNPARSED_BUF_LEN];
 	char mParserBuffer[UNPARSED_BUF_LEN];
-	static void UartWorkHandler(struct k_work *work);
-	struct k_work mUartWork;
+	static void RxThreadMain(void *arg1, void *arg2, void *arg3);
+	static void StartThreadMain(void *arg1, void *arg2, void *arg3);
+	struct k_thread mStartThread;
+	void ProcessRx();
+	struct k_thread mRxThread;
+	struct k_sem mRxSem;
+	atomic_t mRxWakePending;
+	uint32_t mRxWakeTimestamp;
+	LatencyHistogram mRxWakeLatency;
+
+	/* lineEnd is the end of the last line of the notification */
+	typedef void (ZigbeeShell::*NotificationParser)(const char *marker, const char *lineEnd);
+	struct Notification {
+		ShellMatcher::Marker_t marker;
+		NotificationParser parse;
+		/* Log lines it spans from its marker on */
+		uint8_t lines;
+	};
+	static const Notification sNotifications[];
+	ShellMatcher mMatcher;
+	/* Bytes at the start of the unparsed data whose notifications were dispatched */
+	size_t mNotifiedLen;
+	/* Start of the line of a notification whose last line is still to come, kept unparsed */
+	size_t mIncompleteLen;
 
-	size_t ParseShellMessage(const char * szMsg);
-	int WriteCmd(const char *cmd, ZigbeeResponseHandler cmd_handler);
+	/*
+	 * Dispatches the notifications starting before until, and returns parsed
+	 * moved past the notification lines that directly follow it.
+	 */
+	size_t ParseShellMessage(const char *szMsg, size_t parsed, const char *until);
+	void ParseJoinNetwork(const char *marker, const char *lineEnd);
+	void ParseDeviceAnnounce(const char *marker, const char *lineEnd);
+	void ParseAttrReport(const char *marker, const char *lineEnd);
+	EventPayload *AllocEvent(Event_t type);
+	void NotifyEvent(EventPayload *payload);
+	/* Sends the len bytes encoded in the TX buffer last acquired and waits for the response */
+	int SendCmd(size_t len, ZigbeeResponseHandler cmd_handler,
+		    k_timeout_t timeout = K_MSEC(CONFIG_ZIGBEE_SHELL_CMD_TIMEOUT_MS));
+	template <size_t N>
+	int WriteCmd(const char (&cmd)[N], ZigbeeResponseHandler cmd_handler,
+		     k_timeout_t timeout = K_MSEC(CONFIG_ZIGBEE_SHELL_CMD_TIMEOUT_MS))
+	{
+		return SendCmd(BuildZigbeeCmd(AcquireTx()).Text(cmd).End(), cmd_handler, timeout);
+	}
+	/* Encode the commands with arguments and return their length */
+	static size_t EncodeZdoActiveEpReq(CmdBuffer &cmd, uint16_t addr);
+	static size_t EncodeZdoSimpleDescReq(CmdBuffer &cmd, uint16_t addr, uint8_t ep);
+	static size_t EncodeZclCmd(CmdBuffer &cmd, uint16_t addr, uint8_t ep, uint16_t cluster, uint16_t cmd_id);
+	static size_t EncodeZclAttrRead(CmdBuffer &cmd, uint16_t addr, uint8_t ep, uint16_t profile_id,
+					uint16_t cluster_id, uint16_t attr_id);
+	static size_t EncodeZclSubscribe(CmdBuffer &cmd, uint16_t addr, uint8_t ep, uint16_t profile_id,
+					 uint16_t cluster_id, uint16_t attr_id, uint8_t type, uint16_t min_interval_s,
+					 uint16_t max_interval_s);
+	static size_t EncodeZdoMatchDesc(CmdBuffer &cmd, uint16_t dst_addr, uint16_t req_addr, uint16_t profile_id,
+					 uint8_t in_cluster_cnt, const uint16_t *in_clusters, uint8_t out_cluster_cnt,
+					 const uint16_t *out_clusters);
+	int ConfigureShell();
+	int SetupLink();
+	bool ProbeLink(struct uart_config &config, uint32_t baudRate, bool flowControl);
+	bool ProbeWarmStart();
+	int BdbStart();
 	zigbee_event_handler_t mEvent_CB;
+	Stats mStats = {};
+	StartInfo mStartInfo = {};
 
 	static size_t ShellRspHandler(ZigbeeShell *shell, const char *data, size_t len);
+	/* Whether the response ends on "Done" or "Error" rather than on the prompt */
+	static bool EndsOnStatus(ZigbeeResponseHandler handler) { return handler != ShellRspHandler; }
 	static size_t GeneralRspHandler(ZigbeeShell *shell, const char *data, size_t len);
+	static size_t ValueRspHandler(ZigbeeShell *shell, const char *data, size_t len);
 	static size_t ZdoActiveEpRspHandler(ZigbeeShell *shell, const char *data, size_t len);
 	static size_t ZdoSimpleDescRspHandler(ZigbeeShell *shell, const char *data, size_t len);
 	static size_t ZclAttrReadRspHandler(ZigbeeShell *shell,const char *data, size_t len);
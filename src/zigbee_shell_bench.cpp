@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "bench.h"
+#include "zigbee_shell.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+/* Responses and notifications as the NCP prints them, echo and colors off */
+const char kPromptRsp[] = "\r\nuart:~$ ";
+const char kDoneRsp[] = "Started network steering\r\nDone\r\nuart:~$ ";
+const char kValueRsp[] = "ddeeaabbccdd0011\r\nDone\r\nuart:~$ ";
+const char kActiveEpRsp[] = "src_addr=A1B2 ep=10\r\nDone\r\nuart:~$ ";
+const char kSimpleDescRsp[] = "src_addr=0xa1b2 ep=10 profile_id=0x0104 app_dev_id=0x0101 app_dev_ver=0x1 "
+			      "in_clusters=0x0000,0x0003,0x0004,0x0005,0x0006,0x0008 out_clusters=\r\nDone\r\nuart:~$ ";
+const char kZclAttrReadRsp[] = "ID: 0 Type: 10 Value: True\r\nDone\r\nuart:~$ ";
+const char kDeviceAnnounce[] = "[00:00:12.345,678] <inf> zigbee_app_utils: "
+			       "New device commissioned or rejoined (short: 0xa1b2)\r\n";
+const char kAttrReport[] = "[00:00:12.345,678] <inf> zigbee_shell: Received value updates from the remote node 0xa1b2\r\n"
+			   "[00:00:12.345,679] <inf> zigbee_shell: Profile: 0x0104 Cluster: 0x0006 Attribute: 0x0000 "
+			   "Type: 16 Value: True\r\n";
+
+/* Searched by the simple descriptor handler and the notification parser before the matcher */
+const char *const kStrstrMarkers[] = { ZB_SHELL_MSG_CMD_ERROR,	  ZB_SHELL_MSG_CMD_DONE,      "src_addr=", "ep=",
+				       "app_dev_id=",		  ZB_SHELL_MSG_JOIN_NETWORK, ZB_SHELL_MSG_DEVICE_REJOIN };
+
+/* What WriteCmd() did with a command formatted by sprintf before the command builder */
+size_t SprintfCopy(char *command, const char *cmd)
+{
+	size_t len = strlen(cmd);
+
+	memset(command, 0, MAX_ZIGBEE_CMD_LEN + 1);
+	memcpy(command, cmd, len);
+	command[len] = '\r';
+	command[len + 1] = '\n';
+
+	return len + 2;
+}
+
+void DropEvent(ZigbeeShell *shell, ZigbeeShell::EventPayload *payload)
+{
+	ARG_UNUSED(shell);
+	Bench::DoNotOptimize(payload->type);
+}
+} /* namespace */
+
+namespace Bench {
+
+void RunZigbeeShellBenchmarks(Runner &runner)
+{
+	/* Events are allocated and released as on the device, then dropped by the callback */
+	static ZigbeeShell shell{ ZigbeeShell::Detached() };
+	char cmd[MAX_ZIGBEE_CMD_LEN];
+	uint16_t clusters[] = { ZigbeeShell::kCluster_OnOff, ZigbeeShell::kCluster_LevelControl, 0, 0 };
+
+	shell.SetEventCallback(DropEvent);
+	shell.mZigbeeCmd.zclRead.addr = 0xa1b2;
+	shell.mZigbeeCmd.zclRead.ep = 10;
+	shell.mZigbeeCmd.zclRead.cluster_id = ZigbeeShell::kCluster_OnOff;
+
+	/* A response handler with the marker scan it relies on, as run by ProcessRx() */
+	auto parse = [&](size_t (*handler)(ZigbeeShell *, const char *, size_t), const char *data, size_t len) {
+		shell.mMatcher.Scan(data, len);
+		DoNotOptimize(handler(&shell, data, len));
+	};
+
+	runner.Run("parse.shell_prompt",
+		   [&] { parse(ZigbeeShell::ShellRspHandler, kPromptRsp, sizeof(kPromptRsp) - 1); });
+	runner.Run("parse.general", [&] { parse(ZigbeeShell::GeneralRspHandler, kDoneRsp, sizeof(kDoneRsp) - 1); });
+	runner.Run("parse.value", [&] { parse(ZigbeeShell::ValueRspHandler, kValueRsp, sizeof(kValueRsp) - 1); });
+	runner.Run("parse.zdo_active_ep",
+		   [&] { parse(ZigbeeShell::ZdoActiveEpRspHandler, kActiveEpRsp, sizeof(kActiveEpRsp) - 1); });
+	runner.Run("parse.zdo_simple_desc",
+		   [&] { parse(ZigbeeShell::ZdoSimpleDescRspHandler, kSimpleDescRsp, sizeof(kSimpleDescRsp) - 1); });
+	runner.Run("parse.zcl_attr_read",
+		   [&] { parse(ZigbeeShell::ZclAttrReadRspHandler, kZclAttrReadRsp, sizeof(kZclAttrReadRsp) - 1); });
+
+	/* Every RX chunk is also scanned for notifications, and offsets are taken in the parser buffer */
+	strcpy(shell.mParserBuffer, kZclAttrReadRsp);
+	runner.Run("parse.notification_none", [&] {
+		shell.mMatcher.Scan(shell.mParserBuffer, sizeof(kZclAttrReadRsp) - 1);
+		shell.mNotifiedLen = 0;
+		DoNotOptimize(
+			shell.ParseShellMessage(shell.mParserBuffer, 0, shell.mParserBuffer + sizeof(kZclAttrReadRsp) - 1));
+	});
+	strcpy(shell.mParserBuffer, kDeviceAnnounce);
+	runner.Run("parse.device_announce", [&] {
+		shell.mMatcher.Scan(shell.mParserBuffer, sizeof(kDeviceAnnounce) - 1);
+		shell.mNotifiedLen = 0;
+		DoNotOptimize(
+			shell.ParseShellMessage(shell.mParserBuffer, 0, shell.mParserBuffer + sizeof(kDeviceAnnounce) - 1));
+	});
+	strcpy(shell.mParserBuffer, kAttrReport);
+	runner.Run("parse.attr_report", [&] {
+		shell.mMatcher.Scan(shell.mParserBuffer, sizeof(kAttrReport) - 1);
+		shell.mNotifiedLen = 0;
+		DoNotOptimize(
+			shell.ParseShellMessage(shell.mParserBuffer, 0, shell.mParserBuffer + sizeof(kAttrReport) - 1));
+	});
+
+	/* Markers of a simple descriptor response: one automaton pass, and one strstr per marker before it */
+	runner.Run("scan.simple_desc", [&] {
+		shell.mMatcher.Scan(kSimpleDescRsp, sizeof(kSimpleDescRsp) - 1);
+		DoNotOptimize(shell.mMatcher.Count());
+	});
+	runner.Run("scan_strstr.simple_desc", [&] {
+		for (const char *marker : kStrstrMarkers) {
+			DoNotOptimize(strstr(kSimpleDescRsp, marker));
+		}
+	});
+
+	/* RX thread work for one response: ring buffer, response handler and notification scan */
+	shell.mZigbeeCmd.handler = ZigbeeShell::ZclAttrReadRspHandler;
+	runner.Run("rx.process_zcl_attr_read", [&] {
+		shell.mZigbeeCmd.pending = true;
+		ring_buf_put(&shell.mShellRspRb, reinterpret_cast<const uint8_t *>(kZclAttrReadRsp),
+			     sizeof(kZclAttrReadRsp) - 1);
+		shell.ProcessRx();
+	});
+	shell.mZigbeeCmd.handler = nullptr;
+
+	/* Command text written into the TX buffer, as sent by SendCmd() */
+	runner.Run("format.zdo_active_ep", [&] {
+		DoNotOptimize(ZigbeeShell::EncodeZdoActiveEpReq(shell.mTxBuf[0].data, 0xa1b2));
+	});
+	runner.Run("format.zdo_simple_desc", [&] {
+		DoNotOptimize(ZigbeeShell::EncodeZdoSimpleDescReq(shell.mTxBuf[0].data, 0xa1b2, 10));
+	});
+	runner.Run("format.zcl_cmd", [&] {
+		DoNotOptimize(ZigbeeShell::EncodeZclCmd(shell.mTxBuf[0].data, 0xa1b2, 10, ZigbeeShell::kCluster_OnOff,
+							ZigbeeShell::kOnOffCmd_On));
+	});
+	runner.Run("format.zcl_attr_read", [&] {
+		DoNotOptimize(ZigbeeShell::EncodeZclAttrRead(shell.mTxBuf[0].data, 0xa1b2, 10, 0x0104,
+							     ZigbeeShell::kCluster_OnOff, ZigbeeShell::kOnOffAttr_OnOff));
+	});
+	runner.Run("format.zcl_subscribe", [&] {
+		DoNotOptimize(ZigbeeShell::EncodeZclSubscribe(shell.mTxBuf[0].data, 0xa1b2, 10, 0x0104,
+							      ZigbeeShell::kCluster_OnOff, ZigbeeShell::kOnOffAttr_OnOff,
+							      ZigbeeShell::kZclAttrType_BOOL, 0, 300));
+	});
+	runner.Run("format.zdo_match_desc", [&] {
+		DoNotOptimize(ZigbeeShell::EncodeZdoMatchDesc(shell.mTxBuf[0].data, 0xfffd, 0xfffd, 0x0104, 2,
+							      clusters, 0, clusters));
+	});
+
+	/* Baseline: sprintf into a stack buffer, then copied into the TX buffer */
+	runner.Run("format_sprintf.zdo_active_ep", [&] {
+		sprintf(cmd, "zdo active_ep 0x%04hx", 0xa1b2);
+		DoNotOptimize(SprintfCopy(shell.mTxBuf[0].data, cmd));
+	});
+	runner.Run("format_sprintf.zdo_simple_desc", [&] {
+		sprintf(cmd, "zdo simple_desc_req 0x%04hx %d", 0xa1b2, 10);
+		DoNotOptimize(SprintfCopy(shell.mTxBuf[0].data, cmd));
+	});
+	runner.Run("format_sprintf.zcl_cmd", [&] {
+		sprintf(cmd, "zcl cmd -d 0x%04hx %d 0x%04hx 0x%04hx", 0xa1b2, 10, ZigbeeShell::kCluster_OnOff,
+			ZigbeeShell::kOnOffCmd_On);
+		DoNotOptimize(SprintfCopy(shell.mTxBuf[0].data, cmd));
+	});
+	runner.Run("format_sprintf.zcl_attr_read", [&] {
+		sprintf(cmd, "zcl attr read 0x%04hx %d 0x%04hx 0x%04hx 0x%04hx", 0xa1b2, 10, ZigbeeShell::kCluster_OnOff,
+			0x0104, ZigbeeShell::kOnOffAttr_OnOff);
+		DoNotOptimize(SprintfCopy(shell.mTxBuf[0].data, cmd));
+	});
+	runner.Run("format_sprintf.zdo_match_desc", [&] {
+		char in_cluster_str[32], out_cluster_str[32];
+
+		memset(cmd, 0, sizeof(cmd));
+		memset(in_cluster_str, 0, sizeof(in_cluster_str));
+		memset(out_cluster_str, 0, sizeof(out_cluster_str));
+		for (int i = 0; i < 2; i++) {
+			sprintf(in_cluster_str + strlen(in_cluster_str), "%hx ", clusters[i]);
+		}
+		sprintf(cmd, "zdo match_desc 0x%04hx 0x%04hx 0x%04hx %d %s %d %s -t 5", 0xfffd, 0xfffd, 0x0104, 2,
+			in_cluster_str, 0, out_cluster_str);
+		DoNotOptimize(SprintfCopy(shell.mTxBuf[0].data, cmd));
+	});
+}
+
+} /* namespace Bench */